@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint64_t benchmark_now_ns();
+
+void benchmark_report(const char *name, uint64_t elapsed_ns,
+                      size_t operations);
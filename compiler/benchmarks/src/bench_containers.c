@@ -0,0 +1,109 @@
+#include "allocator.h"
+#include "array.h"
+#include "benchmark.h"
+#include "hash_map.h"
+#include "small_vector.h"
+#include "stack_allocator.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef Array(uint32_t) Uint32Array;
+
+typedef SmallVector(uint32_t, 4) SmallUint32s;
+
+bool uint64_equal(uint64_t a, uint64_t b) { return a == b; }
+
+DEFINE_HASH_MAP(Uint64Map, uint64_map, uint64_t, uint64_t, hash_integer,
+                uint64_equal)
+
+uint64_t checksum;
+
+void bench_array_push(const char *name, StackAllocator *stack, bool in_place,
+                      size_t count) {
+  stack_allocator_reset(stack);
+  Allocator allocator = {.allocate = stack_allocate,
+                         .resize = in_place ? stack_resize : nullptr,
+                         .state = stack};
+  uint64_t begin = benchmark_now_ns();
+  Uint32Array array = {};
+  for (uint32_t i = 0; i < count; ++i) {
+    array_push(allocator, &array, i);
+  }
+  benchmark_report(name, benchmark_now_ns() - begin, count);
+  checksum += array.data[count / 2];
+}
+
+void bench_short_lists(StackAllocator *stack, size_t lists) {
+  stack_allocator_reset(stack);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = stack};
+  uint64_t begin = benchmark_now_ns();
+  for (uint32_t i = 0; i < lists; ++i) {
+    Uint32Array array = {};
+    for (uint32_t j = 0; j < 3; ++j) {
+      array_push(allocator, &array, i + j);
+    }
+    checksum += array.data[2];
+  }
+  benchmark_report("array/three_element_lists", benchmark_now_ns() - begin,
+                   lists);
+  stack_allocator_reset(stack);
+  begin = benchmark_now_ns();
+  for (uint32_t i = 0; i < lists; ++i) {
+    SmallUint32s vector = {};
+    for (uint32_t j = 0; j < 3; ++j) {
+      small_vector_push(allocator, &vector, i + j);
+    }
+    checksum += small_vector_data(&vector)[2];
+  }
+  benchmark_report("small_vector/three_element_lists",
+                   benchmark_now_ns() - begin, lists);
+}
+
+void bench_hash_map(StackAllocator *stack, size_t count) {
+  stack_allocator_reset(stack);
+  Allocator allocator = {.allocate = stack_allocate, .state = stack};
+  uint64_t *keys = stack_allocate(stack, count * sizeof(uint64_t), 8);
+  for (size_t i = 0; i < count; ++i) {
+    keys[i] = hash_integer(i + 1);
+  }
+  Uint64Map map = {};
+  uint64_t begin = benchmark_now_ns();
+  for (size_t i = 0; i < count; ++i) {
+    map_insert(uint64_map, allocator, &map, keys[i], i);
+  }
+  benchmark_report("hash_map/insert", benchmark_now_ns() - begin, count);
+  begin = benchmark_now_ns();
+  for (size_t i = 0; i < count; ++i) {
+    checksum += *uint64_map_find(&map, keys[(i * 7919) % count]);
+  }
+  benchmark_report("hash_map/find_hit", benchmark_now_ns() - begin, count);
+  begin = benchmark_now_ns();
+  for (size_t i = 0; i < count; ++i) {
+    checksum += uint64_map_find(&map, ~keys[i]) == nullptr;
+  }
+  benchmark_report("hash_map/find_miss", benchmark_now_ns() - begin, count);
+  Uint64Map reserved = {};
+  hash_map_reserve(allocator, &reserved.map, &uint64_map_layout, count);
+  begin = benchmark_now_ns();
+  for (size_t i = 0; i < count; ++i) {
+    map_insert(uint64_map, allocator, &reserved, keys[i], i);
+  }
+  benchmark_report("hash_map/insert_reserved", benchmark_now_ns() - begin,
+                   count);
+}
+
+int32_t main(int32_t argc, char *argv[]) {
+  size_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1 << 20;
+  StackAllocator stack;
+  stack_allocator_init(&stack, count * 160 + (1 << 20));
+  bench_array_push("array/push_resize_in_place", &stack, true, count);
+  bench_array_push("array/push_copy_on_growth", &stack, false, count);
+  bench_short_lists(&stack, count);
+  bench_hash_map(&stack, count);
+  stack_allocator_destroy(&stack);
+  printf("checksum %llu\n", (unsigned long long)checksum);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+#include "benchmark.h"
+#include "parser.h"
+#include "stack_allocator.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+  char *data;
+  size_t length;
+  size_t declarations;
+} Corpus;
+
+Corpus generate_corpus(size_t declarations) {
+  const char *types[] = {"f32", "f64", "i32", "i64"};
+  size_t capacity = declarations * 32;
+  char *data = malloc(capacity);
+  size_t length = 0;
+  for (size_t i = 0; i < declarations; ++i) {
+    const char *type = types[i % 4];
+    if (i % 2 == 0) {
+      length += snprintf(data + length, capacity - length, "%s x%zu = %zu\n",
+                         type, i, i * 7919 % 100000);
+    } else {
+      length += snprintf(data + length, capacity - length,
+                         "%s x%zu = %zu.%zu\n", type, i, i % 1000, i % 97);
+    }
+  }
+  return (Corpus){.data = data, .length = length, .declarations = declarations};
+}
+
+size_t greatest_common_divisor(size_t a, size_t b) {
+  while (b != 0) {
+    size_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+typedef struct {
+  uint64_t parse_ns;
+  uint64_t walk_ns;
+  uint64_t checksum;
+  PageKind pages;
+} RunResult;
+
+RunResult parse_and_walk(const Corpus *corpus, bool huge_pages) {
+  StackAllocator stack;
+  size_t arena_size = corpus->declarations * 4 * sizeof(Expression) + (1 << 20);
+  if (huge_pages) {
+    stack_allocator_init_huge_pages(&stack, arena_size);
+  } else {
+    stack_allocator_init(&stack, arena_size);
+  }
+  Parser parser = {
+      .allocator = {.allocate = stack_allocate, .state = &stack},
+  };
+  Expression *expressions =
+      stack_allocate(&stack, corpus->declarations * sizeof(Expression),
+                     _Alignof(Expression));
+  uint64_t begin = benchmark_now_ns();
+  Cursor cursor = {.input = corpus->data};
+  for (size_t i = 0; i < corpus->declarations; ++i) {
+    ParseExpressionResult result = parse_expression(&parser, cursor);
+    expressions[i] = result.expression;
+    cursor = result.cursor;
+  }
+  uint64_t parsed = benchmark_now_ns();
+  // Visit declarations in a scattered order so the walk is dominated by
+  // address translation rather than sequential prefetching.
+  size_t stride = 7919 * 131;
+  while (greatest_common_divisor(stride, corpus->declarations) != 1) {
+    stride += 1;
+  }
+  uint64_t checksum = 0;
+  size_t index = 0;
+  for (size_t i = 0; i < corpus->declarations; ++i) {
+    Assign assign = expressions[index].value.assign;
+    checksum += assign.type->value.symbol.view.length;
+    checksum += assign.name.view.length;
+    checksum += assign.value->kind == IntExpression
+                    ? assign.value->value.int_.view.length
+                    : assign.value->value.float_.view.length;
+    index = (index + stride) % corpus->declarations;
+  }
+  uint64_t walked = benchmark_now_ns();
+  PageKind pages = stack.pages;
+  stack_allocator_destroy(&stack);
+  return (RunResult){.parse_ns = parsed - begin,
+                     .walk_ns = walked - parsed,
+                     .checksum = checksum,
+                     .pages = pages};
+}
+
+RunResult best_of(const Corpus *corpus, bool huge_pages, size_t repetitions) {
+  RunResult best = parse_and_walk(corpus, huge_pages);
+  for (size_t i = 1; i < repetitions; ++i) {
+    RunResult result = parse_and_walk(corpus, huge_pages);
+    if (result.parse_ns < best.parse_ns) {
+      best.parse_ns = result.parse_ns;
+    }
+    if (result.walk_ns < best.walk_ns) {
+      best.walk_ns = result.walk_ns;
+    }
+  }
+  return best;
+}
+
+int32_t main(int32_t argc, char *argv[]) {
+  size_t declarations = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1 << 20;
+  Corpus corpus = generate_corpus(declarations);
+  printf("corpus: %zu declarations, %.1f MiB of source\n", declarations,
+         corpus.length / (double)(1 << 20));
+  printf("%-32s %14s %16s %16s\n", "pages", "parse MiB/s", "parse ns/decl",
+         "walk ns/decl");
+  bool modes[] = {false, true};
+  for (size_t i = 0; i < 2; ++i) {
+    RunResult result = best_of(&corpus, modes[i], 3);
+    printf("%-32s %14.1f %16.2f %16.2f\n", page_kind_name(result.pages),
+           corpus.length / (double)(1 << 20) / (result.parse_ns / 1e9),
+           (double)result.parse_ns / declarations,
+           (double)result.walk_ns / declarations);
+    if (result.checksum == 0) {
+      return EXIT_FAILURE;
+    }
+  }
+  free(corpus.data);
+  return EXIT_SUCCESS;
+}
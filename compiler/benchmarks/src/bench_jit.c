@@ -0,0 +1,104 @@
+#include "benchmark.h"
+#include "bytecode.h"
+#include "constant_fold.h"
+#include "jit.h"
+#include "lower.h"
+#include "stack_allocator.h"
+#include "vm.h"
+#include "x64.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Small enough to be typical of a quick edit-run loop. Nothing is folded
+// away because the divisor is only known to be nonzero at run time.
+static const char *source = "i64 width = 640\n"
+                            "i64 height = 480\n"
+                            "i64 pixels = width * height\n"
+                            "i64 zero = width - width\n"
+                            "i64 tiles = pixels / (64 + zero)\n"
+                            "f64 scale = 1.5\n"
+                            "f64 area = scale * scale * 3.25 % 2\n"
+                            "bool large = area > 1\n"
+                            "i64 result = tiles % 1000 + width / (height + "
+                            "zero)\n";
+
+uint64_t checksum;
+
+typedef struct {
+  Interner interner;
+  TypeTable types;
+  Analyzer analyzer;
+  IrFunction function;
+} Frontend;
+
+void compile_frontend(Allocator allocator, Frontend *frontend) {
+  interner_init(&frontend->interner, allocator);
+  type_table_init(&frontend->types, allocator);
+  analyzer_init(&frontend->analyzer, allocator, &frontend->interner,
+                &frontend->types);
+  Parser parser = {.allocator = allocator};
+  Module module = parse_module(&parser, (Cursor){.input = source}).module;
+  analyze_module(&frontend->analyzer, module);
+  frontend->function = lower_module(&frontend->analyzer, module);
+  fold_constants(allocator, &frontend->function, &frontend->types);
+}
+
+void bench_jit(StackAllocator *stack, Allocator allocator, size_t runs) {
+  uint64_t begin = benchmark_now_ns();
+  for (size_t i = 0; i < runs; ++i) {
+    stack_allocator_reset(stack);
+    Frontend frontend;
+    compile_frontend(allocator, &frontend);
+    X64CompileResult compiled =
+        x64_compile(allocator, &frontend.function, &frontend.types);
+    JitFunction jit = jit_load(&compiled.code);
+    uint64_t value = 0;
+    jit.entry(&value);
+    checksum += value;
+    jit_release(&jit);
+  }
+  benchmark_report("jit/time_to_first_execution", benchmark_now_ns() - begin,
+                   runs);
+  stack_allocator_reset(stack);
+  Frontend frontend;
+  compile_frontend(allocator, &frontend);
+  X64CompileResult compiled =
+      x64_compile(allocator, &frontend.function, &frontend.types);
+  begin = benchmark_now_ns();
+  for (size_t i = 0; i < runs; ++i) {
+    JitFunction jit = jit_load(&compiled.code);
+    uint64_t value = 0;
+    jit.entry(&value);
+    checksum += value;
+    jit_release(&jit);
+  }
+  benchmark_report("jit/map_and_call", benchmark_now_ns() - begin, runs);
+}
+
+void bench_vm(StackAllocator *stack, Allocator allocator, size_t runs) {
+  uint64_t begin = benchmark_now_ns();
+  for (size_t i = 0; i < runs; ++i) {
+    stack_allocator_reset(stack);
+    Frontend frontend;
+    compile_frontend(allocator, &frontend);
+    BytecodeFunction bytecode =
+        compile_bytecode(allocator, &frontend.function, &frontend.types);
+    uint64_t registers[64];
+    checksum += vm_run(&bytecode, registers).value;
+  }
+  benchmark_report("vm/time_to_first_execution", benchmark_now_ns() - begin,
+                   runs);
+}
+
+int main() {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 20);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  bench_jit(&stack, allocator, 20000);
+  bench_vm(&stack, allocator, 20000);
+  printf("checksum %llu\n", (unsigned long long)checksum);
+  stack_allocator_destroy(&stack);
+  return EXIT_SUCCESS;
+}
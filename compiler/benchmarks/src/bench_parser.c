@@ -0,0 +1,84 @@
+#include "benchmark.h"
+#include "parser.h"
+#include "stack_allocator.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// "[]i64 xs = [0, 1, ...]" with count literals, grouped in rows of width
+// when width is not zero.
+char *data_table(size_t count, size_t width) {
+  char *source = malloc(count * 24 + 64);
+  if (source == nullptr) {
+    abort();
+  }
+  char *out = source;
+  out += sprintf(out, width == 0 ? "[]i64 xs = [" : "[][]i64 xs = [");
+  for (size_t i = 0; i < count; ++i) {
+    if (width != 0 && i % width == 0) {
+      out += sprintf(out, "[");
+    }
+    out += sprintf(out, "%zu", i);
+    if (width != 0 && (i + 1 == count || (i + 1) % width == 0)) {
+      out += sprintf(out, "]");
+    }
+    out += sprintf(out, i + 1 == count ? "]\n" : ", ");
+  }
+  return source;
+}
+
+// count lines of "f(g(i, 1), h(2, 3, 4))", three calls each.
+char *call_lines(size_t count) {
+  char *source = malloc(count * 48 + 1);
+  if (source == nullptr) {
+    abort();
+  }
+  char *out = source;
+  for (size_t i = 0; i < count; ++i) {
+    out += sprintf(out, "f(g(%zu, 1), h(2, 3, 4))\n", i);
+  }
+  return source;
+}
+
+int main() {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1ull << 31);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  // Time per literal should stay flat as tables grow.
+  for (size_t count = 100000; count <= 1600000; count *= 2) {
+    for (size_t width = 0; width <= 16; width += 16) {
+      char *source = data_table(count, width);
+      stack_allocator_reset(&stack);
+      Parser parser = {.allocator = allocator};
+      uint64_t begin = benchmark_now_ns();
+      Module module = parse_module(&parser, (Cursor){.input = source}).module;
+      char name[64];
+      snprintf(name, sizeof(name), "parser/array_literal/%s/%zu",
+               width == 0 ? "flat" : "rows", count);
+      benchmark_report(name, benchmark_now_ns() - begin, count);
+      if (module.length != 1) {
+        abort();
+      }
+      free(source);
+    }
+  }
+  // Argument lists are copied out of the scratch stack once, so time per
+  // call should not depend on how deeply calls nest.
+  for (size_t count = 100000; count <= 800000; count *= 2) {
+    char *source = call_lines(count);
+    stack_allocator_reset(&stack);
+    Parser parser = {.allocator = allocator};
+    uint64_t begin = benchmark_now_ns();
+    Module module = parse_module(&parser, (Cursor){.input = source}).module;
+    char name[64];
+    snprintf(name, sizeof(name), "parser/calls/%zu", count);
+    benchmark_report(name, benchmark_now_ns() - begin, count * 3);
+    if (module.length != count) {
+      abort();
+    }
+    free(source);
+  }
+  stack_allocator_destroy(&stack);
+  return EXIT_SUCCESS;
+}
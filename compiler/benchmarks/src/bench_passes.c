@@ -0,0 +1,68 @@
+#include "benchmark.h"
+#include "dead_code.h"
+#include "ir.h"
+#include "stack_allocator.h"
+#include "value_numbering.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Straight-line arithmetic over eight parameters where half of the
+// instructions recompute an earlier one and a quarter are never used,
+// built directly as IR to reach sizes the front end is slow to parse.
+IrFunction redundant_function(Allocator allocator, size_t length) {
+  static const IrOpcode opcodes[] = {AddOp, SubOp, MulOp};
+  IrFunction function = {.return_type = I64TypeId};
+  for (uint32_t i = 0; i < 8; ++i) {
+    ir_param(allocator, &function, I64TypeId);
+  }
+  uint64_t state = 0x9e3779b97f4a7c15ull;
+  IrValue last = 0;
+  while (function.instructions.length < length) {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    uint32_t count = (uint32_t)function.instructions.length;
+    IrValue left = (IrValue)((state >> 33) % count);
+    IrValue right = (IrValue)((state >> 13) % count);
+    IrOpcode opcode = opcodes[(state >> 60) % 3];
+    IrValue value =
+        ir_binary(allocator, &function, opcode, I64TypeId, left, right);
+    ir_binary(allocator, &function, opcode, I64TypeId, left, right);
+    // Every other pair is left without users of its own.
+    if ((state >> 62) & 1) {
+      last = ir_binary(allocator, &function, AddOp, I64TypeId, last, value);
+    }
+  }
+  ir_return(allocator, &function, last);
+  ir_end_block(allocator, &function);
+  return function;
+}
+
+int main() {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1ull << 30);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  TypeTable types;
+  type_table_init(&types, allocator);
+  // Time per instruction should stay flat as functions grow.
+  for (size_t length = 100000; length <= 1600000; length *= 2) {
+    stack_allocator_reset(&stack);
+    type_table_init(&types, allocator);
+    IrFunction function = redundant_function(allocator, length);
+    size_t before = function.instructions.length;
+    char name[64];
+    uint64_t begin = benchmark_now_ns();
+    ValueNumberingStats numbered = number_values(allocator, &function, &types);
+    snprintf(name, sizeof(name), "passes/number_values/%zu", before);
+    benchmark_report(name, benchmark_now_ns() - begin, before);
+    size_t middle = function.instructions.length;
+    begin = benchmark_now_ns();
+    DeadCodeStats dead = eliminate_dead_code(allocator, &function, &types);
+    snprintf(name, sizeof(name), "passes/eliminate_dead_code/%zu", middle);
+    benchmark_report(name, benchmark_now_ns() - begin, middle);
+    printf("  %zu redundant, %zu dead, %zu left\n", numbered.removed,
+           dead.removed, function.instructions.length);
+  }
+  stack_allocator_destroy(&stack);
+  return EXIT_SUCCESS;
+}
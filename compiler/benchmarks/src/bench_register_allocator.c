@@ -0,0 +1,137 @@
+#include "benchmark.h"
+#include "jit.h"
+#include "lower.h"
+#include "register_allocator.h"
+#include "stack_allocator.h"
+#include "x64.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Kernels are compiled without constant folding, which would otherwise
+// reduce them to their result, so every instruction runs on each call.
+
+uint64_t checksum;
+
+typedef struct {
+  const char *name;
+  const RegisterFile *file;
+} Allocation;
+
+static const Allocation allocations[] = {
+    {.name = "spill_everything", .file = &(const RegisterFile){}},
+    {.name = "linear_scan", .file = &x64_registers},
+};
+
+// A chain where every step also reads a value defined long before, so a
+// growing set of values stays live.
+char *integer_chain(size_t bindings) {
+  size_t capacity = bindings * 64;
+  char *source = malloc(capacity);
+  size_t length = snprintf(source, capacity, "i64 x0 = 3\n");
+  for (size_t i = 1; i < bindings; ++i) {
+    length += snprintf(source + length, capacity - length,
+                       "i64 x%zu = x%zu * 3 + x%zu - %zu\n", i, i - 1, i / 2,
+                       i);
+  }
+  return source;
+}
+
+// Sixteen live accumulators, more than there are registers to hold them,
+// folded together at the end.
+char *wide_reduction(size_t rounds) {
+  size_t capacity = (rounds + 2) * 16 * 48;
+  char *source = malloc(capacity);
+  size_t length = 0;
+  for (size_t j = 0; j < 16; ++j) {
+    length += snprintf(source + length, capacity - length,
+                       "f64 a%zu_0 = %zu.5\n", j, j);
+  }
+  for (size_t i = 1; i <= rounds; ++i) {
+    for (size_t j = 0; j < 16; ++j) {
+      length += snprintf(source + length, capacity - length,
+                         "f64 a%zu_%zu = a%zu_%zu * 0.5 + a%zu_%zu\n", j, i,
+                         j, i - 1, (j + 1) % 16, i - 1);
+    }
+  }
+  length += snprintf(source + length, capacity - length, "f64 sum = a0_%zu",
+                     rounds);
+  for (size_t j = 1; j < 16; ++j) {
+    length += snprintf(source + length, capacity - length, " + a%zu_%zu", j,
+                       rounds);
+  }
+  snprintf(source + length, capacity - length, "\n");
+  return source;
+}
+
+// Float remainders call into libm, splitting whatever is live across them.
+char *calls_in_a_loop_body(size_t bindings) {
+  size_t capacity = bindings * 96;
+  char *source = malloc(capacity);
+  size_t length =
+      snprintf(source, capacity, "f64 x0 = 7.5\ni64 n0 = 11\n");
+  for (size_t i = 1; i < bindings; ++i) {
+    length += snprintf(
+        source + length, capacity - length,
+        "f64 x%zu = x%zu %% 3 + x%zu\ni64 n%zu = n%zu * 5 - n%zu\n", i, i - 1,
+        i / 2, i, i - 1, i / 2);
+  }
+  return source;
+}
+
+void bench_kernel(StackAllocator *stack, Allocator allocator,
+                  const char *kernel, char *source, size_t runs) {
+  for (size_t i = 0; i < sizeof(allocations) / sizeof(allocations[0]); ++i) {
+    stack_allocator_reset(stack);
+    Interner interner;
+    interner_init(&interner, allocator);
+    TypeTable types;
+    type_table_init(&types, allocator);
+    Analyzer analyzer;
+    analyzer_init(&analyzer, allocator, &interner, &types);
+    Parser parser = {.allocator = allocator};
+    Module module = parse_module(&parser, (Cursor){.input = source}).module;
+    analyze_module(&analyzer, module);
+    IrFunction function = lower_module(&analyzer, module);
+    X64CompileResult compiled = x64_compile_with_registers(
+        allocator, &function, &types, allocations[i].file);
+    JitFunction jit = jit_load(&compiled.code);
+    uint64_t begin = benchmark_now_ns();
+    for (size_t run = 0; run < runs; ++run) {
+      uint64_t value = 0;
+      jit.entry(&value);
+      checksum += value;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "regalloc/%s/%s", kernel,
+             allocations[i].name);
+    benchmark_report(name, benchmark_now_ns() - begin, runs);
+    RegisterAllocation registers = compiled.registers;
+    printf("  %zu instructions, %u spilled, %u split, %u slots, "
+           "%zu code bytes\n",
+           function.instructions.length, registers.spill_count,
+           registers.split_count, registers.slot_count,
+           compiled.code.bytes.length);
+    jit_release(&jit);
+  }
+  free(source);
+}
+
+int main() {
+#ifndef __x86_64__
+  printf("register allocation benchmarks need x86-64\n");
+  return EXIT_SUCCESS;
+#endif
+  StackAllocator stack;
+  stack_allocator_init(&stack, 64 << 20);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  bench_kernel(&stack, allocator, "integer_chain", integer_chain(2000),
+               100000);
+  bench_kernel(&stack, allocator, "wide_reduction", wide_reduction(100),
+               100000);
+  bench_kernel(&stack, allocator, "calls", calls_in_a_loop_body(500), 20000);
+  printf("checksum %llu\n", (unsigned long long)checksum);
+  stack_allocator_destroy(&stack);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+#include "benchmark.h"
+#include "concurrent_arena.h"
+#include "trace.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <threads.h>
+
+enum { EVENTS_PER_THREAD = 1000000 };
+
+int32_t record_events(void *state) {
+  TraceThread thread;
+  trace_thread_init(&thread, state);
+  for (uint64_t i = 0; i < EVENTS_PER_THREAD; ++i) {
+    trace_event(&thread, "parse", "bench.yeti", i, i + 1);
+  }
+  return 0;
+}
+
+int main() {
+  // Threads never share a buffer, so the total time per event should not
+  // grow as threads are added.
+  for (uint32_t count = 1; count <= 8; count *= 2) {
+    ConcurrentArena arena;
+    concurrent_arena_init(&arena, 1 << 20);
+    Tracer tracer;
+    tracer_init(&tracer,
+                (Allocator){.allocate = concurrent_arena_allocate,
+                            .resize = concurrent_arena_resize,
+                            .state = &arena},
+                4096, 0);
+    thrd_t threads[8];
+    uint64_t begin = benchmark_now_ns();
+    for (uint32_t i = 0; i < count; ++i) {
+      if (thrd_create(&threads[i], record_events, &tracer) != thrd_success) {
+        abort();
+      }
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      thrd_join(threads[i], nullptr);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "trace/record/%u_threads", count);
+    benchmark_report(name, benchmark_now_ns() - begin,
+                     (size_t)count * EVENTS_PER_THREAD);
+    concurrent_arena_destroy(&arena);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+#include "benchmark.h"
+#include "jit.h"
+#include "lower.h"
+#include "stack_allocator.h"
+#include "vectorize.h"
+#include "x64.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Kernels are compiled without constant folding, which would otherwise
+// reduce them to their result, so every instruction runs on each call.
+
+uint64_t checksum;
+
+typedef struct {
+  const char *name;
+  const VectorTarget *target;
+} Variant;
+
+static const Variant variants[] = {
+    {.name = "scalar"},
+    {.name = "sse2", .target = &sse2_target},
+    {.name = "avx2", .target = &avx2_target},
+};
+
+// Independent chains that advance in lockstep and are summed at the end,
+// the straight-line shape of a loop body unrolled across lanes.
+char *lockstep_chains(const char *type, size_t lanes, size_t rounds) {
+  size_t capacity = (rounds + 2) * lanes * 64;
+  char *source = malloc(capacity);
+  bool is_float = type[0] == 'f';
+  size_t length = 0;
+  for (size_t j = 0; j < lanes; ++j) {
+    length += snprintf(source + length, capacity - length,
+                       is_float ? "%s a%zu_0 = %zu.5\n" : "%s a%zu_0 = %zu\n",
+                       type, j, j);
+  }
+  for (size_t i = 1; i <= rounds; ++i) {
+    for (size_t j = 0; j < lanes; ++j) {
+      length += snprintf(source + length, capacity - length,
+                         is_float ? "%s a%zu_%zu = a%zu_%zu * 0.75 + 1\n"
+                                  : "%s a%zu_%zu = a%zu_%zu * 3 - 1\n",
+                         type, j, i, j, i - 1);
+    }
+  }
+  length += snprintf(source + length, capacity - length, "%s sum = a0_%zu",
+                     type, rounds);
+  for (size_t j = 1; j < lanes; ++j) {
+    length += snprintf(source + length, capacity - length, " + a%zu_%zu", j,
+                       rounds);
+  }
+  snprintf(source + length, capacity - length, "\n");
+  return source;
+}
+
+void bench_kernel(StackAllocator *stack, Allocator allocator,
+                  const char *kernel, char *source, size_t runs) {
+  for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); ++i) {
+    stack_allocator_reset(stack);
+    Interner interner;
+    interner_init(&interner, allocator);
+    TypeTable types;
+    type_table_init(&types, allocator);
+    Analyzer analyzer;
+    analyzer_init(&analyzer, allocator, &interner, &types);
+    Parser parser = {.allocator = allocator};
+    Module module = parse_module(&parser, (Cursor){.input = source}).module;
+    analyze_module(&analyzer, module);
+    IrFunction function = lower_module(&analyzer, module);
+    VectorizeResult vectorized = {};
+    if (variants[i].target != nullptr) {
+      vectorized = vectorize(allocator, &function, variants[i].target);
+    }
+    X64CompileResult compiled = x64_compile(allocator, &function, &types);
+    JitFunction jit = jit_load(&compiled.code);
+    char name[64];
+    snprintf(name, sizeof(name), "vectorize/%s/%s", kernel,
+             variants[i].name);
+    if (jit.entry == nullptr) {
+      printf("%s: host lacks the extensions, skipped\n", name);
+      continue;
+    }
+    uint64_t begin = benchmark_now_ns();
+    for (size_t run = 0; run < runs; ++run) {
+      uint64_t value[4] = {};
+      jit.entry(value);
+      checksum += value[0];
+    }
+    benchmark_report(name, benchmark_now_ns() - begin, runs);
+    printf("  %zu instructions, %u groups vectorized, %zu code bytes\n",
+           function.instructions.length, vectorized.vectorized,
+           compiled.code.bytes.length);
+    jit_release(&jit);
+  }
+  free(source);
+}
+
+int main() {
+#ifndef __x86_64__
+  printf("vectorize benchmarks need x86-64\n");
+  return EXIT_SUCCESS;
+#endif
+  StackAllocator stack;
+  stack_allocator_init(&stack, 64 << 20);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  bench_kernel(&stack, allocator, "f32_chains",
+               lockstep_chains("f32", 16, 200), 100000);
+  bench_kernel(&stack, allocator, "i32_chains",
+               lockstep_chains("i32", 16, 200), 100000);
+  bench_kernel(&stack, allocator, "f32_ragged",
+               lockstep_chains("f32", 13, 200), 100000);
+  printf("checksum %llu\n", (unsigned long long)checksum);
+  stack_allocator_destroy(&stack);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+#include "benchmark.h"
+#include "bytecode.h"
+#include "lower.h"
+#include "stack_allocator.h"
+#include "vm.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef VmResult (*VmRun)(const BytecodeFunction *, uint64_t *);
+
+typedef struct {
+  const char *name;
+  VmRun run;
+} Dispatch;
+
+static const Dispatch dispatches[] = {
+    {.name = "threaded", .run = vm_run},
+    {.name = "switch", .run = vm_run_switch},
+};
+
+uint64_t checksum;
+
+void report(const char *dispatch, const char *kernel, uint64_t elapsed_ns,
+            size_t operations) {
+  char name[64];
+  snprintf(name, sizeof(name), "vm/%s/%s", dispatch, kernel);
+  benchmark_report(name, elapsed_ns, operations);
+}
+
+uint64_t f64_bits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// A chain of dependent i64 bindings compiled from source, so every
+// instruction the lowering produces is dispatched once per run.
+void bench_straight_line(Allocator allocator, size_t bindings, size_t runs) {
+  size_t capacity = bindings * 64;
+  char *source = malloc(capacity);
+  size_t length = snprintf(source, capacity, "i64 x0 = 3\n");
+  for (size_t i = 1; i < bindings; ++i) {
+    length += snprintf(source + length, capacity - length,
+                       "i64 x%zu = x%zu * 3 + %zu - x%zu / 7\n", i, i - 1, i,
+                       i - 1);
+  }
+  Interner interner;
+  interner_init(&interner, allocator);
+  TypeTable types;
+  type_table_init(&types, allocator);
+  Analyzer analyzer;
+  analyzer_init(&analyzer, allocator, &interner, &types);
+  Parser parser = {.allocator = allocator};
+  Module module = parse_module(&parser, (Cursor){.input = source}).module;
+  analyze_module(&analyzer, module);
+  IrFunction ir = lower_module(&analyzer, module);
+  BytecodeFunction function = compile_bytecode(allocator, &ir, &types);
+  uint64_t *registers = malloc(function.register_count * sizeof(uint64_t));
+  for (size_t d = 0; d < sizeof(dispatches) / sizeof(dispatches[0]); ++d) {
+    uint64_t begin = benchmark_now_ns();
+    for (size_t run = 0; run < runs; ++run) {
+      checksum += dispatches[d].run(&function, registers).value;
+    }
+    report(dispatches[d].name, "straight_line", benchmark_now_ns() - begin,
+           runs * function.instructions.length);
+  }
+  free(registers);
+  free(source);
+}
+
+void bench_loop(Dispatch dispatch, const char *kernel,
+                const BytecodeFunction *function, size_t per_iteration,
+                size_t iterations) {
+  uint64_t registers[8];
+  uint64_t begin = benchmark_now_ns();
+  checksum += dispatch.run(function, registers).value;
+  report(dispatch.name, kernel, benchmark_now_ns() - begin,
+         per_iteration * iterations);
+}
+
+void bench_loops(Allocator allocator, size_t iterations) {
+  // r0 = sum, r1 = i, r2 = n, r3 = 1, r4 = i < n
+  BytecodeFunction sum = {.register_count = 5};
+  bytecode_load_constant(allocator, &sum, 0, 0);
+  bytecode_load_constant(allocator, &sum, 1, 0);
+  bytecode_load_constant(allocator, &sum, 2, iterations);
+  bytecode_load_constant(allocator, &sum, 3, 1);
+  bytecode_emit(allocator, &sum, AddIntBytecode, 0, 0, 1);
+  bytecode_emit(allocator, &sum, AddIntBytecode, 1, 1, 3);
+  bytecode_emit(allocator, &sum, LtSignedBytecode, 4, 1, 2);
+  bytecode_emit_wide(allocator, &sum, JumpIfBytecode, 4, 4);
+  bytecode_emit(allocator, &sum, ReturnBytecode, 0, 0, 0);
+
+  // r0 = acc * 31 + i wrapped to i32, the shape of a string hash
+  BytecodeFunction hash = {.register_count = 6};
+  bytecode_load_constant(allocator, &hash, 0, 7);
+  bytecode_load_constant(allocator, &hash, 1, 0);
+  bytecode_load_constant(allocator, &hash, 2, iterations);
+  bytecode_load_constant(allocator, &hash, 3, 1);
+  bytecode_load_constant(allocator, &hash, 5, 31);
+  bytecode_emit(allocator, &hash, MulIntBytecode, 0, 0, 5);
+  bytecode_emit(allocator, &hash, SignExtend32Bytecode, 0, 0, 0);
+  bytecode_emit(allocator, &hash, AddIntBytecode, 0, 0, 1);
+  bytecode_emit(allocator, &hash, SignExtend32Bytecode, 0, 0, 0);
+  bytecode_emit(allocator, &hash, AddIntBytecode, 1, 1, 3);
+  bytecode_emit(allocator, &hash, LtSignedBytecode, 4, 1, 2);
+  bytecode_emit_wide(allocator, &hash, JumpIfBytecode, 4, 5);
+  bytecode_emit(allocator, &hash, ReturnBytecode, 0, 0, 0);
+
+  // r0 = r0 * x + c evaluated in f64, Horner's rule one step per iteration
+  BytecodeFunction horner = {.register_count = 7};
+  bytecode_load_constant(allocator, &horner, 0, f64_bits(0.0));
+  bytecode_load_constant(allocator, &horner, 1, 0);
+  bytecode_load_constant(allocator, &horner, 2, iterations);
+  bytecode_load_constant(allocator, &horner, 3, 1);
+  bytecode_load_constant(allocator, &horner, 5, f64_bits(0.999999));
+  bytecode_load_constant(allocator, &horner, 6, f64_bits(0.5));
+  bytecode_emit(allocator, &horner, MulF64Bytecode, 0, 0, 5);
+  bytecode_emit(allocator, &horner, AddF64Bytecode, 0, 0, 6);
+  bytecode_emit(allocator, &horner, AddIntBytecode, 1, 1, 3);
+  bytecode_emit(allocator, &horner, LtSignedBytecode, 4, 1, 2);
+  bytecode_emit_wide(allocator, &horner, JumpIfBytecode, 4, 6);
+  bytecode_emit(allocator, &horner, ReturnBytecode, 0, 0, 0);
+
+  for (size_t d = 0; d < sizeof(dispatches) / sizeof(dispatches[0]); ++d) {
+    bench_loop(dispatches[d], "loop_sum", &sum, 4, iterations);
+    bench_loop(dispatches[d], "loop_i32_hash", &hash, 7, iterations);
+    bench_loop(dispatches[d], "loop_f64_horner", &horner, 5, iterations);
+  }
+}
+
+int main() {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 64 << 20);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  bench_straight_line(allocator, 5000, 2000);
+  bench_loops(allocator, 20000000);
+  printf("checksum %llu\n", (unsigned long long)checksum);
+  stack_allocator_destroy(&stack);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,18 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "benchmark.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+uint64_t benchmark_now_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void benchmark_report(const char *name, uint64_t elapsed_ns,
+                      size_t operations) {
+  printf("%-40s %12.2f ns/op %14zu ops %10.2f ms\n", name,
+         (double)elapsed_ns / operations, operations, elapsed_ns / 1e6);
+}
@@ -1,15 +1,89 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 typedef struct {
   void *(*allocate)(void *state, size_t size, size_t alignment);
+  // Optional. Grows or shrinks an allocation without moving it and returns
+  // false when that is not possible, e.g. it is not the most recent one.
+  bool (*resize)(void *state, void *memory, size_t old_size, size_t new_size);
   void *state;
 } Allocator;
 
+typedef struct {
+  const char *file;
+  uint32_t line;
+  const char *type_name;
+} CallSite;
+
+size_t align_forward_adjustment(const void *address, size_t alignment);
+
+// Resizes in place when the allocator supports it, otherwise allocates new
+// memory and copies the contents over.
+void *reallocate(Allocator allocator, void *memory, size_t old_size,
+                 size_t new_size, size_t alignment);
+
+#ifdef YETI_TRACK_ALLOCATIONS
+
+void *allocate_at_call_site(Allocator allocator, size_t size, size_t alignment,
+                            CallSite call_site);
+
+// The call site of the innermost allocate_at_call_site on this thread.
+CallSite current_call_site();
+
+// Makes site the current call site on this thread and returns the one it
+// replaced, for code that allocates on behalf of its caller such as the
+// containers. Put the returned site back when done.
+CallSite swap_call_site(CallSite site);
+
+#else
+
+// Without tracking there is no call site to keep, so the containers'
+// bookkeeping compiles down to a plain allocate.
+static inline void *allocate_at_call_site(Allocator allocator, size_t size,
+                                          size_t alignment,
+                                          CallSite call_site) {
+  return allocator.allocate(allocator.state, size, alignment);
+}
+
+static inline CallSite current_call_site() { return (CallSite){}; }
+
+static inline CallSite swap_call_site(CallSite site) { return site; }
+
+#endif
+
+// The call site of the expansion when the build defines
+// YETI_TRACK_ALLOCATIONS, an unknown one otherwise.
+#ifdef YETI_TRACK_ALLOCATIONS
+#define call_site_here(type)                                                   \
+  ((CallSite){.file = __FILE__, .line = __LINE__, .type_name = (type)})
+#else
+#define call_site_here(type) ((CallSite){})
+#endif
+
 #ifdef YETI_ENABLE_ALLOCATOR_MACROS
 
+#ifdef YETI_TRACK_ALLOCATIONS
+
+#define allocate(allocator, type)                                              \
+  (type *)allocate_at_call_site(                                               \
+      allocator, sizeof(type), _Alignof(type),                                 \
+      (CallSite){.file = __FILE__, .line = __LINE__, .type_name = #type})
+
+// For allocations whose size is only known at run time.
+#define allocate_bytes(allocator, size, alignment)                             \
+  allocate_at_call_site(allocator, size, alignment, call_site_here(nullptr))
+
+#else
+
 #define allocate(allocator, type)                                              \
   (type *)allocator.allocate(allocator.state, sizeof(type), _Alignof(type))
 
+#define allocate_bytes(allocator, size, alignment)                             \
+  (allocator.allocate)(allocator.state, size, alignment)
+
+#endif
+
 #endif
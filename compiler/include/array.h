@@ -0,0 +1,65 @@
+#pragma once
+
+#include <allocator.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// A growable array whose storage comes from an Allocator passed to every
+// growing operation. Declare concrete types with
+//
+//   typedef Array(Expression) ExpressionArray;
+//
+// and zero initialize them. Growth first tries to resize in place, which on
+// a stack allocator succeeds as long as nothing else was allocated since.
+#define Array(T)                                                               \
+  struct {                                                                     \
+    T *data;                                                                   \
+    size_t length;                                                             \
+    size_t capacity;                                                           \
+  }
+
+#define array_reserve(allocator, array, minimum_capacity)                      \
+  do {                                                                         \
+    if ((array)->capacity < (minimum_capacity)) {                              \
+      (array)->data = array_grow(allocator, (array)->data, &(array)->capacity, \
+                                 (minimum_capacity), sizeof(*(array)->data),   \
+                                 _Alignof(typeof(*(array)->data)),             \
+                                 call_site_here("Array"));                     \
+    }                                                                          \
+  } while (false)
+
+#define array_push(allocator, array, ...)                                      \
+  do {                                                                         \
+    array_reserve(allocator, array, (array)->length + 1);                      \
+    (array)->data[(array)->length++] = (__VA_ARGS__);                          \
+  } while (false)
+
+#define array_append(allocator, array, values, count)                          \
+  do {                                                                         \
+    array_reserve(allocator, array, (array)->length + (count));                \
+    memcpy((array)->data + (array)->length, (values),                          \
+           (count) * sizeof(*(array)->data));                                  \
+    (array)->length += (count);                                                \
+  } while (false)
+
+#define array_pop(array) ((array)->data[--(array)->length])
+
+#define array_last(array) ((array)->data[(array)->length - 1])
+
+// Gives unused capacity back when the array is the most recent allocation.
+#define array_shrink_to_fit(allocator, array)                                  \
+  do {                                                                         \
+    if ((array)->capacity > (array)->length &&                                 \
+        (allocator).resize != nullptr &&                                       \
+        (allocator).resize((allocator).state, (array)->data,                   \
+                           (array)->capacity * sizeof(*(array)->data),         \
+                           (array)->length * sizeof(*(array)->data))) {        \
+      (array)->capacity = (array)->length;                                     \
+    }                                                                          \
+  } while (false)
+
+// Growth is charged to call_site when allocations are tracked.
+void *array_grow(Allocator allocator, void *data, size_t *capacity,
+                 size_t minimum_capacity, size_t element_size,
+                 size_t alignment, CallSite call_site);
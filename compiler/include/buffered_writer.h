@@ -0,0 +1,40 @@
+#pragma once
+
+#include <allocator.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Collects output in one large buffer and hands it to write(2) only when
+// the buffer fills up or on flush, so emitting a file costs a handful of
+// system calls no matter how many small pieces it is built from.
+typedef struct {
+  int fd;
+  // Also holds formatted text too long for the buffer.
+  Allocator allocator;
+  char *buffer;
+  size_t length;
+  size_t capacity;
+  // Set once a write fails, later writes are dropped.
+  bool failed;
+} BufferedWriter;
+
+void buffered_writer_init(BufferedWriter *writer, Allocator allocator, int fd,
+                          size_t capacity);
+
+void buffered_write(BufferedWriter *writer, const char *data, size_t length);
+
+void buffered_write_string(BufferedWriter *writer, const char *string);
+
+void buffered_write_char(BufferedWriter *writer, char c);
+
+void buffered_write_unsigned(BufferedWriter *writer, uint64_t value);
+
+void buffered_write_signed(BufferedWriter *writer, int64_t value);
+
+[[gnu::format(printf, 2, 3)]] void
+buffered_write_format(BufferedWriter *writer, const char *format, ...);
+
+// Writes out everything buffered so far. Returns false if any write since
+// initialization failed.
+bool buffered_writer_flush(BufferedWriter *writer);
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <allocator.h>
+#include <array.h>
+#include <ir.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <types.h>
+
+// Integer registers hold their value sign extended for signed types and
+// zero extended for unsigned ones, so comparisons and division work on the
+// full 64 bits and only narrow arithmetic needs an extend afterwards.
+// f32 values live in the low half of a register, f64 use all of it.
+typedef enum {
+  // a = constants[b | c << 16]
+  LoadConstBytecode,
+  MoveBytecode,
+  AddIntBytecode,
+  SubIntBytecode,
+  MulIntBytecode,
+  DivSignedBytecode,
+  DivUnsignedBytecode,
+  ModSignedBytecode,
+  ModUnsignedBytecode,
+  EqIntBytecode,
+  NeIntBytecode,
+  LtSignedBytecode,
+  LeSignedBytecode,
+  LtUnsignedBytecode,
+  LeUnsignedBytecode,
+  SignExtend8Bytecode,
+  SignExtend16Bytecode,
+  SignExtend32Bytecode,
+  ZeroExtend8Bytecode,
+  ZeroExtend16Bytecode,
+  ZeroExtend32Bytecode,
+  AddF32Bytecode,
+  SubF32Bytecode,
+  MulF32Bytecode,
+  DivF32Bytecode,
+  ModF32Bytecode,
+  EqF32Bytecode,
+  NeF32Bytecode,
+  LtF32Bytecode,
+  LeF32Bytecode,
+  AddF64Bytecode,
+  SubF64Bytecode,
+  MulF64Bytecode,
+  DivF64Bytecode,
+  ModF64Bytecode,
+  EqF64Bytecode,
+  NeF64Bytecode,
+  LtF64Bytecode,
+  LeF64Bytecode,
+  // Vectors span consecutive registers of two 32-bit lanes each, and these
+  // operate on one register's worth of lanes.
+  AddF32x2Bytecode,
+  SubF32x2Bytecode,
+  MulF32x2Bytecode,
+  DivF32x2Bytecode,
+  AddI32x2Bytecode,
+  SubI32x2Bytecode,
+  MulI32x2Bytecode,
+  // Replace the low or high lane of register a with the low half of b.
+  InsertLowBytecode,
+  InsertHighBytecode,
+  // a = b >> 32
+  ExtractHighBytecode,
+  // pc = b | c << 16
+  JumpBytecode,
+  // if a then pc = b | c << 16
+  JumpIfBytecode,
+  // returns register a, or nothing when a is BYTECODE_NO_REGISTER
+  ReturnBytecode,
+  // returns the b registers starting at a
+  ReturnVectorBytecode,
+  BytecodeOpcodeCount,
+} BytecodeOpcode;
+
+#define BYTECODE_NO_REGISTER UINT16_MAX
+
+// Registers taken by the widest vector type.
+enum { MaxRegisterWords = 4 };
+
+typedef struct {
+  uint16_t opcode;
+  uint16_t a;
+  uint16_t b;
+  uint16_t c;
+} BytecodeInstruction;
+
+typedef Array(BytecodeInstruction) BytecodeInstructionArray;
+
+typedef Array(uint64_t) BytecodeConstantArray;
+
+typedef struct {
+  BytecodeInstructionArray instructions;
+  BytecodeConstantArray constants;
+  uint32_t register_count;
+  TypeId return_type;
+  // Set when more values are live at once than registers can be numbered,
+  // the function is then left incomplete and must not be run.
+  bool too_many_registers;
+} BytecodeFunction;
+
+// Every IR value gets registers of its own while it is live, one for
+// scalars and one per eight bytes for vectors. Registers of dead values are
+// reused by later values of the same width.
+BytecodeFunction compile_bytecode(Allocator allocator,
+                                  const IrFunction *function,
+                                  const TypeTable *types);
+
+void bytecode_emit(Allocator allocator, BytecodeFunction *function,
+                   BytecodeOpcode opcode, uint16_t a, uint16_t b, uint16_t c);
+
+void bytecode_emit_wide(Allocator allocator, BytecodeFunction *function,
+                        BytecodeOpcode opcode, uint16_t a, uint32_t operand);
+
+void bytecode_load_constant(Allocator allocator, BytecodeFunction *function,
+                            uint16_t destination, uint64_t value);
+
+const char *bytecode_opcode_name(BytecodeOpcode opcode);
+
+void bytecode_dump(const BytecodeFunction *function, FILE *out);
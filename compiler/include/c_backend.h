@@ -0,0 +1,14 @@
+#pragma once
+
+#include <buffered_writer.h>
+#include <ir.h>
+#include <types.h>
+
+// Writes a standalone C23 translation unit whose main evaluates the
+// function and prints its result the way the interpreter does. Integer
+// arithmetic is carried out on unsigned types so wrapping never becomes
+// undefined behavior, and division traps exit with the VM's messages.
+void emit_c(BufferedWriter *writer, const IrFunction *function,
+            const TypeTable *types);
+
+const char *c_type_name(const Type *type);
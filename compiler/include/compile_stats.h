@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// The driver's phases in the order they run.
+typedef enum {
+  ReadPhase,
+  // The tokenizer runs on demand inside the parser, so this is a separate
+  // pass that only counts tokens, run only when statistics are requested.
+  // Parse time includes lexing again, so this is reported as the share of
+  // parse spent lexing and left out of the total.
+  LexPhase,
+  ParsePhase,
+  AnalyzePhase,
+  LowerPhase,
+  // Inlining, compile time evaluation, the optimization passes,
+  // vectorization and verification.
+  OptimizePhase,
+  // The requested output: IR dumps, bytecode, machine code, C and objects.
+  CodegenPhase,
+  // Running the program for --interpret and --run.
+  RunPhase,
+  // The C compiler that --build hands the emitted C to.
+  CcPhase,
+  PhaseCount,
+} Phase;
+
+typedef struct {
+  uint64_t nanoseconds[PhaseCount];
+  size_t files;
+  size_t source_bytes;
+  size_t tokens;
+  size_t nodes;
+  size_t instructions;
+  size_t arena_bytes;
+} CompileStats;
+
+uint64_t monotonic_ns();
+
+// Charges the time since begin to phase and returns the current time, so
+// consecutive phases chain without reading the clock twice.
+uint64_t compile_stats_lap(CompileStats *stats, Phase phase, uint64_t begin);
+
+const char *phase_name(Phase phase);
+
+// The time of every phase but LexPhase, which parse time already covers.
+uint64_t compile_stats_total_ns(const CompileStats *stats);
+
+void compile_stats_write_table(const CompileStats *stats, FILE *file);
+
+void compile_stats_write_json(const CompileStats *stats, FILE *file);
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <allocator.h>
+#include <array.h>
+#include <hash_map.h>
+#include <ir.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <types.h>
+
+typedef struct {
+  // Instructions one evaluation may execute, memoized calls excluded.
+  uint64_t max_steps;
+  // Bytes of frames and their values live at once, which bounds recursion.
+  size_t max_memory;
+} ComptimeLimits;
+
+extern const ComptimeLimits default_comptime_limits;
+
+typedef enum {
+  ComptimeOk,
+  // An instruction is left to run time: division that traps, float
+  // remainders, vectors and memory.
+  ComptimeNotConstant,
+  ComptimeStepLimit,
+  ComptimeMemoryLimit,
+} ComptimeStatus;
+
+typedef struct {
+  ComptimeStatus status;
+  uint64_t bits;
+} ComptimeResult;
+
+typedef struct {
+  // Calls whose arguments are all constants.
+  uint32_t calls;
+  // Of those, the calls replaced by their result.
+  uint32_t evaluated;
+  uint32_t not_constant;
+  uint32_t over_step_limit;
+  uint32_t over_memory_limit;
+  size_t memo_hits;
+  uint64_t steps;
+} ComptimeStats;
+
+typedef struct {
+  uint32_t function;
+  uint32_t count;
+  const uint64_t *arguments;
+} CallKey;
+
+static inline uint64_t hash_call_key(CallKey key) {
+  uint64_t hash = hash_integer(key.function);
+  for (uint32_t i = 0; i < key.count; ++i) {
+    hash = hash_combine(hash, key.arguments[i]);
+  }
+  return hash;
+}
+
+static inline bool call_keys_equal(CallKey a, CallKey b) {
+  return a.function == b.function && a.count == b.count &&
+         (a.count == 0 ||
+          memcmp(a.arguments, b.arguments, a.count * sizeof(uint64_t)) == 0);
+}
+
+DEFINE_HASH_MAP(CallMemo, call_memo, CallKey, uint64_t, hash_call_key,
+                call_keys_equal)
+
+typedef struct {
+  uint32_t function;
+  // The instruction to execute next, or the call being waited on.
+  uint32_t next;
+  // Where the frame's values start in the value stack.
+  uint32_t values;
+} ComptimeFrame;
+
+typedef Array(ComptimeFrame) ComptimeFrameArray;
+
+typedef Array(uint64_t) ComptimeValueArray;
+
+// Interprets module functions during compilation. Instructions are
+// evaluated with fold_binary, so results match what the program computes
+// at run time bit for bit, and anything fold_binary leaves to run time
+// stops the evaluation. Every completed call is memoized by function and
+// argument bits, so repeated and recursive calls are evaluated once.
+typedef struct {
+  Allocator allocator;
+  const IrModule *module;
+  const TypeTable *types;
+  ComptimeLimits limits;
+  // Results of completed calls keyed by function and arguments.
+  CallMemo memo;
+  ComptimeFrameArray frames;
+  ComptimeValueArray values;
+  ComptimeStats stats;
+} Comptime;
+
+void comptime_init(Comptime *comptime, Allocator allocator,
+                   const IrModule *module, const TypeTable *types,
+                   const ComptimeLimits *limits);
+
+// Calls function with arguments given as constant bits.
+ComptimeResult comptime_call(Comptime *comptime, uint32_t function,
+                             const uint64_t *arguments);
+
+// Replaces every call whose arguments are constants by the constant it
+// returns, when it can be evaluated within the limits, and drops its
+// arguments. fold_constants then carries the results on. The module must
+// be the one the evaluator was created with.
+ComptimeStats evaluate_constant_calls(Comptime *comptime, IrModule *module);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct ArenaChunk ArenaChunk;
+
+struct ArenaChunk {
+  _Atomic(ArenaChunk *) next;
+  _Atomic size_t used;
+  size_t capacity;
+  _Alignas(max_align_t) uint8_t data[];
+};
+
+// Many threads bump allocate from the head chunk with a compare and swap on
+// its offset. When the head fills up a new chunk is pushed in front of it.
+// Nothing is freed until the whole arena is destroyed.
+typedef struct {
+  _Atomic(ArenaChunk *) head;
+  size_t chunk_size;
+} ConcurrentArena;
+
+// Owned by a single thread. Carves small allocations out of a block taken
+// from the shared arena so the shared bump pointer is only touched once per
+// block instead of once per allocation.
+typedef struct {
+  ConcurrentArena *arena;
+  uint8_t *current_position;
+  uint8_t *end;
+  size_t block_size;
+} ArenaThreadCache;
+
+void *concurrent_arena_allocate(void *arena, size_t size, size_t alignment);
+
+bool concurrent_arena_resize(void *arena, void *memory, size_t old_size,
+                             size_t new_size);
+
+void concurrent_arena_init(ConcurrentArena *arena, size_t chunk_size);
+
+void concurrent_arena_destroy(ConcurrentArena *arena);
+
+void *arena_thread_cache_allocate(void *cache, size_t size, size_t alignment);
+
+bool arena_thread_cache_resize(void *cache, void *memory, size_t old_size,
+                               size_t new_size);
+
+void arena_thread_cache_init(ArenaThreadCache *cache, ConcurrentArena *arena,
+                             size_t block_size);
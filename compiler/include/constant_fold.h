@@ -0,0 +1,33 @@
+#pragma once
+
+#include <allocator.h>
+#include <ir.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+typedef struct {
+  bool folded;
+  uint64_t bits;
+} FoldResult;
+
+typedef struct {
+  size_t folded;
+  size_t removed;
+} ConstantFoldStats;
+
+// Evaluates instructions whose operands are all constants, in the
+// instruction's own type: integers wrap at their declared width and f32
+// arithmetic is rounded to single precision after every step. Because a
+// binding is just a value in SSA form, constants flow through definitions
+// without any extra bookkeeping. Constants left without users afterwards
+// are removed.
+ConstantFoldStats fold_constants(Allocator allocator, IrFunction *function,
+                                 const TypeTable *types);
+
+// Evaluates a binary opcode on operands of the given type as the program
+// would at run time. Division that traps and float remainders are not
+// folded and are left for the program to execute.
+FoldResult fold_binary(const TypeTable *types, IrOpcode opcode, TypeId type,
+                       uint64_t left, uint64_t right);
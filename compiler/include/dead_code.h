@@ -0,0 +1,19 @@
+#pragma once
+
+#include <allocator.h>
+#include <ir.h>
+#include <stddef.h>
+#include <types.h>
+
+typedef struct {
+  size_t removed;
+} DeadCodeStats;
+
+// Removes instructions whose values are never used. Use counts come from
+// the use lists; a worklist starts with every unused instruction, and
+// removing one releases its operands, which join the worklist when their
+// last user goes. Whole dead chains are removed in one pass over the uses.
+// Stores, parameters, arguments, calls, terminators and integer division
+// that may trap are kept, so the program fails exactly as it did before.
+DeadCodeStats eliminate_dead_code(Allocator allocator, IrFunction *function,
+                                  const TypeTable *types);
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <buffered_writer.h>
+#include <x64.h>
+
+// Writes code as an x86-64 ELF64 relocatable object defining one global
+// function called name, with the signature documented on X64Code. Calls
+// into libm become undefined symbols reached through the GOT, so the system
+// linker resolves them without text relocations, PIE or not.
+void write_elf_object(BufferedWriter *writer, const X64Code *code,
+                      const char *name);
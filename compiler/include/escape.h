@@ -0,0 +1,32 @@
+#pragma once
+
+#include <allocator.h>
+#include <ir.h>
+#include <stdint.h>
+
+typedef struct {
+  // Allocations of a constant size up to this many bytes may take a stack
+  // slot. Larger or variable ones that stay local go to the arena.
+  uint64_t max_stack_bytes;
+} EscapeOptions;
+
+extern const EscapeOptions default_escape_options;
+
+typedef struct {
+  // Heap allocations looked at.
+  uint32_t allocations;
+  uint32_t to_stack;
+  uint32_t to_arena;
+  // Allocations that may outlive their caller and stay on the heap.
+  uint32_t escaping;
+} EscapeStats;
+
+// Rewrites heap allocations that provably do not outlive their function
+// into stack slots, and those that only outlive it by being returned to
+// callers that keep them local into bump allocations on the caller's
+// arena. An address escapes when it is stored to memory, used as anything
+// but an address or in address arithmetic, or passed to a parameter that
+// escapes. Parameters are summarized per function and iterated to a fixed
+// point over the module, so recursion needs no special casing.
+EscapeStats promote_allocations(Allocator allocator, IrModule *module,
+                                const EscapeOptions *options);
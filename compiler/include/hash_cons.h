@@ -0,0 +1,30 @@
+#pragma once
+
+#include <allocator.h>
+#include <hash_map.h>
+#include <parser.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Interns expressions by structure so identical subtrees are stored once.
+// Leaves are keyed by kind and text, interior nodes by kind and the
+// addresses of their already interned children, and the elements of array
+// literals and argument lists one by one, so pointer equality of interned
+// nodes is structural equality. Spans are not part of the key, a
+// shared node keeps the span of its first occurrence, so the analyzer
+// locates diagnostics in a shared module at the enclosing expression that
+// is stored by value.
+typedef struct HashConsTable {
+  Allocator allocator;
+  HashMap nodes;
+  size_t hits;
+} HashConsTable;
+
+void hash_cons_table_init(HashConsTable *table, Allocator allocator);
+
+Expression *hash_cons(HashConsTable *table, Expression expression);
+
+uint64_t hash_expression(const Expression *expression);
+
+bool expressions_equal(const Expression *a, const Expression *b);
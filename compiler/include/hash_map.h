@@ -0,0 +1,155 @@
+#pragma once
+
+#include <allocator.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Open addressing hash table in the style of a Swiss table. Every slot has a
+// control byte holding either empty, deleted or the low seven bits of its
+// hash. Lookups compare sixteen control bytes at a time and only touch slots
+// whose control byte matches. Slots are stored untyped, use DEFINE_HASH_MAP
+// below to get a typed interface.
+typedef struct {
+  uint8_t *control;
+  uint8_t *slots;
+  size_t length;
+  size_t capacity;
+  size_t growth_left;
+} HashMap;
+
+typedef struct {
+  size_t slot_size;
+  size_t slot_alignment;
+  uint64_t (*hash)(const void *slot);
+  // Reported as the type of the table's allocations when they are tracked.
+  const char *name;
+} HashMapLayout;
+
+typedef bool (*HashMapMatch)(const void *slot, const void *key);
+
+typedef struct {
+  void *slot;
+  bool inserted;
+} HashMapInsertResult;
+
+void *hash_map_find(const HashMap *map, size_t slot_size, uint64_t hash,
+                    const void *key, HashMapMatch match);
+
+// Returns the slot holding key, or reserves a new one for the caller to fill
+// in. Slots move when the table grows, so pointers into it are only valid
+// until the next insert. Growth is charged to call_site when allocations are
+// tracked, hash_map_insert passes the caller's.
+HashMapInsertResult hash_map_insert_at(Allocator allocator, HashMap *map,
+                                       const HashMapLayout *layout,
+                                       uint64_t hash, const void *key,
+                                       HashMapMatch match, CallSite call_site);
+
+#define hash_map_insert(allocator, map, layout, hash, key, match)              \
+  hash_map_insert_at(allocator, map, layout, hash, key, match,                 \
+                     call_site_here((layout)->name))
+
+bool hash_map_remove(HashMap *map, size_t slot_size, uint64_t hash,
+                     const void *key, HashMapMatch match);
+
+void hash_map_reserve_at(Allocator allocator, HashMap *map,
+                         const HashMapLayout *layout, size_t length,
+                         CallSite call_site);
+
+#define hash_map_reserve(allocator, map, layout, length)                       \
+  hash_map_reserve_at(allocator, map, layout, length,                          \
+                      call_site_here((layout)->name))
+
+// Iterates the occupied slots. Start with *index = 0, stops with nullptr.
+void *hash_map_next(const HashMap *map, size_t slot_size, size_t *index);
+
+static inline uint64_t hash_integer(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+static inline uint64_t hash_combine(uint64_t seed, uint64_t value) {
+  return hash_integer(seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) +
+                              (seed >> 2)));
+}
+
+uint64_t hash_bytes(const void *data, size_t length);
+
+#define DEFINE_HASH_MAP(Name, prefix, Key, Value, hash_key, keys_equal)        \
+  typedef struct {                                                             \
+    Key key;                                                                   \
+    Value value;                                                               \
+  } Name##Entry;                                                               \
+                                                                               \
+  typedef struct {                                                             \
+    HashMap map;                                                               \
+  } Name;                                                                      \
+                                                                               \
+  static inline uint64_t prefix##_hash_slot(const void *slot) {                \
+    return hash_key(((const Name##Entry *)slot)->key);                         \
+  }                                                                            \
+                                                                               \
+  static inline bool prefix##_match(const void *slot, const void *key) {       \
+    return keys_equal(((const Name##Entry *)slot)->key, *(const Key *)key);    \
+  }                                                                            \
+                                                                               \
+  static const HashMapLayout prefix##_layout = {                               \
+      .slot_size = sizeof(Name##Entry),                                        \
+      .slot_alignment = _Alignof(Name##Entry),                                 \
+      .hash = prefix##_hash_slot,                                              \
+      .name = #Name,                                                           \
+  };                                                                           \
+                                                                               \
+  static inline Value *prefix##_find(const Name *map, Key key) {               \
+    Name##Entry *entry = hash_map_find(&map->map, sizeof(Name##Entry),         \
+                                       hash_key(key), &key, prefix##_match);   \
+    return entry == nullptr ? nullptr : &entry->value;                         \
+  }                                                                            \
+                                                                               \
+  /* Inserts value unless key is present, returns the stored value. */       \
+  static inline Value *prefix##_find_or_insert_at(                             \
+      Allocator allocator, Name *map, Key key, Value value,                    \
+      CallSite call_site) {                                                    \
+    HashMapInsertResult result = hash_map_insert_at(                           \
+        allocator, &map->map, &prefix##_layout, hash_key(key), &key,           \
+        prefix##_match, call_site);                                            \
+    Name##Entry *entry = result.slot;                                          \
+    if (result.inserted) {                                                     \
+      *entry = (Name##Entry){.key = key, .value = value};                      \
+    }                                                                          \
+    return &entry->value;                                                      \
+  }                                                                            \
+                                                                               \
+  static inline Value *prefix##_insert_at(Allocator allocator, Name *map,      \
+                                          Key key, Value value,                \
+                                          CallSite call_site) {                \
+    Value *stored =                                                            \
+        prefix##_find_or_insert_at(allocator, map, key, value, call_site);     \
+    *stored = value;                                                           \
+    return stored;                                                             \
+  }                                                                            \
+                                                                               \
+  static inline bool prefix##_remove(Name *map, Key key) {                     \
+    return hash_map_remove(&map->map, sizeof(Name##Entry), hash_key(key),      \
+                           &key, prefix##_match);                              \
+  }                                                                            \
+                                                                               \
+  static inline Name##Entry *prefix##_next(const Name *map, size_t *index) {   \
+    return hash_map_next(&map->map, sizeof(Name##Entry), index);               \
+  }
+
+// The typed inserts of a map declared with DEFINE_HASH_MAP, named by its
+// prefix. Like array_push they expand at the caller, so growth is charged
+// to the caller's line when allocations are tracked.
+#define map_find_or_insert(prefix, allocator, map, key, ...)                   \
+  prefix##_find_or_insert_at(allocator, map, key, (__VA_ARGS__),              \
+                             call_site_here(prefix##_layout.name))
+
+#define map_insert(prefix, allocator, map, key, ...)                           \
+  prefix##_insert_at(allocator, map, key, (__VA_ARGS__),                       \
+                     call_site_here(prefix##_layout.name))
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <allocator.h>
+#include <ir.h>
+#include <stdint.h>
+
+typedef struct {
+  // Inline a callee when its instructions, less the call and its
+  // arguments and less the bonus for constant arguments, are at most this.
+  uint32_t threshold;
+  // Instructions a caller may grow by through inlining. Calls that shrink
+  // the caller are always taken.
+  uint32_t caller_budget;
+  // Instructions expected to fold away per use of a parameter that gets a
+  // constant argument.
+  uint32_t constant_argument_bonus;
+} InlineOptions;
+
+extern const InlineOptions default_inline_options;
+
+typedef struct {
+  uint32_t calls;
+  uint32_t inlined;
+  // Calls between functions on a cycle of the call graph.
+  uint32_t recursive;
+  // Calls into callees with more than one block.
+  uint32_t branching;
+  uint32_t too_costly;
+  uint32_t over_budget;
+  size_t instructions_before;
+  size_t instructions_after;
+} InlineStats;
+
+// Replaces calls with copies of their callees. Functions are visited bottom
+// up over the call graph, callees before callers, so a callee has already
+// absorbed its own small helpers when it is weighed for inlining. Calls
+// within a strongly connected component are left alone, which keeps
+// recursion finite. Parameters become the call's arguments, so constant
+// arguments are left for fold_constants to propagate.
+InlineStats inline_calls(Allocator allocator, IrModule *module,
+                         const InlineOptions *options);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <allocator.h>
+#include <array.h>
+#include <hash_map.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <tokenizer.h>
+
+typedef uint32_t SymbolId;
+
+static inline bool symbol_ids_equal(SymbolId a, SymbolId b) { return a == b; }
+
+DEFINE_HASH_MAP(SymbolIdMap, symbol_id_map, StringView, SymbolId,
+                hash_string_view, string_view_equal)
+
+typedef Array(StringView) StringViewArray;
+
+// Maps each distinct spelling to a dense id so later passes compare and hash
+// 32 bit integers instead of strings. The views are not copied, the text they
+// point into must outlive the interner.
+typedef struct {
+  Allocator allocator;
+  SymbolIdMap ids;
+  StringViewArray strings;
+} Interner;
+
+void interner_init(Interner *interner, Allocator allocator);
+
+SymbolId intern(Interner *interner, StringView string);
+
+StringView symbol_string(const Interner *interner, SymbolId symbol);
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <allocator.h>
+#include <array.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <types.h>
+
+// Values are named by the index of the instruction that defines them.
+typedef uint32_t IrValue;
+
+#define IR_NO_VALUE UINT32_MAX
+
+typedef enum {
+  // operands hold the low and high halves of the constant, see ir_constant.
+  // Constants whose type is or holds a type parameter hold an integer and
+  // are converted like ir_int_bits when the generic is instantiated.
+  ConstOp,
+  AddOp,
+  SubOp,
+  MulOp,
+  DivOp,
+  ModOp,
+  EqOp,
+  NeOp,
+  LtOp,
+  LeOp,
+  GtOp,
+  GeOp,
+  // the u64 index operands[0] when it is below the length operands[1];
+  // traps otherwise
+  BoundsOp,
+  // the vector operands[0] with the lane replaced by the scalar operands[1]
+  InsertOp,
+  // the lane of the vector operands[0]
+  ExtractOp,
+  // the u64 address of operands[0] bytes, allocated as lane says, see
+  // IrAllocation
+  AllocOp,
+  // the value at address operands[0]
+  LoadOp,
+  // writes operands[1] to address operands[0]; has no value
+  StoreOp,
+  // the parameter numbered operands[0]; a function with n parameters
+  // starts with n of these in order
+  ParamOp,
+  // passes operands[0] to the CallOp that ends the run of arguments
+  ArgOp,
+  // calls the function numbered operands[0] in the module with the ArgOp
+  // instructions right before it as arguments
+  CallOp,
+  // operands[0] is the returned value or IR_NO_VALUE
+  ReturnOp,
+  IrOpcodeCount,
+} IrOpcode;
+
+// Where an AllocOp takes its memory from.
+typedef enum {
+  // Lives until freed by the runtime.
+  HeapAllocation,
+  // Bump allocated from the arena of the calling frame and released when
+  // that caller returns.
+  ArenaAllocation,
+  // A slot in the allocating function's own frame.
+  StackAllocation,
+  IrAllocationCount,
+} IrAllocation;
+
+typedef struct {
+  uint16_t opcode;
+  // The lane an InsertOp or ExtractOp works on, or the IrAllocation of an
+  // AllocOp.
+  uint16_t lane;
+  TypeId type;
+  uint32_t operands[2];
+} IrInstruction;
+
+// A basic block is the half open range [begin, end) of instructions. Blocks
+// are laid out back to back in instruction order.
+typedef struct {
+  uint32_t begin;
+  uint32_t end;
+} IrBlock;
+
+typedef Array(IrInstruction) IrInstructionArray;
+
+typedef Array(IrBlock) IrBlockArray;
+
+typedef struct {
+  StringView name;
+  IrInstructionArray instructions;
+  IrBlockArray blocks;
+  uint32_t parameter_count;
+  TypeId return_type;
+} IrFunction;
+
+typedef Array(IrFunction) IrFunctionArray;
+
+// Functions call each other by their index in functions. The backends
+// take single functions and do not support calls yet.
+typedef struct {
+  IrFunctionArray functions;
+} IrModule;
+
+// Users of every value in compressed sparse row form: the users of value v
+// are users[offsets[v]] up to users[offsets[v + 1]].
+typedef struct {
+  uint32_t *offsets;
+  IrValue *users;
+} IrUses;
+
+typedef struct {
+  bool valid;
+  uint32_t function;
+  uint32_t instruction;
+  const char *message;
+} IrVerifyResult;
+
+IrValue ir_append(Allocator allocator, IrFunction *function,
+                  IrInstruction instruction);
+
+IrValue ir_constant(Allocator allocator, IrFunction *function, TypeId type,
+                    uint64_t bits);
+
+IrValue ir_binary(Allocator allocator, IrFunction *function, IrOpcode opcode,
+                  TypeId type, IrValue left, IrValue right);
+
+IrValue ir_insert(Allocator allocator, IrFunction *function, TypeId type,
+                  IrValue vector, IrValue scalar, uint32_t lane);
+
+IrValue ir_extract(Allocator allocator, IrFunction *function, TypeId type,
+                   IrValue vector, uint32_t lane);
+
+IrValue ir_alloc(Allocator allocator, IrFunction *function,
+                 IrAllocation allocation, IrValue size);
+
+IrValue ir_load(Allocator allocator, IrFunction *function, TypeId type,
+                IrValue address);
+
+void ir_store(Allocator allocator, IrFunction *function, IrValue address,
+              IrValue value);
+
+// Appends the next parameter, before any other instruction.
+IrValue ir_param(Allocator allocator, IrFunction *function, TypeId type);
+
+// Appends an ArgOp per argument and then the call, whose value is the
+// result.
+IrValue ir_call(Allocator allocator, IrFunction *function, TypeId type,
+                uint32_t callee, const IrValue *arguments, uint32_t count);
+
+void ir_return(Allocator allocator, IrFunction *function, IrValue value);
+
+// Closes the block that started after the previous one.
+void ir_end_block(Allocator allocator, IrFunction *function);
+
+uint64_t ir_constant_bits(IrInstruction instruction);
+
+// The bits of a constant of the type holding the integer value, converted
+// to floating point or truncated to the width of the type. Vectors hold
+// the bits of one lane, which stand for every lane. Type parameters keep
+// the integer as it is.
+uint64_t ir_int_bits(const TypeTable *types, TypeId type, uint64_t value);
+
+bool ir_is_terminator(IrOpcode opcode);
+
+bool ir_is_comparison(IrOpcode opcode);
+
+uint32_t ir_operand_count(IrInstruction instruction);
+
+const char *ir_opcode_name(IrOpcode opcode);
+
+IrUses ir_compute_uses(Allocator allocator, const IrFunction *function);
+
+// Vectors have element-wise add, sub and mul, and div for float lanes.
+bool ir_vector_supports(const TypeTable *types, const Type *type,
+                        IrOpcode opcode);
+
+IrVerifyResult ir_verify(const IrFunction *function, const TypeTable *types);
+
+// Verifies every function and that each call passes its callee's
+// parameter types and produces its return type.
+IrVerifyResult ir_verify_module(const IrModule *module,
+                                const TypeTable *types);
+
+// Prints a value of the given type from its bit pattern. Integers are read
+// from their low size bytes.
+void ir_write_constant(FILE *out, const Type *type, uint64_t bits);
+
+// Prints every lane of a vector laid out as in memory, as [a, b, ...].
+void ir_write_vector(FILE *out, const TypeTable *types, const Type *type,
+                     const void *lanes);
+
+void ir_dump(const IrFunction *function, const TypeTable *types, FILE *out);
+
+// Drops every instruction whose keep flag is false, renumbering the
+// remaining values and block ranges. Callers guarantee that no kept
+// instruction uses a dropped one. remap receives the new index of every
+// kept value and must have room for one entry per instruction.
+void ir_compact(IrFunction *function, const bool *keep, IrValue *remap);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vm.h>
+#include <x64.h>
+
+typedef VmStatus (*JitEntry)(uint64_t *result);
+
+typedef struct {
+  void *memory;
+  size_t size;
+  JitEntry entry;
+} JitFunction;
+
+// Whether the host has every extension in the X64Feature mask.
+bool host_supports(uint32_t features);
+
+// Copies the code into fresh pages, resolves its relocations and flips the
+// pages from writable to executable, so they are never both at once.
+// entry is nullptr when the pages could not be mapped or the host lacks
+// an extension the code needs.
+JitFunction jit_load(const X64Code *code);
+
+void jit_release(JitFunction *function);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <ir.h>
+#include <parser.h>
+#include <semantic.h>
+
+// Lowers a module that passed semantic analysis. Every function definition
+// becomes a function of the module, in definition order, followed by main,
+// which evaluates every other top level expression in order and returns
+// the value of the last one. Generic functions are instantiated by their
+// calls instead, and their instances are added when first called. Types
+// are resolved through the analyzer, which must not have reported any
+// diagnostics.
+IrModule lower_program(Analyzer *analyzer, Module module);
+
+// Lowers a module without function definitions to its main function.
+IrFunction lower_module(Analyzer *analyzer, Module module);
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <allocator.h>
+#include <array.h>
+#include <hash_map.h>
+#include <ir.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <types.h>
+
+// A function whose instruction, parameter and return types may be type
+// parameters, see type_parameter, or vectors of them. Constants of those
+// types hold integers, see ConstOp. Calls in the body name functions of
+// the module instances are added to.
+typedef struct {
+  IrFunction body;
+  uint32_t type_parameter_count;
+} IrGeneric;
+
+typedef Array(IrGeneric) IrGenericArray;
+
+typedef struct {
+  const TypeId *types;
+  uint32_t count;
+} TypeTuple;
+
+static inline uint64_t hash_type_tuple(TypeTuple tuple) {
+  return hash_bytes(tuple.types, tuple.count * sizeof(TypeId));
+}
+
+static inline bool type_tuples_equal(TypeTuple a, TypeTuple b) {
+  return a.count == b.count &&
+         (a.count == 0 ||
+          memcmp(a.types, b.types, a.count * sizeof(TypeId)) == 0);
+}
+
+DEFINE_HASH_MAP(TypeTupleMap, type_tuple_map, TypeTuple, uint32_t,
+                hash_type_tuple, type_tuples_equal)
+
+static inline bool uint64s_equal(uint64_t a, uint64_t b) { return a == b; }
+
+// Keyed by the generic in the high half and the type tuple in the low.
+DEFINE_HASH_MAP(InstanceMap, instance_map, uint64_t, uint32_t, hash_integer,
+                uint64s_equal)
+
+// An instantiated body, compared by everything but its name.
+typedef struct {
+  const IrInstruction *instructions;
+  uint32_t length;
+  TypeId return_type;
+} InstanceBody;
+
+static inline uint64_t hash_instance_body(InstanceBody body) {
+  return hash_combine(
+      hash_bytes(body.instructions, body.length * sizeof(IrInstruction)),
+      body.return_type);
+}
+
+static inline bool instance_bodies_equal(InstanceBody a, InstanceBody b) {
+  return a.length == b.length && a.return_type == b.return_type &&
+         memcmp(a.instructions, b.instructions,
+                a.length * sizeof(IrInstruction)) == 0;
+}
+
+DEFINE_HASH_MAP(InstanceBodyMap, instance_body_map, InstanceBody, uint32_t,
+                hash_instance_body, instance_bodies_equal)
+
+typedef struct {
+  uint32_t requests;
+  // Requests answered from the instantiation cache.
+  uint32_t cache_hits;
+  uint32_t instantiated;
+  // Instantiations identical to one made before, often the same generic
+  // registered by another compilation unit, which share its function.
+  uint32_t deduplicated;
+} MonomorphizeStats;
+
+// Instantiates generic functions once per build. Requests are cached by
+// generic and interned type argument tuple, so repeating one is a single
+// lookup. Fresh instantiations are hashed by body and merged with any
+// identical instance already in the module, which is how compilation units
+// that each bring their own copy of a generic end up sharing one function.
+// The table hashes instance bodies in place, so passes that rewrite them
+// run once every instance has been made.
+typedef struct {
+  Allocator allocator;
+  TypeTable *types;
+  IrModule *module;
+  IrGenericArray generics;
+  TypeTupleMap tuples;
+  uint32_t tuple_count;
+  InstanceMap instances;
+  InstanceBodyMap bodies;
+  MonomorphizeStats stats;
+} Monomorphizer;
+
+void monomorphizer_init(Monomorphizer *monomorphizer, Allocator allocator,
+                        TypeTable *types, IrModule *module);
+
+// Registers a generic and returns its id. Compilation units each register
+// the generics they see, so one source function may get several ids.
+uint32_t monomorphizer_add_generic(Monomorphizer *monomorphizer,
+                                   IrGeneric generic);
+
+// The same id for every equal list of types.
+uint32_t intern_type_tuple(Monomorphizer *monomorphizer, const TypeId *types,
+                           uint32_t count);
+
+// Returns the module function specializing the generic to the type
+// arguments, one per type parameter, instantiating it on first request.
+// Instances are named like dot<f32>.
+uint32_t monomorphize(Monomorphizer *monomorphizer, uint32_t generic,
+                      const TypeId *arguments);
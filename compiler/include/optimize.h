@@ -0,0 +1,20 @@
+#pragma once
+
+#include <allocator.h>
+#include <ir.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types.h>
+
+typedef struct {
+  const char *name;
+  size_t removed;
+  uint64_t nanoseconds;
+} PassStats;
+
+enum { PassCount = 3 };
+
+// Runs the optimization passes the driver runs on main in order, timing
+// each one.
+void optimize(Allocator allocator, IrFunction *function,
+              const TypeTable *types, PassStats stats[PassCount]);
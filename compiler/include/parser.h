@@ -1,6 +1,7 @@
 #pragma once
 
 #include <allocator.h>
+#include <array.h>
 #include <tokenizer.h>
 
 typedef enum {
@@ -8,6 +9,13 @@ typedef enum {
   FloatExpression,
   IntExpression,
   AssignExpression,
+  BinaryOpExpression,
+  StructExpression,
+  ArrayExpression,
+  SliceTypeExpression,
+  IndexExpression,
+  FunctionExpression,
+  CallExpression,
 } ExpressionKind;
 
 typedef struct Expression Expression;
@@ -19,11 +27,78 @@ typedef struct {
   Expression *value;
 } Assign;
 
+typedef struct {
+  Operator op;
+  Expression *left;
+  Expression *right;
+} BinaryOp;
+
+// A struct field or function parameter.
+typedef struct {
+  Expression *type;
+  Symbol name;
+} TypedName;
+
+// struct [attribute, ...] Name { type name, ... }
+typedef struct {
+  Span keyword;
+  Symbol name;
+  Symbol *attributes;
+  uint32_t attribute_count;
+  TypedName *fields;
+  uint32_t field_count;
+} StructDeclaration;
+
+// [element, ...] with the elements stored back to back in one allocation.
+typedef struct {
+  Expression *elements;
+  uint32_t count;
+} ArrayLiteral;
+
+// []element
+typedef struct {
+  Expression *element;
+} Slice;
+
+// target[index]
+typedef struct {
+  Expression *target;
+  Expression *index;
+} Index;
+
+// type name(type name, ...) = body, or type name<T, ...>(type name, ...) =
+// body for a generic function whose types may name its type parameters.
+typedef struct {
+  Expression *return_type;
+  Symbol name;
+  Symbol *type_parameters;
+  uint32_t type_parameter_count;
+  TypedName *parameters;
+  uint32_t parameter_count;
+  Span assign_token;
+  Expression *body;
+} Function;
+
+// callee(argument, ...) with the arguments stored back to back in one
+// allocation.
+typedef struct {
+  Expression *callee;
+  Expression *arguments;
+  uint32_t argument_count;
+} Call;
+
 typedef union {
   Symbol symbol;
   Float float_;
   Int int_;
   Assign assign;
+  BinaryOp binary_op;
+  StructDeclaration struct_;
+  ArrayLiteral array;
+  Slice slice;
+  Index index;
+  Function function;
+  Call call;
 } ExpressionValue;
 
 struct Expression {
@@ -37,4 +112,45 @@ typedef struct {
   Cursor cursor;
 } ParseExpressionResult;
 
-ParseExpressionResult parse_expression(Allocator allocator, Cursor cursor);
+typedef struct HashConsTable HashConsTable;
+
+typedef Array(Expression) ExpressionArray;
+
+typedef Array(TypedName) TypedNameArray;
+
+typedef struct {
+  Allocator allocator;
+  // Optional. When set, child nodes are shared with structurally identical
+  // nodes parsed earlier instead of being copied.
+  HashConsTable *hash_cons;
+  // Elements and arguments of the lists being parsed, innermost last. A
+  // list is copied out in one allocation once it is closed, so nested
+  // lists never interleave their growth.
+  ExpressionArray scratch;
+  // The same for the fields or parameters being parsed, which never nest.
+  TypedNameArray typed_names;
+} Parser;
+
+typedef struct {
+  Expression *expressions;
+  size_t length;
+  // Set when parsed with hash consing. Nodes reached through a pointer may
+  // then stand for several places in the source and keep the span of the
+  // first one. Only the top level expressions and, recursively, the list
+  // elements of nodes that are exact are exact.
+  bool shared;
+} Module;
+
+typedef struct {
+  Module module;
+  Cursor cursor;
+} ParseModuleResult;
+
+ParseExpressionResult parse_expression(Parser *parser, Cursor cursor);
+
+// Parses top level expressions until the end of the input.
+ParseModuleResult parse_module(Parser *parser, Cursor cursor);
+
+// Expressions in the module, counting every type, element and argument.
+// Shared hash consed nodes are counted once per use.
+size_t count_nodes(Module module);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <allocator.h>
+#include <ir.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <types.h>
+
+typedef enum {
+  GeneralRegisterClass,
+  FloatRegisterClass,
+  RegisterClassCount,
+} RegisterClass;
+
+#define NO_REGISTER UINT8_MAX
+
+// The registers of one class in the order they are handed out, and the
+// ones a call clobbers as a bitmask over register numbers. A class with no
+// registers spills everything.
+typedef struct {
+  const uint8_t *registers;
+  uint32_t count;
+  uint32_t caller_saved;
+} RegisterClassInfo;
+
+typedef struct {
+  RegisterClassInfo classes[RegisterClassCount];
+} RegisterFile;
+
+// A value is in reg from its definition up to, but not including, the
+// instruction at split, and in spill slot `slot` from there on. Unsplit
+// values have split past their last use, values spilled from the start
+// have reg set to NO_REGISTER, and unused values have neither.
+typedef struct {
+  uint8_t reg;
+  uint32_t split;
+  uint32_t slot;
+} ValueLocation;
+
+typedef struct {
+  // Indexed by IrValue.
+  ValueLocation *values;
+  uint32_t slot_count;
+  // Values moved to memory partway through their lifetime, by a call or
+  // by register pressure, in the order of their split positions. Code
+  // generators store each one to its slot just before that instruction.
+  IrValue *splits;
+  uint32_t split_count;
+  // Values that never got a register.
+  uint32_t spill_count;
+  // Bitmasks over register numbers of every register handed out.
+  uint32_t used_registers[RegisterClassCount];
+} RegisterAllocation;
+
+RegisterClass register_class_of(const Type *type);
+
+// Float remainders call into libm on every target we generate code for.
+bool ir_instruction_is_call(IrInstruction instruction, const TypeTable *types);
+
+// Linear scan over the live intervals of the instructions in order.
+// Operands are read before results are written, so a value may take the
+// register of an operand whose interval ends at its definition. When no
+// register is free, whichever of the new interval and the active ones
+// ends last is split there, and the rest of it lives in a spill slot that
+// is reused once the interval ends. Intervals that cross a call prefer
+// registers the call preserves and are otherwise split at the call.
+RegisterAllocation allocate_registers(Allocator allocator,
+                                      const IrFunction *function,
+                                      const TypeTable *types,
+                                      const RegisterFile *file);
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <allocator.h>
+#include <array.h>
+#include <hash_map.h>
+#include <interner.h>
+#include <parser.h>
+#include <stdint.h>
+#include <types.h>
+
+typedef enum {
+  UnknownTypeDiagnostic,
+  UndefinedSymbolDiagnostic,
+  RedefinitionDiagnostic,
+  TypeMismatchDiagnostic,
+  LiteralOutOfRangeDiagnostic,
+  UnsupportedOperatorDiagnostic,
+  UnknownAttributeDiagnostic,
+  NotCallableDiagnostic,
+  ArgumentCountDiagnostic,
+  OuterBindingDiagnostic,
+  GenericSliceDiagnostic,
+  GenericCallDiagnostic,
+  UninferredTypeArgumentDiagnostic,
+  TypeArgumentDiagnostic,
+} DiagnosticKind;
+
+typedef struct {
+  DiagnosticKind kind;
+  Span span;
+  // The name or literal text the diagnostic is about.
+  StringView subject;
+} Diagnostic;
+
+typedef Array(Diagnostic) DiagnosticArray;
+
+typedef struct {
+  SymbolId name;
+  TypeId type;
+  Span span;
+  const Expression *value;
+} Binding;
+
+static inline uint64_t hash_symbol_id(SymbolId symbol) {
+  return hash_integer(symbol);
+}
+
+DEFINE_HASH_MAP(BindingMap, binding_map, SymbolId, Binding, hash_symbol_id,
+                symbol_ids_equal)
+
+DEFINE_HASH_MAP(TypeNameMap, type_name_map, SymbolId, TypeId, hash_symbol_id,
+                symbol_ids_equal)
+
+// One flat table per scope, keyed by interned name. Lookups that miss walk
+// out to the enclosing scope.
+typedef struct Scope Scope;
+
+struct Scope {
+  BindingMap bindings;
+  Scope *parent;
+  // Set on the scope holding a function's parameters. Lookups that leave
+  // it only find functions, since a body cannot reach values computed by
+  // the top level expressions.
+  bool function;
+};
+
+typedef struct {
+  Allocator allocator;
+  Interner *interner;
+  TypeTable *types;
+  TypeNameMap type_names;
+  Scope *scope;
+  DiagnosticArray diagnostics;
+  // Set from Module.shared. Diagnostics are then located at anchor, the
+  // innermost expression that is not shared, since the spans of shared
+  // nodes may point at another occurrence.
+  bool shared_spans;
+  const Expression *anchor;
+  // The type parameters of the generic function being checked or lowered,
+  // which resolve_type_name finds before any other type name.
+  const Symbol *type_parameters;
+  uint32_t type_parameter_count;
+} Analyzer;
+
+void analyzer_init(Analyzer *analyzer, Allocator allocator, Interner *interner,
+                   TypeTable *types);
+
+// Checks a top level expression and records the bindings it introduces in
+// the current scope. Returns the type of the expression, or InvalidTypeId
+// when it could not be determined.
+TypeId analyze_expression(Analyzer *analyzer, const Expression *expression);
+
+void analyze_module(Analyzer *analyzer, Module module);
+
+const Binding *lookup_binding(const Analyzer *analyzer, SymbolId name);
+
+TypeId resolve_type_name(Analyzer *analyzer, const Expression *type);
+
+const char *diagnostic_message(DiagnosticKind kind);
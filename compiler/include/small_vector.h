@@ -0,0 +1,49 @@
+#pragma once
+
+#include <allocator.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Like Array but the first N elements live inside the struct, so short lists
+// never touch the allocator. capacity stays zero until the inline storage
+// overflows onto the heap. Copying the struct by value is safe.
+//
+//   typedef SmallVector(Expression *, 4) Arguments;
+#define SmallVector(T, N)                                                      \
+  struct {                                                                     \
+    size_t length;                                                             \
+    size_t capacity;                                                           \
+    union {                                                                    \
+      T inline_storage[N];                                                     \
+      T *heap;                                                                 \
+    };                                                                         \
+  }
+
+#define small_vector_inline_capacity(vector)                                   \
+  (sizeof((vector)->inline_storage) / sizeof((vector)->inline_storage[0]))
+
+#define small_vector_data(vector)                                              \
+  ((vector)->capacity == 0 ? (vector)->inline_storage : (vector)->heap)
+
+#define small_vector_push(allocator, vector, ...)                              \
+  do {                                                                         \
+    if ((vector)->length == ((vector)->capacity == 0                           \
+                                 ? small_vector_inline_capacity(vector)        \
+                                 : (vector)->capacity)) {                      \
+      void *heap = small_vector_grow(                                          \
+          allocator, small_vector_data(vector), &(vector)->capacity,           \
+          (vector)->length, small_vector_inline_capacity(vector),              \
+          sizeof((vector)->inline_storage[0]),                                 \
+          _Alignof(typeof((vector)->inline_storage[0])),                       \
+          call_site_here("SmallVector"));                                      \
+      (vector)->heap = heap;                                                   \
+    }                                                                          \
+    small_vector_data(vector)[(vector)->length++] = (__VA_ARGS__);             \
+  } while (false)
+
+#define small_vector_pop(vector) (small_vector_data(vector)[--(vector)->length])
+
+void *small_vector_grow(Allocator allocator, void *data, size_t *capacity,
+                        size_t length, size_t inline_capacity,
+                        size_t element_size, size_t alignment,
+                        CallSite call_site);
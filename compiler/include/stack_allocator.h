@@ -1,18 +1,60 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+typedef enum {
+  DefaultPages,
+  // The kernel was asked for transparent huge pages, whether it backs the
+  // range with them is up to it and can change over time.
+  RequestedHugePages,
+  HugeTlbPages,
+} PageKind;
+
+// A block the stack filled up and moved on from.
+typedef struct StackBlock StackBlock;
+
+struct StackBlock {
+  StackBlock *previous;
+  uint8_t *base;
+  size_t mapped_size;
+};
+
+// Bump allocates from the current block. When it fills up a block at least
+// twice as large is obtained the same way as the first one, so total_size
+// is only a first guess. Earlier blocks stay alive until reset or destroy.
 typedef struct {
   uint8_t *base;
   uint8_t *current_position;
   size_t total_size;
+  size_t mapped_size;
+  PageKind pages;
+  // Blocks filled before the current one, most recent first.
+  StackBlock *previous;
+  // Bytes handed out from the blocks in previous.
+  size_t retired_bytes;
 } StackAllocator;
 
 void *stack_allocate(void *allocator, size_t size, size_t alignment);
 
+bool stack_resize(void *allocator, void *memory, size_t old_size,
+                  size_t new_size);
+
 void stack_allocator_init(StackAllocator *stack, size_t total_size);
 
+// Backs the stack with 2 MiB pages when the system allows it. Tries reserved
+// hugetlbfs pages first, then asks for transparent huge pages, then settles
+// for normal pages from stack_allocator_init. stack->pages records which
+// one was used.
+void stack_allocator_init_huge_pages(StackAllocator *stack, size_t total_size);
+
+// Keeps only the current block, which is the largest.
 void stack_allocator_reset(StackAllocator *stack);
 
+// Bytes handed out since the last reset, alignment padding included.
+size_t stack_allocator_used(const StackAllocator *stack);
+
 void stack_allocator_destroy(StackAllocator *stack);
+
+const char *page_kind_name(PageKind pages);
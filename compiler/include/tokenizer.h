@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -107,3 +108,20 @@ typedef struct {
 } NextTokenResult;
 
 NextTokenResult next_token(Cursor cursor);
+
+// Tokens up to the end of the input, not counting the end itself.
+size_t count_tokens(Cursor cursor);
+
+typedef struct {
+  uint64_t value;
+  bool overflow;
+} DecodeIntResult;
+
+DecodeIntResult decode_int(Int int_);
+
+// Correctly rounded to the nearest double.
+double decode_float(Float float_);
+
+bool string_view_equal(StringView a, StringView b);
+
+uint64_t hash_string_view(StringView view);
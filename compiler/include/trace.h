@@ -0,0 +1,63 @@
+#pragma once
+
+#include <allocator.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// A span of work on one thread, a complete event in the trace.
+typedef struct {
+  // Both borrowed, they must live until the trace is written.
+  const char *name;
+  const char *file;
+  uint64_t begin_ns;
+  uint64_t end_ns;
+} TraceEvent;
+
+typedef struct TraceBuffer TraceBuffer;
+
+// Written only by the thread it belongs to. Events below length are
+// complete, so the trace may be written while threads still record.
+struct TraceBuffer {
+  TraceBuffer *next;
+  uint32_t thread;
+  _Atomic size_t length;
+  size_t capacity;
+  TraceEvent events[];
+};
+
+// Every thread records into buffers of its own, so recording an event is
+// a store and a release of the length. Threads only touch shared state to
+// push a buffer onto the list with a compare and swap, once per buffer
+// full of events.
+typedef struct {
+  // Called from every recording thread, so it has to be thread safe like a
+  // concurrent arena. The buffers live as long as its memory does.
+  Allocator allocator;
+  _Atomic(TraceBuffer *) buffers;
+  _Atomic uint32_t threads;
+  size_t buffer_capacity;
+  // Timestamps in the trace count from here.
+  uint64_t origin_ns;
+} Tracer;
+
+// Owned by a single thread.
+typedef struct {
+  Tracer *tracer;
+  TraceBuffer *buffer;
+  uint32_t thread;
+} TraceThread;
+
+void tracer_init(Tracer *tracer, Allocator allocator, size_t buffer_capacity,
+                 uint64_t origin_ns);
+
+// Gives the calling thread the next thread id of the trace.
+void trace_thread_init(TraceThread *thread, Tracer *tracer);
+
+void trace_event(TraceThread *thread, const char *name, const char *file,
+                 uint64_t begin_ns, uint64_t end_ns);
+
+// Writes the Chrome trace event format, which Perfetto and
+// chrome://tracing open, with timestamps in microseconds.
+void tracer_write_json(const Tracer *tracer, FILE *file);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <allocator.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+  CallSite call_site;
+  size_t bytes;
+  size_t allocations;
+} CallSiteStats;
+
+// Power of two so call sites can be found by masking their hash. Call sites
+// past this limit are folded into a single overflow entry.
+enum { TRACKED_CALL_SITE_CAPACITY = 256 };
+
+// Wraps another allocator and records what flows through it. In place
+// resizes are counted towards bytes but not allocations, and towards the
+// call site that allocated the block when it is the most recent one. Call
+// sites are only known when the build defines YETI_TRACK_ALLOCATIONS, and
+// then for allocations made through the allocate and allocate_bytes macros
+// or by the containers. Everything else is attributed to an unknown call
+// site.
+typedef struct {
+  Allocator backing;
+  size_t bytes;
+  size_t allocations;
+  size_t alignment_waste;
+  size_t peak_bytes;
+  const uint8_t *previous_end;
+  CallSiteStats *previous_call_site;
+  CallSiteStats call_sites[TRACKED_CALL_SITE_CAPACITY];
+  CallSiteStats overflow;
+} TrackingAllocator;
+
+void *tracking_allocate(void *allocator, size_t size, size_t alignment);
+
+bool tracking_resize(void *allocator, void *memory, size_t old_size,
+                     size_t new_size);
+
+void tracking_allocator_init(TrackingAllocator *tracking, Allocator backing);
+
+// Call after resetting the backing allocator. Peak usage is kept.
+void tracking_allocator_reset(TrackingAllocator *tracking);
+
+void tracking_allocator_write_json(const TrackingAllocator *tracking,
+                                   FILE *file);
+
+// Writes string as a quoted JSON string, or null.
+void write_json_string(FILE *file, const char *string);
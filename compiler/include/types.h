@@ -0,0 +1,141 @@
+#pragma once
+
+#include <allocator.h>
+#include <array.h>
+#include <stdint.h>
+#include <tokenizer.h>
+
+typedef enum {
+  InvalidType,
+  BoolType,
+  SignedIntType,
+  UnsignedIntType,
+  FloatType,
+  // lanes elements of the element type side by side, operated on
+  // element-wise.
+  VectorType,
+  // Stands for the type argument at index in a generic function until it
+  // is instantiated.
+  TypeParameterType,
+  // Named fields at fixed offsets. Struct values live in memory.
+  StructType,
+  // The address of the first of its elements of the element type. Their
+  // count is stored as a u64 right below it and indexes are checked
+  // against it.
+  SliceType,
+  // Takes arguments of the parameter types and returns the element type.
+  FunctionType,
+} TypeKind;
+
+typedef uint32_t TypeId;
+
+typedef struct {
+  StringView name;
+  TypeId type;
+  uint32_t offset;
+} StructField;
+
+typedef enum {
+  // Fields keep their declaration order instead of being sorted.
+  PinnedStruct = 1 << 0,
+  // Arrays of the struct keep every field in a column of its own.
+  SoaStruct = 1 << 1,
+} StructFlags;
+
+typedef struct {
+  TypeKind kind;
+  uint32_t size;
+  uint32_t alignment;
+  StringView name;
+  TypeId element;
+  uint32_t lanes;
+  uint32_t index;
+  // Fields of a struct in layout order, which is by increasing offset.
+  const StructField *fields;
+  uint32_t field_count;
+  uint32_t flags;
+  const TypeId *parameters;
+  uint32_t parameter_count;
+} Type;
+
+// Builtin types occupy the first ids of every table in this order.
+enum {
+  InvalidTypeId,
+  BoolTypeId,
+  I8TypeId,
+  I16TypeId,
+  I32TypeId,
+  I64TypeId,
+  U8TypeId,
+  U16TypeId,
+  U32TypeId,
+  U64TypeId,
+  F32TypeId,
+  F64TypeId,
+  F32x4TypeId,
+  F32x8TypeId,
+  I32x4TypeId,
+  I32x8TypeId,
+  BuiltinTypeCount,
+};
+
+typedef Array(Type) TypeArray;
+
+typedef struct {
+  Allocator allocator;
+  TypeArray types;
+} TypeTable;
+
+void type_table_init(TypeTable *table, Allocator allocator);
+
+const Type *lookup_type(const TypeTable *table, TypeId type);
+
+// The type parameter at index, created on first use.
+TypeId type_parameter(TypeTable *table, uint32_t index);
+
+// The slice of element, created on first use.
+TypeId slice_type(TypeTable *table, TypeId element);
+
+// The vector of lanes elements, which is one of the builtin vectors unless
+// the element is a type parameter. Created on first use.
+TypeId vector_type(TypeTable *table, TypeId element, uint32_t lanes);
+
+// The function type with the given result and parameters, created on
+// first use.
+TypeId function_type(TypeTable *table, TypeId result,
+                     const TypeId *parameters, uint32_t count);
+
+// The type with every type parameter replaced by the argument at its
+// index, looking through vectors, slices and function types.
+TypeId substitute_type(TypeTable *table, TypeId type,
+                       const TypeId *arguments);
+
+// Whether the type is or holds a type parameter.
+bool mentions_type_parameter(const TypeTable *table, TypeId type);
+
+// Matches a type that may hold type parameters against a concrete one.
+// Parameters without an argument yet, InvalidTypeId, take the part of type
+// they line up with. Returns whether the two agree everywhere else.
+bool bind_type_arguments(const TypeTable *table, TypeId pattern, TypeId type,
+                         TypeId *arguments);
+
+// Adds a struct with the given fields, whose offsets are filled in. Unless
+// pinned, fields are ordered by decreasing alignment, ties kept in
+// declaration order, so padding is only needed at the end.
+TypeId struct_type(TypeTable *table, StringView name,
+                   const StructField *fields, uint32_t count, uint32_t flags);
+
+// The field of a struct called name, or nullptr.
+const StructField *find_field(const TypeTable *table, TypeId type,
+                              StringView name);
+
+// Bytes taken by count elements of the type laid out side by side.
+uint64_t array_size(const TypeTable *table, TypeId element, uint64_t count);
+
+// Where the field at index field of element index lives in an array of
+// count elements of a struct. Arrays of SoA structs store each field as a
+// column of count values, in layout order, so a loop over one field
+// streams through contiguous memory.
+uint64_t field_offset_in_array(const TypeTable *table, TypeId type,
+                               uint32_t field, uint64_t index,
+                               uint64_t count);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <allocator.h>
+#include <ir.h>
+#include <stddef.h>
+#include <types.h>
+
+typedef struct {
+  // Instructions found to recompute an earlier value.
+  size_t removed;
+} ValueNumberingStats;
+
+// Global value numbering. Every instruction is keyed by its opcode, lane,
+// type and the value numbers of its operands, with the operands of
+// commutative integer operations sorted, and looked up in a hash table of
+// the values seen so far. A hit replaces the instruction by the earlier
+// value. The IR has no branches yet, so an instruction dominates everything
+// after it and one table serves the whole function. Memory operations,
+// parameters, arguments, calls and terminators are never merged.
+ValueNumberingStats number_values(Allocator allocator, IrFunction *function,
+                                  const TypeTable *types);
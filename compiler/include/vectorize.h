@@ -0,0 +1,74 @@
+#pragma once
+
+#include <allocator.h>
+#include <array.h>
+#include <ir.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <types.h>
+
+// What a target's vector units offer, which decides how wide groups get
+// and which operations have a packed instruction at all.
+typedef struct {
+  const char *name;
+  // 32 bit lanes in the widest vector register.
+  uint32_t max_lanes;
+  bool packed_i32_multiply;
+} VectorTarget;
+
+// SSE2 has 128 bit registers and no packed 32 bit multiply; AVX2 has 256
+// bit registers and vpmulld.
+extern const VectorTarget sse2_target;
+extern const VectorTarget avx2_target;
+
+typedef enum {
+  VectorizedRemark,
+  // Fewer independent instructions than the narrowest vector, so they
+  // stay scalar. Whatever is left over after the full width groups of a
+  // larger set is reported this way too.
+  TooFewLanesRemark,
+  UnsupportedOperationRemark,
+  NotProfitableRemark,
+  // A lane's result is needed before every lane's operands exist.
+  UsedTooEarlyRemark,
+} VectorizeRemarkKind;
+
+// One group of isomorphic instructions and what became of it.
+typedef struct {
+  VectorizeRemarkKind kind;
+  IrOpcode opcode;
+  TypeId type;
+  // The group's first instruction, numbered as before vectorizing.
+  IrValue first;
+  uint32_t lanes;
+  uint32_t scalar_cost;
+  uint32_t vector_cost;
+} VectorizeRemark;
+
+typedef Array(VectorizeRemark) VectorizeRemarkArray;
+
+typedef struct {
+  uint32_t vectorized;
+  uint32_t instructions_replaced;
+  VectorizeRemarkArray remarks;
+} VectorizeResult;
+
+// Packs independent isomorphic f32 and i32 arithmetic into vector
+// instructions. The IR has no loops, so this works on straight-line code:
+// instructions with the same opcode, type and depth in the dependence
+// graph cannot depend on one another, and are grouped in program order
+// into vectors of the target's width, then of four lanes, leaving the
+// rest scalar. Operands come from the vector of an earlier group when the
+// lanes line up, from a broadcast when every lane reads the same
+// constant, and are otherwise inserted lane by lane; scalar users get the
+// lanes they need extracted. Groups connected by reused vectors are kept
+// or dropped together, whichever the cost model finds cheaper.
+VectorizeResult vectorize(Allocator allocator, IrFunction *function,
+                          const VectorTarget *target);
+
+// One line per remark with the instruction numbers from before the pass,
+// then a summary.
+void vectorize_write_remarks(FILE *out, const VectorizeResult *result,
+                             const TypeTable *types,
+                             const VectorTarget *target);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <bytecode.h>
+#include <stdint.h>
+
+typedef enum {
+  VmOk,
+  VmDivisionByZero,
+  VmDivisionOverflow,
+} VmStatus;
+
+typedef struct {
+  VmStatus status;
+  uint64_t value;
+  // Vector results, laid out as in memory. value holds the first word.
+  uint64_t vector[4];
+} VmResult;
+
+// Runs a function with threaded dispatch. registers must have room for
+// function->register_count values.
+VmResult vm_run(const BytecodeFunction *function, uint64_t *registers);
+
+// The same interpreter dispatching through a switch, kept as a baseline
+// for the benchmarks and for compilers without labels as values.
+VmResult vm_run_switch(const BytecodeFunction *function, uint64_t *registers);
+
+const char *vm_status_message(VmStatus status);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <allocator.h>
+#include <array.h>
+#include <ir.h>
+#include <register_allocator.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <types.h>
+
+// Functions the generated code calls. Their addresses are not known while
+// generating, so each call goes through an 8 byte slot in a table after the
+// code. offset locates the call's 32 bit rip-relative displacement, which
+// already points at the slot the loader fills in; an object writer can
+// instead hand the displacement to the linker as a GOT reference.
+typedef enum {
+  FmodSymbol,
+  FmodfSymbol,
+  X64SymbolCount,
+} X64Symbol;
+
+typedef struct {
+  uint32_t offset;
+  X64Symbol symbol;
+} X64Relocation;
+
+typedef Array(uint8_t) X64ByteArray;
+
+typedef Array(X64Relocation) X64RelocationArray;
+
+// Instruction set extensions beyond the SSE2 baseline, as a bitmask.
+typedef enum {
+  X64Sse41 = 1 << 0,
+  X64Avx = 1 << 1,
+  X64Avx2 = 1 << 2,
+} X64Feature;
+
+// Machine code for a function with the C signature
+//
+//   VmStatus entry(uint64_t *result);
+//
+// which stores the returned value, in the same representation the VM uses,
+// through result and reports traps through its return value. Vectors are
+// stored whole, so result must have room for 32 bytes.
+typedef struct {
+  X64ByteArray bytes;
+  X64RelocationArray relocations;
+  // The extensions the code needs to run.
+  uint32_t features;
+} X64Code;
+
+typedef struct {
+  X64Code code;
+  RegisterAllocation registers;
+  bool supported;
+} X64CompileResult;
+
+// Every register the code generator may allocate. rax, rcx, rdx, xmm0 and
+// xmm1 are its scratch registers and must stay out of any register file.
+extern const RegisterFile x64_registers;
+
+X64CompileResult x64_compile(Allocator allocator, const IrFunction *function,
+                             const TypeTable *types);
+
+X64CompileResult x64_compile_with_registers(Allocator allocator,
+                                            const IrFunction *function,
+                                            const TypeTable *types,
+                                            const RegisterFile *file);
+
+const char *x64_symbol_name(X64Symbol symbol);
@@ -0,0 +1,47 @@
+#include "allocator.h"
+#include <stddef.h>
+#include <string.h>
+
+#ifdef YETI_TRACK_ALLOCATIONS
+
+static thread_local CallSite call_site;
+
+void *allocate_at_call_site(Allocator allocator, size_t size, size_t alignment,
+                            CallSite site) {
+  CallSite previous = call_site;
+  call_site = site;
+  void *result = allocator.allocate(allocator.state, size, alignment);
+  call_site = previous;
+  return result;
+}
+
+CallSite current_call_site() { return call_site; }
+
+CallSite swap_call_site(CallSite site) {
+  CallSite previous = call_site;
+  call_site = site;
+  return previous;
+}
+
+#endif
+
+size_t align_forward_adjustment(const void *address, size_t alignment) {
+  size_t adjustment = alignment - ((size_t)address & (alignment - 1));
+  if (adjustment == alignment) {
+    return 0; // Already aligned
+  }
+  return adjustment;
+}
+
+void *reallocate(Allocator allocator, void *memory, size_t old_size,
+                 size_t new_size, size_t alignment) {
+  if (memory != nullptr && allocator.resize != nullptr &&
+      allocator.resize(allocator.state, memory, old_size, new_size)) {
+    return memory;
+  }
+  void *result = allocator.allocate(allocator.state, new_size, alignment);
+  if (result != nullptr && memory != nullptr) {
+    memcpy(result, memory, old_size < new_size ? old_size : new_size);
+  }
+  return result;
+}
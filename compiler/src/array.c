@@ -0,0 +1,24 @@
+#include "array.h"
+#include "allocator.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+void *array_grow(Allocator allocator, void *data, size_t *capacity,
+                 size_t minimum_capacity, size_t element_size,
+                 size_t alignment, CallSite call_site) {
+  size_t new_capacity = *capacity < 4 ? 8 : *capacity * 2;
+  if (new_capacity < minimum_capacity) {
+    new_capacity = minimum_capacity;
+  }
+  CallSite previous = swap_call_site(call_site);
+  void *result = reallocate(allocator, data, *capacity * element_size,
+                            new_capacity * element_size, alignment);
+  swap_call_site(previous);
+  if (result == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  *capacity = new_capacity;
+  return result;
+}
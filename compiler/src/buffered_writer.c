@@ -0,0 +1,119 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "buffered_writer.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+void buffered_writer_init(BufferedWriter *writer, Allocator allocator, int fd,
+                          size_t capacity) {
+  *writer = (BufferedWriter){
+      .fd = fd,
+      .allocator = allocator,
+      .buffer = allocate_bytes(allocator, capacity, 1),
+      .capacity = capacity,
+  };
+  if (writer->buffer == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+}
+
+void write_fully(BufferedWriter *writer, const char *data, size_t length) {
+  while (length > 0 && !writer->failed) {
+    ssize_t written = write(writer->fd, data, length);
+    if (written < 0) {
+      if (errno != EINTR) {
+        writer->failed = true;
+      }
+      continue;
+    }
+    data += written;
+    length -= (size_t)written;
+  }
+}
+
+bool buffered_writer_flush(BufferedWriter *writer) {
+  write_fully(writer, writer->buffer, writer->length);
+  writer->length = 0;
+  return !writer->failed;
+}
+
+void buffered_write(BufferedWriter *writer, const char *data, size_t length) {
+  if (writer->length + length > writer->capacity) {
+    buffered_writer_flush(writer);
+    if (length > writer->capacity) {
+      write_fully(writer, data, length);
+      return;
+    }
+  }
+  memcpy(writer->buffer + writer->length, data, length);
+  writer->length += length;
+}
+
+void buffered_write_string(BufferedWriter *writer, const char *string) {
+  buffered_write(writer, string, strlen(string));
+}
+
+void buffered_write_char(BufferedWriter *writer, char c) {
+  if (writer->length == writer->capacity) {
+    buffered_writer_flush(writer);
+  }
+  writer->buffer[writer->length++] = c;
+}
+
+void buffered_write_unsigned(BufferedWriter *writer, uint64_t value) {
+  char digits[20];
+  size_t length = 0;
+  do {
+    digits[sizeof(digits) - ++length] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+  buffered_write(writer, digits + sizeof(digits) - length, length);
+}
+
+void buffered_write_signed(BufferedWriter *writer, int64_t value) {
+  if (value < 0) {
+    buffered_write_char(writer, '-');
+    buffered_write_unsigned(writer, 0 - (uint64_t)value);
+    return;
+  }
+  buffered_write_unsigned(writer, (uint64_t)value);
+}
+
+void buffered_write_format(BufferedWriter *writer, const char *format, ...) {
+  va_list arguments;
+  va_start(arguments, format);
+  size_t available = writer->capacity - writer->length;
+  int length = vsnprintf(writer->buffer + writer->length, available, format,
+                         arguments);
+  va_end(arguments);
+  if (length < 0) {
+    writer->failed = true;
+    return;
+  }
+  if ((size_t)length < available) {
+    writer->length += (size_t)length;
+    return;
+  }
+  // Did not fit: flush and format again, straight into a temporary when
+  // even an empty buffer is too small.
+  buffered_writer_flush(writer);
+  va_start(arguments, format);
+  if ((size_t)length < writer->capacity) {
+    vsnprintf(writer->buffer, writer->capacity, format, arguments);
+    writer->length = (size_t)length;
+  } else {
+    char *text = allocate_bytes(writer->allocator, (size_t)length + 1, 1);
+    if (text == nullptr) {
+      // TODO: report out of memory instead of panicking
+      assert(false);
+    }
+    vsnprintf(text, (size_t)length + 1, format, arguments);
+    write_fully(writer, text, (size_t)length);
+  }
+  va_end(arguments);
+}
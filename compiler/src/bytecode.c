@@ -0,0 +1,410 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "bytecode.h"
+#include "array.h"
+#include <assert.h>
+#include <string.h>
+
+void bytecode_emit(Allocator allocator, BytecodeFunction *function,
+                   BytecodeOpcode opcode, uint16_t a, uint16_t b, uint16_t c) {
+  array_push(allocator, &function->instructions,
+             (BytecodeInstruction){.opcode = opcode, .a = a, .b = b, .c = c});
+}
+
+void bytecode_emit_wide(Allocator allocator, BytecodeFunction *function,
+                        BytecodeOpcode opcode, uint16_t a, uint32_t operand) {
+  bytecode_emit(allocator, function, opcode, a, (uint16_t)operand,
+                (uint16_t)(operand >> 16));
+}
+
+void bytecode_load_constant(Allocator allocator, BytecodeFunction *function,
+                            uint16_t destination, uint64_t value) {
+  uint32_t index = (uint32_t)function->constants.length;
+  array_push(allocator, &function->constants, value);
+  bytecode_emit_wide(allocator, function, LoadConstBytecode, destination,
+                     index);
+}
+
+// IR constants are zero extended from their width, registers sign extend
+// signed integers.
+uint64_t canonical_constant(IrInstruction instruction, const Type *type) {
+  uint64_t bits = ir_constant_bits(instruction);
+  if (type->kind != SignedIntType) {
+    return bits;
+  }
+  uint32_t shift = 64 - type->size * 8;
+  return (uint64_t)((int64_t)(bits << shift) >> shift);
+}
+
+BytecodeOpcode int_opcode(IrOpcode opcode, bool is_signed) {
+  switch (opcode) {
+  case AddOp:
+    return AddIntBytecode;
+  case SubOp:
+    return SubIntBytecode;
+  case MulOp:
+    return MulIntBytecode;
+  case DivOp:
+    return is_signed ? DivSignedBytecode : DivUnsignedBytecode;
+  case ModOp:
+    return is_signed ? ModSignedBytecode : ModUnsignedBytecode;
+  case EqOp:
+    return EqIntBytecode;
+  case NeOp:
+    return NeIntBytecode;
+  case LtOp:
+  case GtOp:
+    return is_signed ? LtSignedBytecode : LtUnsignedBytecode;
+  case LeOp:
+  case GeOp:
+    return is_signed ? LeSignedBytecode : LeUnsignedBytecode;
+  default:
+    assert(false);
+  }
+}
+
+// The f64 opcodes mirror the f32 ones at a fixed distance.
+BytecodeOpcode float_opcode(IrOpcode opcode, uint32_t size) {
+  uint32_t offset = size == 8 ? AddF64Bytecode - AddF32Bytecode : 0;
+  switch (opcode) {
+  case AddOp:
+    return AddF32Bytecode + offset;
+  case SubOp:
+    return SubF32Bytecode + offset;
+  case MulOp:
+    return MulF32Bytecode + offset;
+  case DivOp:
+    return DivF32Bytecode + offset;
+  case ModOp:
+    return ModF32Bytecode + offset;
+  case EqOp:
+    return EqF32Bytecode + offset;
+  case NeOp:
+    return NeF32Bytecode + offset;
+  case LtOp:
+  case GtOp:
+    return LtF32Bytecode + offset;
+  case LeOp:
+  case GeOp:
+    return LeF32Bytecode + offset;
+  default:
+    assert(false);
+  }
+}
+
+// Narrow integer results are brought back into canonical form in place.
+void emit_extend(Allocator allocator, BytecodeFunction *function,
+                 uint16_t destination, const Type *type) {
+  if (type->size == 8) {
+    return;
+  }
+  BytecodeOpcode opcode = type->size == 1   ? SignExtend8Bytecode
+                          : type->size == 2 ? SignExtend16Bytecode
+                                            : SignExtend32Bytecode;
+  if (type->kind == UnsignedIntType) {
+    opcode += ZeroExtend8Bytecode - SignExtend8Bytecode;
+  }
+  bytecode_emit(allocator, function, opcode, destination, destination, 0);
+}
+
+BytecodeOpcode vector_opcode(IrOpcode opcode, const Type *element) {
+  if (element->kind == FloatType) {
+    switch (opcode) {
+    case AddOp:
+      return AddF32x2Bytecode;
+    case SubOp:
+      return SubF32x2Bytecode;
+    case MulOp:
+      return MulF32x2Bytecode;
+    case DivOp:
+      return DivF32x2Bytecode;
+    default:
+      assert(false);
+    }
+  }
+  switch (opcode) {
+  case AddOp:
+    return AddI32x2Bytecode;
+  case SubOp:
+    return SubI32x2Bytecode;
+  case MulOp:
+    return MulI32x2Bytecode;
+  default:
+    assert(false);
+  }
+}
+
+uint32_t register_words(const Type *type) {
+  return type->kind == VectorType ? type->size / 8 : 1;
+}
+
+void compile_binary(Allocator allocator, BytecodeFunction *function,
+                    const IrInstruction *instructions, IrValue value,
+                    const uint16_t *registers, const TypeTable *types) {
+  IrInstruction instruction = instructions[value];
+  IrOpcode opcode = instruction.opcode;
+  const Type *type =
+      lookup_type(types, instructions[instruction.operands[0]].type);
+  uint16_t destination = registers[value];
+  uint16_t left = registers[instruction.operands[0]];
+  uint16_t right = registers[instruction.operands[1]];
+  if (type->kind == VectorType) {
+    BytecodeOpcode vector =
+        vector_opcode(opcode, lookup_type(types, type->element));
+    for (uint16_t i = 0; i < register_words(type); ++i) {
+      bytecode_emit(allocator, function, vector, destination + i, left + i,
+                    right + i);
+    }
+    return;
+  }
+  // a > b is b < a, which also keeps NaN comparisons unordered.
+  if (opcode == GtOp || opcode == GeOp) {
+    uint16_t swap = left;
+    left = right;
+    right = swap;
+  }
+  if (type->kind == FloatType) {
+    bytecode_emit(allocator, function, float_opcode(opcode, type->size),
+                  destination, left, right);
+    return;
+  }
+  bool is_signed = type->kind == SignedIntType;
+  bytecode_emit(allocator, function, int_opcode(opcode, is_signed),
+                destination, left, right);
+  if (opcode == AddOp || opcode == SubOp || opcode == MulOp ||
+      (opcode == DivOp && is_signed)) {
+    emit_extend(allocator, function, destination, type);
+  }
+}
+
+// Vector constants broadcast one element, which is repeated to fill each
+// register.
+void load_vector_constant(Allocator allocator, BytecodeFunction *function,
+                          uint16_t destination, IrInstruction instruction,
+                          const Type *type, const TypeTable *types) {
+  uint32_t element_bits = lookup_type(types, type->element)->size * 8;
+  uint64_t bits = ir_constant_bits(instruction);
+  for (uint32_t shift = element_bits; shift < 64; shift *= 2) {
+    bits |= bits << shift;
+  }
+  uint32_t index = (uint32_t)function->constants.length;
+  array_push(allocator, &function->constants, bits);
+  for (uint16_t i = 0; i < register_words(type); ++i) {
+    bytecode_emit_wide(allocator, function, LoadConstBytecode,
+                       destination + i, index);
+  }
+}
+
+// Copies the vector, then overwrites the half register holding the lane.
+void compile_insert(Allocator allocator, BytecodeFunction *function,
+                    IrInstruction instruction, uint16_t destination,
+                    const uint16_t *registers, const Type *type) {
+  uint16_t vector = registers[instruction.operands[0]];
+  for (uint16_t i = 0; i < register_words(type); ++i) {
+    bytecode_emit(allocator, function, MoveBytecode, destination + i,
+                  vector + i, 0);
+  }
+  bytecode_emit(allocator, function,
+                instruction.lane % 2 == 0 ? InsertLowBytecode
+                                          : InsertHighBytecode,
+                destination + instruction.lane / 2,
+                registers[instruction.operands[1]], 0);
+}
+
+// Brings the lane down to the low half and into canonical form.
+void compile_extract(Allocator allocator, BytecodeFunction *function,
+                     IrInstruction instruction, uint16_t destination,
+                     const uint16_t *registers, const Type *type) {
+  uint16_t source = registers[instruction.operands[0]] + instruction.lane / 2;
+  bool high = instruction.lane % 2 == 1;
+  bytecode_emit(allocator, function,
+                high ? ExtractHighBytecode : MoveBytecode, destination,
+                source, 0);
+  if (type->kind == SignedIntType) {
+    bytecode_emit(allocator, function, SignExtend32Bytecode, destination,
+                  destination, 0);
+  } else if (!high) {
+    bytecode_emit(allocator, function, ZeroExtend32Bytecode, destination,
+                  destination, 0);
+  }
+}
+
+void release_registers(IrValue *free_heads, IrValue *free_next,
+                       const IrInstruction *instructions, IrValue value,
+                       const TypeTable *types) {
+  uint32_t words = register_words(lookup_type(types, instructions[value].type));
+  free_next[value] = free_heads[words];
+  free_heads[words] = value;
+}
+
+BytecodeFunction compile_bytecode(Allocator allocator,
+                                  const IrFunction *function,
+                                  const TypeTable *types) {
+  uint32_t length = (uint32_t)function->instructions.length;
+  const IrInstruction *instructions = function->instructions.data;
+  uint16_t *registers = allocate_bytes(
+      allocator, (length + 1) * sizeof(uint16_t), _Alignof(uint16_t));
+  uint32_t *ends = allocate_bytes(allocator, (length + 1) * sizeof(uint32_t),
+                                  _Alignof(uint32_t));
+  IrValue *free_next = allocate_bytes(
+      allocator, (length + 1) * sizeof(IrValue), _Alignof(IrValue));
+  if (registers == nullptr || ends == nullptr || free_next == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  memset(ends, 0xff, length * sizeof(uint32_t));
+  for (uint32_t i = 0; i < length; ++i) {
+    uint32_t count = ir_operand_count(instructions[i]);
+    for (uint32_t j = 0; j < count; ++j) {
+      ends[instructions[i].operands[j]] = i;
+    }
+  }
+  // Dead values hand their registers to later ones of the same width,
+  // chained through free_next. They are released after the instruction of
+  // their last use got its registers, since some results are written
+  // before all operands have been read.
+  IrValue free_heads[MaxRegisterWords + 1];
+  for (uint32_t words = 0; words <= MaxRegisterWords; ++words) {
+    free_heads[words] = IR_NO_VALUE;
+  }
+  BytecodeFunction bytecode = {.return_type = function->return_type};
+  for (uint32_t i = 0; i < length; ++i) {
+    uint32_t words = register_words(lookup_type(types, instructions[i].type));
+    assert(words <= MaxRegisterWords);
+    IrValue dead = free_heads[words];
+    if (dead != IR_NO_VALUE) {
+      registers[i] = registers[dead];
+      free_heads[words] = free_next[dead];
+    } else if (bytecode.register_count + words < BYTECODE_NO_REGISTER) {
+      registers[i] = (uint16_t)bytecode.register_count;
+      bytecode.register_count += words;
+    } else {
+      bytecode.too_many_registers = true;
+      return bytecode;
+    }
+    uint32_t count = ir_operand_count(instructions[i]);
+    for (uint32_t j = 0; j < count; ++j) {
+      IrValue operand = instructions[i].operands[j];
+      if (ends[operand] == i) {
+        release_registers(free_heads, free_next, instructions, operand, types);
+        // Only once when both operands are the same value.
+        ends[operand] = 0;
+      }
+    }
+    if (ends[i] == IR_NO_VALUE) {
+      release_registers(free_heads, free_next, instructions, i, types);
+    }
+  }
+  for (uint32_t i = 0; i < length; ++i) {
+    IrInstruction instruction = instructions[i];
+    const Type *type = lookup_type(types, instruction.type);
+    switch ((IrOpcode)instruction.opcode) {
+    case ConstOp:
+      if (type->kind == VectorType) {
+        load_vector_constant(allocator, &bytecode, registers[i], instruction,
+                             type, types);
+        break;
+      }
+      bytecode_load_constant(allocator, &bytecode, registers[i],
+                             canonical_constant(instruction, type));
+      break;
+    case ReturnOp: {
+      IrValue value = instruction.operands[0];
+      if (value == IR_NO_VALUE) {
+        bytecode_emit(allocator, &bytecode, ReturnBytecode,
+                      BYTECODE_NO_REGISTER, 0, 0);
+      } else if (type->kind == VectorType) {
+        bytecode_emit(allocator, &bytecode, ReturnVectorBytecode,
+                      registers[value], (uint16_t)register_words(type), 0);
+      } else {
+        bytecode_emit(allocator, &bytecode, ReturnBytecode, registers[value],
+                      0, 0);
+      }
+      break;
+    }
+    case InsertOp:
+      compile_insert(allocator, &bytecode, instruction, registers[i],
+                     registers, type);
+      break;
+    case ExtractOp:
+      compile_extract(allocator, &bytecode, instruction, registers[i],
+                      registers, type);
+      break;
+    case IrOpcodeCount:
+      assert(false);
+    default:
+      compile_binary(allocator, &bytecode, instructions, i, registers, types);
+      break;
+    }
+  }
+  return bytecode;
+}
+
+static const char *opcode_names[BytecodeOpcodeCount] = {
+    [LoadConstBytecode] = "load_const",
+    [MoveBytecode] = "move",
+    [AddIntBytecode] = "add_int",
+    [SubIntBytecode] = "sub_int",
+    [MulIntBytecode] = "mul_int",
+    [DivSignedBytecode] = "div_signed",
+    [DivUnsignedBytecode] = "div_unsigned",
+    [ModSignedBytecode] = "mod_signed",
+    [ModUnsignedBytecode] = "mod_unsigned",
+    [EqIntBytecode] = "eq_int",
+    [NeIntBytecode] = "ne_int",
+    [LtSignedBytecode] = "lt_signed",
+    [LeSignedBytecode] = "le_signed",
+    [LtUnsignedBytecode] = "lt_unsigned",
+    [LeUnsignedBytecode] = "le_unsigned",
+    [SignExtend8Bytecode] = "sign_extend8",
+    [SignExtend16Bytecode] = "sign_extend16",
+    [SignExtend32Bytecode] = "sign_extend32",
+    [ZeroExtend8Bytecode] = "zero_extend8",
+    [ZeroExtend16Bytecode] = "zero_extend16",
+    [ZeroExtend32Bytecode] = "zero_extend32",
+    [AddF32Bytecode] = "add_f32",
+    [SubF32Bytecode] = "sub_f32",
+    [MulF32Bytecode] = "mul_f32",
+    [DivF32Bytecode] = "div_f32",
+    [ModF32Bytecode] = "mod_f32",
+    [EqF32Bytecode] = "eq_f32",
+    [NeF32Bytecode] = "ne_f32",
+    [LtF32Bytecode] = "lt_f32",
+    [LeF32Bytecode] = "le_f32",
+    [AddF64Bytecode] = "add_f64",
+    [SubF64Bytecode] = "sub_f64",
+    [MulF64Bytecode] = "mul_f64",
+    [DivF64Bytecode] = "div_f64",
+    [ModF64Bytecode] = "mod_f64",
+    [EqF64Bytecode] = "eq_f64",
+    [NeF64Bytecode] = "ne_f64",
+    [LtF64Bytecode] = "lt_f64",
+    [LeF64Bytecode] = "le_f64",
+    [AddF32x2Bytecode] = "add_f32x2",
+    [SubF32x2Bytecode] = "sub_f32x2",
+    [MulF32x2Bytecode] = "mul_f32x2",
+    [DivF32x2Bytecode] = "div_f32x2",
+    [AddI32x2Bytecode] = "add_i32x2",
+    [SubI32x2Bytecode] = "sub_i32x2",
+    [MulI32x2Bytecode] = "mul_i32x2",
+    [InsertLowBytecode] = "insert_low",
+    [InsertHighBytecode] = "insert_high",
+    [ExtractHighBytecode] = "extract_high",
+    [JumpBytecode] = "jump",
+    [JumpIfBytecode] = "jump_if",
+    [ReturnBytecode] = "return",
+    [ReturnVectorBytecode] = "return_vector",
+};
+
+const char *bytecode_opcode_name(BytecodeOpcode opcode) {
+  return opcode < BytecodeOpcodeCount ? opcode_names[opcode] : "<invalid>";
+}
+
+void bytecode_dump(const BytecodeFunction *function, FILE *out) {
+  for (size_t i = 0; i < function->instructions.length; ++i) {
+    BytecodeInstruction instruction = function->instructions.data[i];
+    fprintf(out, "%4zu  %-14s %u, %u, %u\n", i,
+            bytecode_opcode_name(instruction.opcode), instruction.a,
+            instruction.b, instruction.c);
+  }
+}
@@ -0,0 +1,346 @@
+#include "c_backend.h"
+#include "vm.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+const char *c_type_name(const Type *type) {
+  switch (type->kind) {
+  case BoolType:
+    return "bool";
+  case SignedIntType:
+    return type->size == 1   ? "int8_t"
+           : type->size == 2 ? "int16_t"
+           : type->size == 4 ? "int32_t"
+                             : "int64_t";
+  case UnsignedIntType:
+    return type->size == 1   ? "uint8_t"
+           : type->size == 2 ? "uint16_t"
+           : type->size == 4 ? "uint32_t"
+                             : "uint64_t";
+  case FloatType:
+    return type->size == 4 ? "float" : "double";
+  case VectorType:
+    if (type->element == F32TypeId) {
+      return type->lanes == 4 ? "yeti_f32x4" : "yeti_f32x8";
+    }
+    return type->lanes == 4 ? "yeti_i32x4" : "yeti_i32x8";
+  case InvalidType:
+    return "void";
+  case TypeParameterType:
+    // Generic functions reach the backends only once instantiated.
+    assert(false);
+  case StructType:
+  case SliceType:
+  case FunctionType:
+    // Lowered to addresses or calls before reaching the backends.
+    assert(false);
+  }
+  assert(false);
+}
+
+// The type wrapping arithmetic is computed in. Narrow types would promote
+// to int, where uint16_t * uint16_t can overflow, so they use 32 bits.
+const char *c_wrapping_name(const Type *type) {
+  if (type->kind == VectorType) {
+    return type->lanes == 4 ? "yeti_u32x4" : "yeti_u32x8";
+  }
+  return type->size == 8 ? "uint64_t" : "uint32_t";
+}
+
+static const char *preamble =
+    "// Generated by the Yeti compiler.\n"
+    "#include <inttypes.h>\n"
+    "#include <math.h>\n"
+    "#include <stdbool.h>\n"
+    "#include <stdint.h>\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "\n"
+    "// yeti_main is static, so how 32 byte vectors are returned without AVX\n"
+    "// is never visible to other code.\n"
+    "#if defined(__GNUC__) && !defined(__clang__)\n"
+    "#pragma GCC diagnostic ignored \"-Wpsabi\"\n"
+    "#endif\n"
+    "typedef float yeti_f32x4 __attribute__((vector_size(16)));\n"
+    "typedef float yeti_f32x8 __attribute__((vector_size(32)));\n"
+    "typedef int32_t yeti_i32x4 __attribute__((vector_size(16)));\n"
+    "typedef int32_t yeti_i32x8 __attribute__((vector_size(32)));\n"
+    "typedef uint32_t yeti_u32x4 __attribute__((vector_size(16)));\n"
+    "typedef uint32_t yeti_u32x8 __attribute__((vector_size(32)));\n"
+    "\n"
+    "static void yeti_trap(const char *message) {\n"
+    "  fprintf(stderr, \"error: %s\\n\", message);\n"
+    "  exit(EXIT_FAILURE);\n"
+    "}\n"
+    "\n"
+    "// NaNs have no literal that keeps their sign and payload.\n"
+    "static inline float yeti_f32_from_bits(uint32_t bits) {\n"
+    "  float value;\n"
+    "  memcpy(&value, &bits, sizeof(value));\n"
+    "  return value;\n"
+    "}\n"
+    "\n"
+    "static inline double yeti_f64_from_bits(uint64_t bits) {\n"
+    "  double value;\n"
+    "  memcpy(&value, &bits, sizeof(value));\n"
+    "  return value;\n"
+    "}\n"
+    "\n";
+
+void write_value(BufferedWriter *writer, IrValue value) {
+  buffered_write_char(writer, 'v');
+  buffered_write_unsigned(writer, value);
+}
+
+void write_constant(BufferedWriter *writer, IrInstruction instruction,
+                    const Type *type) {
+  uint64_t bits = ir_constant_bits(instruction);
+  switch (type->kind) {
+  case BoolType:
+    buffered_write_string(writer, bits ? "true" : "false");
+    return;
+  case SignedIntType: {
+    uint32_t shift = 64 - type->size * 8;
+    int64_t value = (int64_t)(bits << shift) >> shift;
+    buffered_write_format(writer, "(%s)", c_type_name(type));
+    // INT64_MIN has no literal of its own.
+    if (value == INT64_MIN) {
+      buffered_write_string(writer, "INT64_MIN");
+    } else {
+      buffered_write_string(writer, "INT64_C(");
+      buffered_write_signed(writer, value);
+      buffered_write_char(writer, ')');
+    }
+    return;
+  }
+  case UnsignedIntType:
+    buffered_write_format(writer, "(%s)UINT64_C(", c_type_name(type));
+    buffered_write_unsigned(writer, bits);
+    buffered_write_char(writer, ')');
+    return;
+  case FloatType:
+    // Hexadecimal literals round trip every other value exactly, NaNs are
+    // rebuilt from their bits.
+    if (type->size == 4) {
+      uint32_t narrow = (uint32_t)bits;
+      float value;
+      memcpy(&value, &narrow, sizeof(value));
+      if (isnan(value)) {
+        buffered_write_format(
+            writer, "yeti_f32_from_bits(UINT32_C(0x%" PRIx32 "))", narrow);
+      } else if (isinf(value)) {
+        buffered_write_string(writer, value < 0 ? "-INFINITY" : "INFINITY");
+      } else {
+        buffered_write_format(writer, "%af", (double)value);
+      }
+    } else {
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      if (isnan(value)) {
+        buffered_write_format(
+            writer, "yeti_f64_from_bits(UINT64_C(0x%" PRIx64 "))", bits);
+      } else if (isinf(value)) {
+        buffered_write_string(writer, value < 0 ? "-(double)INFINITY"
+                                                : "(double)INFINITY");
+      } else {
+        buffered_write_format(writer, "%a", value);
+      }
+    }
+    return;
+  case VectorType:
+  case InvalidType:
+  case TypeParameterType:
+  case StructType:
+  case SliceType:
+  case FunctionType:
+    assert(false);
+  }
+}
+
+// Vector constants broadcast their element to every lane.
+void write_vector_constant(BufferedWriter *writer, IrInstruction instruction,
+                           const Type *type, const Type *element) {
+  buffered_write_format(writer, "(%s){", c_type_name(type));
+  for (uint32_t i = 0; i < type->lanes; ++i) {
+    buffered_write_string(writer, i == 0 ? "" : ", ");
+    write_constant(writer, instruction, element);
+  }
+  buffered_write_char(writer, '}');
+}
+
+static const char *c_operators[IrOpcodeCount] = {
+    [AddOp] = " + ", [SubOp] = " - ", [MulOp] = " * ",  [DivOp] = " / ",
+    [ModOp] = " % ", [EqOp] = " == ", [NeOp] = " != ", [LtOp] = " < ",
+    [LeOp] = " <= ", [GtOp] = " > ",  [GeOp] = " >= ",
+};
+
+void write_division(BufferedWriter *writer, IrInstruction instruction,
+                    const Type *type) {
+  IrValue left = instruction.operands[0];
+  IrValue right = instruction.operands[1];
+  bool is_div = instruction.opcode == DivOp;
+  buffered_write_string(writer, "(");
+  write_value(writer, right);
+  buffered_write_string(writer, " == 0 ? (yeti_trap(\"");
+  buffered_write_string(writer, vm_status_message(VmDivisionByZero));
+  buffered_write_string(writer, "\"), 0) : ");
+  if (type->kind == SignedIntType) {
+    // Dividing by -1 is negation, which only overflows for INT64_MIN; C
+    // leaves INT_MIN / -1 undefined at every width so it never reaches /.
+    write_value(writer, right);
+    buffered_write_string(writer, " == -1 ? ");
+    if (!is_div) {
+      buffered_write_string(writer, "0");
+    } else {
+      if (type->size == 8) {
+        buffered_write_string(writer, "(");
+        write_value(writer, left);
+        buffered_write_string(writer, " == INT64_MIN ? (yeti_trap(\"");
+        buffered_write_string(writer, vm_status_message(VmDivisionOverflow));
+        buffered_write_string(writer, "\"), 0) : ");
+      }
+      buffered_write_format(writer, "(%s)(0u - (%s)", c_type_name(type),
+                            c_wrapping_name(type));
+      write_value(writer, left);
+      buffered_write_string(writer, type->size == 8 ? "))" : ")");
+    }
+    buffered_write_string(writer, " : ");
+  }
+  write_value(writer, left);
+  buffered_write_string(writer, c_operators[instruction.opcode]);
+  write_value(writer, right);
+  buffered_write_string(writer, ")");
+}
+
+void write_binary(BufferedWriter *writer, IrInstruction instruction,
+                  const Type *type) {
+  IrOpcode opcode = instruction.opcode;
+  bool is_integer =
+      type->kind == SignedIntType || type->kind == UnsignedIntType;
+  if (is_integer && (opcode == DivOp || opcode == ModOp)) {
+    write_division(writer, instruction, type);
+    return;
+  }
+  if (type->kind == FloatType && opcode == ModOp) {
+    buffered_write_string(writer, type->size == 4 ? "fmodf(" : "fmod(");
+    write_value(writer, instruction.operands[0]);
+    buffered_write_string(writer, ", ");
+    write_value(writer, instruction.operands[1]);
+    buffered_write_char(writer, ')');
+    return;
+  }
+  bool wraps = (is_integer && !ir_is_comparison(opcode)) ||
+               (type->kind == VectorType && type->element != F32TypeId);
+  if (wraps) {
+    buffered_write_format(writer, "(%s)((%s)", c_type_name(type),
+                          c_wrapping_name(type));
+  }
+  write_value(writer, instruction.operands[0]);
+  buffered_write_string(writer, c_operators[opcode]);
+  if (wraps) {
+    buffered_write_format(writer, "(%s)", c_wrapping_name(type));
+  }
+  write_value(writer, instruction.operands[1]);
+  if (wraps) {
+    buffered_write_char(writer, ')');
+  }
+}
+
+void write_print(BufferedWriter *writer, const Type *type) {
+  switch (type->kind) {
+  case BoolType:
+    buffered_write_string(writer,
+                          "  puts(result ? \"true\" : \"false\");\n");
+    return;
+  case SignedIntType:
+    buffered_write_string(
+        writer, "  printf(\"%\" PRId64 \"\\n\", (int64_t)result);\n");
+    return;
+  case UnsignedIntType:
+    buffered_write_string(
+        writer, "  printf(\"%\" PRIu64 \"\\n\", (uint64_t)result);\n");
+    return;
+  case FloatType:
+    buffered_write_string(writer, type->size == 4
+                                      ? "  printf(\"%.9g\\n\", result);\n"
+                                      : "  printf(\"%.17g\\n\", result);\n");
+    return;
+  case VectorType:
+    buffered_write_format(writer, "  for (int i = 0; i < %u; ++i) {\n",
+                          type->lanes);
+    buffered_write_string(
+        writer, type->element == F32TypeId
+                    ? "    printf(i == 0 ? \"[%.9g\" : \", %.9g\", "
+                      "(double)result[i]);\n"
+                    : "    printf(i == 0 ? \"[%\" PRId64 : \", %\" PRId64, "
+                      "(int64_t)result[i]);\n");
+    buffered_write_string(writer, "  }\n  puts(\"]\");\n");
+    return;
+  case InvalidType:
+    return;
+  case TypeParameterType:
+  case StructType:
+  case SliceType:
+  case FunctionType:
+    assert(false);
+  }
+}
+
+void emit_c(BufferedWriter *writer, const IrFunction *function,
+            const TypeTable *types) {
+  const Type *return_type = lookup_type(types, function->return_type);
+  buffered_write_string(writer, preamble);
+  buffered_write_format(writer, "static %s yeti_main(void) {\n",
+                        c_type_name(return_type));
+  const IrInstruction *instructions = function->instructions.data;
+  for (uint32_t i = 0; i < function->instructions.length; ++i) {
+    IrInstruction instruction = instructions[i];
+    if (instruction.opcode == ReturnOp) {
+      buffered_write_string(writer, "  return");
+      if (instruction.operands[0] != IR_NO_VALUE) {
+        buffered_write_char(writer, ' ');
+        write_value(writer, instruction.operands[0]);
+      }
+      buffered_write_string(writer, ";\n");
+      continue;
+    }
+    const Type *type = lookup_type(types, instruction.type);
+    buffered_write_format(writer, "  %s ", c_type_name(type));
+    write_value(writer, i);
+    buffered_write_string(writer, " = ");
+    if (instruction.opcode == InsertOp) {
+      write_value(writer, instruction.operands[0]);
+      buffered_write_string(writer, ";\n  ");
+      write_value(writer, i);
+      buffered_write_format(writer, "[%u] = ", instruction.lane);
+      write_value(writer, instruction.operands[1]);
+    } else if (instruction.opcode == ExtractOp) {
+      write_value(writer, instruction.operands[0]);
+      buffered_write_format(writer, "[%u]", instruction.lane);
+    } else if (instruction.opcode == ConstOp && type->kind == VectorType) {
+      write_vector_constant(writer, instruction, type,
+                            lookup_type(types, type->element));
+    } else if (instruction.opcode == ConstOp) {
+      write_constant(writer, instruction, type);
+    } else {
+      write_binary(writer, instruction,
+                   lookup_type(types,
+                               instructions[instruction.operands[0]].type));
+    }
+    buffered_write_string(writer, ";\n");
+  }
+  buffered_write_string(writer, "}\n\nint main(void) {\n");
+  if (function->return_type == InvalidTypeId) {
+    buffered_write_string(writer, "  yeti_main();\n");
+  } else {
+    buffered_write_format(writer, "  %s result = yeti_main();\n",
+                          c_type_name(return_type));
+    write_print(writer, return_type);
+  }
+  buffered_write_string(writer, "  return EXIT_SUCCESS;\n}\n");
+}
@@ -0,0 +1,110 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "compile_stats.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <time.h>
+
+uint64_t monotonic_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+uint64_t compile_stats_lap(CompileStats *stats, Phase phase, uint64_t begin) {
+  uint64_t end = monotonic_ns();
+  stats->nanoseconds[phase] += end - begin;
+  return end;
+}
+
+const char *phase_name(Phase phase) {
+  switch (phase) {
+  case ReadPhase:
+    return "read";
+  case LexPhase:
+    return "lex";
+  case ParsePhase:
+    return "parse";
+  case AnalyzePhase:
+    return "analyze";
+  case LowerPhase:
+    return "lower";
+  case OptimizePhase:
+    return "optimize";
+  case CodegenPhase:
+    return "codegen";
+  case RunPhase:
+    return "run";
+  case CcPhase:
+    return "cc";
+  case PhaseCount:
+    break;
+  }
+  assert(false);
+}
+
+uint64_t compile_stats_total_ns(const CompileStats *stats) {
+  uint64_t total = 0;
+  for (size_t i = 0; i < PhaseCount; ++i) {
+    if (i != LexPhase) {
+      total += stats->nanoseconds[i];
+    }
+  }
+  return total;
+}
+
+void write_table_row(FILE *file, const char *name, uint64_t nanoseconds,
+                     uint64_t total) {
+  fprintf(file, "%-12s %10.3f ms %6.1f%%\n", name, nanoseconds / 1e6,
+          total == 0 ? 0.0 : 100.0 * nanoseconds / total);
+}
+
+// Lexing is listed under parse, which it is part of.
+void compile_stats_write_table(const CompileStats *stats, FILE *file) {
+  uint64_t total = compile_stats_total_ns(stats);
+  for (size_t i = 0; i < PhaseCount; ++i) {
+    if (i != LexPhase) {
+      write_table_row(file, phase_name(i), stats->nanoseconds[i], total);
+    }
+    if (i == ParsePhase) {
+      write_table_row(file, "  lex", stats->nanoseconds[LexPhase], total);
+    }
+  }
+  fprintf(file, "%-12s %10.3f ms\n", "total", total / 1e6);
+  fprintf(file,
+          "%-12s %10zu\n%-12s %10zu\n%-12s %10zu\n%-12s %10zu\n"
+          "%-12s %10zu\n%-12s %10zu\n",
+          "files", stats->files, "bytes", stats->source_bytes, "tokens",
+          stats->tokens, "nodes", stats->nodes, "instructions",
+          stats->instructions, "arena bytes", stats->arena_bytes);
+}
+
+void compile_stats_write_json(const CompileStats *stats, FILE *file) {
+  fprintf(file, "{\n  \"phases\": {");
+  for (size_t i = 0; i < PhaseCount; ++i) {
+    if (i == LexPhase) {
+      continue;
+    }
+    fprintf(file, "%s\n    \"%s\": {\"nanoseconds\": %llu",
+            i == 0 ? "" : ",", phase_name(i),
+            (unsigned long long)stats->nanoseconds[i]);
+    if (i == ParsePhase) {
+      fprintf(file, ", \"lex\": {\"nanoseconds\": %llu}",
+              (unsigned long long)stats->nanoseconds[LexPhase]);
+    }
+    fputc('}', file);
+  }
+  fprintf(file,
+          "\n  },\n"
+          "  \"total_nanoseconds\": %llu,\n"
+          "  \"files\": %zu,\n"
+          "  \"source_bytes\": %zu,\n"
+          "  \"tokens\": %zu,\n"
+          "  \"nodes\": %zu,\n"
+          "  \"instructions\": %zu,\n"
+          "  \"arena_bytes\": %zu\n"
+          "}\n",
+          (unsigned long long)compile_stats_total_ns(stats), stats->files,
+          stats->source_bytes, stats->tokens, stats->nodes,
+          stats->instructions, stats->arena_bytes);
+}
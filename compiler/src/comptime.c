@@ -0,0 +1,234 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "comptime.h"
+#include "constant_fold.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+const ComptimeLimits default_comptime_limits = {.max_steps = 1 << 20,
+                                                .max_memory = 1 << 20};
+
+void comptime_init(Comptime *comptime, Allocator allocator,
+                   const IrModule *module, const TypeTable *types,
+                   const ComptimeLimits *limits) {
+  *comptime = (Comptime){.allocator = allocator,
+                         .module = module,
+                         .types = types,
+                         .limits = *limits};
+}
+
+// Pushes a frame for function with room for all of its values, leaving the
+// parameters for the caller to fill in.
+bool comptime_push(Comptime *comptime, uint32_t function) {
+  const IrFunction *callee = &comptime->module->functions.data[function];
+  size_t length = callee->instructions.length;
+  size_t memory = (comptime->values.length + length) * sizeof(uint64_t) +
+                  (comptime->frames.length + 1) * sizeof(ComptimeFrame);
+  if (memory > comptime->limits.max_memory) {
+    comptime->stats.over_memory_limit += 1;
+    return false;
+  }
+  uint32_t values = (uint32_t)comptime->values.length;
+  array_reserve(comptime->allocator, &comptime->values, values + length);
+  comptime->values.length = values + length;
+  array_push(comptime->allocator, &comptime->frames,
+             (ComptimeFrame){.function = function, .values = values});
+  return true;
+}
+
+void comptime_memoize(Comptime *comptime, const ComptimeFrame *frame,
+                      uint64_t result) {
+  uint32_t count =
+      comptime->module->functions.data[frame->function].parameter_count;
+  uint64_t *arguments = allocate_bytes(
+      comptime->allocator, count * sizeof(uint64_t) + 1, _Alignof(uint64_t));
+  if (arguments == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  memcpy(arguments, comptime->values.data + frame->values,
+         count * sizeof(uint64_t));
+  CallKey key = {
+      .function = frame->function, .count = count, .arguments = arguments};
+  map_insert(call_memo, comptime->allocator, &comptime->memo, key, result);
+}
+
+ComptimeResult comptime_stop(Comptime *comptime, ComptimeStatus status) {
+  if (status == ComptimeNotConstant) {
+    comptime->stats.not_constant += 1;
+  } else if (status == ComptimeStepLimit) {
+    comptime->stats.over_step_limit += 1;
+  }
+  return (ComptimeResult){.status = status};
+}
+
+// Runs the frames on the stack until the first one returns.
+ComptimeResult comptime_run(Comptime *comptime) {
+  const IrFunction *functions = comptime->module->functions.data;
+  uint64_t step_limit = comptime->stats.steps + comptime->limits.max_steps;
+  while (true) {
+    ComptimeFrame *frame = &array_last(&comptime->frames);
+    const IrFunction *function = &functions[frame->function];
+    IrInstruction instruction = function->instructions.data[frame->next];
+    uint64_t *values = comptime->values.data + frame->values;
+    if (comptime->stats.steps++ == step_limit) {
+      return comptime_stop(comptime, ComptimeStepLimit);
+    }
+    if (lookup_type(comptime->types, instruction.type)->kind == VectorType) {
+      return comptime_stop(comptime, ComptimeNotConstant);
+    }
+    switch ((IrOpcode)instruction.opcode) {
+    case ParamOp:
+      break;
+    case ConstOp:
+      values[frame->next] = ir_constant_bits(instruction);
+      break;
+    case ArgOp:
+      values[frame->next] = values[instruction.operands[0]];
+      break;
+    case CallOp: {
+      uint32_t callee = instruction.operands[0];
+      uint32_t count = functions[callee].parameter_count;
+      uint32_t arguments = frame->values + frame->next - count;
+      CallKey key = {.function = callee,
+                     .count = count,
+                     .arguments = comptime->values.data + arguments};
+      uint64_t *memoized = call_memo_find(&comptime->memo, key);
+      if (memoized != nullptr) {
+        comptime->stats.memo_hits += 1;
+        values[frame->next] = *memoized;
+        break;
+      }
+      if (!comptime_push(comptime, callee)) {
+        return (ComptimeResult){.status = ComptimeMemoryLimit};
+      }
+      // The caller resumes at the call once the callee returns.
+      memcpy(comptime->values.data + array_last(&comptime->frames).values,
+             comptime->values.data + arguments, count * sizeof(uint64_t));
+      continue;
+    }
+    case ReturnOp: {
+      IrValue returned = instruction.operands[0];
+      uint64_t result = returned == IR_NO_VALUE ? 0 : values[returned];
+      comptime_memoize(comptime, frame, result);
+      comptime->values.length = frame->values;
+      comptime->frames.length -= 1;
+      if (comptime->frames.length == 0) {
+        return (ComptimeResult){.status = ComptimeOk, .bits = result};
+      }
+      ComptimeFrame *caller = &array_last(&comptime->frames);
+      comptime->values.data[caller->values + caller->next] = result;
+      caller->next += 1;
+      continue;
+    }
+    case InsertOp:
+    case ExtractOp:
+    case AllocOp:
+    case LoadOp:
+    case StoreOp:
+      return comptime_stop(comptime, ComptimeNotConstant);
+    default: {
+      IrValue left = instruction.operands[0];
+      IrValue right = instruction.operands[1];
+      FoldResult folded = fold_binary(
+          comptime->types, instruction.opcode,
+          function->instructions.data[left].type, values[left], values[right]);
+      if (!folded.folded) {
+        return comptime_stop(comptime, ComptimeNotConstant);
+      }
+      values[frame->next] = folded.bits;
+    }
+    }
+    frame->next += 1;
+  }
+}
+
+ComptimeResult comptime_call(Comptime *comptime, uint32_t function,
+                             const uint64_t *arguments) {
+  uint32_t count = comptime->module->functions.data[function].parameter_count;
+  CallKey key = {.function = function, .count = count, .arguments = arguments};
+  uint64_t *memoized = call_memo_find(&comptime->memo, key);
+  if (memoized != nullptr) {
+    comptime->stats.memo_hits += 1;
+    return (ComptimeResult){.status = ComptimeOk, .bits = *memoized};
+  }
+  comptime->frames.length = 0;
+  comptime->values.length = 0;
+  if (!comptime_push(comptime, function)) {
+    return (ComptimeResult){.status = ComptimeMemoryLimit};
+  }
+  if (count > 0) {
+    memcpy(comptime->values.data, arguments, count * sizeof(uint64_t));
+  }
+  return comptime_run(comptime);
+}
+
+// Whether every argument of the call at index call is a constant, which
+// are then gathered into arguments.
+bool constant_arguments(Comptime *comptime, const IrFunction *function,
+                        uint32_t call, ComptimeValueArray *arguments) {
+  const IrInstruction *instructions = function->instructions.data;
+  uint32_t callee = instructions[call].operands[0];
+  uint32_t count = comptime->module->functions.data[callee].parameter_count;
+  arguments->length = 0;
+  for (uint32_t k = call - count; k < call; ++k) {
+    IrInstruction argument = instructions[instructions[k].operands[0]];
+    if (argument.opcode != ConstOp) {
+      return false;
+    }
+    array_push(comptime->allocator, arguments, ir_constant_bits(argument));
+  }
+  return true;
+}
+
+ComptimeStats evaluate_constant_calls(Comptime *comptime, IrModule *module) {
+  assert(module == comptime->module);
+  Allocator allocator = comptime->allocator;
+  ComptimeValueArray arguments = {};
+  for (size_t f = 0; f < module->functions.length; ++f) {
+    IrFunction *function = &module->functions.data[f];
+    IrInstruction *instructions = function->instructions.data;
+    uint32_t length = (uint32_t)function->instructions.length;
+    bool *keep = nullptr;
+    for (uint32_t i = 0; i < length; ++i) {
+      if (instructions[i].opcode != CallOp ||
+          !constant_arguments(comptime, function, i, &arguments)) {
+        continue;
+      }
+      comptime->stats.calls += 1;
+      ComptimeResult result =
+          comptime_call(comptime, instructions[i].operands[0], arguments.data);
+      if (result.status != ComptimeOk) {
+        continue;
+      }
+      comptime->stats.evaluated += 1;
+      instructions[i].opcode = ConstOp;
+      instructions[i].operands[0] = (uint32_t)result.bits;
+      instructions[i].operands[1] = (uint32_t)(result.bits >> 32);
+      if (keep == nullptr) {
+        keep = allocate_bytes(allocator, length * sizeof(bool),
+                              _Alignof(bool));
+        if (keep == nullptr) {
+          // TODO: report out of memory instead of panicking
+          assert(false);
+        }
+        memset(keep, 1, length * sizeof(bool));
+      }
+      for (uint32_t k = i - (uint32_t)arguments.length; k < i; ++k) {
+        keep[k] = false;
+      }
+    }
+    if (keep != nullptr) {
+      IrValue *remap = allocate_bytes(allocator, length * sizeof(IrValue),
+                                      _Alignof(IrValue));
+      if (remap == nullptr) {
+        // TODO: report out of memory instead of panicking
+        assert(false);
+      }
+      ir_compact(function, keep, remap);
+    }
+  }
+  return comptime->stats;
+}
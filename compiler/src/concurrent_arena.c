@@ -0,0 +1,150 @@
+#include "concurrent_arena.h"
+#include "allocator.h"
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+ArenaChunk *arena_chunk_create(size_t capacity) {
+  ArenaChunk *chunk = malloc(sizeof(ArenaChunk) + capacity);
+  if (chunk == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  atomic_init(&chunk->next, nullptr);
+  atomic_init(&chunk->used, 0);
+  chunk->capacity = capacity;
+  return chunk;
+}
+
+void *arena_chunk_bump(ArenaChunk *chunk, size_t size, size_t alignment) {
+  size_t used = atomic_load_explicit(&chunk->used, memory_order_relaxed);
+  for (;;) {
+    size_t adjustment = align_forward_adjustment(chunk->data + used, alignment);
+    size_t new_used = used + adjustment + size;
+    if (new_used > chunk->capacity) {
+      return nullptr;
+    }
+    if (atomic_compare_exchange_weak_explicit(&chunk->used, &used, new_used,
+                                              memory_order_relaxed,
+                                              memory_order_relaxed)) {
+      return chunk->data + used + adjustment;
+    }
+  }
+}
+
+void *allocate_dedicated_chunk(ArenaChunk *head, size_t size,
+                               size_t alignment) {
+  // Oversized requests get a chunk of their own which is linked in behind
+  // the head so the head keeps serving everyone else.
+  ArenaChunk *chunk = arena_chunk_create(size + alignment);
+  void *result = arena_chunk_bump(chunk, size, alignment);
+  ArenaChunk *next = atomic_load_explicit(&head->next, memory_order_relaxed);
+  do {
+    atomic_store_explicit(&chunk->next, next, memory_order_relaxed);
+  } while (!atomic_compare_exchange_weak_explicit(
+      &head->next, &next, chunk, memory_order_release, memory_order_relaxed));
+  return result;
+}
+
+void *concurrent_arena_allocate(void *allocator, size_t size,
+                                size_t alignment) {
+  ConcurrentArena *arena = (ConcurrentArena *)allocator;
+  ArenaChunk *head = atomic_load_explicit(&arena->head, memory_order_acquire);
+  if (size > arena->chunk_size / 4) {
+    return allocate_dedicated_chunk(head, size, alignment);
+  }
+  for (;;) {
+    void *result = arena_chunk_bump(head, size, alignment);
+    if (result != nullptr) {
+      return result;
+    }
+    ArenaChunk *chunk = arena_chunk_create(arena->chunk_size);
+    atomic_store_explicit(&chunk->next, head, memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&arena->head, &head, chunk,
+                                                 memory_order_acq_rel,
+                                                 memory_order_acquire)) {
+      // Another thread already replaced the full chunk, use theirs. On
+      // failure head has been reloaded with the current head.
+      free(chunk);
+      continue;
+    }
+    head = chunk;
+  }
+}
+
+bool concurrent_arena_resize(void *allocator, void *memory, size_t old_size,
+                             size_t new_size) {
+  ConcurrentArena *arena = (ConcurrentArena *)allocator;
+  ArenaChunk *head = atomic_load_explicit(&arena->head, memory_order_acquire);
+  uint8_t *begin = memory;
+  if (begin < head->data || begin > head->data + head->capacity) {
+    return false;
+  }
+  size_t used = begin + old_size - head->data;
+  size_t new_used = begin + new_size - head->data;
+  if (new_used > head->capacity) {
+    return false;
+  }
+  // Only succeeds while nobody has allocated after this block.
+  return atomic_compare_exchange_strong_explicit(
+      &head->used, &used, new_used, memory_order_relaxed, memory_order_relaxed);
+}
+
+void concurrent_arena_init(ConcurrentArena *arena, size_t chunk_size) {
+  atomic_init(&arena->head, arena_chunk_create(chunk_size));
+  arena->chunk_size = chunk_size;
+}
+
+void concurrent_arena_destroy(ConcurrentArena *arena) {
+  ArenaChunk *chunk = atomic_load_explicit(&arena->head, memory_order_acquire);
+  while (chunk != nullptr) {
+    ArenaChunk *next = atomic_load_explicit(&chunk->next, memory_order_relaxed);
+    free(chunk);
+    chunk = next;
+  }
+  atomic_store_explicit(&arena->head, nullptr, memory_order_relaxed);
+}
+
+void *arena_thread_cache_allocate(void *allocator, size_t size,
+                                  size_t alignment) {
+  ArenaThreadCache *cache = (ArenaThreadCache *)allocator;
+  if (size > cache->block_size / 4) {
+    return concurrent_arena_allocate(cache->arena, size, alignment);
+  }
+  size_t adjustment =
+      align_forward_adjustment(cache->current_position, alignment);
+  if ((size_t)(cache->end - cache->current_position) < adjustment + size) {
+    // The tail of the old block is abandoned, at most a quarter of a block.
+    cache->current_position = concurrent_arena_allocate(
+        cache->arena, cache->block_size, _Alignof(max_align_t));
+    cache->end = cache->current_position + cache->block_size;
+    adjustment = align_forward_adjustment(cache->current_position, alignment);
+  }
+  void *aligned_address = cache->current_position + adjustment;
+  cache->current_position = (uint8_t *)aligned_address + size;
+  return aligned_address;
+}
+
+bool arena_thread_cache_resize(void *allocator, void *memory, size_t old_size,
+                               size_t new_size) {
+  ArenaThreadCache *cache = (ArenaThreadCache *)allocator;
+  uint8_t *begin = memory;
+  if (begin + old_size != cache->current_position ||
+      (size_t)(cache->end - begin) < new_size) {
+    return concurrent_arena_resize(cache->arena, memory, old_size, new_size);
+  }
+  cache->current_position = begin + new_size;
+  return true;
+}
+
+void arena_thread_cache_init(ArenaThreadCache *cache, ConcurrentArena *arena,
+                             size_t block_size) {
+  assert(block_size <= arena->chunk_size / 4);
+  cache->arena = arena;
+  cache->current_position = nullptr;
+  cache->end = nullptr;
+  cache->block_size = block_size;
+}
@@ -0,0 +1,267 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "constant_fold.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+uint64_t width_mask(const Type *type) {
+  return type->size == 8 ? UINT64_MAX : (1ull << (type->size * 8)) - 1;
+}
+
+int64_t sign_extend(uint64_t bits, const Type *type) {
+  uint32_t shift = 64 - type->size * 8;
+  return (int64_t)(bits << shift) >> shift;
+}
+
+FoldResult folded(uint64_t bits) {
+  return (FoldResult){.folded = true, .bits = bits};
+}
+
+FoldResult fold_comparison(IrOpcode opcode, int32_t order) {
+  switch (opcode) {
+  case EqOp:
+    return folded(order == 0);
+  case NeOp:
+    return folded(order != 0);
+  case LtOp:
+    return folded(order < 0);
+  case LeOp:
+    return folded(order <= 0);
+  case GtOp:
+    return folded(order > 0);
+  case GeOp:
+    return folded(order >= 0);
+  default:
+    assert(false);
+  }
+}
+
+FoldResult fold_int(IrOpcode opcode, const Type *type, uint64_t left,
+                    uint64_t right) {
+  bool is_signed = type->kind == SignedIntType;
+  if (ir_is_comparison(opcode)) {
+    if (is_signed) {
+      int64_t a = sign_extend(left, type);
+      int64_t b = sign_extend(right, type);
+      return fold_comparison(opcode, (a > b) - (a < b));
+    }
+    return fold_comparison(opcode, (left > right) - (left < right));
+  }
+  uint64_t mask = width_mask(type);
+  switch (opcode) {
+  case AddOp:
+    return folded((left + right) & mask);
+  case SubOp:
+    return folded((left - right) & mask);
+  case MulOp:
+    return folded((left * right) & mask);
+  case DivOp:
+  case ModOp: {
+    // Division by zero and INT64_MIN / -1 trap at run time, so they are
+    // left for the program to execute. Narrower overflow wraps.
+    if (right == 0) {
+      return (FoldResult){};
+    }
+    if (!is_signed) {
+      return folded(opcode == DivOp ? left / right : left % right);
+    }
+    int64_t a = sign_extend(left, type);
+    int64_t b = sign_extend(right, type);
+    if (b == -1 && a == INT64_MIN) {
+      return opcode == DivOp ? (FoldResult){} : folded(0);
+    }
+    return folded((uint64_t)(opcode == DivOp ? a / b : a % b) & mask);
+  }
+  case BoundsOp:
+    // An index out of bounds traps at run time like division by zero.
+    return left < right ? folded(left) : (FoldResult){};
+  default:
+    assert(false);
+  }
+}
+
+// Widening f32 to double is exact, so one comparison serves both widths.
+// NaN operands compare unordered exactly as they would at run time.
+FoldResult compare_floats(IrOpcode opcode, double left, double right) {
+  switch (opcode) {
+  case EqOp:
+    return folded(left == right);
+  case NeOp:
+    return folded(left != right);
+  case LtOp:
+    return folded(left < right);
+  case LeOp:
+    return folded(left <= right);
+  case GtOp:
+    return folded(left > right);
+  case GeOp:
+    return folded(left >= right);
+  default:
+    assert(false);
+  }
+}
+
+FoldResult fold_f32(IrOpcode opcode, uint64_t left_bits, uint64_t right_bits) {
+  uint32_t narrow_left = (uint32_t)left_bits;
+  uint32_t narrow_right = (uint32_t)right_bits;
+  float left;
+  float right;
+  memcpy(&left, &narrow_left, sizeof(left));
+  memcpy(&right, &narrow_right, sizeof(right));
+  float result;
+  switch (opcode) {
+  case AddOp:
+    result = left + right;
+    break;
+  case SubOp:
+    result = left - right;
+    break;
+  case MulOp:
+    result = left * right;
+    break;
+  case DivOp:
+    result = left / right;
+    break;
+  case ModOp:
+    // Left to the runtime's fmod so both agree on rounding.
+    return (FoldResult){};
+  default:
+    return compare_floats(opcode, left, right);
+  }
+  uint32_t bits;
+  memcpy(&bits, &result, sizeof(bits));
+  return folded(bits);
+}
+
+FoldResult fold_f64(IrOpcode opcode, uint64_t left_bits, uint64_t right_bits) {
+  double left;
+  double right;
+  memcpy(&left, &left_bits, sizeof(left));
+  memcpy(&right, &right_bits, sizeof(right));
+  double result;
+  switch (opcode) {
+  case AddOp:
+    result = left + right;
+    break;
+  case SubOp:
+    result = left - right;
+    break;
+  case MulOp:
+    result = left * right;
+    break;
+  case DivOp:
+    result = left / right;
+    break;
+  case ModOp:
+    return (FoldResult){};
+  default:
+    return compare_floats(opcode, left, right);
+  }
+  uint64_t bits;
+  memcpy(&bits, &result, sizeof(bits));
+  return folded(bits);
+}
+
+FoldResult fold_binary(const TypeTable *types, IrOpcode opcode, TypeId type,
+                       uint64_t left, uint64_t right) {
+  const Type *resolved = lookup_type(types, type);
+  if (resolved->kind == VectorType) {
+    // Vector constants are broadcasts, so every lane folds the same way.
+    resolved = lookup_type(types, resolved->element);
+  }
+  switch (resolved->kind) {
+  case SignedIntType:
+  case UnsignedIntType:
+    return fold_int(opcode, resolved, left, right);
+  case FloatType:
+    return resolved->size == 4 ? fold_f32(opcode, left, right)
+                               : fold_f64(opcode, left, right);
+  case BoolType:
+    if (opcode == EqOp || opcode == NeOp) {
+      return fold_comparison(opcode, left != right);
+    }
+    return (FoldResult){};
+  case VectorType:
+  case InvalidType:
+  case TypeParameterType:
+  case StructType:
+  case SliceType:
+  case FunctionType:
+    return (FoldResult){};
+  }
+  assert(false);
+}
+
+FoldResult fold_instruction(const IrInstruction *instructions,
+                            IrInstruction instruction,
+                            const TypeTable *types) {
+  if (instruction.opcode == ConstOp || instruction.opcode == InsertOp ||
+      instruction.opcode == AllocOp || instruction.opcode == LoadOp ||
+      instruction.opcode == StoreOp || instruction.opcode == ParamOp ||
+      instruction.opcode == ArgOp || instruction.opcode == CallOp ||
+      ir_is_terminator(instruction.opcode)) {
+    return (FoldResult){};
+  }
+  if (instruction.opcode == ExtractOp) {
+    // Vector constants are broadcasts, so every lane holds their bits.
+    IrInstruction vector = instructions[instruction.operands[0]];
+    return vector.opcode == ConstOp ? folded(ir_constant_bits(vector))
+                                    : (FoldResult){};
+  }
+  IrInstruction left = instructions[instruction.operands[0]];
+  IrInstruction right = instructions[instruction.operands[1]];
+  if (left.opcode != ConstOp || right.opcode != ConstOp) {
+    return (FoldResult){};
+  }
+  // Comparisons produce bool, the operands carry the type to compute in.
+  return fold_binary(types, instruction.opcode, left.type,
+                     ir_constant_bits(left), ir_constant_bits(right));
+}
+
+ConstantFoldStats fold_constants(Allocator allocator, IrFunction *function,
+                                 const TypeTable *types) {
+  ConstantFoldStats stats = {};
+  IrInstruction *instructions = function->instructions.data;
+  uint32_t length = (uint32_t)function->instructions.length;
+  // Operands always precede their users, so one forward sweep sees every
+  // operand in its final folded form.
+  for (uint32_t i = 0; i < length; ++i) {
+    FoldResult result = fold_instruction(instructions, instructions[i], types);
+    if (result.folded) {
+      instructions[i].opcode = ConstOp;
+      instructions[i].operands[0] = (uint32_t)result.bits;
+      instructions[i].operands[1] = (uint32_t)(result.bits >> 32);
+      stats.folded += 1;
+    }
+  }
+  bool *keep =
+      allocate_bytes(allocator, length * sizeof(bool), _Alignof(bool));
+  IrValue *remap =
+      allocate_bytes(allocator, length * sizeof(IrValue), _Alignof(IrValue));
+  if (keep == nullptr || remap == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  // Walk backwards so users are decided before the values they read.
+  memset(keep, 0, length * sizeof(bool));
+  for (uint32_t i = length; i-- > 0;) {
+    IrInstruction instruction = instructions[i];
+    if (instruction.opcode != ConstOp) {
+      keep[i] = true;
+    }
+    if (!keep[i]) {
+      stats.removed += 1;
+      continue;
+    }
+    uint32_t count = ir_operand_count(instruction);
+    for (uint32_t j = 0; j < count; ++j) {
+      keep[instruction.operands[j]] = true;
+    }
+  }
+  if (stats.removed > 0) {
+    ir_compact(function, keep, remap);
+  }
+  return stats;
+}
@@ -0,0 +1,90 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "dead_code.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Integer division traps on a zero divisor and on INT64_MIN / -1, so it
+// is only removable when the divisor is a constant that rules both out.
+// Bounds checks that constant folding could not prove always might trap.
+bool may_trap(const IrInstruction *instructions, IrInstruction instruction,
+              const TypeTable *types) {
+  if (instruction.opcode == BoundsOp) {
+    return true;
+  }
+  if (instruction.opcode != DivOp && instruction.opcode != ModOp) {
+    return false;
+  }
+  const Type *type = lookup_type(types, instruction.type);
+  if (type->kind == VectorType) {
+    type = lookup_type(types, type->element);
+  }
+  if (type->kind == FloatType) {
+    return false;
+  }
+  IrInstruction divisor = instructions[instruction.operands[1]];
+  if (divisor.opcode != ConstOp) {
+    return true;
+  }
+  uint64_t bits = ir_constant_bits(divisor);
+  uint64_t mask = type->size == 8 ? UINT64_MAX : (1ull << (type->size * 8)) - 1;
+  return (bits & mask) == 0 || (type->kind == SignedIntType &&
+                                (bits & mask) == mask);
+}
+
+bool removable(const IrInstruction *instructions, IrInstruction instruction,
+               const TypeTable *types) {
+  IrOpcode opcode = instruction.opcode;
+  return opcode != StoreOp && opcode != ParamOp && opcode != ArgOp &&
+         opcode != CallOp && !ir_is_terminator(opcode) &&
+         !may_trap(instructions, instruction, types);
+}
+
+DeadCodeStats eliminate_dead_code(Allocator allocator, IrFunction *function,
+                                  const TypeTable *types) {
+  DeadCodeStats stats = {};
+  const IrInstruction *instructions = function->instructions.data;
+  uint32_t length = (uint32_t)function->instructions.length;
+  IrUses uses = ir_compute_uses(allocator, function);
+  // How many users of every value are left, from the length of its use list.
+  uint32_t *remaining = allocate_bytes(
+      allocator, length * sizeof(uint32_t) + 1, _Alignof(uint32_t));
+  IrValue *worklist = allocate_bytes(allocator, length * sizeof(IrValue) + 1,
+                                     _Alignof(IrValue));
+  bool *keep =
+      allocate_bytes(allocator, length * sizeof(bool) + 1, _Alignof(bool));
+  if (remaining == nullptr || worklist == nullptr || keep == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  uint32_t pending = 0;
+  for (uint32_t i = 0; i < length; ++i) {
+    remaining[i] = uses.offsets[i + 1] - uses.offsets[i];
+    keep[i] = true;
+    if (remaining[i] == 0 && removable(instructions, instructions[i], types)) {
+      worklist[pending++] = i;
+    }
+  }
+  // Each instruction is pushed at most once: when it starts unused or
+  // when its last user is removed.
+  while (pending > 0) {
+    IrValue value = worklist[--pending];
+    keep[value] = false;
+    stats.removed += 1;
+    IrInstruction instruction = instructions[value];
+    uint32_t count = ir_operand_count(instruction);
+    for (uint32_t j = 0; j < count; ++j) {
+      IrValue operand = instruction.operands[j];
+      if (--remaining[operand] == 0 &&
+          removable(instructions, instructions[operand], types)) {
+        worklist[pending++] = operand;
+      }
+    }
+  }
+  if (stats.removed > 0) {
+    ir_compact(function, keep, worklist);
+  }
+  return stats;
+}
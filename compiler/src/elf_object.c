@@ -0,0 +1,243 @@
+#include "elf_object.h"
+#include <string.h>
+
+// Section and symbol indices are fixed, only the code, relocations and the
+// set of referenced libm functions vary between objects.
+
+typedef enum {
+  NullSection,
+  TextSection,
+  RelaTextSection,
+  SymtabSection,
+  StrtabSection,
+  ShstrtabSection,
+  NoteGnuStackSection,
+  SectionCount,
+} ElfSection;
+
+enum {
+  ElfHeaderSize = 64,
+  SectionHeaderSize = 64,
+  SymbolSize = 24,
+  RelocationSize = 24,
+  // The null symbol and the .text section symbol precede the globals.
+  LocalSymbolCount = 2,
+};
+
+static const char section_names[] =
+    "\0.text\0.rela.text\0.symtab\0.strtab\0.shstrtab\0.note.GNU-stack";
+
+uint32_t section_name_offset(ElfSection section) {
+  static const uint32_t offsets[] = {
+      [NullSection] = 0,        [TextSection] = 1,
+      [RelaTextSection] = 7,    [SymtabSection] = 18,
+      [StrtabSection] = 26,     [ShstrtabSection] = 34,
+      [NoteGnuStackSection] = 44,
+  };
+  return offsets[section];
+}
+
+void write_u16(BufferedWriter *writer, uint16_t value) {
+  char bytes[] = {(char)value, (char)(value >> 8)};
+  buffered_write(writer, bytes, sizeof(bytes));
+}
+
+void write_u32(BufferedWriter *writer, uint32_t value) {
+  write_u16(writer, (uint16_t)value);
+  write_u16(writer, (uint16_t)(value >> 16));
+}
+
+void write_u64(BufferedWriter *writer, uint64_t value) {
+  write_u32(writer, (uint32_t)value);
+  write_u32(writer, (uint32_t)(value >> 32));
+}
+
+void write_padding(BufferedWriter *writer, size_t from, size_t to) {
+  static const char zeros[16] = {};
+  buffered_write(writer, zeros, to - from);
+}
+
+size_t align_offset(size_t offset, size_t alignment) {
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+typedef struct {
+  uint32_t name;
+  uint32_t type;
+  uint64_t flags;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t link;
+  uint32_t info;
+  uint64_t alignment;
+  uint64_t entry_size;
+} SectionHeader;
+
+void write_section_header(BufferedWriter *writer, SectionHeader header) {
+  write_u32(writer, header.name);
+  write_u32(writer, header.type);
+  write_u64(writer, header.flags);
+  write_u64(writer, 0); // address
+  write_u64(writer, header.offset);
+  write_u64(writer, header.size);
+  write_u32(writer, header.link);
+  write_u32(writer, header.info);
+  write_u64(writer, header.alignment);
+  write_u64(writer, header.entry_size);
+}
+
+void write_symbol(BufferedWriter *writer, uint32_t name, uint8_t info,
+                  uint16_t section, uint64_t size) {
+  write_u32(writer, name);
+  buffered_write_char(writer, (char)info);
+  buffered_write_char(writer, 0); // default visibility
+  write_u16(writer, section);
+  write_u64(writer, 0); // value
+  write_u64(writer, size);
+}
+
+void write_elf_header(BufferedWriter *writer, uint64_t section_headers) {
+  static const char identification[16] = {
+      0x7f, 'E', 'L', 'F',
+      2, // 64 bit
+      1, // little endian
+      1, // current version
+  };
+  buffered_write(writer, identification, sizeof(identification));
+  write_u16(writer, 1);  // ET_REL
+  write_u16(writer, 62); // EM_X86_64
+  write_u32(writer, 1);  // EV_CURRENT
+  write_u64(writer, 0);  // entry point
+  write_u64(writer, 0);  // program headers
+  write_u64(writer, section_headers);
+  write_u32(writer, 0); // flags
+  write_u16(writer, ElfHeaderSize);
+  write_u16(writer, 0); // program header size
+  write_u16(writer, 0); // program header count
+  write_u16(writer, SectionHeaderSize);
+  write_u16(writer, SectionCount);
+  write_u16(writer, ShstrtabSection);
+}
+
+void write_elf_object(BufferedWriter *writer, const X64Code *code,
+                      const char *name) {
+  // Only the libm functions the code calls get a symbol. symbol_index maps
+  // each to its symbol table entry and string_offset to its name.
+  uint32_t symbol_index[X64SymbolCount] = {};
+  uint32_t string_offset[X64SymbolCount] = {};
+  size_t name_length = strlen(name);
+  uint32_t symbol_count = LocalSymbolCount + 1;
+  uint32_t strtab_size = 1 + (uint32_t)name_length + 1;
+  for (size_t i = 0; i < code->relocations.length; ++i) {
+    X64Symbol symbol = code->relocations.data[i].symbol;
+    if (symbol_index[symbol] == 0) {
+      symbol_index[symbol] = symbol_count++;
+      string_offset[symbol] = strtab_size;
+      strtab_size += (uint32_t)strlen(x64_symbol_name(symbol)) + 1;
+    }
+  }
+
+  size_t text_offset = ElfHeaderSize;
+  size_t text_size = code->bytes.length;
+  size_t rela_offset = align_offset(text_offset + text_size, 8);
+  size_t rela_size = code->relocations.length * RelocationSize;
+  size_t symtab_offset = rela_offset + rela_size;
+  size_t symtab_size = symbol_count * SymbolSize;
+  size_t strtab_offset = symtab_offset + symtab_size;
+  size_t shstrtab_offset = strtab_offset + strtab_size;
+  size_t shstrtab_end = shstrtab_offset + sizeof(section_names);
+  size_t headers_offset = align_offset(shstrtab_end, 8);
+
+  write_elf_header(writer, headers_offset);
+  buffered_write(writer, (const char *)code->bytes.data, text_size);
+  write_padding(writer, text_offset + text_size, rela_offset);
+  for (size_t i = 0; i < code->relocations.length; ++i) {
+    X64Relocation relocation = code->relocations.data[i];
+    write_u64(writer, relocation.offset);
+    // R_X86_64_GOTPCREL: the call reads the address from the symbol's GOT
+    // entry, relative to the end of the displacement.
+    write_u64(writer, (uint64_t)symbol_index[relocation.symbol] << 32 | 9);
+    write_u64(writer, (uint64_t)-4);
+  }
+
+  const uint8_t local_section = 0 << 4 | 3;
+  const uint8_t global_function = 1 << 4 | 2;
+  const uint8_t global_undefined = 1 << 4 | 0;
+  write_symbol(writer, 0, 0, 0, 0);
+  write_symbol(writer, 0, local_section, TextSection, 0);
+  write_symbol(writer, 1, global_function, TextSection, text_size);
+  for (uint32_t symbol = 0; symbol < X64SymbolCount; ++symbol) {
+    if (symbol_index[symbol] != 0) {
+      write_symbol(writer, string_offset[symbol], global_undefined, 0, 0);
+    }
+  }
+
+  buffered_write_char(writer, '\0');
+  buffered_write(writer, name, name_length + 1);
+  for (uint32_t symbol = 0; symbol < X64SymbolCount; ++symbol) {
+    if (symbol_index[symbol] != 0) {
+      const char *symbol_name = x64_symbol_name(symbol);
+      buffered_write(writer, symbol_name, strlen(symbol_name) + 1);
+    }
+  }
+  buffered_write(writer, section_names, sizeof(section_names));
+  write_padding(writer, shstrtab_end, headers_offset);
+
+  enum { Progbits = 1, Symtab = 2, Strtab = 3, Rela = 4 };
+  enum { Alloc = 0x2, Executable = 0x4, InfoLink = 0x40 };
+  write_section_header(writer, (SectionHeader){});
+  write_section_header(writer, (SectionHeader){
+                                   .name = section_name_offset(TextSection),
+                                   .type = Progbits,
+                                   .flags = Alloc | Executable,
+                                   .offset = text_offset,
+                                   .size = text_size,
+                                   .alignment = 16,
+                               });
+  write_section_header(writer,
+                       (SectionHeader){
+                           .name = section_name_offset(RelaTextSection),
+                           .type = Rela,
+                           .flags = InfoLink,
+                           .offset = rela_offset,
+                           .size = rela_size,
+                           .link = SymtabSection,
+                           .info = TextSection,
+                           .alignment = 8,
+                           .entry_size = RelocationSize,
+                       });
+  write_section_header(writer, (SectionHeader){
+                                   .name = section_name_offset(SymtabSection),
+                                   .type = Symtab,
+                                   .offset = symtab_offset,
+                                   .size = symtab_size,
+                                   .link = StrtabSection,
+                                   .info = LocalSymbolCount,
+                                   .alignment = 8,
+                                   .entry_size = SymbolSize,
+                               });
+  write_section_header(writer, (SectionHeader){
+                                   .name = section_name_offset(StrtabSection),
+                                   .type = Strtab,
+                                   .offset = strtab_offset,
+                                   .size = strtab_size,
+                                   .alignment = 1,
+                               });
+  write_section_header(writer,
+                       (SectionHeader){
+                           .name = section_name_offset(ShstrtabSection),
+                           .type = Strtab,
+                           .offset = shstrtab_offset,
+                           .size = sizeof(section_names),
+                           .alignment = 1,
+                       });
+  // An empty .note.GNU-stack tells the linker the stack need not be
+  // executable.
+  write_section_header(writer,
+                       (SectionHeader){
+                           .name = section_name_offset(NoteGnuStackSection),
+                           .type = Progbits,
+                           .offset = shstrtab_end,
+                           .alignment = 1,
+                       });
+}
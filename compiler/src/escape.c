@@ -0,0 +1,259 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "escape.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+const EscapeOptions default_escape_options = {.max_stack_bytes = 1024};
+
+typedef enum {
+  StaysLocal,
+  // Reaches the caller only as the function's result.
+  ReturnedToCaller,
+  Escapes,
+} EscapeState;
+
+typedef enum {
+  CallersUnknown,
+  CallersKeepResult,
+  CallersLeakResult,
+} CallerVerdict;
+
+typedef struct {
+  Allocator allocator;
+  IrModule *module;
+  // The uses of every value, per function.
+  IrUses *uses;
+  // Whether each parameter may escape, per function. Only ever grows
+  // from false to true.
+  bool **parameter_escapes;
+  // Call sites of every function in compressed sparse row form, as pairs
+  // of caller and call instruction.
+  uint32_t *call_offsets;
+  uint32_t *call_sites;
+  CallerVerdict *verdicts;
+  // Values reached by the current walk are stamped with its number.
+  uint32_t *seen;
+  uint32_t stamp;
+  IrValue *stack;
+} EscapeAnalysis;
+
+void *escape_allocate(Allocator allocator, size_t count, size_t size) {
+  void *memory =
+      allocate_bytes(allocator, count * size + 1, _Alignof(uint64_t));
+  if (memory == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  return memory;
+}
+
+// Whether the argument at index argument escapes through its call.
+bool argument_escapes(const EscapeAnalysis *analysis,
+                      const IrFunction *function, uint32_t argument) {
+  const IrInstruction *instructions = function->instructions.data;
+  uint32_t call = argument;
+  while (instructions[call].opcode == ArgOp) {
+    call += 1;
+  }
+  uint32_t callee = instructions[call].operands[0];
+  if (callee >= analysis->module->functions.length) {
+    return true;
+  }
+  uint32_t count = analysis->module->functions.data[callee].parameter_count;
+  if (call - argument > count) {
+    return true;
+  }
+  return analysis->parameter_escapes[callee][count - (call - argument)];
+}
+
+// Follows the address defined by root through address arithmetic to every
+// use and reports the worst one.
+EscapeState escape_walk(EscapeAnalysis *analysis, uint32_t f, IrValue root) {
+  const IrFunction *function = &analysis->module->functions.data[f];
+  const IrInstruction *instructions = function->instructions.data;
+  IrUses uses = analysis->uses[f];
+  EscapeState state = StaysLocal;
+  uint32_t stamp = ++analysis->stamp;
+  uint32_t pending = 0;
+  analysis->seen[root] = stamp;
+  analysis->stack[pending++] = root;
+  while (pending > 0) {
+    IrValue value = analysis->stack[--pending];
+    for (uint32_t u = uses.offsets[value]; u < uses.offsets[value + 1]; ++u) {
+      IrValue user = uses.users[u];
+      IrInstruction instruction = instructions[user];
+      switch ((IrOpcode)instruction.opcode) {
+      case LoadOp:
+      case EqOp:
+      case NeOp:
+      case LtOp:
+      case LeOp:
+      case GtOp:
+      case GeOp:
+        break;
+      case StoreOp:
+        if (instruction.operands[1] == value) {
+          return Escapes;
+        }
+        break;
+      case AddOp:
+      case SubOp:
+        if (analysis->seen[user] != stamp) {
+          analysis->seen[user] = stamp;
+          analysis->stack[pending++] = user;
+        }
+        break;
+      case ReturnOp:
+        state = ReturnedToCaller;
+        break;
+      case ArgOp:
+        if (argument_escapes(analysis, function, user)) {
+          return Escapes;
+        }
+        break;
+      default:
+        return Escapes;
+      }
+    }
+  }
+  return state;
+}
+
+// Whether every caller of the function keeps its result local, which lets
+// an allocation it returns live in the caller's arena.
+bool callers_keep_result(EscapeAnalysis *analysis, uint32_t callee) {
+  if (analysis->verdicts[callee] == CallersUnknown) {
+    uint32_t begin = analysis->call_offsets[callee];
+    uint32_t end = analysis->call_offsets[callee + 1];
+    bool kept = begin < end;
+    for (uint32_t c = begin; kept && c < end; c += 2) {
+      kept = escape_walk(analysis, analysis->call_sites[c],
+                         analysis->call_sites[c + 1]) == StaysLocal;
+    }
+    analysis->verdicts[callee] =
+        kept ? CallersKeepResult : CallersLeakResult;
+  }
+  return analysis->verdicts[callee] == CallersKeepResult;
+}
+
+void find_call_sites(EscapeAnalysis *analysis) {
+  const IrModule *module = analysis->module;
+  uint32_t count = (uint32_t)module->functions.length;
+  uint32_t *offsets = escape_allocate(analysis->allocator, count + 2,
+                                      sizeof(uint32_t));
+  memset(offsets, 0, (count + 2) * sizeof(uint32_t));
+  for (uint32_t f = 0; f < count; ++f) {
+    IrInstructionArray instructions = module->functions.data[f].instructions;
+    for (size_t i = 0; i < instructions.length; ++i) {
+      IrInstruction instruction = instructions.data[i];
+      if (instruction.opcode == CallOp && instruction.operands[0] < count) {
+        offsets[instruction.operands[0] + 2] += 2;
+      }
+    }
+  }
+  // Prefix sums shifted by one so filling can use offsets[callee + 1] as
+  // the cursor and leave offsets[callee] at the start.
+  for (uint32_t f = 0; f < count; ++f) {
+    offsets[f + 2] += offsets[f + 1];
+  }
+  uint32_t *sites = escape_allocate(analysis->allocator, offsets[count + 1],
+                                    sizeof(uint32_t));
+  for (uint32_t f = 0; f < count; ++f) {
+    IrInstructionArray instructions = module->functions.data[f].instructions;
+    for (uint32_t i = 0; i < instructions.length; ++i) {
+      IrInstruction instruction = instructions.data[i];
+      if (instruction.opcode == CallOp && instruction.operands[0] < count) {
+        uint32_t *cursor = &offsets[instruction.operands[0] + 1];
+        sites[(*cursor)++] = f;
+        sites[(*cursor)++] = i;
+      }
+    }
+  }
+  analysis->call_offsets = offsets;
+  analysis->call_sites = sites;
+}
+
+EscapeStats promote_allocations(Allocator allocator, IrModule *module,
+                                const EscapeOptions *options) {
+  EscapeStats stats = {};
+  uint32_t count = (uint32_t)module->functions.length;
+  EscapeAnalysis analysis = {
+      .allocator = allocator,
+      .module = module,
+      .uses = escape_allocate(allocator, count, sizeof(IrUses)),
+      .parameter_escapes = escape_allocate(allocator, count, sizeof(bool *)),
+      .verdicts = escape_allocate(allocator, count, sizeof(CallerVerdict)),
+  };
+  size_t longest = 0;
+  for (uint32_t f = 0; f < count; ++f) {
+    const IrFunction *function = &module->functions.data[f];
+    analysis.uses[f] = ir_compute_uses(allocator, function);
+    analysis.parameter_escapes[f] = escape_allocate(
+        allocator, function->parameter_count, sizeof(bool));
+    memset(analysis.parameter_escapes[f], 0,
+           function->parameter_count * sizeof(bool));
+    analysis.verdicts[f] = CallersUnknown;
+    if (function->instructions.length > longest) {
+      longest = function->instructions.length;
+    }
+  }
+  analysis.seen = escape_allocate(allocator, longest, sizeof(uint32_t));
+  memset(analysis.seen, 0, longest * sizeof(uint32_t));
+  analysis.stack = escape_allocate(allocator, longest, sizeof(IrValue));
+  find_call_sites(&analysis);
+  // Parameters start out assumed local. A parameter returned to the caller
+  // aliases its argument there, so only parameters that stay local stay
+  // that way. Every round marks at least one more parameter or stops.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (uint32_t f = 0; f < count; ++f) {
+      uint32_t parameters = module->functions.data[f].parameter_count;
+      for (uint32_t k = 0; k < parameters; ++k) {
+        if (!analysis.parameter_escapes[f][k] &&
+            escape_walk(&analysis, f, k) != StaysLocal) {
+          analysis.parameter_escapes[f][k] = true;
+          changed = true;
+        }
+      }
+    }
+  }
+  for (uint32_t f = 0; f < count; ++f) {
+    IrFunction *function = &module->functions.data[f];
+    IrInstruction *instructions = function->instructions.data;
+    for (uint32_t i = 0; i < function->instructions.length; ++i) {
+      if (instructions[i].opcode != AllocOp ||
+          instructions[i].lane != HeapAllocation) {
+        continue;
+      }
+      stats.allocations += 1;
+      IrInstruction size = instructions[instructions[i].operands[0]];
+      switch (escape_walk(&analysis, f, i)) {
+      case StaysLocal:
+        if (size.opcode == ConstOp &&
+            ir_constant_bits(size) <= options->max_stack_bytes) {
+          instructions[i].lane = StackAllocation;
+          stats.to_stack += 1;
+        } else {
+          instructions[i].lane = ArenaAllocation;
+          stats.to_arena += 1;
+        }
+        break;
+      case ReturnedToCaller:
+        if (callers_keep_result(&analysis, f)) {
+          instructions[i].lane = ArenaAllocation;
+          stats.to_arena += 1;
+        } else {
+          stats.escaping += 1;
+        }
+        break;
+      case Escapes:
+        stats.escaping += 1;
+        break;
+      }
+    }
+  }
+  return stats;
+}
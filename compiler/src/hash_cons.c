@@ -0,0 +1,178 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "hash_cons.h"
+#include "allocator.h"
+#include "hash_map.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Lists are copied out of the parser's scratch space, so two equal lists
+// never share storage. Their elements are stored by value but all of their
+// children are interned, hashing each element shallowly is enough.
+uint64_t hash_expressions(const Expression *expressions, uint32_t count) {
+  uint64_t hash = hash_integer(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    hash = hash_combine(hash, hash_expression(&expressions[i]));
+  }
+  return hash;
+}
+
+bool expression_lists_equal(const Expression *a, const Expression *b,
+                            uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!expressions_equal(&a[i], &b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t hash_expression(const Expression *expression) {
+  uint64_t hash = hash_integer(expression->kind);
+  switch (expression->kind) {
+  case SymbolExpression:
+    return hash_combine(hash,
+                        hash_string_view(expression->value.symbol.view));
+  case FloatExpression:
+    return hash_combine(hash,
+                        hash_string_view(expression->value.float_.view));
+  case IntExpression:
+    return hash_combine(hash,
+                        hash_string_view(expression->value.int_.view));
+  case AssignExpression: {
+    Assign assign = expression->value.assign;
+    hash = hash_combine(hash, (uintptr_t)assign.type);
+    hash = hash_combine(hash, hash_string_view(assign.name.view));
+    return hash_combine(hash, (uintptr_t)assign.value);
+  }
+  case BinaryOpExpression: {
+    BinaryOp binary_op = expression->value.binary_op;
+    hash = hash_combine(hash, binary_op.op.kind);
+    hash = hash_combine(hash, (uintptr_t)binary_op.left);
+    return hash_combine(hash, (uintptr_t)binary_op.right);
+  }
+  case StructExpression: {
+    StructDeclaration struct_ = expression->value.struct_;
+    hash = hash_combine(hash, hash_string_view(struct_.name.view));
+    hash = hash_combine(hash, (uintptr_t)struct_.attributes);
+    return hash_combine(hash, (uintptr_t)struct_.fields);
+  }
+  case ArrayExpression:
+    hash = hash_combine(hash, expression->value.array.count);
+    return hash_combine(hash,
+                        hash_expressions(expression->value.array.elements,
+                                         expression->value.array.count));
+  case SliceTypeExpression:
+    return hash_combine(hash, (uintptr_t)expression->value.slice.element);
+  case IndexExpression:
+    hash = hash_combine(hash, (uintptr_t)expression->value.index.target);
+    return hash_combine(hash, (uintptr_t)expression->value.index.index);
+  case FunctionExpression: {
+    Function function = expression->value.function;
+    hash = hash_combine(hash, hash_string_view(function.name.view));
+    hash = hash_combine(hash, (uintptr_t)function.type_parameters);
+    hash = hash_combine(hash, (uintptr_t)function.parameters);
+    return hash_combine(hash, (uintptr_t)function.body);
+  }
+  case CallExpression: {
+    Call call = expression->value.call;
+    hash = hash_combine(hash, (uintptr_t)call.callee);
+    return hash_combine(
+        hash, hash_expressions(call.arguments, call.argument_count));
+  }
+  }
+  assert(false);
+}
+
+bool expressions_equal(const Expression *a, const Expression *b) {
+  if (a->kind != b->kind) {
+    return false;
+  }
+  switch (a->kind) {
+  case SymbolExpression:
+    return string_view_equal(a->value.symbol.view, b->value.symbol.view);
+  case FloatExpression:
+    return string_view_equal(a->value.float_.view, b->value.float_.view);
+  case IntExpression:
+    return string_view_equal(a->value.int_.view, b->value.int_.view);
+  case AssignExpression:
+    return a->value.assign.type == b->value.assign.type &&
+           a->value.assign.value == b->value.assign.value &&
+           string_view_equal(a->value.assign.name.view,
+                              b->value.assign.name.view);
+  case BinaryOpExpression:
+    return a->value.binary_op.op.kind == b->value.binary_op.op.kind &&
+           a->value.binary_op.left == b->value.binary_op.left &&
+           a->value.binary_op.right == b->value.binary_op.right;
+  case StructExpression:
+    return a->value.struct_.attributes == b->value.struct_.attributes &&
+           a->value.struct_.fields == b->value.struct_.fields &&
+           string_view_equal(a->value.struct_.name.view,
+                             b->value.struct_.name.view);
+  case ArrayExpression:
+    return a->value.array.count == b->value.array.count &&
+           expression_lists_equal(a->value.array.elements,
+                                  b->value.array.elements,
+                                  a->value.array.count);
+  case SliceTypeExpression:
+    return a->value.slice.element == b->value.slice.element;
+  case IndexExpression:
+    return a->value.index.target == b->value.index.target &&
+           a->value.index.index == b->value.index.index;
+  case FunctionExpression:
+    return a->value.function.return_type == b->value.function.return_type &&
+           a->value.function.type_parameters ==
+               b->value.function.type_parameters &&
+           a->value.function.parameters == b->value.function.parameters &&
+           a->value.function.body == b->value.function.body &&
+           string_view_equal(a->value.function.name.view,
+                             b->value.function.name.view);
+  case CallExpression:
+    return a->value.call.callee == b->value.call.callee &&
+           a->value.call.argument_count == b->value.call.argument_count &&
+           expression_lists_equal(a->value.call.arguments,
+                                  b->value.call.arguments,
+                                  a->value.call.argument_count);
+  }
+  assert(false);
+}
+
+uint64_t hash_expression_slot(const void *slot) {
+  return hash_expression(*(Expression *const *)slot);
+}
+
+bool expression_slot_matches(const void *slot, const void *key) {
+  return expressions_equal(*(Expression *const *)slot, key);
+}
+
+static const HashMapLayout expression_slot_layout = {
+    .slot_size = sizeof(Expression *),
+    .slot_alignment = _Alignof(Expression *),
+    .hash = hash_expression_slot,
+    .name = "HashConsTable",
+};
+
+void hash_cons_table_init(HashConsTable *table, Allocator allocator) {
+  *table = (HashConsTable){.allocator = allocator};
+}
+
+Expression *hash_cons(HashConsTable *table, Expression expression) {
+  HashMapInsertResult result =
+      hash_map_insert(table->allocator, &table->nodes, &expression_slot_layout,
+                      hash_expression(&expression), &expression,
+                      expression_slot_matches);
+  Expression **slot = result.slot;
+  if (!result.inserted) {
+    table->hits += 1;
+    return *slot;
+  }
+  Expression *interned = allocate(table->allocator, Expression);
+  if (interned == nullptr) {
+    // TODO: return an error ast node instead of panicking
+    assert(false);
+  }
+  *interned = expression;
+  *slot = interned;
+  return interned;
+}
@@ -0,0 +1,211 @@
+#include "hash_map.h"
+#include "allocator.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+enum {
+  GROUP_WIDTH = 16,
+  MINIMUM_CAPACITY = 16,
+  CONTROL_EMPTY = 0x80,
+  CONTROL_DELETED = 0xFE,
+};
+
+// Bit i is set when control byte i of the group matched.
+typedef uint32_t GroupMask;
+
+GroupMask group_match(const uint8_t *group, uint8_t value) {
+#ifdef __SSE2__
+  __m128i control = _mm_loadu_si128((const __m128i *)group);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char)value), control));
+#else
+  GroupMask mask = 0;
+  for (uint32_t i = 0; i < GROUP_WIDTH; ++i) {
+    mask |= (GroupMask)(group[i] == value) << i;
+  }
+  return mask;
+#endif
+}
+
+GroupMask group_match_empty_or_deleted(const uint8_t *group) {
+  // Full slots store a seven bit hash, the others have the top bit set.
+#ifdef __SSE2__
+  return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+  GroupMask mask = 0;
+  for (uint32_t i = 0; i < GROUP_WIDTH; ++i) {
+    mask |= (GroupMask)(group[i] >> 7) << i;
+  }
+  return mask;
+#endif
+}
+
+uint8_t control_hash(uint64_t hash) { return hash & 0x7F; }
+
+size_t probe_start(uint64_t hash, size_t capacity) {
+  return (hash >> 7) & (capacity - 1);
+}
+
+bool is_full(uint8_t control) { return (control & CONTROL_EMPTY) == 0; }
+
+void set_control(HashMap *map, size_t index, uint8_t control) {
+  map->control[index] = control;
+  // The first group is mirrored past the end so groups starting near the end
+  // can be loaded without wrapping around.
+  if (index < GROUP_WIDTH - 1) {
+    map->control[map->capacity + index] = control;
+  }
+}
+
+size_t growth_for_capacity(size_t capacity) { return capacity - capacity / 8; }
+
+void *hash_map_find(const HashMap *map, size_t slot_size, uint64_t hash,
+                    const void *key, HashMapMatch match) {
+  if (map->capacity == 0) {
+    return nullptr;
+  }
+  size_t mask = map->capacity - 1;
+  size_t position = probe_start(hash, map->capacity);
+  uint8_t h2 = control_hash(hash);
+  for (size_t stride = GROUP_WIDTH;; stride += GROUP_WIDTH) {
+    const uint8_t *group = map->control + position;
+    for (GroupMask matches = group_match(group, h2); matches != 0;
+         matches &= matches - 1) {
+      size_t index = (position + __builtin_ctz(matches)) & mask;
+      void *slot = map->slots + index * slot_size;
+      if (match(slot, key)) {
+        return slot;
+      }
+    }
+    if (group_match(group, CONTROL_EMPTY) != 0) {
+      return nullptr;
+    }
+    position = (position + stride) & mask;
+  }
+}
+
+size_t find_insert_index(const HashMap *map, uint64_t hash) {
+  size_t mask = map->capacity - 1;
+  size_t position = probe_start(hash, map->capacity);
+  for (size_t stride = GROUP_WIDTH;; stride += GROUP_WIDTH) {
+    GroupMask available =
+        group_match_empty_or_deleted(map->control + position);
+    if (available != 0) {
+      return (position + __builtin_ctz(available)) & mask;
+    }
+    position = (position + stride) & mask;
+  }
+}
+
+void hash_map_rehash(Allocator allocator, HashMap *map,
+                     const HashMapLayout *layout, size_t capacity,
+                     CallSite call_site) {
+  HashMap old = *map;
+  map->control = allocate_at_call_site(allocator, capacity + GROUP_WIDTH - 1,
+                                       GROUP_WIDTH, call_site);
+  map->slots = allocate_at_call_site(allocator, capacity * layout->slot_size,
+                                     layout->slot_alignment, call_site);
+  if (map->control == nullptr || map->slots == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  memset(map->control, CONTROL_EMPTY, capacity + GROUP_WIDTH - 1);
+  map->capacity = capacity;
+  map->growth_left = growth_for_capacity(capacity) - old.length;
+  for (size_t i = 0; i < old.capacity; ++i) {
+    if (!is_full(old.control[i])) {
+      continue;
+    }
+    const uint8_t *slot = old.slots + i * layout->slot_size;
+    uint64_t hash = layout->hash(slot);
+    size_t index = find_insert_index(map, hash);
+    set_control(map, index, control_hash(hash));
+    memcpy(map->slots + index * layout->slot_size, slot, layout->slot_size);
+  }
+  // The old arrays stay with the allocator, arenas reclaim them all at once.
+}
+
+void hash_map_reserve_at(Allocator allocator, HashMap *map,
+                         const HashMapLayout *layout, size_t length,
+                         CallSite call_site) {
+  size_t capacity = map->capacity == 0 ? MINIMUM_CAPACITY : map->capacity;
+  while (growth_for_capacity(capacity) < length) {
+    capacity *= 2;
+  }
+  if (capacity != map->capacity) {
+    hash_map_rehash(allocator, map, layout, capacity, call_site);
+  }
+}
+
+HashMapInsertResult hash_map_insert_at(Allocator allocator, HashMap *map,
+                                       const HashMapLayout *layout,
+                                       uint64_t hash, const void *key,
+                                       HashMapMatch match, CallSite call_site) {
+  void *existing = hash_map_find(map, layout->slot_size, hash, key, match);
+  if (existing != nullptr) {
+    return (HashMapInsertResult){.slot = existing, .inserted = false};
+  }
+  if (map->growth_left == 0) {
+    // Out of empty slots. Double unless most of them are tombstones, in
+    // which case rebuilding at the same size is enough.
+    size_t capacity = map->capacity;
+    if (capacity == 0) {
+      capacity = MINIMUM_CAPACITY;
+    } else if (map->length * 2 >= growth_for_capacity(capacity)) {
+      capacity *= 2;
+    }
+    hash_map_rehash(allocator, map, layout, capacity, call_site);
+  }
+  size_t index = find_insert_index(map, hash);
+  if (map->control[index] == CONTROL_EMPTY) {
+    map->growth_left -= 1;
+  }
+  set_control(map, index, control_hash(hash));
+  map->length += 1;
+  return (HashMapInsertResult){
+      .slot = map->slots + index * layout->slot_size,
+      .inserted = true,
+  };
+}
+
+bool hash_map_remove(HashMap *map, size_t slot_size, uint64_t hash,
+                     const void *key, HashMapMatch match) {
+  uint8_t *slot = hash_map_find(map, slot_size, hash, key, match);
+  if (slot == nullptr) {
+    return false;
+  }
+  set_control(map, (slot - map->slots) / slot_size, CONTROL_DELETED);
+  map->length -= 1;
+  return true;
+}
+
+void *hash_map_next(const HashMap *map, size_t slot_size, size_t *index) {
+  for (; *index < map->capacity; ++*index) {
+    if (is_full(map->control[*index])) {
+      void *slot = map->slots + *index * slot_size;
+      *index += 1;
+      return slot;
+    }
+  }
+  return nullptr;
+}
+
+uint64_t hash_bytes(const void *data, size_t length) {
+  const uint8_t *bytes = data;
+  uint64_t hash = 0x243f6a8885a308d3ull ^ length;
+  for (; length >= 8; bytes += 8, length -= 8) {
+    uint64_t word;
+    memcpy(&word, bytes, 8);
+    hash = (hash ^ word) * 0x100000001b3ull;
+    hash ^= hash >> 29;
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, bytes, length);
+  return hash_integer(hash ^ tail);
+}
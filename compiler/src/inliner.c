@@ -0,0 +1,307 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "inliner.h"
+#include <assert.h>
+#include <string.h>
+
+const InlineOptions default_inline_options = {
+    .threshold = 24, .caller_budget = 256, .constant_argument_bonus = 2};
+
+#define UNVISITED UINT32_MAX
+
+typedef struct {
+  Allocator allocator;
+  IrModule *module;
+  const InlineOptions *options;
+  InlineStats stats;
+  // The strongly connected component of every function.
+  uint32_t *components;
+  // Uses of every parameter, filled in for a callee once it is final.
+  uint32_t **parameter_uses;
+  // Where a callee's values landed in the caller while it is copied.
+  IrValue *scratch;
+  size_t scratch_capacity;
+} Inliner;
+
+typedef struct {
+  uint32_t function;
+  uint32_t edge;
+} TarjanFrame;
+
+void *inliner_allocate(Allocator allocator, size_t count, size_t size) {
+  void *memory =
+      allocate_bytes(allocator, count * size + 1, _Alignof(uint64_t));
+  if (memory == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  return memory;
+}
+
+// Tarjan's algorithm with an explicit stack, so deep call chains cannot
+// overflow the native one. Components are completed callees first, which
+// is the order functions are returned in.
+uint32_t *bottom_up_order(Inliner *inliner) {
+  Allocator allocator = inliner->allocator;
+  const IrModule *module = inliner->module;
+  uint32_t count = (uint32_t)module->functions.length;
+  uint32_t *offsets = inliner_allocate(allocator, count + 1, sizeof(uint32_t));
+  offsets[0] = 0;
+  for (uint32_t f = 0; f < count; ++f) {
+    IrInstructionArray instructions = module->functions.data[f].instructions;
+    offsets[f + 1] = offsets[f];
+    for (size_t i = 0; i < instructions.length; ++i) {
+      offsets[f + 1] += instructions.data[i].opcode == CallOp;
+    }
+  }
+  uint32_t *callees =
+      inliner_allocate(allocator, offsets[count], sizeof(uint32_t));
+  for (uint32_t f = 0; f < count; ++f) {
+    IrInstructionArray instructions = module->functions.data[f].instructions;
+    uint32_t edge = offsets[f];
+    for (size_t i = 0; i < instructions.length; ++i) {
+      if (instructions.data[i].opcode == CallOp) {
+        callees[edge++] = instructions.data[i].operands[0];
+      }
+    }
+  }
+  uint32_t *order = inliner_allocate(allocator, count, sizeof(uint32_t));
+  uint32_t *index = inliner_allocate(allocator, count, sizeof(uint32_t));
+  uint32_t *lowlink = inliner_allocate(allocator, count, sizeof(uint32_t));
+  uint32_t *stack = inliner_allocate(allocator, count, sizeof(uint32_t));
+  bool *on_stack = inliner_allocate(allocator, count, sizeof(bool));
+  TarjanFrame *frames = inliner_allocate(allocator, count, sizeof(TarjanFrame));
+  memset(index, 0xff, count * sizeof(uint32_t));
+  memset(on_stack, 0, count * sizeof(bool));
+  uint32_t visited = 0;
+  uint32_t stack_length = 0;
+  uint32_t ordered = 0;
+  uint32_t component = 0;
+  for (uint32_t root = 0; root < count; ++root) {
+    if (index[root] != UNVISITED) {
+      continue;
+    }
+    uint32_t depth = 0;
+    frames[depth++] = (TarjanFrame){.function = root, .edge = offsets[root]};
+    index[root] = lowlink[root] = visited++;
+    stack[stack_length++] = root;
+    on_stack[root] = true;
+    while (depth > 0) {
+      TarjanFrame *frame = &frames[depth - 1];
+      uint32_t f = frame->function;
+      if (frame->edge < offsets[f + 1]) {
+        uint32_t callee = callees[frame->edge++];
+        if (index[callee] == UNVISITED) {
+          index[callee] = lowlink[callee] = visited++;
+          stack[stack_length++] = callee;
+          on_stack[callee] = true;
+          frames[depth++] =
+              (TarjanFrame){.function = callee, .edge = offsets[callee]};
+        } else if (on_stack[callee] && index[callee] < lowlink[f]) {
+          lowlink[f] = index[callee];
+        }
+        continue;
+      }
+      depth -= 1;
+      if (lowlink[f] == index[f]) {
+        uint32_t member;
+        do {
+          member = stack[--stack_length];
+          on_stack[member] = false;
+          inliner->components[member] = component;
+          order[ordered++] = member;
+        } while (member != f);
+        component += 1;
+      }
+      if (depth > 0) {
+        uint32_t caller = frames[depth - 1].function;
+        if (lowlink[f] < lowlink[caller]) {
+          lowlink[caller] = lowlink[f];
+        }
+      }
+    }
+  }
+  return order;
+}
+
+const uint32_t *parameter_uses(Inliner *inliner, uint32_t callee) {
+  if (inliner->parameter_uses[callee] != nullptr) {
+    return inliner->parameter_uses[callee];
+  }
+  const IrFunction *function = &inliner->module->functions.data[callee];
+  uint32_t *uses = inliner_allocate(
+      inliner->allocator, function->parameter_count, sizeof(uint32_t));
+  memset(uses, 0, function->parameter_count * sizeof(uint32_t));
+  for (size_t i = 0; i < function->instructions.length; ++i) {
+    IrInstruction instruction = function->instructions.data[i];
+    uint32_t count = ir_operand_count(instruction);
+    for (uint32_t j = 0; j < count; ++j) {
+      if (instruction.operands[j] < function->parameter_count) {
+        uses[instruction.operands[j]] += 1;
+      }
+    }
+  }
+  inliner->parameter_uses[callee] = uses;
+  return uses;
+}
+
+// Whether to inline the call, counting it in the stats either way. growth
+// is how much inlining has grown the caller so far.
+bool should_inline(Inliner *inliner, uint32_t caller,
+                   const IrFunction *function, uint32_t call,
+                   int64_t *growth) {
+  const InlineOptions *options = inliner->options;
+  const IrInstruction *instructions = function->instructions.data;
+  uint32_t index = instructions[call].operands[0];
+  const IrFunction *callee = &inliner->module->functions.data[index];
+  inliner->stats.calls += 1;
+  if (inliner->components[index] == inliner->components[caller]) {
+    inliner->stats.recursive += 1;
+    return false;
+  }
+  if (callee->blocks.length != 1) {
+    inliner->stats.branching += 1;
+    return false;
+  }
+  uint32_t count = callee->parameter_count;
+  const uint32_t *uses = parameter_uses(inliner, index);
+  int64_t bonus = 0;
+  for (uint32_t k = 0; k < count; ++k) {
+    IrValue argument = instructions[call - count + k].operands[0];
+    if (instructions[argument].opcode == ConstOp) {
+      bonus += (int64_t)uses[k] * options->constant_argument_bonus;
+    }
+  }
+  // The body without parameters and return replaces the arguments and
+  // the call.
+  int64_t added = (int64_t)callee->instructions.length - count - 1 -
+                  (count + 1);
+  if (added - bonus > (int64_t)options->threshold) {
+    inliner->stats.too_costly += 1;
+    return false;
+  }
+  if (added > 0 && *growth + added > (int64_t)options->caller_budget) {
+    inliner->stats.over_budget += 1;
+    return false;
+  }
+  *growth += added;
+  inliner->stats.inlined += 1;
+  return true;
+}
+
+// Copies the callee's body into out with its parameters replaced by the
+// call's arguments and returns what it returned.
+IrValue inline_body(Inliner *inliner, IrFunction *out,
+                    const IrFunction *function, uint32_t call,
+                    const IrValue *remap) {
+  const IrInstruction *instructions = function->instructions.data;
+  const IrFunction *callee =
+      &inliner->module->functions.data[instructions[call].operands[0]];
+  size_t length = callee->instructions.length;
+  if (length > inliner->scratch_capacity) {
+    inliner->scratch_capacity = length * 2;
+    inliner->scratch = inliner_allocate(
+        inliner->allocator, inliner->scratch_capacity, sizeof(IrValue));
+  }
+  IrValue *values = inliner->scratch;
+  uint32_t count = callee->parameter_count;
+  for (uint32_t k = 0; k < count; ++k) {
+    values[k] = remap[instructions[call - count + k].operands[0]];
+  }
+  for (size_t j = count; j < length; ++j) {
+    IrInstruction instruction = callee->instructions.data[j];
+    uint32_t operands = ir_operand_count(instruction);
+    for (uint32_t k = 0; k < operands; ++k) {
+      instruction.operands[k] = values[instruction.operands[k]];
+    }
+    if (instruction.opcode == ReturnOp) {
+      return operands == 0 ? IR_NO_VALUE : instruction.operands[0];
+    }
+    values[j] = ir_append(inliner->allocator, out, instruction);
+  }
+  assert(false);
+}
+
+void inline_into(Inliner *inliner, uint32_t caller) {
+  Allocator allocator = inliner->allocator;
+  const IrFunction function = inliner->module->functions.data[caller];
+  const IrInstruction *instructions = function.instructions.data;
+  uint32_t length = (uint32_t)function.instructions.length;
+  int64_t growth = 0;
+  // Most functions have nothing worth inlining, so they are only rebuilt
+  // from the first call that is.
+  uint32_t first = 0;
+  while (first < length &&
+         !(instructions[first].opcode == CallOp &&
+           should_inline(inliner, caller, &function, first, &growth))) {
+    first += 1;
+  }
+  if (first == length) {
+    return;
+  }
+  IrValue *remap = inliner_allocate(allocator, length, sizeof(IrValue));
+  IrFunction out = function;
+  out.instructions = (IrInstructionArray){};
+  out.blocks = (IrBlockArray){};
+  uint32_t block = 0;
+  for (uint32_t i = 0; i < length; ++i) {
+    IrInstruction instruction = instructions[i];
+    bool inlined =
+        instruction.opcode == CallOp &&
+        (i == first ||
+         (i > first && should_inline(inliner, caller, &function, i, &growth)));
+    if (inlined) {
+      remap[i] = inline_body(inliner, &out, &function, i, remap);
+    } else if (instruction.opcode == CallOp) {
+      // Arguments wait for their call, which decides whether they stay.
+      uint32_t first = i;
+      while (first > 0 && instructions[first - 1].opcode == ArgOp) {
+        first -= 1;
+      }
+      for (uint32_t k = first; k < i; ++k) {
+        IrInstruction argument = instructions[k];
+        argument.operands[0] = remap[argument.operands[0]];
+        remap[k] = ir_append(allocator, &out, argument);
+      }
+      remap[i] = ir_append(allocator, &out, instruction);
+    } else if (instruction.opcode != ArgOp) {
+      uint32_t count = ir_operand_count(instruction);
+      for (uint32_t j = 0; j < count; ++j) {
+        instruction.operands[j] = remap[instruction.operands[j]];
+      }
+      remap[i] = ir_append(allocator, &out, instruction);
+    }
+    while (block < function.blocks.length &&
+           function.blocks.data[block].end == i + 1) {
+      ir_end_block(allocator, &out);
+      block += 1;
+    }
+  }
+  inliner->module->functions.data[caller] = out;
+}
+
+InlineStats inline_calls(Allocator allocator, IrModule *module,
+                         const InlineOptions *options) {
+  uint32_t count = (uint32_t)module->functions.length;
+  Inliner inliner = {
+      .allocator = allocator,
+      .module = module,
+      .options = options,
+      .components = inliner_allocate(allocator, count, sizeof(uint32_t)),
+      .parameter_uses = inliner_allocate(allocator, count, sizeof(uint32_t *)),
+  };
+  memset(inliner.parameter_uses, 0, count * sizeof(uint32_t *));
+  for (uint32_t f = 0; f < count; ++f) {
+    inliner.stats.instructions_before +=
+        module->functions.data[f].instructions.length;
+  }
+  uint32_t *order = bottom_up_order(&inliner);
+  for (uint32_t i = 0; i < count; ++i) {
+    inline_into(&inliner, order[i]);
+  }
+  for (uint32_t f = 0; f < count; ++f) {
+    inliner.stats.instructions_after +=
+        module->functions.data[f].instructions.length;
+  }
+  return inliner.stats;
+}
@@ -0,0 +1,22 @@
+#include "interner.h"
+#include "array.h"
+#include <stdint.h>
+
+void interner_init(Interner *interner, Allocator allocator) {
+  *interner = (Interner){.allocator = allocator};
+}
+
+SymbolId intern(Interner *interner, StringView string) {
+  SymbolId next = (SymbolId)interner->strings.length;
+  SymbolId id =
+      *map_find_or_insert(symbol_id_map, interner->allocator, &interner->ids,
+                          string, next);
+  if (id == next) {
+    array_push(interner->allocator, &interner->strings, string);
+  }
+  return id;
+}
+
+StringView symbol_string(const Interner *interner, SymbolId symbol) {
+  return interner->strings.data[symbol];
+}
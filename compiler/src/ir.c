@@ -0,0 +1,587 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "ir.h"
+#include "array.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+
+IrValue ir_append(Allocator allocator, IrFunction *function,
+                  IrInstruction instruction) {
+  IrValue value = (IrValue)function->instructions.length;
+  array_push(allocator, &function->instructions, instruction);
+  return value;
+}
+
+IrValue ir_constant(Allocator allocator, IrFunction *function, TypeId type,
+                    uint64_t bits) {
+  return ir_append(allocator, function,
+                   (IrInstruction){.opcode = ConstOp,
+                                   .type = type,
+                                   .operands = {(uint32_t)bits,
+                                                (uint32_t)(bits >> 32)}});
+}
+
+IrValue ir_binary(Allocator allocator, IrFunction *function, IrOpcode opcode,
+                  TypeId type, IrValue left, IrValue right) {
+  return ir_append(allocator, function,
+                   (IrInstruction){.opcode = opcode,
+                                   .type = type,
+                                   .operands = {left, right}});
+}
+
+IrValue ir_insert(Allocator allocator, IrFunction *function, TypeId type,
+                  IrValue vector, IrValue scalar, uint32_t lane) {
+  return ir_append(allocator, function,
+                   (IrInstruction){.opcode = InsertOp,
+                                   .lane = (uint16_t)lane,
+                                   .type = type,
+                                   .operands = {vector, scalar}});
+}
+
+IrValue ir_extract(Allocator allocator, IrFunction *function, TypeId type,
+                   IrValue vector, uint32_t lane) {
+  return ir_append(allocator, function,
+                   (IrInstruction){.opcode = ExtractOp,
+                                   .lane = (uint16_t)lane,
+                                   .type = type,
+                                   .operands = {vector, IR_NO_VALUE}});
+}
+
+IrValue ir_alloc(Allocator allocator, IrFunction *function,
+                 IrAllocation allocation, IrValue size) {
+  return ir_append(allocator, function,
+                   (IrInstruction){.opcode = AllocOp,
+                                   .lane = (uint16_t)allocation,
+                                   .type = U64TypeId,
+                                   .operands = {size, IR_NO_VALUE}});
+}
+
+IrValue ir_load(Allocator allocator, IrFunction *function, TypeId type,
+                IrValue address) {
+  return ir_append(allocator, function,
+                   (IrInstruction){.opcode = LoadOp,
+                                   .type = type,
+                                   .operands = {address, IR_NO_VALUE}});
+}
+
+void ir_store(Allocator allocator, IrFunction *function, IrValue address,
+              IrValue value) {
+  ir_append(allocator, function,
+            (IrInstruction){.opcode = StoreOp,
+                            .type = InvalidTypeId,
+                            .operands = {address, value}});
+}
+
+IrValue ir_param(Allocator allocator, IrFunction *function, TypeId type) {
+  assert(function->instructions.length == function->parameter_count);
+  return ir_append(allocator, function,
+                   (IrInstruction){.opcode = ParamOp,
+                                   .type = type,
+                                   .operands = {function->parameter_count++,
+                                                IR_NO_VALUE}});
+}
+
+IrValue ir_call(Allocator allocator, IrFunction *function, TypeId type,
+                uint32_t callee, const IrValue *arguments, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    ir_append(allocator, function,
+              (IrInstruction){
+                  .opcode = ArgOp,
+                  .type = function->instructions.data[arguments[i]].type,
+                  .operands = {arguments[i], IR_NO_VALUE}});
+  }
+  return ir_append(allocator, function,
+                   (IrInstruction){.opcode = CallOp,
+                                   .type = type,
+                                   .operands = {callee, IR_NO_VALUE}});
+}
+
+void ir_return(Allocator allocator, IrFunction *function, IrValue value) {
+  TypeId type = value == IR_NO_VALUE
+                    ? InvalidTypeId
+                    : function->instructions.data[value].type;
+  ir_append(allocator, function,
+            (IrInstruction){.opcode = ReturnOp,
+                            .type = type,
+                            .operands = {value, IR_NO_VALUE}});
+}
+
+void ir_end_block(Allocator allocator, IrFunction *function) {
+  uint32_t begin = function->blocks.length == 0
+                       ? 0
+                       : array_last(&function->blocks).end;
+  array_push(allocator, &function->blocks,
+             (IrBlock){.begin = begin,
+                       .end = (uint32_t)function->instructions.length});
+}
+
+uint64_t ir_constant_bits(IrInstruction instruction) {
+  return (uint64_t)instruction.operands[1] << 32 | instruction.operands[0];
+}
+
+uint64_t ir_int_bits(const TypeTable *types, TypeId type, uint64_t value) {
+  const Type *lane = lookup_type(types, type);
+  if (lane->kind == VectorType) {
+    lane = lookup_type(types, lane->element);
+  }
+  switch (lane->kind) {
+  case FloatType: {
+    if (lane->size == 4) {
+      float narrow = (float)value;
+      uint32_t bits;
+      memcpy(&bits, &narrow, sizeof(bits));
+      return bits;
+    }
+    double wide = (double)value;
+    uint64_t bits;
+    memcpy(&bits, &wide, sizeof(bits));
+    return bits;
+  }
+  case BoolType:
+    return value != 0;
+  case TypeParameterType:
+    return value;
+  default:
+    return lane->size >= 8 ? value : value & ((1ull << (lane->size * 8)) - 1);
+  }
+}
+
+bool ir_is_terminator(IrOpcode opcode) { return opcode == ReturnOp; }
+
+bool ir_is_comparison(IrOpcode opcode) {
+  return opcode >= EqOp && opcode <= GeOp;
+}
+
+uint32_t ir_operand_count(IrInstruction instruction) {
+  switch ((IrOpcode)instruction.opcode) {
+  case ConstOp:
+  case ParamOp:
+  case CallOp:
+    return 0;
+  case ExtractOp:
+  case AllocOp:
+  case LoadOp:
+  case ArgOp:
+    return 1;
+  case ReturnOp:
+    return instruction.operands[0] == IR_NO_VALUE ? 0 : 1;
+  case IrOpcodeCount:
+    break;
+  default:
+    return 2;
+  }
+  assert(false);
+}
+
+static const char *opcode_names[IrOpcodeCount] = {
+    [ConstOp] = "const",   [AddOp] = "add",       [SubOp] = "sub",
+    [MulOp] = "mul",       [DivOp] = "div",       [ModOp] = "mod",
+    [EqOp] = "eq",         [NeOp] = "ne",         [LtOp] = "lt",
+    [LeOp] = "le",         [GtOp] = "gt",         [GeOp] = "ge",
+    [BoundsOp] = "bounds", [InsertOp] = "insert", [ExtractOp] = "extract",
+    [AllocOp] = "alloc",   [LoadOp] = "load",     [StoreOp] = "store",
+    [ParamOp] = "param",   [ArgOp] = "arg",       [CallOp] = "call",
+    [ReturnOp] = "return",
+};
+
+static const char *allocation_names[IrAllocationCount] = {
+    [HeapAllocation] = "heap",
+    [ArenaAllocation] = "arena",
+    [StackAllocation] = "stack",
+};
+
+const char *ir_opcode_name(IrOpcode opcode) {
+  return opcode < IrOpcodeCount ? opcode_names[opcode] : "<invalid>";
+}
+
+IrUses ir_compute_uses(Allocator allocator, const IrFunction *function) {
+  size_t length = function->instructions.length;
+  const IrInstruction *instructions = function->instructions.data;
+  uint32_t *offsets = allocate_bytes(
+      allocator, (length + 1) * sizeof(uint32_t), _Alignof(uint32_t));
+  if (offsets == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  memset(offsets, 0, (length + 1) * sizeof(uint32_t));
+  // Count into offsets[v + 1], then prefix sum so offsets[v] is where the
+  // users of v start.
+  for (size_t i = 0; i < length; ++i) {
+    uint32_t count = ir_operand_count(instructions[i]);
+    for (uint32_t j = 0; j < count; ++j) {
+      offsets[instructions[i].operands[j] + 1] += 1;
+    }
+  }
+  for (size_t v = 0; v < length; ++v) {
+    offsets[v + 1] += offsets[v];
+  }
+  IrValue *users = allocate_bytes(
+      allocator, offsets[length] * sizeof(IrValue) + 1, _Alignof(IrValue));
+  if (users == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  // Fill using offsets[v] as a cursor, which leaves every entry pointing at
+  // the end of its range; shifting by one restores the starts.
+  for (size_t i = 0; i < length; ++i) {
+    uint32_t count = ir_operand_count(instructions[i]);
+    for (uint32_t j = 0; j < count; ++j) {
+      users[offsets[instructions[i].operands[j]]++] = (IrValue)i;
+    }
+  }
+  memmove(offsets + 1, offsets, length * sizeof(uint32_t));
+  offsets[0] = 0;
+  return (IrUses){.offsets = offsets, .users = users};
+}
+
+bool ir_vector_supports(const TypeTable *types, const Type *type,
+                        IrOpcode opcode) {
+  switch (opcode) {
+  case AddOp:
+  case SubOp:
+  case MulOp:
+    return true;
+  case DivOp:
+    return lookup_type(types, type->element)->kind == FloatType;
+  default:
+    return false;
+  }
+}
+
+IrVerifyResult verify_error(uint32_t instruction, const char *message) {
+  return (IrVerifyResult){
+      .valid = false, .instruction = instruction, .message = message};
+}
+
+IrVerifyResult ir_verify(const IrFunction *function, const TypeTable *types) {
+  const IrInstruction *instructions = function->instructions.data;
+  uint32_t length = (uint32_t)function->instructions.length;
+  uint32_t expected_begin = 0;
+  for (size_t b = 0; b < function->blocks.length; ++b) {
+    IrBlock block = function->blocks.data[b];
+    if (block.begin != expected_begin || block.end > length) {
+      return verify_error(block.begin, "blocks do not tile the function");
+    }
+    if (block.begin == block.end) {
+      return verify_error(block.begin, "empty block");
+    }
+    for (uint32_t i = block.begin; i < block.end; ++i) {
+      IrInstruction instruction = instructions[i];
+      if (instruction.opcode >= IrOpcodeCount) {
+        return verify_error(i, "unknown opcode");
+      }
+      bool last = i + 1 == block.end;
+      if (ir_is_terminator(instruction.opcode) != last) {
+        return verify_error(i, last ? "block does not end in a terminator"
+                                    : "terminator in the middle of a block");
+      }
+      uint32_t count = ir_operand_count(instruction);
+      for (uint32_t j = 0; j < count; ++j) {
+        if (instruction.operands[j] >= i) {
+          return verify_error(i, "operand does not dominate its use");
+        }
+      }
+      const Type *type = lookup_type(types, instruction.type);
+      TypeKind kind = type->kind;
+      if (kind == TypeParameterType ||
+          (kind == VectorType &&
+           lookup_type(types, type->element)->kind == TypeParameterType)) {
+        return verify_error(i, "type parameter in a concrete function");
+      }
+      if (kind == StructType) {
+        return verify_error(i, "struct value outside of memory");
+      }
+      switch ((IrOpcode)instruction.opcode) {
+      case ConstOp:
+        if (kind == InvalidType) {
+          return verify_error(i, "constant without a type");
+        }
+        break;
+      case ParamOp:
+        if (instruction.operands[0] != i ||
+            i >= function->parameter_count) {
+          return verify_error(i, "parameter out of place");
+        }
+        break;
+      case ArgOp:
+        if (i + 1 == block.end || (instructions[i + 1].opcode != ArgOp &&
+                                   instructions[i + 1].opcode != CallOp)) {
+          return verify_error(i, "argument without a call");
+        }
+        if (instruction.type != instructions[instruction.operands[0]].type) {
+          return verify_error(i, "argument type does not match its operand");
+        }
+        break;
+      case CallOp:
+        break;
+      case AllocOp:
+        if (instruction.lane >= IrAllocationCount ||
+            instruction.type != U64TypeId) {
+          return verify_error(i, "allocation is not a u64 address");
+        }
+        if (instructions[instruction.operands[0]].type != U64TypeId) {
+          return verify_error(i, "allocation size is not a u64");
+        }
+        break;
+      case LoadOp:
+      case StoreOp:
+        if (instructions[instruction.operands[0]].type != U64TypeId) {
+          return verify_error(i, "address is not a u64");
+        }
+        if ((instruction.opcode == LoadOp) == (kind == InvalidType)) {
+          return verify_error(i, instruction.opcode == LoadOp
+                                     ? "load without a type"
+                                     : "store with a value");
+        }
+        break;
+      case ReturnOp:
+        if (count == 1 &&
+            instructions[instruction.operands[0]].type != instruction.type) {
+          return verify_error(i, "return type does not match its operand");
+        }
+        if (instruction.type != function->return_type) {
+          return verify_error(i, "return type does not match the function");
+        }
+        break;
+      case InsertOp:
+      case ExtractOp: {
+        const Type *vector =
+            lookup_type(types, instructions[instruction.operands[0]].type);
+        if (vector->kind != VectorType || instruction.lane >= vector->lanes) {
+          return verify_error(i, "lane out of range for a vector");
+        }
+        TypeId scalar = instruction.opcode == InsertOp
+                            ? instructions[instruction.operands[1]].type
+                            : instruction.type;
+        if (scalar != vector->element ||
+            (instruction.opcode == InsertOp &&
+             instruction.type != instructions[instruction.operands[0]].type)) {
+          return verify_error(i, "lane type does not match the vector");
+        }
+        break;
+      }
+      case BoundsOp:
+        if (instructions[instruction.operands[0]].type != U64TypeId ||
+            instructions[instruction.operands[1]].type != U64TypeId ||
+            instruction.type != U64TypeId) {
+          return verify_error(i, "bounds check is not on u64 values");
+        }
+        break;
+      default: {
+        TypeId left = instructions[instruction.operands[0]].type;
+        TypeId right = instructions[instruction.operands[1]].type;
+        if (left != right) {
+          return verify_error(i, "operand types differ");
+        }
+        if (ir_is_comparison(instruction.opcode)
+                ? instruction.type != BoolTypeId
+                : instruction.type != left) {
+          return verify_error(i, "result type does not match operands");
+        }
+        if (lookup_type(types, left)->kind == BoolType &&
+            !ir_is_comparison(instruction.opcode)) {
+          return verify_error(i, "arithmetic on bool");
+        }
+        const Type *operand = lookup_type(types, left);
+        if (operand->kind == VectorType &&
+            !ir_vector_supports(types, operand, instruction.opcode)) {
+          return verify_error(i, "operator not supported for vectors");
+        }
+        break;
+      }
+      }
+    }
+    expected_begin = block.end;
+  }
+  if (expected_begin != length) {
+    return verify_error(expected_begin, "instructions outside of any block");
+  }
+  for (uint32_t i = 0; i < function->parameter_count; ++i) {
+    if (i >= length || instructions[i].opcode != ParamOp) {
+      return verify_error(i, "missing parameters");
+    }
+  }
+  return (IrVerifyResult){.valid = true};
+}
+
+IrVerifyResult verify_call(const IrModule *module, const IrFunction *caller,
+                           uint32_t at) {
+  const IrInstruction *instructions = caller->instructions.data;
+  IrInstruction call = instructions[at];
+  if (call.operands[0] >= module->functions.length) {
+    return verify_error(at, "call to an unknown function");
+  }
+  const IrFunction *callee = &module->functions.data[call.operands[0]];
+  uint32_t count = 0;
+  while (count < at && instructions[at - count - 1].opcode == ArgOp) {
+    count += 1;
+  }
+  if (count != callee->parameter_count) {
+    return verify_error(at, "wrong number of arguments");
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    if (instructions[at - count + i].type !=
+        callee->instructions.data[i].type) {
+      return verify_error(at - count + i, "argument type does not match");
+    }
+  }
+  if (call.type != callee->return_type) {
+    return verify_error(at, "call type does not match the callee");
+  }
+  return (IrVerifyResult){.valid = true};
+}
+
+IrVerifyResult ir_verify_module(const IrModule *module,
+                                const TypeTable *types) {
+  for (uint32_t f = 0; f < module->functions.length; ++f) {
+    const IrFunction *function = &module->functions.data[f];
+    IrVerifyResult result = ir_verify(function, types);
+    for (uint32_t i = 0; result.valid && i < function->instructions.length;
+         ++i) {
+      if (function->instructions.data[i].opcode == CallOp) {
+        result = verify_call(module, function, i);
+      }
+    }
+    if (!result.valid) {
+      result.function = f;
+      return result;
+    }
+  }
+  return (IrVerifyResult){.valid = true};
+}
+
+void ir_write_constant(FILE *out, const Type *type, uint64_t bits) {
+  switch (type->kind) {
+  case BoolType:
+    fputs(bits ? "true" : "false", out);
+    return;
+  case SignedIntType: {
+    uint32_t shift = 64 - type->size * 8;
+    fprintf(out, "%" PRId64, (int64_t)(bits << shift) >> shift);
+    return;
+  }
+  case UnsignedIntType:
+    fprintf(out, "%" PRIu64, bits & (UINT64_MAX >> (64 - type->size * 8)));
+    return;
+  case FloatType:
+    if (type->size == 4) {
+      uint32_t narrow = (uint32_t)bits;
+      float value;
+      memcpy(&value, &narrow, sizeof(value));
+      fprintf(out, "%.9g", value);
+    } else {
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      fprintf(out, "%.17g", value);
+    }
+    return;
+  case VectorType:
+  case InvalidType:
+  case TypeParameterType:
+  case StructType:
+  case SliceType:
+  case FunctionType:
+    fprintf(out, "0x%" PRIx64, bits);
+    return;
+  }
+}
+
+void ir_write_vector(FILE *out, const TypeTable *types, const Type *type,
+                     const void *lanes) {
+  const Type *element = lookup_type(types, type->element);
+  const uint8_t *bytes = lanes;
+  fputc('[', out);
+  for (uint32_t i = 0; i < type->lanes; ++i) {
+    uint64_t bits = 0;
+    memcpy(&bits, bytes + i * element->size, element->size);
+    fputs(i == 0 ? "" : ", ", out);
+    ir_write_constant(out, element, bits);
+  }
+  fputc(']', out);
+}
+
+void ir_dump(const IrFunction *function, const TypeTable *types, FILE *out) {
+  StringView return_type =
+      function->return_type == InvalidTypeId
+          ? (StringView){.data = "void", .length = 4}
+          : lookup_type(types, function->return_type)->name;
+  fprintf(out, "function %.*s(", (int)function->name.length,
+          function->name.data);
+  for (uint32_t i = 0; i < function->parameter_count; ++i) {
+    StringView name =
+        lookup_type(types, function->instructions.data[i].type)->name;
+    fprintf(out, "%s%.*s", i == 0 ? "" : ", ", (int)name.length, name.data);
+  }
+  fprintf(out, ") -> %.*s {\n", (int)return_type.length, return_type.data);
+  for (size_t b = 0; b < function->blocks.length; ++b) {
+    IrBlock block = function->blocks.data[b];
+    fprintf(out, "block%zu:\n", b);
+    for (uint32_t i = block.begin; i < block.end; ++i) {
+      IrInstruction instruction = function->instructions.data[i];
+      const Type *type = lookup_type(types, instruction.type);
+      const char *name = ir_opcode_name(instruction.opcode);
+      if (instruction.opcode == ReturnOp || instruction.opcode == StoreOp) {
+        fprintf(out, "  %s", name);
+      } else {
+        fprintf(out, "  %%%u = %s %.*s", i, name, (int)type->name.length,
+                type->name.data);
+      }
+      if (instruction.opcode == ConstOp) {
+        fputc(' ', out);
+        // Vector constants are one element broadcast to every lane.
+        ir_write_constant(out,
+                          type->kind == VectorType
+                              ? lookup_type(types, type->element)
+                              : type,
+                          ir_constant_bits(instruction));
+      }
+      uint32_t count = ir_operand_count(instruction);
+      for (uint32_t j = 0; j < count; ++j) {
+        fprintf(out, "%s%%%u", j == 0 ? " " : ", ", instruction.operands[j]);
+      }
+      if (instruction.opcode == InsertOp || instruction.opcode == ExtractOp) {
+        fprintf(out, " lane %u", instruction.lane);
+      }
+      if (instruction.opcode == AllocOp) {
+        fprintf(out, " %s", allocation_names[instruction.lane]);
+      }
+      if (instruction.opcode == ParamOp || instruction.opcode == CallOp) {
+        fprintf(out, " %s%u", instruction.opcode == CallOp ? "@" : "",
+                instruction.operands[0]);
+      }
+      fputc('\n', out);
+    }
+  }
+  fputs("}\n", out);
+}
+
+void ir_compact(IrFunction *function, const bool *keep, IrValue *remap) {
+  IrInstruction *instructions = function->instructions.data;
+  uint32_t length = (uint32_t)function->instructions.length;
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < length; ++i) {
+    remap[i] = keep[i] ? kept++ : IR_NO_VALUE;
+  }
+  for (uint32_t i = 0; i < length; ++i) {
+    if (!keep[i]) {
+      continue;
+    }
+    IrInstruction instruction = instructions[i];
+    uint32_t count = ir_operand_count(instruction);
+    for (uint32_t j = 0; j < count; ++j) {
+      instruction.operands[j] = remap[instruction.operands[j]];
+    }
+    instructions[remap[i]] = instruction;
+  }
+  // A block's new end is where its last kept instruction landed; its
+  // terminator is always kept so no block becomes empty.
+  uint32_t begin = 0;
+  for (size_t b = 0; b < function->blocks.length; ++b) {
+    IrBlock *block = &function->blocks.data[b];
+    uint32_t end = remap[block->end - 1] + 1;
+    *block = (IrBlock){.begin = begin, .end = end};
+    begin = end;
+  }
+  function->instructions.length = kept;
+}
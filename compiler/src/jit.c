@@ -0,0 +1,71 @@
+#define _DEFAULT_SOURCE
+
+#include "jit.h"
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+uint64_t symbol_address(X64Symbol symbol) {
+  switch (symbol) {
+  case FmodSymbol:
+    return (uint64_t)(uintptr_t)&fmod;
+  case FmodfSymbol:
+    return (uint64_t)(uintptr_t)&fmodf;
+  case X64SymbolCount:
+    break;
+  }
+  return 0;
+}
+
+bool host_supports(uint32_t features) {
+#ifdef __x86_64__
+  return ((features & X64Sse41) == 0 || __builtin_cpu_supports("sse4.1")) &&
+         ((features & X64Avx) == 0 || __builtin_cpu_supports("avx")) &&
+         ((features & X64Avx2) == 0 || __builtin_cpu_supports("avx2"));
+#else
+  return false;
+#endif
+}
+
+JitFunction jit_load(const X64Code *code) {
+#ifndef __x86_64__
+  return (JitFunction){};
+#endif
+  if (!host_supports(code->features)) {
+    return (JitFunction){};
+  }
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  size_t size = (code->bytes.length + page_size - 1) & ~(page_size - 1);
+  void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    return (JitFunction){};
+  }
+  uint8_t *bytes = memory;
+  memcpy(bytes, code->bytes.data, code->bytes.length);
+  for (size_t i = 0; i < code->relocations.length; ++i) {
+    X64Relocation relocation = code->relocations.data[i];
+    int32_t displacement;
+    memcpy(&displacement, bytes + relocation.offset, sizeof(displacement));
+    uint64_t address = symbol_address(relocation.symbol);
+    memcpy(bytes + relocation.offset + 4 + displacement, &address,
+           sizeof(address));
+  }
+  if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(memory, size);
+    return (JitFunction){};
+  }
+  return (JitFunction){
+      .memory = memory,
+      .size = size,
+      .entry = (JitEntry)memory,
+  };
+}
+
+void jit_release(JitFunction *function) {
+  if (function->memory != nullptr) {
+    munmap(function->memory, function->size);
+  }
+  *function = (JitFunction){};
+}
@@ -0,0 +1,469 @@
+#include "lower.h"
+#include "array.h"
+#include "monomorphize.h"
+#include <assert.h>
+#include <string.h>
+
+typedef struct {
+  // Position in the module, UINT32_MAX for names that are not functions.
+  uint32_t index;
+  // The id of a generic function in the monomorphizer, UINT32_MAX for
+  // concrete functions.
+  uint32_t generic;
+  TypeId type;
+} LoweredFunction;
+
+typedef Array(IrValue) IrValueArray;
+
+typedef Array(TypeId) TypeIdArray;
+
+typedef struct {
+  Analyzer *analyzer;
+  IrModule module;
+  // The function being lowered; values and slices belong to it.
+  IrFunction function;
+  // Indexed by SymbolId, IR_NO_VALUE for names without a binding yet.
+  IrValueArray values;
+  // Indexed by IrValue, the slice type of values that stand for one and
+  // InvalidTypeId everywhere else.
+  TypeIdArray slices;
+  // Indexed by SymbolId, shared by every function.
+  Array(LoweredFunction) functions;
+  // Arguments of the calls being lowered, innermost last.
+  IrValueArray arguments;
+  // Instantiates generic functions into module at their calls.
+  Monomorphizer monomorphizer;
+} Lowering;
+
+IrValue lower_expression(Lowering *lowering, const Expression *expression,
+                         TypeId expected);
+
+// Vector constants hold the bits of the element broadcast to every lane.
+const Type *lane_type(const TypeTable *types, TypeId type) {
+  const Type *resolved = lookup_type(types, type);
+  return resolved->kind == VectorType ? lookup_type(types, resolved->element)
+                                      : resolved;
+}
+
+IrValue lower_int(Lowering *lowering, Int int_, TypeId type) {
+  return ir_constant(
+      lowering->analyzer->allocator, &lowering->function, type,
+      ir_int_bits(lowering->analyzer->types, type, decode_int(int_).value));
+}
+
+IrValue lower_float(Lowering *lowering, Float float_, TypeId type) {
+  Allocator allocator = lowering->analyzer->allocator;
+  double value = decode_float(float_);
+  if (lane_type(lowering->analyzer->types, type)->size == 4) {
+    float narrow = (float)value;
+    uint32_t bits;
+    memcpy(&bits, &narrow, sizeof(bits));
+    return ir_constant(allocator, &lowering->function, type, bits);
+  }
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return ir_constant(allocator, &lowering->function, type, bits);
+}
+
+IrValue *value_slot(Lowering *lowering, StringView name) {
+  Analyzer *analyzer = lowering->analyzer;
+  SymbolId symbol = intern(analyzer->interner, name);
+  while (lowering->values.length <= symbol) {
+    array_push(analyzer->allocator, &lowering->values, IR_NO_VALUE);
+  }
+  return &lowering->values.data[symbol];
+}
+
+IrValue lower_assign(Lowering *lowering, Assign assign) {
+  TypeId type = resolve_type_name(lowering->analyzer, assign.type);
+  IrValue value = lower_expression(lowering, assign.value, type);
+  *value_slot(lowering, assign.name.view) = value;
+  return value;
+}
+
+IrOpcode binary_opcode(OperatorKind kind) {
+  switch (kind) {
+  case AddOperator:
+    return AddOp;
+  case SubOperator:
+    return SubOp;
+  case MulOperator:
+    return MulOp;
+  case DivOperator:
+    return DivOp;
+  case ModOperator:
+    return ModOp;
+  case EqOperator:
+    return EqOp;
+  case NeOperator:
+    return NeOp;
+  case LtOperator:
+    return LtOp;
+  case LeOperator:
+    return LeOp;
+  case GtOperator:
+    return GtOp;
+  case GeOperator:
+    return GeOp;
+  case AssignOperator:
+  case NotOperator:
+    break;
+  }
+  assert(false);
+}
+
+bool is_literal_expression(const Expression *expression) {
+  return expression->kind == IntExpression ||
+         expression->kind == FloatExpression;
+}
+
+// Mirrors check_operands: literals take the type of the other operand.
+IrValue lower_binary_op(Lowering *lowering, BinaryOp binary_op,
+                        TypeId expected) {
+  IrOpcode opcode = binary_opcode(binary_op.op.kind);
+  TypeId operand_type = ir_is_comparison(opcode) ? InvalidTypeId : expected;
+  IrValue left;
+  IrValue right;
+  if (operand_type == InvalidTypeId && is_literal_expression(binary_op.left) &&
+      !is_literal_expression(binary_op.right)) {
+    right = lower_expression(lowering, binary_op.right, InvalidTypeId);
+    operand_type = lowering->function.instructions.data[right].type;
+    left = lower_expression(lowering, binary_op.left, operand_type);
+  } else {
+    left = lower_expression(lowering, binary_op.left, operand_type);
+    operand_type = lowering->function.instructions.data[left].type;
+    right = lower_expression(lowering, binary_op.right, operand_type);
+  }
+  TypeId type = ir_is_comparison(opcode) ? BoolTypeId : operand_type;
+  return ir_binary(lowering->analyzer->allocator, &lowering->function, opcode,
+                   type, left, right);
+}
+
+// The type the analyzer gave the value, which for slices is not the u64
+// address they are lowered to.
+TypeId source_type(const Lowering *lowering, IrValue value) {
+  if (value < lowering->slices.length &&
+      lowering->slices.data[value] != InvalidTypeId) {
+    return lowering->slices.data[value];
+  }
+  return lowering->function.instructions.data[value].type;
+}
+
+void mark_slice(Lowering *lowering, IrValue value, TypeId slice) {
+  while (lowering->slices.length <= value) {
+    array_push(lowering->analyzer->allocator, &lowering->slices,
+               InvalidTypeId);
+  }
+  lowering->slices.data[value] = slice;
+}
+
+// Slices are passed around as the u64 address of their first element, see
+// lower_array for where their length is.
+TypeId value_type(const TypeTable *types, TypeId type) {
+  return lookup_type(types, type)->kind == SliceType ? U64TypeId : type;
+}
+
+// The elements are stored to a heap allocation whose address stands for
+// the slice; escape analysis is left to find a cheaper home for it. The
+// length is a u64 right below the first element, so the slice stays a
+// single address and indexing can still check against it. Mirrors
+// check_array: without an expected type the first element decides.
+IrValue lower_array(Lowering *lowering, ArrayLiteral array, TypeId expected) {
+  Allocator allocator = lowering->analyzer->allocator;
+  TypeTable *types = lowering->analyzer->types;
+  IrFunction *function = &lowering->function;
+  TypeId element = InvalidTypeId;
+  IrValue first = IR_NO_VALUE;
+  if (expected != InvalidTypeId) {
+    element = lookup_type(types, expected)->element;
+  } else {
+    first = lower_expression(lowering, &array.elements[0], InvalidTypeId);
+    element = source_type(lowering, first);
+  }
+  const Type *resolved = lookup_type(types, element);
+  uint32_t size = resolved->size;
+  // Padded so the elements keep their alignment.
+  uint64_t header = resolved->alignment > 8 ? resolved->alignment : 8;
+  IrValue bytes =
+      ir_constant(allocator, function, U64TypeId,
+                  header + array_size(types, element, array.count));
+  IrValue allocation = ir_alloc(allocator, function, HeapAllocation, bytes);
+  IrValue length_address = allocation;
+  if (header > 8) {
+    IrValue padding = ir_constant(allocator, function, U64TypeId, header - 8);
+    length_address = ir_binary(allocator, function, AddOp, U64TypeId,
+                               allocation, padding);
+  }
+  ir_store(allocator, function, length_address,
+           ir_constant(allocator, function, U64TypeId, array.count));
+  IrValue base = ir_binary(allocator, function, AddOp, U64TypeId, allocation,
+                           ir_constant(allocator, function, U64TypeId, header));
+  mark_slice(lowering, base, slice_type(types, element));
+  for (uint32_t i = 0; i < array.count; ++i) {
+    IrValue value =
+        i == 0 && first != IR_NO_VALUE
+            ? first
+            : lower_expression(lowering, &array.elements[i], element);
+    IrValue address = base;
+    if (i > 0) {
+      IrValue offset =
+          ir_constant(allocator, function, U64TypeId, (uint64_t)i * size);
+      address =
+          ir_binary(allocator, function, AddOp, U64TypeId, base, offset);
+    }
+    ir_store(allocator, function, address, value);
+  }
+  return base;
+}
+
+IrValue lower_index(Lowering *lowering, Index index) {
+  Analyzer *analyzer = lowering->analyzer;
+  IrFunction *function = &lowering->function;
+  IrValue base = lower_expression(lowering, index.target, InvalidTypeId);
+  TypeId slice = source_type(lowering, base);
+  TypeId element = lookup_type(analyzer->types, slice)->element;
+  uint32_t size = lookup_type(analyzer->types, element)->size;
+  IrValue position = lower_expression(lowering, index.index, U64TypeId);
+  IrValue eight = ir_constant(analyzer->allocator, function, U64TypeId, 8);
+  IrValue length_address = ir_binary(analyzer->allocator, function, SubOp,
+                                     U64TypeId, base, eight);
+  IrValue length =
+      ir_load(analyzer->allocator, function, U64TypeId, length_address);
+  IrValue offset = ir_binary(analyzer->allocator, function, BoundsOp,
+                             U64TypeId, position, length);
+  if (size > 1) {
+    IrValue scale = ir_constant(analyzer->allocator, function, U64TypeId, size);
+    offset = ir_binary(analyzer->allocator, function, MulOp, U64TypeId,
+                       offset, scale);
+  }
+  IrValue address = ir_binary(analyzer->allocator, function, AddOp,
+                              U64TypeId, base, offset);
+  return ir_load(analyzer->allocator, function, element, address);
+}
+
+LoweredFunction *function_slot(Lowering *lowering, StringView name) {
+  Analyzer *analyzer = lowering->analyzer;
+  SymbolId symbol = intern(analyzer->interner, name);
+  while (lowering->functions.length <= symbol) {
+    array_push(analyzer->allocator, &lowering->functions,
+               (LoweredFunction){.index = UINT32_MAX, .generic = UINT32_MAX});
+  }
+  return &lowering->functions.data[symbol];
+}
+
+// The function takes its place in the module before its body is lowered,
+// so recursive calls know where to go. The body sees only its parameters
+// and other functions, as check_function made sure. A generic function is
+// lowered once with its type parameters in place and registered with the
+// monomorphizer instead, which makes an instance per type arguments called
+// with.
+IrValue lower_function(Lowering *lowering, Function function) {
+  Analyzer *analyzer = lowering->analyzer;
+  Allocator allocator = analyzer->allocator;
+  analyzer->type_parameters = function.type_parameters;
+  analyzer->type_parameter_count = function.type_parameter_count;
+  TypeId result = resolve_type_name(analyzer, function.return_type);
+  TypeIdArray parameters = {};
+  for (uint32_t i = 0; i < function.parameter_count; ++i) {
+    array_push(allocator, &parameters,
+               resolve_type_name(analyzer, function.parameters[i].type));
+  }
+  bool generic = function.type_parameter_count > 0;
+  uint32_t index = UINT32_MAX;
+  if (!generic) {
+    index = (uint32_t)lowering->module.functions.length;
+    array_push(allocator, &lowering->module.functions, (IrFunction){});
+  }
+  *function_slot(lowering, function.name.view) = (LoweredFunction){
+      .index = index,
+      .generic = UINT32_MAX,
+      .type = function_type(analyzer->types, result, parameters.data,
+                            function.parameter_count)};
+  IrFunction outer = lowering->function;
+  IrValueArray values = lowering->values;
+  TypeIdArray slices = lowering->slices;
+  lowering->function =
+      (IrFunction){.name = function.name.view,
+                   .return_type = value_type(analyzer->types, result)};
+  lowering->values = (IrValueArray){};
+  lowering->slices = (TypeIdArray){};
+  for (uint32_t i = 0; i < function.parameter_count; ++i) {
+    TypeId type = parameters.data[i];
+    IrValue value = ir_param(allocator, &lowering->function,
+                             value_type(analyzer->types, type));
+    if (type != value_type(analyzer->types, type)) {
+      mark_slice(lowering, value, type);
+    }
+    *value_slot(lowering, function.parameters[i].name.view) = value;
+  }
+  IrValue body = lower_expression(lowering, function.body, result);
+  ir_return(allocator, &lowering->function, body);
+  ir_end_block(allocator, &lowering->function);
+  if (generic) {
+    uint32_t id = monomorphizer_add_generic(
+        &lowering->monomorphizer,
+        (IrGeneric){.body = lowering->function,
+                    .type_parameter_count = function.type_parameter_count});
+    function_slot(lowering, function.name.view)->generic = id;
+  } else {
+    lowering->module.functions.data[index] = lowering->function;
+  }
+  analyzer->type_parameters = nullptr;
+  analyzer->type_parameter_count = 0;
+  lowering->function = outer;
+  lowering->values = values;
+  lowering->slices = slices;
+  return IR_NO_VALUE;
+}
+
+typedef struct {
+  uint32_t function;
+  TypeId result;
+} LowerGenericArgumentsResult;
+
+// Mirrors check_generic_call: the expected result and then arguments that
+// are not literals bind the type parameters, then literals take the types
+// bound. The arguments go to the stack from base on.
+LowerGenericArgumentsResult
+lower_generic_arguments(Lowering *lowering, Call call, LoweredFunction callee,
+                        TypeId expected, size_t base) {
+  Analyzer *analyzer = lowering->analyzer;
+  TypeTable *types = analyzer->types;
+  uint32_t count =
+      lowering->monomorphizer.generics.data[callee.generic]
+          .type_parameter_count;
+  TypeIdArray arguments = {};
+  for (uint32_t k = 0; k < count; ++k) {
+    array_push(analyzer->allocator, &arguments, InvalidTypeId);
+  }
+  if (expected != InvalidTypeId) {
+    bind_type_arguments(types, lookup_type(types, callee.type)->element,
+                        expected, arguments.data);
+  }
+  for (uint32_t literals = 0; literals < 2; ++literals) {
+    for (uint32_t i = 0; i < call.argument_count; ++i) {
+      const Expression *argument = &call.arguments[i];
+      if (is_literal_expression(argument) != (literals == 1)) {
+        continue;
+      }
+      TypeId parameter = lookup_type(types, callee.type)->parameters[i];
+      TypeId expected = parameter;
+      if (mentions_type_parameter(types, parameter)) {
+        const Type *pattern = lookup_type(types, parameter);
+        expected = pattern->kind == TypeParameterType
+                       ? arguments.data[pattern->index]
+                       : InvalidTypeId;
+      }
+      IrValue value = lower_expression(lowering, argument, expected);
+      lowering->arguments.data[base + i] = value;
+      bind_type_arguments(types, parameter, source_type(lowering, value),
+                          arguments.data);
+    }
+  }
+  return (LowerGenericArgumentsResult){
+      .function = monomorphize(&lowering->monomorphizer, callee.generic,
+                               arguments.data),
+      .result = substitute_type(
+          types, lookup_type(types, callee.type)->element, arguments.data)};
+}
+
+// Arguments are gathered on the shared stack, so calls nested in an
+// argument push theirs above and pop them before the outer call is built.
+IrValue lower_call(Lowering *lowering, Call call, TypeId expected) {
+  Analyzer *analyzer = lowering->analyzer;
+  LoweredFunction callee =
+      *function_slot(lowering, call.callee->value.symbol.view);
+  size_t base = lowering->arguments.length;
+  for (uint32_t i = 0; i < call.argument_count; ++i) {
+    array_push(analyzer->allocator, &lowering->arguments, IR_NO_VALUE);
+  }
+  uint32_t index = callee.index;
+  TypeId result = lookup_type(analyzer->types, callee.type)->element;
+  if (callee.generic != UINT32_MAX) {
+    LowerGenericArgumentsResult instance =
+        lower_generic_arguments(lowering, call, callee, expected, base);
+    index = instance.function;
+    result = instance.result;
+  } else {
+    for (uint32_t i = 0; i < call.argument_count; ++i) {
+      IrValue argument = lower_expression(
+          lowering, &call.arguments[i],
+          lookup_type(analyzer->types, callee.type)->parameters[i]);
+      lowering->arguments.data[base + i] = argument;
+    }
+  }
+  assert(index != UINT32_MAX);
+  IrValue value = ir_call(analyzer->allocator, &lowering->function,
+                          value_type(analyzer->types, result), index,
+                          &lowering->arguments.data[base],
+                          call.argument_count);
+  lowering->arguments.length = base;
+  if (value_type(analyzer->types, result) != result) {
+    mark_slice(lowering, value, result);
+  }
+  return value;
+}
+
+IrValue lower_expression(Lowering *lowering, const Expression *expression,
+                         TypeId expected) {
+  switch (expression->kind) {
+  case SymbolExpression: {
+    IrValue value = *value_slot(lowering, expression->value.symbol.view);
+    assert(value != IR_NO_VALUE);
+    return value;
+  }
+  case IntExpression:
+    return lower_int(lowering, expression->value.int_,
+                     expected == InvalidTypeId ? I64TypeId : expected);
+  case FloatExpression:
+    return lower_float(lowering, expression->value.float_,
+                       expected == InvalidTypeId ? F64TypeId : expected);
+  case AssignExpression:
+    return lower_assign(lowering, expression->value.assign);
+  case BinaryOpExpression:
+    return lower_binary_op(lowering, expression->value.binary_op, expected);
+  case StructExpression:
+    // Declarations only introduce a type.
+    return IR_NO_VALUE;
+  case ArrayExpression:
+    return lower_array(lowering, expression->value.array, expected);
+  case IndexExpression:
+    return lower_index(lowering, expression->value.index);
+  case FunctionExpression:
+    return lower_function(lowering, expression->value.function);
+  case CallExpression:
+    return lower_call(lowering, expression->value.call, expected);
+  case SliceTypeExpression:
+    assert(false);
+  }
+  assert(false);
+}
+
+IrModule lower_program(Analyzer *analyzer, Module module) {
+  Lowering lowering = {.analyzer = analyzer};
+  monomorphizer_init(&lowering.monomorphizer, analyzer->allocator,
+                     analyzer->types, &lowering.module);
+  lowering.function.name = (StringView){.data = "main", .length = 4};
+  IrValue last = IR_NO_VALUE;
+  for (size_t i = 0; i < module.length; ++i) {
+    IrValue value =
+        lower_expression(&lowering, &module.expressions[i], InvalidTypeId);
+    if (value != IR_NO_VALUE) {
+      last = value;
+    }
+  }
+  lowering.function.return_type =
+      last == IR_NO_VALUE ? InvalidTypeId
+                          : lowering.function.instructions.data[last].type;
+  ir_return(analyzer->allocator, &lowering.function, last);
+  ir_end_block(analyzer->allocator, &lowering.function);
+  array_push(analyzer->allocator, &lowering.module.functions,
+             lowering.function);
+  return lowering.module;
+}
+
+IrFunction lower_module(Analyzer *analyzer, Module module) {
+  IrModule program = lower_program(analyzer, module);
+  assert(program.functions.length == 1);
+  return program.functions.data[0];
+}
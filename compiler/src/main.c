@@ -1,7 +1,541 @@
+#define _DEFAULT_SOURCE
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "buffered_writer.h"
+#include "bytecode.h"
+#include "c_backend.h"
+#include "compile_stats.h"
+#include "comptime.h"
+#include "concurrent_arena.h"
+#include "elf_object.h"
+#include "escape.h"
+#include "hash_cons.h"
+#include "inliner.h"
+#include "ir.h"
+#include "jit.h"
+#include "lower.h"
+#include "optimize.h"
+#include "parser.h"
+#include "semantic.h"
+#include "stack_allocator.h"
+#include "trace.h"
+#include "tracking_allocator.h"
+#include "vectorize.h"
+#include "vm.h"
+#include "x64.h"
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+typedef struct {
+  const char *path;
+  bool alloc_stats;
+  bool huge_pages;
+  bool hash_cons;
+  bool dump_ir;
+  bool pass_stats;
+  bool stats;
+  const char *stats_json;
+  const char *trace;
+  bool vectorize;
+  bool vectorize_report;
+  bool interpret;
+  bool run;
+  const char *emit_c;
+  const char *build;
+  const char *emit_object;
+} Options;
+
+void print_usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [--alloc-stats] [--huge-pages] [--hash-cons] "
+          "[--vectorize] [--vectorize-report] [--dump-ir] [--pass-stats] "
+          "[--stats] [--stats-json <stats.json>] [--trace <trace.json>] "
+          "[--interpret | --run] [--emit-c <file.c>] "
+          "[--build <executable>] [--emit-object <file.o>] <file.yeti>\n",
+          program);
+}
+
+bool parse_options(int32_t argc, char *argv[], Options *options) {
+  *options = (Options){};
+  for (int32_t i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--alloc-stats") == 0) {
+      options->alloc_stats = true;
+    } else if (strcmp(argv[i], "--huge-pages") == 0) {
+      options->huge_pages = true;
+    } else if (strcmp(argv[i], "--hash-cons") == 0) {
+      options->hash_cons = true;
+    } else if (strcmp(argv[i], "--dump-ir") == 0) {
+      options->dump_ir = true;
+    } else if (strcmp(argv[i], "--pass-stats") == 0) {
+      options->pass_stats = true;
+    } else if (strcmp(argv[i], "--stats") == 0) {
+      options->stats = true;
+    } else if (strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc) {
+      options->stats_json = argv[++i];
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      options->trace = argv[++i];
+    } else if (strcmp(argv[i], "--vectorize") == 0) {
+      options->vectorize = true;
+    } else if (strcmp(argv[i], "--vectorize-report") == 0) {
+      options->vectorize = true;
+      options->vectorize_report = true;
+    } else if (strcmp(argv[i], "--interpret") == 0) {
+      options->interpret = true;
+    } else if (strcmp(argv[i], "--run") == 0) {
+      options->run = true;
+    } else if (strcmp(argv[i], "--emit-c") == 0 && i + 1 < argc) {
+      options->emit_c = argv[++i];
+    } else if (strcmp(argv[i], "--build") == 0 && i + 1 < argc) {
+      options->build = argv[++i];
+    } else if (strcmp(argv[i], "--emit-object") == 0 && i + 1 < argc) {
+      options->emit_object = argv[++i];
+    } else if (argv[i][0] == '-' || options->path != nullptr) {
+      return false;
+    } else {
+      options->path = argv[i];
+    }
+  }
+  return options->path != nullptr && !(options->interpret && options->run);
+}
+
+typedef struct {
+  char *data;
+  size_t length;
+} ReadFileResult;
+
+ReadFileResult read_file(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) {
+    return (ReadFileResult){};
+  }
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char *data = malloc(length + 1);
+  if (data == nullptr || fread(data, 1, length, file) != (size_t)length) {
+    free(data);
+    fclose(file);
+    return (ReadFileResult){};
+  }
+  data[length] = '\0';
+  fclose(file);
+  return (ReadFileResult){.data = data, .length = length};
+}
+
+void print_diagnostics(const char *path, DiagnosticArray diagnostics) {
+  for (size_t i = 0; i < diagnostics.length; ++i) {
+    Diagnostic diagnostic = diagnostics.data[i];
+    fprintf(stderr, "%s:%u:%u: error: %s", path,
+            diagnostic.span.begin.line + 1, diagnostic.span.begin.column + 1,
+            diagnostic_message(diagnostic.kind));
+    if (diagnostic.subject.length > 0) {
+      fprintf(stderr, " '%.*s'", (int)diagnostic.subject.length,
+              diagnostic.subject.data);
+    }
+    fputc('\n', stderr);
+  }
+}
+
+void print_pass_stats(const PassStats stats[PassCount]) {
+  for (size_t i = 0; i < PassCount; ++i) {
+    fprintf(stderr, "%-20s %8zu removed %10.3f ms\n", stats[i].name,
+            stats[i].removed, stats[i].nanoseconds / 1e6);
+  }
+}
+
+// Times consecutive phases of one file.
+typedef struct {
+  CompileStats stats;
+  // Optional. Receives an event per phase.
+  TraceThread *trace;
+  const char *path;
+  uint64_t clock;
+} PhaseClock;
+
+void end_phase(PhaseClock *clock, Phase phase) {
+  uint64_t begin = clock->clock;
+  clock->clock = compile_stats_lap(&clock->stats, phase, begin);
+  if (clock->trace != nullptr) {
+    trace_event(clock->trace, phase_name(phase), clock->path, begin,
+                clock->clock);
+  }
+}
+
+bool write_stats_file(const char *path, const CompileStats *stats) {
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "could not write %s\n", path);
+    return false;
+  }
+  compile_stats_write_json(stats, file);
+  return fclose(file) == 0;
+}
+
+bool write_trace_file(const char *path, const Tracer *tracer) {
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "could not write %s\n", path);
+    return false;
+  }
+  tracer_write_json(tracer, file);
+  return fclose(file) == 0;
+}
+
+int32_t print_result(VmResult result, TypeId type, const TypeTable *types) {
+  if (result.status != VmOk) {
+    fprintf(stderr, "error: %s\n", vm_status_message(result.status));
+    return EXIT_FAILURE;
+  }
+  const Type *resolved = lookup_type(types, type);
+  if (resolved->kind == VectorType) {
+    ir_write_vector(stdout, types, resolved, result.vector);
+    fputc('\n', stdout);
+  } else if (type != InvalidTypeId) {
+    ir_write_constant(stdout, resolved, result.value);
+    fputc('\n', stdout);
+  }
+  return EXIT_SUCCESS;
+}
+
+// Arrays lower to allocations, loads and stores, which no backend emits yet.
+bool uses_memory(const IrFunction *function) {
+  for (size_t i = 0; i < function->instructions.length; ++i) {
+    IrOpcode opcode = function->instructions.data[i].opcode;
+    if (opcode == AllocOp || opcode == LoadOp || opcode == StoreOp ||
+        opcode == BoundsOp) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Calls the inliner and the compile time evaluator could not remove.
+bool uses_calls(const IrFunction *function) {
+  for (size_t i = 0; i < function->instructions.length; ++i) {
+    if (function->instructions.data[i].opcode == CallOp) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int32_t interpret(PhaseClock *clock, Allocator allocator,
+                  const IrFunction *function, const TypeTable *types) {
+  BytecodeFunction bytecode = compile_bytecode(allocator, function, types);
+  if (bytecode.too_many_registers) {
+    fprintf(stderr, "error: too many live values for the interpreter\n");
+    return EXIT_FAILURE;
+  }
+  uint64_t *registers = allocate_bytes(
+      allocator, bytecode.register_count * sizeof(uint64_t),
+      _Alignof(uint64_t));
+  end_phase(clock, CodegenPhase);
+  VmResult result = vm_run(&bytecode, registers);
+  int32_t status = print_result(result, function->return_type, types);
+  end_phase(clock, RunPhase);
+  return status;
+}
+
+int32_t run(PhaseClock *clock, Allocator allocator,
+            const IrFunction *function, const TypeTable *types) {
+  X64CompileResult compiled = x64_compile(allocator, function, types);
+  JitFunction jit = {};
+  if (compiled.supported) {
+    jit = jit_load(&compiled.code);
+  }
+  if (jit.entry == nullptr) {
+    fprintf(stderr, "error: --run is not supported on this machine\n");
+    return EXIT_FAILURE;
+  }
+  end_phase(clock, CodegenPhase);
+  VmResult result = {};
+  result.status = jit.entry(result.vector);
+  result.value = result.vector[0];
+  jit_release(&jit);
+  int32_t status = print_result(result, function->return_type, types);
+  end_phase(clock, RunPhase);
+  return status;
+}
+
+bool emit_c_to_fd(int fd, Allocator allocator, const IrFunction *function,
+                  const TypeTable *types) {
+  BufferedWriter writer;
+  buffered_writer_init(&writer, allocator, fd, 1 << 16);
+  emit_c(&writer, function, types);
+  return buffered_writer_flush(&writer);
+}
+
+int32_t write_c_file(const char *path, Allocator allocator,
+                     const IrFunction *function, const TypeTable *types) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "could not write %s\n", path);
+    return EXIT_FAILURE;
+  }
+  bool written = emit_c_to_fd(fd, allocator, function, types);
+  if (close(fd) != 0 || !written) {
+    fprintf(stderr, "could not write %s\n", path);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+// Writes the natively compiled function as an object defining yeti_main.
+int32_t write_object_file(const char *path, Allocator allocator,
+                          const IrFunction *function, const TypeTable *types) {
+  X64CompileResult compiled = x64_compile(allocator, function, types);
+  if (!compiled.supported) {
+    fprintf(stderr, "error: --emit-object does not support this program\n");
+    return EXIT_FAILURE;
+  }
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "could not write %s\n", path);
+    return EXIT_FAILURE;
+  }
+  BufferedWriter writer;
+  buffered_writer_init(&writer, allocator, fd, 1 << 16);
+  write_elf_object(&writer, &compiled.code, "yeti_main");
+  bool written = buffered_writer_flush(&writer);
+  if (close(fd) != 0 || !written) {
+    fprintf(stderr, "could not write %s\n", path);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+// Emits C into a temporary file and hands it to $CC, or cc, at -O3.
+int32_t build_executable(PhaseClock *clock, const char *output,
+                         Allocator allocator, const IrFunction *function,
+                         const TypeTable *types) {
+  char c_path[] = "/tmp/yeti-XXXXXX.c";
+  int fd = mkstemps(c_path, 2);
+  if (fd < 0) {
+    fprintf(stderr, "could not create a temporary file\n");
+    return EXIT_FAILURE;
+  }
+  bool written = emit_c_to_fd(fd, allocator, function, types);
+  if (close(fd) != 0 || !written) {
+    fprintf(stderr, "could not write %s\n", c_path);
+    unlink(c_path);
+    return EXIT_FAILURE;
+  }
+  end_phase(clock, CodegenPhase);
+  char *cc = getenv("CC");
+  if (cc == nullptr || cc[0] == '\0') {
+    cc = "cc";
+  }
+  char *arguments[] = {
+      cc, "-std=c2x", "-O3", "-o", (char *)output, c_path, "-lm", nullptr,
+  };
+  pid_t pid;
+  int32_t status = EXIT_FAILURE;
+  if (posix_spawnp(&pid, cc, nullptr, nullptr, arguments, environ) != 0) {
+    fprintf(stderr, "could not run %s\n", cc);
+  } else {
+    int wait_status;
+    if (waitpid(pid, &wait_status, 0) == pid && WIFEXITED(wait_status) &&
+        WEXITSTATUS(wait_status) == 0) {
+      status = EXIT_SUCCESS;
+    } else {
+      fprintf(stderr, "%s failed to compile %s\n", cc, c_path);
+    }
+  }
+  unlink(c_path);
+  end_phase(clock, CcPhase);
+  return status;
+}
 
-int32_t main() {
-  printf("Hello, Yeti!\n");
-  return 0;
+int32_t main(int32_t argc, char *argv[]) {
+  Options options;
+  if (!parse_options(argc, argv, &options)) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+#ifndef YETI_TRACK_ALLOCATIONS
+  if (options.alloc_stats) {
+    fprintf(stderr, "--alloc-stats requires building with "
+                    "-Dtrack_allocations=true\n");
+    return EXIT_FAILURE;
+  }
+#endif
+  // Timing costs a clock read per phase; counting is only done on request.
+  bool stats = options.stats || options.stats_json != nullptr;
+  PhaseClock clock = {.path = options.path, .clock = monotonic_ns()};
+  // The tracer has an arena of its own as it is set up before the stack
+  // allocator and may be recorded into from several threads.
+  ConcurrentArena trace_arena;
+  Tracer tracer;
+  TraceThread trace;
+  if (options.trace != nullptr) {
+    concurrent_arena_init(&trace_arena, 1 << 16);
+    tracer_init(&tracer,
+                (Allocator){.allocate = concurrent_arena_allocate,
+                            .resize = concurrent_arena_resize,
+                            .state = &trace_arena},
+                PhaseCount, clock.clock);
+    trace_thread_init(&trace, &tracer);
+    clock.trace = &trace;
+  }
+  ReadFileResult file = read_file(options.path);
+  if (file.data == nullptr) {
+    fprintf(stderr, "could not read %s\n", options.path);
+    return EXIT_FAILURE;
+  }
+  clock.stats.files = 1;
+  clock.stats.source_bytes = file.length;
+  end_phase(&clock, ReadPhase);
+  // A first guess, the arena grows when it runs out.
+  size_t capacity = file.length * 64 + (1 << 20);
+  StackAllocator stack;
+  if (options.huge_pages) {
+    stack_allocator_init_huge_pages(&stack, capacity);
+    fprintf(stderr, "arena backed by %s\n", page_kind_name(stack.pages));
+  } else {
+    stack_allocator_init(&stack, capacity);
+  }
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+#ifdef YETI_TRACK_ALLOCATIONS
+  TrackingAllocator tracking;
+  tracking_allocator_init(&tracking, allocator);
+  allocator = (Allocator){.allocate = tracking_allocate,
+                          .resize = tracking_resize,
+                          .state = &tracking};
+#endif
+  if (stats) {
+    clock.stats.tokens = count_tokens((Cursor){.input = file.data});
+    end_phase(&clock, LexPhase);
+  }
+  Parser parser = {.allocator = allocator};
+  HashConsTable hash_cons;
+  if (options.hash_cons) {
+    hash_cons_table_init(&hash_cons, allocator);
+    parser.hash_cons = &hash_cons;
+  }
+  Module module = parse_module(&parser, (Cursor){.input = file.data}).module;
+  if (stats) {
+    clock.stats.nodes = count_nodes(module);
+  }
+  end_phase(&clock, ParsePhase);
+  Interner interner;
+  interner_init(&interner, allocator);
+  TypeTable types;
+  type_table_init(&types, allocator);
+  Analyzer analyzer;
+  analyzer_init(&analyzer, allocator, &interner, &types);
+  analyze_module(&analyzer, module);
+  end_phase(&clock, AnalyzePhase);
+  print_diagnostics(options.path, analyzer.diagnostics);
+  int32_t status =
+      analyzer.diagnostics.length == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  if (status == EXIT_SUCCESS) {
+    IrModule program = lower_program(&analyzer, module);
+    for (size_t i = 0; stats && i < program.functions.length; ++i) {
+      clock.stats.instructions +=
+          program.functions.data[i].instructions.length;
+    }
+    end_phase(&clock, LowerPhase);
+    if (program.functions.length > 1) {
+      inline_calls(allocator, &program, &default_inline_options);
+      Comptime comptime;
+      comptime_init(&comptime, allocator, &program, &types,
+                    &default_comptime_limits);
+      evaluate_constant_calls(&comptime, &program);
+    }
+    // After inlining, so allocations that only escaped into an inlined
+    // callee can move off the heap.
+    promote_allocations(allocator, &program, &default_escape_options);
+    // The backends only see main, which is lowered last.
+    IrFunction *function =
+        &program.functions.data[program.functions.length - 1];
+    PassStats pass_stats[PassCount];
+    optimize(allocator, function, &types, pass_stats);
+    if (options.pass_stats) {
+      print_pass_stats(pass_stats);
+    }
+    if (options.vectorize) {
+      const VectorTarget *target =
+          host_supports(X64Avx2) ? &avx2_target : &sse2_target;
+      VectorizeResult vectorized = vectorize(allocator, function, target);
+      if (options.vectorize_report) {
+        vectorize_write_remarks(stderr, &vectorized, &types, target);
+      }
+    }
+    IrVerifyResult verified = ir_verify_module(&program, &types);
+    if (!verified.valid) {
+      fprintf(stderr, "internal error: invalid ir at %%%u in %.*s: %s\n",
+              verified.instruction,
+              (int)program.functions.data[verified.function].name.length,
+              program.functions.data[verified.function].name.data,
+              verified.message);
+      status = EXIT_FAILURE;
+    }
+    end_phase(&clock, OptimizePhase);
+    if (options.dump_ir) {
+      for (size_t i = 0; i < program.functions.length; ++i) {
+        ir_dump(&program.functions.data[i], &types, stdout);
+      }
+    }
+    bool backend = options.interpret || options.run ||
+                   options.emit_c != nullptr || options.build != nullptr ||
+                   options.emit_object != nullptr;
+    if (status == EXIT_SUCCESS && backend && uses_memory(function)) {
+      fprintf(stderr, "error: the backends do not support arrays yet\n");
+      status = EXIT_FAILURE;
+    }
+    if (status == EXIT_SUCCESS && backend && uses_calls(function)) {
+      fprintf(stderr, "error: the backends do not support calls yet\n");
+      status = EXIT_FAILURE;
+    }
+    if (status == EXIT_SUCCESS && options.interpret) {
+      status = interpret(&clock, allocator, function, &types);
+    }
+    if (status == EXIT_SUCCESS && options.run) {
+      status = run(&clock, allocator, function, &types);
+    }
+    if (status == EXIT_SUCCESS && options.emit_c != nullptr) {
+      status = write_c_file(options.emit_c, allocator, function, &types);
+    }
+    if (status == EXIT_SUCCESS && options.build != nullptr) {
+      status = build_executable(&clock, options.build, allocator, function,
+                                &types);
+    }
+    if (status == EXIT_SUCCESS && options.emit_object != nullptr) {
+      status =
+          write_object_file(options.emit_object, allocator, function, &types);
+    }
+    end_phase(&clock, CodegenPhase);
+  }
+  clock.stats.arena_bytes = stack_allocator_used(&stack);
+  if (options.stats) {
+    compile_stats_write_table(&clock.stats, stderr);
+  }
+  if (options.stats_json != nullptr &&
+      !write_stats_file(options.stats_json, &clock.stats)) {
+    status = EXIT_FAILURE;
+  }
+  if (options.trace != nullptr) {
+    if (!write_trace_file(options.trace, &tracer)) {
+      status = EXIT_FAILURE;
+    }
+    concurrent_arena_destroy(&trace_arena);
+  }
+#ifdef YETI_TRACK_ALLOCATIONS
+  if (options.alloc_stats) {
+    tracking_allocator_write_json(&tracking, stdout);
+  }
+#endif
+  stack_allocator_destroy(&stack);
+  free(file.data);
+  return status;
 }
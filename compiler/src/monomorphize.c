@@ -0,0 +1,126 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "monomorphize.h"
+#include <assert.h>
+#include <string.h>
+
+void monomorphizer_init(Monomorphizer *monomorphizer, Allocator allocator,
+                        TypeTable *types, IrModule *module) {
+  *monomorphizer = (Monomorphizer){
+      .allocator = allocator, .types = types, .module = module};
+}
+
+uint32_t monomorphizer_add_generic(Monomorphizer *monomorphizer,
+                                   IrGeneric generic) {
+  array_push(monomorphizer->allocator, &monomorphizer->generics, generic);
+  return (uint32_t)monomorphizer->generics.length - 1;
+}
+
+void *monomorphize_allocate(Allocator allocator, size_t size) {
+  void *memory = allocate_bytes(allocator, size + 1, _Alignof(uint64_t));
+  if (memory == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  return memory;
+}
+
+uint32_t intern_type_tuple(Monomorphizer *monomorphizer, const TypeId *types,
+                           uint32_t count) {
+  TypeTuple tuple = {.types = types, .count = count};
+  uint32_t *id = type_tuple_map_find(&monomorphizer->tuples, tuple);
+  if (id != nullptr) {
+    return *id;
+  }
+  // The caller's array may not outlive the call, the table keeps a copy.
+  TypeId *copy =
+      monomorphize_allocate(monomorphizer->allocator, count * sizeof(TypeId));
+  memcpy(copy, types, count * sizeof(TypeId));
+  tuple.types = copy;
+  uint32_t fresh = monomorphizer->tuple_count++;
+  map_insert(type_tuple_map, monomorphizer->allocator, &monomorphizer->tuples,
+             tuple, fresh);
+  return fresh;
+}
+
+// name<a, b> with the type arguments spelled out.
+StringView instance_name(Monomorphizer *monomorphizer, StringView name,
+                         const TypeId *arguments, uint32_t count) {
+  size_t length = name.length + 2;
+  for (uint32_t k = 0; k < count; ++k) {
+    length += lookup_type(monomorphizer->types, arguments[k])->name.length + 2;
+  }
+  char *data = monomorphize_allocate(monomorphizer->allocator, length);
+  size_t written = 0;
+  memcpy(data, name.data, name.length);
+  written += name.length;
+  data[written++] = '<';
+  for (uint32_t k = 0; k < count; ++k) {
+    StringView type = lookup_type(monomorphizer->types, arguments[k])->name;
+    if (k > 0) {
+      data[written++] = ',';
+      data[written++] = ' ';
+    }
+    memcpy(data + written, type.data, type.length);
+    written += type.length;
+  }
+  data[written++] = '>';
+  return (StringView){.data = data, .length = written};
+}
+
+uint32_t monomorphize(Monomorphizer *monomorphizer, uint32_t generic,
+                      const TypeId *arguments) {
+  monomorphizer->stats.requests += 1;
+  const IrGeneric *source = &monomorphizer->generics.data[generic];
+  uint32_t count = source->type_parameter_count;
+  uint32_t tuple = intern_type_tuple(monomorphizer, arguments, count);
+  uint64_t key = (uint64_t)generic << 32 | tuple;
+  uint32_t *cached = instance_map_find(&monomorphizer->instances, key);
+  if (cached != nullptr) {
+    monomorphizer->stats.cache_hits += 1;
+    return *cached;
+  }
+  const IrFunction *body = &source->body;
+  IrFunction instance = *body;
+  instance.instructions = (IrInstructionArray){};
+  instance.blocks = (IrBlockArray){};
+  array_append(monomorphizer->allocator, &instance.instructions,
+               body->instructions.data, body->instructions.length);
+  array_append(monomorphizer->allocator, &instance.blocks, body->blocks.data,
+               body->blocks.length);
+  for (size_t i = 0; i < instance.instructions.length; ++i) {
+    IrInstruction *instruction = &instance.instructions.data[i];
+    TypeId type =
+        substitute_type(monomorphizer->types, instruction->type, arguments);
+    // Constants of a type parameter hold an integer, which only now has a
+    // representation.
+    if (instruction->opcode == ConstOp && type != instruction->type) {
+      uint64_t bits = ir_int_bits(monomorphizer->types, type,
+                                  ir_constant_bits(*instruction));
+      instruction->operands[0] = (uint32_t)bits;
+      instruction->operands[1] = (uint32_t)(bits >> 32);
+    }
+    instruction->type = type;
+  }
+  instance.return_type =
+      substitute_type(monomorphizer->types, body->return_type, arguments);
+  InstanceBody shape = {.instructions = instance.instructions.data,
+                        .length = (uint32_t)instance.instructions.length,
+                        .return_type = instance.return_type};
+  IrModule *module = monomorphizer->module;
+  uint32_t *function = map_find_or_insert(
+      instance_body_map, monomorphizer->allocator, &monomorphizer->bodies,
+      shape, (uint32_t)module->functions.length);
+  if (*function == module->functions.length) {
+    instance.name =
+        instance_name(monomorphizer, body->name, arguments, count);
+    array_push(monomorphizer->allocator, &module->functions, instance);
+    monomorphizer->stats.instantiated += 1;
+  } else {
+    monomorphizer->stats.deduplicated += 1;
+  }
+  uint32_t index = *function;
+  map_insert(instance_map, monomorphizer->allocator,
+             &monomorphizer->instances, key, index);
+  return index;
+}
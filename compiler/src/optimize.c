@@ -0,0 +1,21 @@
+#include "optimize.h"
+#include "compile_stats.h"
+#include "constant_fold.h"
+#include "dead_code.h"
+#include "value_numbering.h"
+
+void optimize(Allocator allocator, IrFunction *function,
+              const TypeTable *types, PassStats stats[PassCount]) {
+  uint64_t begin = monotonic_ns();
+  ConstantFoldStats folded = fold_constants(allocator, function, types);
+  uint64_t end = monotonic_ns();
+  stats[0] = (PassStats){"fold_constants", folded.removed, end - begin};
+  begin = end;
+  ValueNumberingStats numbered = number_values(allocator, function, types);
+  end = monotonic_ns();
+  stats[1] = (PassStats){"number_values", numbered.removed, end - begin};
+  begin = end;
+  DeadCodeStats dead = eliminate_dead_code(allocator, function, types);
+  end = monotonic_ns();
+  stats[2] = (PassStats){"eliminate_dead_code", dead.removed, end - begin};
+}
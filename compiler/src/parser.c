@@ -2,8 +2,11 @@
 #define YETI_ENABLE_ALLOCATOR_MACROS
 
 #include "parser.h"
+#include "array.h"
+#include "hash_cons.h"
 #include <assert.h>
 #include <stdbool.h>
+#include <string.h>
 
 ParseExpressionResult parse_symbol(Cursor cursor, Symbol symbol) {
   return (ParseExpressionResult){
@@ -38,40 +41,374 @@ ParseExpressionResult parse_int(Cursor cursor, Int int_) {
   };
 }
 
-ParseExpressionResult parse_prefix(Cursor cursor) {
+typedef enum {
+  LowestPrecedence,
+  DefinePrecedence,
+  ComparePrecedence,
+  AddPrecedence,
+  MultiplyPrecedence,
+  PostfixPrecedence,
+} Precedence;
+
+ParseExpressionResult parse_expression_with_precedence(Parser *parser,
+                                                       Cursor cursor,
+                                                       Precedence precedence);
+
+ParseExpressionResult parse_grouping(Parser *parser, Cursor cursor) {
+  ParseExpressionResult inner = parse_expression(parser, cursor);
+  NextTokenResult close = next_token(inner.cursor);
+  if (close.token.kind != DelimiterToken ||
+      close.token.value.delimiter.kind != CloseParenDelimiter) {
+    // TODO: return an error ast node instead of panicking
+    assert(false);
+  }
+  inner.cursor = close.cursor;
+  return inner;
+}
+
+bool is_struct_keyword(Symbol symbol) {
+  return string_view_equal(symbol.view,
+                           (StringView){.data = "struct", .length = 6});
+}
+
+ParseExpressionResult parse_struct(Parser *parser, Cursor cursor,
+                                   Symbol keyword);
+
+ParseExpressionResult parse_array(Parser *parser, Cursor cursor,
+                                  Delimiter open);
+
+ParseExpressionResult parse_prefix(Parser *parser, Cursor cursor) {
   NextTokenResult result = next_token(cursor);
   switch (result.token.kind) {
   case SymbolToken:
+    if (is_struct_keyword(result.token.value.symbol)) {
+      return parse_struct(parser, result.cursor, result.token.value.symbol);
+    }
     return parse_symbol(result.cursor, result.token.value.symbol);
   case FloatToken:
     return parse_float(result.cursor, result.token.value.float_);
   case IntToken:
     return parse_int(result.cursor, result.token.value.int_);
+  case DelimiterToken:
+    if (result.token.value.delimiter.kind == OpenParenDelimiter) {
+      return parse_grouping(parser, result.cursor);
+    }
+    if (result.token.value.delimiter.kind == OpenSquareDelimiter) {
+      return parse_array(parser, result.cursor, result.token.value.delimiter);
+    }
+    assert(false);
   default:
     assert(false);
   }
 }
 
-typedef ParseExpressionResult (*InfixParser)(Allocator, Cursor, Expression,
+typedef ParseExpressionResult (*InfixParser)(Parser *, Cursor, Expression,
                                              Token);
 
-ParseExpressionResult parse_define(Allocator allocator, Cursor cursor,
-                                   Expression prefix, Token name) {
-  NextTokenResult assign_operator = next_token(cursor);
-  ParseExpressionResult value =
-      parse_expression(allocator, assign_operator.cursor);
-  Expression *type = allocate(allocator, Expression);
-  if (type == nullptr) {
+Expression *store_expression(Parser *parser, Expression expression) {
+  if (parser->hash_cons != nullptr) {
+    return hash_cons(parser->hash_cons, expression);
+  }
+  Expression *stored = allocate(parser->allocator, Expression);
+  if (stored == nullptr) {
     // TODO: return an error ast node instead of panicking
     assert(false);
   }
-  *type = prefix;
-  Expression *assign_value = allocate(allocator, Expression);
-  if (assign_value == nullptr) {
+  *stored = expression;
+  return stored;
+}
+
+bool is_delimiter(Token token, DelimiterKind kind) {
+  return token.kind == DelimiterToken && token.value.delimiter.kind == kind;
+}
+
+bool is_operator(Token token, OperatorKind kind) {
+  return token.kind == OperatorToken && token.value.operator.kind == kind;
+}
+
+Symbol expect_symbol(NextTokenResult result) {
+  if (result.token.kind != SymbolToken) {
+    // TODO: return an error ast node instead of panicking
+    assert(false);
+  }
+  return result.token.value.symbol;
+}
+
+typedef Array(Symbol) SymbolArray;
+
+// One exact allocation for a finished list. The allocate macro only
+// covers single values.
+void *copy_list(Allocator allocator, const void *items, size_t count,
+                size_t size, size_t alignment) {
+  void *copy = allocate_bytes(allocator, count * size + 1, alignment);
+  if (copy == nullptr) {
     // TODO: return an error ast node instead of panicking
     assert(false);
   }
-  *assign_value = value.expression;
+  if (count > 0) {
+    memcpy(copy, items, count * size);
+  }
+  return copy;
+}
+
+typedef struct {
+  Expression *elements;
+  uint32_t count;
+  Cursor cursor;
+} ParseListResult;
+
+// Comma separated expressions up to the close delimiter, which may follow
+// a trailing comma. The cursor is just past the open delimiter.
+ParseListResult parse_list(Parser *parser, Cursor cursor,
+                           DelimiterKind close) {
+  size_t begin = parser->scratch.length;
+  NextTokenResult next = next_token(cursor);
+  while (!is_delimiter(next.token, close)) {
+    ParseExpressionResult element = parse_expression(parser, cursor);
+    array_push(parser->allocator, &parser->scratch, element.expression);
+    next = next_token(element.cursor);
+    if (is_delimiter(next.token, CommaDelimiter)) {
+      cursor = next.cursor;
+      next = next_token(cursor);
+    } else if (!is_delimiter(next.token, close)) {
+      // TODO: return an error ast node instead of panicking
+      assert(false);
+    }
+  }
+  size_t count = parser->scratch.length - begin;
+  Expression *elements = copy_list(
+      parser->allocator, count > 0 ? &parser->scratch.data[begin] : nullptr,
+      count, sizeof(Expression), _Alignof(Expression));
+  parser->scratch.length = begin;
+  return (ParseListResult){
+      .elements = elements, .count = (uint32_t)count, .cursor = next.cursor};
+}
+
+typedef struct {
+  TypedName *names;
+  uint32_t count;
+  Cursor cursor;
+} ParseTypedNamesResult;
+
+// Like parse_list for "type name" pairs.
+ParseTypedNamesResult parse_typed_names(Parser *parser, Cursor cursor,
+                                        DelimiterKind close) {
+  size_t begin = parser->typed_names.length;
+  NextTokenResult next = next_token(cursor);
+  while (!is_delimiter(next.token, close)) {
+    ParseExpressionResult type = parse_prefix(parser, cursor);
+    NextTokenResult name = next_token(type.cursor);
+    TypedName typed_name = {
+        .type = store_expression(parser, type.expression),
+        .name = expect_symbol(name),
+    };
+    array_push(parser->allocator, &parser->typed_names, typed_name);
+    next = next_token(name.cursor);
+    if (is_delimiter(next.token, CommaDelimiter)) {
+      cursor = next.cursor;
+      next = next_token(cursor);
+    } else if (!is_delimiter(next.token, close)) {
+      // TODO: return an error ast node instead of panicking
+      assert(false);
+    }
+  }
+  size_t count = parser->typed_names.length - begin;
+  TypedName *names = copy_list(
+      parser->allocator, count > 0 ? &parser->typed_names.data[begin] : nullptr,
+      count, sizeof(TypedName), _Alignof(TypedName));
+  parser->typed_names.length = begin;
+  return (ParseTypedNamesResult){
+      .names = names, .count = (uint32_t)count, .cursor = next.cursor};
+}
+
+ParseExpressionResult parse_struct(Parser *parser, Cursor cursor,
+                                   Symbol keyword) {
+  NextTokenResult next = next_token(cursor);
+  SymbolArray attributes = {};
+  if (is_delimiter(next.token, OpenSquareDelimiter)) {
+    do {
+      next = next_token(next.cursor);
+      array_push(parser->allocator, &attributes, expect_symbol(next));
+      next = next_token(next.cursor);
+    } while (is_delimiter(next.token, CommaDelimiter));
+    if (!is_delimiter(next.token, CloseSquareDelimiter)) {
+      // TODO: return an error ast node instead of panicking
+      assert(false);
+    }
+    next = next_token(next.cursor);
+  }
+  Symbol name = expect_symbol(next);
+  next = next_token(next.cursor);
+  if (!is_delimiter(next.token, OpenCurlyDelimiter)) {
+    // TODO: return an error ast node instead of panicking
+    assert(false);
+  }
+  ParseTypedNamesResult fields =
+      parse_typed_names(parser, next.cursor, CloseCurlyDelimiter);
+  array_shrink_to_fit(parser->allocator, &attributes);
+  Expression declaration = {
+      .kind = StructExpression,
+      .value.struct_ = {.keyword = keyword.span,
+                        .name = name,
+                        .attributes = attributes.data,
+                        .attribute_count = (uint32_t)attributes.length,
+                        .fields = fields.names,
+                        .field_count = fields.count},
+      .span = name.span,
+  };
+  return (ParseExpressionResult){
+      .expression = declaration,
+      .cursor = fields.cursor,
+  };
+}
+
+bool positions_equal(Position a, Position b) {
+  return a.line == b.line && a.column == b.column;
+}
+
+// [] immediately followed by a type, as in []f32, is a slice type.
+// Anything else after the open bracket is an array literal.
+ParseExpressionResult parse_array(Parser *parser, Cursor cursor,
+                                  Delimiter open) {
+  NextTokenResult next = next_token(cursor);
+  if (is_delimiter(next.token, CloseSquareDelimiter)) {
+    NextTokenResult after = next_token(next.cursor);
+    Position end = next.token.value.delimiter.span.end;
+    if ((after.token.kind == SymbolToken &&
+         positions_equal(after.token.value.symbol.span.begin, end)) ||
+        (is_delimiter(after.token, OpenSquareDelimiter) &&
+         positions_equal(after.token.value.delimiter.span.begin, end))) {
+      ParseExpressionResult element = parse_prefix(parser, next.cursor);
+      return (ParseExpressionResult){
+          .expression = {.kind = SliceTypeExpression,
+                         .value.slice.element =
+                             store_expression(parser, element.expression),
+                         .span = open.span},
+          .cursor = element.cursor,
+      };
+    }
+  }
+  ParseListResult elements =
+      parse_list(parser, cursor, CloseSquareDelimiter);
+  return (ParseExpressionResult){
+      .expression = {.kind = ArrayExpression,
+                     .value.array = {.elements = elements.elements,
+                                     .count = elements.count},
+                     .span = open.span},
+      .cursor = elements.cursor,
+  };
+}
+
+ParseExpressionResult parse_index(Parser *parser, Cursor cursor,
+                                  Expression target, Token open) {
+  ParseExpressionResult index = parse_expression(parser, cursor);
+  NextTokenResult close = next_token(index.cursor);
+  if (!is_delimiter(close.token, CloseSquareDelimiter)) {
+    // TODO: return an error ast node instead of panicking
+    assert(false);
+  }
+  return (ParseExpressionResult){
+      .expression = {.kind = IndexExpression,
+                     .value.index = {.target = store_expression(parser, target),
+                                     .index = store_expression(
+                                         parser, index.expression)},
+                     .span = open.value.delimiter.span},
+      .cursor = close.cursor,
+  };
+}
+
+ParseExpressionResult parse_call(Parser *parser, Cursor cursor,
+                                 Expression callee, Token open) {
+  ParseListResult arguments = parse_list(parser, cursor, CloseParenDelimiter);
+  return (ParseExpressionResult){
+      .expression = {.kind = CallExpression,
+                     .value.call = {.callee = store_expression(parser, callee),
+                                    .arguments = arguments.elements,
+                                    .argument_count = arguments.count},
+                     .span = open.value.delimiter.span},
+      .cursor = arguments.cursor,
+  };
+}
+
+// The cursor is just past the open parenthesis of the parameters.
+ParseExpressionResult parse_function(Parser *parser, Cursor cursor,
+                                     Expression return_type, Symbol name,
+                                     SymbolArray type_parameters) {
+  ParseTypedNamesResult parameters =
+      parse_typed_names(parser, cursor, CloseParenDelimiter);
+  NextTokenResult assign_operator = next_token(parameters.cursor);
+  if (assign_operator.token.kind != OperatorToken ||
+      assign_operator.token.value.operator.kind != AssignOperator) {
+    // TODO: return an error ast node instead of panicking
+    assert(false);
+  }
+  ParseExpressionResult body = parse_expression_with_precedence(
+      parser, assign_operator.cursor, DefinePrecedence);
+  Expression function = {
+      .kind = FunctionExpression,
+      .value.function = {.return_type =
+                             store_expression(parser, return_type),
+                         .name = name,
+                         .type_parameters = type_parameters.data,
+                         .type_parameter_count =
+                             (uint32_t)type_parameters.length,
+                         .parameters = parameters.names,
+                         .parameter_count = parameters.count,
+                         .assign_token =
+                             assign_operator.token.value.operator.span,
+                         .body = store_expression(parser, body.expression)},
+      .span = name.span,
+  };
+  return (ParseExpressionResult){
+      .expression = function,
+      .cursor = body.cursor,
+  };
+}
+
+// The type parameters of a generic function, from just past the <
+// through the open parenthesis after the >.
+typedef struct {
+  SymbolArray names;
+  Cursor cursor;
+} ParseTypeParametersResult;
+
+ParseTypeParametersResult parse_type_parameters(Parser *parser,
+                                                Cursor cursor) {
+  SymbolArray names = {};
+  NextTokenResult next;
+  do {
+    next = next_token(cursor);
+    array_push(parser->allocator, &names, expect_symbol(next));
+    next = next_token(next.cursor);
+    cursor = next.cursor;
+  } while (is_delimiter(next.token, CommaDelimiter));
+  NextTokenResult open = next_token(cursor);
+  if (!is_operator(next.token, GtOperator) ||
+      !is_delimiter(open.token, OpenParenDelimiter)) {
+    // TODO: return an error ast node instead of panicking
+    assert(false);
+  }
+  array_shrink_to_fit(parser->allocator, &names);
+  return (ParseTypeParametersResult){.names = names, .cursor = open.cursor};
+}
+
+ParseExpressionResult parse_define(Parser *parser, Cursor cursor,
+                                   Expression prefix, Token name) {
+  NextTokenResult assign_operator = next_token(cursor);
+  if (is_delimiter(assign_operator.token, OpenParenDelimiter)) {
+    return parse_function(parser, assign_operator.cursor, prefix,
+                          name.value.symbol, (SymbolArray){});
+  }
+  if (is_operator(assign_operator.token, LtOperator)) {
+    ParseTypeParametersResult type_parameters =
+        parse_type_parameters(parser, assign_operator.cursor);
+    return parse_function(parser, type_parameters.cursor, prefix,
+                          name.value.symbol, type_parameters.names);
+  }
+  ParseExpressionResult value = parse_expression_with_precedence(
+      parser, assign_operator.cursor, DefinePrecedence);
+  Expression *type = store_expression(parser, prefix);
+  Expression *assign_value = store_expression(parser, value.expression);
   Expression assign = {
       .kind = AssignExpression,
       .value.assign = {.type = type,
@@ -86,6 +423,32 @@ ParseExpressionResult parse_define(Allocator allocator, Cursor cursor,
   };
 }
 
+ParseExpressionResult parse_binary_op(Parser *parser, Cursor cursor,
+                                      Expression left, Token op);
+
+Precedence operator_precedence(OperatorKind kind) {
+  switch (kind) {
+  case EqOperator:
+  case NeOperator:
+  case LtOperator:
+  case LeOperator:
+  case GtOperator:
+  case GeOperator:
+    return ComparePrecedence;
+  case AddOperator:
+  case SubOperator:
+    return AddPrecedence;
+  case MulOperator:
+  case DivOperator:
+  case ModOperator:
+    return MultiplyPrecedence;
+  case AssignOperator:
+  case NotOperator:
+    return LowestPrecedence;
+  }
+  assert(false);
+}
+
 typedef struct {
   Expression prefix;
   Token token;
@@ -94,42 +457,182 @@ typedef struct {
 } InfixParserForResult;
 
 InfixParserForResult
-infix_parser_for(ParseExpressionResult parse_expression_result) {
-  ExpressionKind expression_kind = parse_expression_result.expression.kind;
+infix_parser_for(ParseExpressionResult parse_expression_result,
+                 Precedence precedence) {
+  Expression prefix = parse_expression_result.expression;
   NextTokenResult next_token_result =
       next_token(parse_expression_result.cursor);
-  switch (expression_kind) {
-  case SymbolExpression: {
-    switch (next_token_result.token.kind) {
-    case SymbolToken:
+  Token token = next_token_result.token;
+  switch (token.kind) {
+  case SymbolToken:
+    // A definition only starts a top level expression, so a symbol after
+    // the value of a definition begins the next one.
+    if ((prefix.kind == SymbolExpression ||
+         prefix.kind == SliceTypeExpression) &&
+        precedence == LowestPrecedence) {
       return (InfixParserForResult){
-          .prefix = parse_expression_result.expression,
-          .token = next_token_result.token,
+          .prefix = prefix,
+          .token = token,
           .cursor = next_token_result.cursor,
           .infix_parser = parse_define,
       };
-    default:
+    }
+    return (InfixParserForResult){};
+  case OperatorToken:
+    if (operator_precedence(token.value.operator.kind) > precedence) {
+      return (InfixParserForResult){
+          .prefix = prefix,
+          .token = token,
+          .cursor = next_token_result.cursor,
+          .infix_parser = parse_binary_op,
+      };
+    }
+    return (InfixParserForResult){};
+  case DelimiterToken:
+    // An index or call has to start on the line of its target, otherwise
+    // the bracket opens the next expression.
+    if (token.value.delimiter.span.begin.line !=
+            parse_expression_result.cursor.position.line ||
+        PostfixPrecedence <= precedence) {
       return (InfixParserForResult){};
     }
-  }
+    if (token.value.delimiter.kind == OpenSquareDelimiter) {
+      return (InfixParserForResult){
+          .prefix = prefix,
+          .token = token,
+          .cursor = next_token_result.cursor,
+          .infix_parser = parse_index,
+      };
+    }
+    if (token.value.delimiter.kind == OpenParenDelimiter) {
+      return (InfixParserForResult){
+          .prefix = prefix,
+          .token = token,
+          .cursor = next_token_result.cursor,
+          .infix_parser = parse_call,
+      };
+    }
+    return (InfixParserForResult){};
   default:
     return (InfixParserForResult){};
   }
 }
 
-ParseExpressionResult parse_infix(Allocator allocator,
+ParseExpressionResult parse_infix(Parser *parser,
                                   InfixParserForResult result) {
-  return result.infix_parser(allocator, result.cursor, result.prefix,
+  return result.infix_parser(parser, result.cursor, result.prefix,
                              result.token);
 }
 
-ParseExpressionResult parse_expression(Allocator allocator, Cursor cursor) {
-  ParseExpressionResult parse_expression_result = parse_prefix(cursor);
+ParseExpressionResult parse_binary_op(Parser *parser, Cursor cursor,
+                                      Expression left, Token op) {
+  Operator operator_ = op.value.operator;
+  ParseExpressionResult right = parse_expression_with_precedence(
+      parser, cursor, operator_precedence(operator_.kind));
+  Expression binary_op = {
+      .kind = BinaryOpExpression,
+      .value.binary_op = {.op = operator_,
+                          .left = store_expression(parser, left),
+                          .right = store_expression(parser, right.expression)},
+      .span = operator_.span,
+  };
+  return (ParseExpressionResult){
+      .expression = binary_op,
+      .cursor = right.cursor,
+  };
+}
+
+ParseExpressionResult parse_expression_with_precedence(Parser *parser,
+                                                       Cursor cursor,
+                                                       Precedence precedence) {
+  ParseExpressionResult parse_expression_result = parse_prefix(parser, cursor);
   InfixParserForResult infix_parser_for_result =
-      infix_parser_for(parse_expression_result);
+      infix_parser_for(parse_expression_result, precedence);
   while (infix_parser_for_result.infix_parser != nullptr) {
-    parse_expression_result = parse_infix(allocator, infix_parser_for_result);
-    infix_parser_for_result = infix_parser_for(parse_expression_result);
+    parse_expression_result = parse_infix(parser, infix_parser_for_result);
+    infix_parser_for_result =
+        infix_parser_for(parse_expression_result, precedence);
   }
   return parse_expression_result;
 }
+
+ParseExpressionResult parse_expression(Parser *parser, Cursor cursor) {
+  return parse_expression_with_precedence(parser, cursor, LowestPrecedence);
+}
+
+ParseModuleResult parse_module(Parser *parser, Cursor cursor) {
+  ExpressionArray expressions = {};
+  while (next_token(cursor).token.kind != EndOfFileToken) {
+    ParseExpressionResult result = parse_expression(parser, cursor);
+    array_push(parser->allocator, &expressions, result.expression);
+    cursor = result.cursor;
+  }
+  array_shrink_to_fit(parser->allocator, &expressions);
+  return (ParseModuleResult){
+      .module = {.expressions = expressions.data,
+                 .length = expressions.length,
+                 .shared = parser->hash_cons != nullptr},
+      .cursor = next_token(cursor).cursor,
+  };
+}
+
+size_t expression_nodes(const Expression *expression) {
+  if (expression == nullptr) {
+    return 0;
+  }
+  ExpressionValue value = expression->value;
+  size_t count = 1;
+  switch (expression->kind) {
+  case SymbolExpression:
+  case FloatExpression:
+  case IntExpression:
+    break;
+  case AssignExpression:
+    count += expression_nodes(value.assign.type) +
+             expression_nodes(value.assign.value);
+    break;
+  case BinaryOpExpression:
+    count += expression_nodes(value.binary_op.left) +
+             expression_nodes(value.binary_op.right);
+    break;
+  case StructExpression:
+    for (uint32_t i = 0; i < value.struct_.field_count; ++i) {
+      count += expression_nodes(value.struct_.fields[i].type);
+    }
+    break;
+  case ArrayExpression:
+    for (uint32_t i = 0; i < value.array.count; ++i) {
+      count += expression_nodes(&value.array.elements[i]);
+    }
+    break;
+  case SliceTypeExpression:
+    count += expression_nodes(value.slice.element);
+    break;
+  case IndexExpression:
+    count += expression_nodes(value.index.target) +
+             expression_nodes(value.index.index);
+    break;
+  case FunctionExpression:
+    count += expression_nodes(value.function.return_type) +
+             expression_nodes(value.function.body);
+    for (uint32_t i = 0; i < value.function.parameter_count; ++i) {
+      count += expression_nodes(value.function.parameters[i].type);
+    }
+    break;
+  case CallExpression:
+    count += expression_nodes(value.call.callee);
+    for (uint32_t i = 0; i < value.call.argument_count; ++i) {
+      count += expression_nodes(&value.call.arguments[i]);
+    }
+    break;
+  }
+  return count;
+}
+
+size_t count_nodes(Module module) {
+  size_t count = 0;
+  for (size_t i = 0; i < module.length; ++i) {
+    count += expression_nodes(&module.expressions[i]);
+  }
+  return count;
+}
@@ -0,0 +1,203 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "register_allocator.h"
+#include <assert.h>
+#include <string.h>
+
+// Instructions are numbered in order and every value is defined by the
+// instruction with its own number, so a live interval runs from a value
+// to its last use and intervals are already sorted by start.
+
+#define NO_SPILL_SLOT UINT32_MAX
+
+enum { MaxActive = 2 * 32 };
+
+typedef struct {
+  const RegisterFile *file;
+  RegisterAllocation result;
+  RegisterClass *classes;
+  // Last use of each value, IR_NO_VALUE when it has none.
+  uint32_t *ends;
+  uint32_t free[RegisterClassCount];
+  IrValue active[MaxActive];
+  uint32_t active_count;
+  uint32_t *free_slots;
+  uint32_t free_slot_count;
+  // Slots return to the free list the instruction after their value's
+  // last use, chained through release_next by position.
+  IrValue *release_heads;
+  IrValue *release_next;
+  IrValue *splits;
+} LinearScan;
+
+RegisterClass register_class_of(const Type *type) {
+  return type->kind == FloatType || type->kind == VectorType
+             ? FloatRegisterClass
+             : GeneralRegisterClass;
+}
+
+bool ir_instruction_is_call(IrInstruction instruction, const TypeTable *types) {
+  return instruction.opcode == ModOp &&
+         lookup_type(types, instruction.type)->kind == FloatType;
+}
+
+void *scan_allocate(Allocator allocator, size_t count, size_t size) {
+  void *memory =
+      allocate_bytes(allocator, count * size + 1, _Alignof(uint64_t));
+  if (memory == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  return memory;
+}
+
+uint32_t take_spill_slot(LinearScan *scan, IrValue value, uint32_t length) {
+  uint32_t slot = scan->free_slot_count > 0
+                      ? scan->free_slots[--scan->free_slot_count]
+                      : scan->result.slot_count++;
+  uint32_t release = scan->ends[value] + 1;
+  if (release < length) {
+    scan->release_next[value] = scan->release_heads[release];
+    scan->release_heads[release] = value;
+  }
+  return slot;
+}
+
+void remove_active(LinearScan *scan, uint32_t index) {
+  IrValue value = scan->active[index];
+  ValueLocation location = scan->result.values[value];
+  scan->free[scan->classes[value]] |= 1u << location.reg;
+  scan->active[index] = scan->active[--scan->active_count];
+}
+
+void split_interval(LinearScan *scan, uint32_t index, uint32_t position,
+                    uint32_t length) {
+  IrValue value = scan->active[index];
+  remove_active(scan, index);
+  scan->result.values[value].split = position;
+  scan->result.values[value].slot = take_spill_slot(scan, value, length);
+  scan->splits[scan->result.split_count++] = value;
+}
+
+void assign_register(LinearScan *scan, IrValue value, uint8_t reg) {
+  RegisterClass class = scan->classes[value];
+  scan->free[class] &= ~(1u << reg);
+  scan->result.used_registers[class] |= 1u << reg;
+  scan->result.values[value].reg = reg;
+  scan->active[scan->active_count++] = value;
+}
+
+// The first free register, preferring ones in the preferred mask.
+uint8_t pick_register(const LinearScan *scan, RegisterClass class,
+                      uint32_t preferred) {
+  const RegisterClassInfo *info = &scan->file->classes[class];
+  uint8_t fallback = NO_REGISTER;
+  for (uint32_t i = 0; i < info->count; ++i) {
+    uint8_t reg = info->registers[i];
+    if ((scan->free[class] & 1u << reg) == 0) {
+      continue;
+    }
+    if (preferred & 1u << reg) {
+      return reg;
+    }
+    if (fallback == NO_REGISTER) {
+      fallback = reg;
+    }
+  }
+  return fallback;
+}
+
+RegisterAllocation allocate_registers(Allocator allocator,
+                                      const IrFunction *function,
+                                      const TypeTable *types,
+                                      const RegisterFile *file) {
+  uint32_t length = (uint32_t)function->instructions.length;
+  const IrInstruction *instructions = function->instructions.data;
+  LinearScan scan = {.file = file};
+  scan.result.values = scan_allocate(allocator, length, sizeof(ValueLocation));
+  scan.classes = scan_allocate(allocator, length, sizeof(RegisterClass));
+  scan.ends = scan_allocate(allocator, length, sizeof(uint32_t));
+  scan.free_slots = scan_allocate(allocator, length, sizeof(uint32_t));
+  scan.release_heads = scan_allocate(allocator, length, sizeof(IrValue));
+  scan.release_next = scan_allocate(allocator, length, sizeof(IrValue));
+  scan.splits = scan_allocate(allocator, length, sizeof(IrValue));
+  uint32_t *next_call = scan_allocate(allocator, length, sizeof(uint32_t));
+  memset(scan.ends, 0xff, length * sizeof(uint32_t));
+  memset(scan.release_heads, 0xff, length * sizeof(IrValue));
+  uint32_t next = length;
+  for (uint32_t i = length; i-- > 0;) {
+    next_call[i] = next;
+    if (ir_instruction_is_call(instructions[i], types)) {
+      next = i;
+    }
+  }
+  for (uint32_t i = 0; i < length; ++i) {
+    uint32_t count = ir_operand_count(instructions[i]);
+    for (uint32_t j = 0; j < count; ++j) {
+      scan.ends[instructions[i].operands[j]] = i;
+    }
+    scan.classes[i] =
+        register_class_of(lookup_type(types, instructions[i].type));
+  }
+  for (uint32_t class = 0; class < RegisterClassCount; ++class) {
+    const RegisterClassInfo *info = &file->classes[class];
+    assert(info->count <= 32);
+    for (uint32_t i = 0; i < info->count; ++i) {
+      scan.free[class] |= 1u << info->registers[i];
+    }
+  }
+
+  for (uint32_t position = 0; position < length; ++position) {
+    for (IrValue value = scan.release_heads[position]; value != IR_NO_VALUE;
+         value = scan.release_next[value]) {
+      scan.free_slots[scan.free_slot_count++] = scan.result.values[value].slot;
+    }
+    bool call = ir_instruction_is_call(instructions[position], types);
+    for (uint32_t i = scan.active_count; i-- > 0;) {
+      IrValue value = scan.active[i];
+      if (scan.ends[value] <= position) {
+        remove_active(&scan, i);
+      } else if (call && file->classes[scan.classes[value]].caller_saved &
+                             1u << scan.result.values[value].reg) {
+        split_interval(&scan, i, position, length);
+      }
+    }
+
+    ValueLocation *location = &scan.result.values[position];
+    *location = (ValueLocation){
+        .reg = NO_REGISTER, .split = UINT32_MAX, .slot = NO_SPILL_SLOT};
+    if (scan.ends[position] == IR_NO_VALUE) {
+      continue;
+    }
+    RegisterClass class = scan.classes[position];
+    uint32_t caller_saved = file->classes[class].caller_saved;
+    bool crosses_call = next_call[position] < scan.ends[position];
+    uint8_t reg = pick_register(&scan, class,
+                                crosses_call ? ~caller_saved : caller_saved);
+    if (reg != NO_REGISTER) {
+      assign_register(&scan, position, reg);
+      continue;
+    }
+    uint32_t furthest = MaxActive;
+    for (uint32_t i = 0; i < scan.active_count; ++i) {
+      IrValue value = scan.active[i];
+      if (scan.classes[value] == class &&
+          (furthest == MaxActive ||
+           scan.ends[value] > scan.ends[scan.active[furthest]])) {
+        furthest = i;
+      }
+    }
+    if (furthest == MaxActive ||
+        scan.ends[scan.active[furthest]] <= scan.ends[position]) {
+      location->split = position;
+      location->slot = take_spill_slot(&scan, position, length);
+      scan.result.spill_count += 1;
+      continue;
+    }
+    reg = scan.result.values[scan.active[furthest]].reg;
+    split_interval(&scan, furthest, position, length);
+    assign_register(&scan, position, reg);
+  }
+  scan.result.splits = scan.splits;
+  return scan.result;
+}
@@ -0,0 +1,711 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "semantic.h"
+#include "array.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+Span anchor_span(const Expression *expression) {
+  switch (expression->kind) {
+  case SymbolExpression:
+    return expression->value.symbol.span;
+  case IntExpression:
+    return expression->value.int_.span;
+  case FloatExpression:
+    return expression->value.float_.span;
+  case AssignExpression:
+    return expression->value.assign.name.span;
+  case StructExpression:
+    return expression->value.struct_.name.span;
+  default:
+    return expression->span;
+  }
+}
+
+void report_diagnostic(Analyzer *analyzer, DiagnosticKind kind, Span span,
+                       StringView subject) {
+  if (analyzer->shared_spans) {
+    span = anchor_span(analyzer->anchor);
+  }
+  array_push(analyzer->allocator, &analyzer->diagnostics,
+             (Diagnostic){.kind = kind, .span = span, .subject = subject});
+}
+
+void analyzer_init(Analyzer *analyzer, Allocator allocator, Interner *interner,
+                   TypeTable *types) {
+  *analyzer = (Analyzer){
+      .allocator = allocator,
+      .interner = interner,
+      .types = types,
+  };
+  for (TypeId type = InvalidTypeId + 1; type < BuiltinTypeCount; ++type) {
+    SymbolId name = intern(interner, lookup_type(types, type)->name);
+    map_insert(type_name_map, allocator, &analyzer->type_names, name, type);
+  }
+  Scope *scope = allocate(allocator, Scope);
+  if (scope == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  *scope = (Scope){};
+  analyzer->scope = scope;
+}
+
+const Binding *lookup_binding(const Analyzer *analyzer, SymbolId name) {
+  for (const Scope *scope = analyzer->scope; scope != nullptr;
+       scope = scope->parent) {
+    const Binding *binding = binding_map_find(&scope->bindings, name);
+    if (binding != nullptr) {
+      return binding;
+    }
+  }
+  return nullptr;
+}
+
+// Generic bodies are lowered once for every type argument, so they cannot
+// lay out memory whose size depends on one.
+bool reject_generic_slice(Analyzer *analyzer, TypeId element, Span span) {
+  const Type *type = lookup_type(analyzer->types, element);
+  if (type->kind != TypeParameterType) {
+    return false;
+  }
+  report_diagnostic(analyzer, GenericSliceDiagnostic, span,
+                    analyzer->type_parameters[type->index].view);
+  return true;
+}
+
+TypeId resolve_type_name(Analyzer *analyzer, const Expression *type) {
+  if (type->kind == SliceTypeExpression) {
+    TypeId element = resolve_type_name(analyzer, type->value.slice.element);
+    if (element == InvalidTypeId ||
+        reject_generic_slice(analyzer, element, type->span)) {
+      return InvalidTypeId;
+    }
+    return slice_type(analyzer->types, element);
+  }
+  if (type->kind != SymbolExpression) {
+    report_diagnostic(analyzer, UnknownTypeDiagnostic, type->span,
+                      (StringView){});
+    return InvalidTypeId;
+  }
+  Symbol symbol = type->value.symbol;
+  for (uint32_t i = 0; i < analyzer->type_parameter_count; ++i) {
+    if (string_view_equal(analyzer->type_parameters[i].view, symbol.view)) {
+      return type_parameter(analyzer->types, i);
+    }
+  }
+  const TypeId *resolved = type_name_map_find(
+      &analyzer->type_names, intern(analyzer->interner, symbol.view));
+  if (resolved == nullptr) {
+    report_diagnostic(analyzer, UnknownTypeDiagnostic, symbol.span,
+                      symbol.view);
+    return InvalidTypeId;
+  }
+  return *resolved;
+}
+
+bool int_fits(const Type *type, uint64_t value) {
+  uint32_t bits = type->size * 8;
+  if (type->kind == SignedIntType) {
+    return value <= (UINT64_MAX >> (65 - bits));
+  }
+  return bits == 64 || value <= (UINT64_MAX >> (64 - bits));
+}
+
+TypeId check_int(Analyzer *analyzer, Int int_, TypeId expected) {
+  const Type *type = lookup_type(analyzer->types, expected);
+  DecodeIntResult decoded = decode_int(int_);
+  switch (type->kind) {
+  case SignedIntType:
+  case UnsignedIntType:
+    if (decoded.overflow || !int_fits(type, decoded.value)) {
+      report_diagnostic(analyzer, LiteralOutOfRangeDiagnostic, int_.span,
+                        int_.view);
+    }
+    return expected;
+  case FloatType:
+    return expected;
+  case TypeParameterType:
+    // Converted to the type argument when instantiated, see ConstOp.
+    if (decoded.overflow) {
+      report_diagnostic(analyzer, LiteralOutOfRangeDiagnostic, int_.span,
+                        int_.view);
+    }
+    return expected;
+  case InvalidType:
+    if (decoded.overflow) {
+      report_diagnostic(analyzer, LiteralOutOfRangeDiagnostic, int_.span,
+                        int_.view);
+    }
+    return I64TypeId;
+  case BoolType:
+  case StructType:
+  case SliceType:
+  case FunctionType:
+    report_diagnostic(analyzer, TypeMismatchDiagnostic, int_.span, int_.view);
+    return InvalidTypeId;
+  case VectorType:
+    // Literals broadcast to every lane.
+    return check_int(analyzer, int_, type->element) == InvalidTypeId
+               ? InvalidTypeId
+               : expected;
+  }
+  assert(false);
+}
+
+TypeId check_float(Analyzer *analyzer, Float float_, TypeId expected) {
+  const Type *type = lookup_type(analyzer->types, expected);
+  switch (type->kind) {
+  case FloatType: {
+    double value = decode_float(float_);
+    bool finite = type->size == 4 ? isfinite((float)value) : isfinite(value);
+    if (!finite) {
+      report_diagnostic(analyzer, LiteralOutOfRangeDiagnostic, float_.span,
+                        float_.view);
+    }
+    return expected;
+  }
+  case InvalidType:
+    return F64TypeId;
+  case BoolType:
+  case SignedIntType:
+  case UnsignedIntType:
+  case TypeParameterType:
+  case StructType:
+  case SliceType:
+  case FunctionType:
+    report_diagnostic(analyzer, TypeMismatchDiagnostic, float_.span,
+                      float_.view);
+    return InvalidTypeId;
+  case VectorType:
+    return check_float(analyzer, float_, type->element) == InvalidTypeId
+               ? InvalidTypeId
+               : expected;
+  }
+  assert(false);
+}
+
+TypeId check_symbol(Analyzer *analyzer, Symbol symbol, TypeId expected) {
+  SymbolId name = intern(analyzer->interner, symbol.view);
+  const Binding *binding = nullptr;
+  bool outer = false;
+  for (const Scope *scope = analyzer->scope;
+       scope != nullptr && binding == nullptr; scope = scope->parent) {
+    binding = binding_map_find(&scope->bindings, name);
+    outer |= binding == nullptr && scope->function;
+  }
+  if (binding == nullptr) {
+    report_diagnostic(analyzer, UndefinedSymbolDiagnostic, symbol.span,
+                      symbol.view);
+    return InvalidTypeId;
+  }
+  // Functions are only ever called.
+  if (lookup_type(analyzer->types, binding->type)->kind == FunctionType) {
+    report_diagnostic(analyzer, TypeMismatchDiagnostic, symbol.span,
+                      symbol.view);
+    return InvalidTypeId;
+  }
+  if (outer) {
+    report_diagnostic(analyzer, OuterBindingDiagnostic, symbol.span,
+                      symbol.view);
+    return binding->type;
+  }
+  if (expected != InvalidTypeId && binding->type != InvalidTypeId &&
+      binding->type != expected) {
+    report_diagnostic(analyzer, TypeMismatchDiagnostic, symbol.span,
+                      symbol.view);
+  }
+  return binding->type;
+}
+
+TypeId check_expression(Analyzer *analyzer, const Expression *expression,
+                        TypeId expected);
+
+// Checks an element of the list held by owner. Elements are stored by
+// value, so they are only shared when owner is.
+TypeId check_element(Analyzer *analyzer, const Expression *owner,
+                     const Expression *element, TypeId expected) {
+  const Expression *outer = analyzer->anchor;
+  if (owner == outer) {
+    analyzer->anchor = element;
+  }
+  TypeId type = check_expression(analyzer, element, expected);
+  analyzer->anchor = outer;
+  return type;
+}
+
+// Binds name in the current scope unless it is already bound there.
+void bind(Analyzer *analyzer, Symbol name, TypeId type,
+          const Expression *value) {
+  SymbolId id = intern(analyzer->interner, name.view);
+  BindingMap *bindings = &analyzer->scope->bindings;
+  if (binding_map_find(bindings, id) != nullptr) {
+    report_diagnostic(analyzer, RedefinitionDiagnostic, name.span, name.view);
+    return;
+  }
+  map_insert(
+      binding_map, analyzer->allocator, bindings, id,
+      (Binding){.name = id, .type = type, .span = name.span, .value = value});
+}
+
+TypeId check_assign(Analyzer *analyzer, Assign assign) {
+  TypeId type = resolve_type_name(analyzer, assign.type);
+  check_expression(analyzer, assign.value, type);
+  bind(analyzer, assign.name, type, assign.value);
+  return type;
+}
+
+StructFlags struct_attribute(Analyzer *analyzer, Symbol attribute) {
+  if (string_view_equal(attribute.view,
+                        (StringView){.data = "pinned", .length = 6})) {
+    return PinnedStruct;
+  }
+  if (string_view_equal(attribute.view,
+                        (StringView){.data = "soa", .length = 3})) {
+    return SoaStruct;
+  }
+  report_diagnostic(analyzer, UnknownAttributeDiagnostic, attribute.span,
+                    attribute.view);
+  return 0;
+}
+
+typedef Array(StructField) StructFieldArray;
+
+// Registers the struct as a type name. Fields whose type is unknown are
+// reported and left out of the layout.
+TypeId check_struct(Analyzer *analyzer, StructDeclaration declaration) {
+  uint32_t flags = 0;
+  for (uint32_t i = 0; i < declaration.attribute_count; ++i) {
+    flags |= struct_attribute(analyzer, declaration.attributes[i]);
+  }
+  StructFieldArray fields = {};
+  TypeNameMap seen = {};
+  for (uint32_t i = 0; i < declaration.field_count; ++i) {
+    TypedName field = declaration.fields[i];
+    TypeId type = resolve_type_name(analyzer, field.type);
+    SymbolId name = intern(analyzer->interner, field.name.view);
+    if (type_name_map_find(&seen, name) != nullptr) {
+      report_diagnostic(analyzer, RedefinitionDiagnostic, field.name.span,
+                        field.name.view);
+      continue;
+    }
+    map_insert(type_name_map, analyzer->allocator, &seen, name, type);
+    if (type != InvalidTypeId) {
+      array_push(analyzer->allocator, &fields,
+                 (StructField){.name = field.name.view, .type = type});
+    }
+  }
+  SymbolId name = intern(analyzer->interner, declaration.name.view);
+  if (type_name_map_find(&analyzer->type_names, name) != nullptr) {
+    report_diagnostic(analyzer, RedefinitionDiagnostic, declaration.name.span,
+                      declaration.name.view);
+    return InvalidTypeId;
+  }
+  TypeId type = struct_type(analyzer->types, declaration.name.view,
+                            fields.data, (uint32_t)fields.length, flags);
+  map_insert(type_name_map, analyzer->allocator, &analyzer->type_names, name,
+             type);
+  return type;
+}
+
+// Elements are checked against the element of the expected slice, or
+// against the first element when nothing is expected.
+TypeId check_array(Analyzer *analyzer, const Expression *expression,
+                   TypeId expected) {
+  ArrayLiteral array = expression->value.array;
+  TypeId element = InvalidTypeId;
+  if (expected != InvalidTypeId) {
+    const Type *type = lookup_type(analyzer->types, expected);
+    if (type->kind != SliceType) {
+      report_diagnostic(analyzer, TypeMismatchDiagnostic, expression->span,
+                        (StringView){});
+      return InvalidTypeId;
+    }
+    element = type->element;
+  } else if (array.count == 0) {
+    // Nothing says what an empty literal holds.
+    report_diagnostic(analyzer, UnknownTypeDiagnostic, expression->span,
+                      (StringView){});
+    return InvalidTypeId;
+  }
+  for (uint32_t i = 0; i < array.count; ++i) {
+    TypeId type =
+        check_element(analyzer, expression, &array.elements[i], element);
+    if (element == InvalidTypeId) {
+      element = type;
+    }
+  }
+  if (element == InvalidTypeId ||
+      reject_generic_slice(analyzer, element, expression->span)) {
+    return InvalidTypeId;
+  }
+  return slice_type(analyzer->types, element);
+}
+
+// Indices are u64, which is what the lowered addresses are computed in.
+TypeId check_index(Analyzer *analyzer, const Expression *expression,
+                   TypeId expected) {
+  Index index = expression->value.index;
+  TypeId target = check_expression(analyzer, index.target, InvalidTypeId);
+  check_expression(analyzer, index.index, U64TypeId);
+  if (target == InvalidTypeId) {
+    return InvalidTypeId;
+  }
+  const Type *type = lookup_type(analyzer->types, target);
+  if (type->kind != SliceType) {
+    report_diagnostic(analyzer, TypeMismatchDiagnostic, expression->span,
+                      type->name);
+    return InvalidTypeId;
+  }
+  if (expected != InvalidTypeId && type->element != expected) {
+    report_diagnostic(analyzer, TypeMismatchDiagnostic, expression->span,
+                      lookup_type(analyzer->types, type->element)->name);
+  }
+  return type->element;
+}
+
+typedef Array(TypeId) TypeIdArray;
+
+// The function is bound before its body is checked, so it may call
+// itself. Generic functions are checked once, with their type parameters
+// standing for any type argument.
+TypeId check_function(Analyzer *analyzer, const Expression *expression) {
+  Function function = expression->value.function;
+  for (uint32_t i = 0; i < function.type_parameter_count; ++i) {
+    for (uint32_t j = 0; j < i; ++j) {
+      if (string_view_equal(function.type_parameters[i].view,
+                            function.type_parameters[j].view)) {
+        report_diagnostic(analyzer, RedefinitionDiagnostic,
+                          function.type_parameters[i].span,
+                          function.type_parameters[i].view);
+      }
+    }
+  }
+  analyzer->type_parameters = function.type_parameters;
+  analyzer->type_parameter_count = function.type_parameter_count;
+  TypeId result = resolve_type_name(analyzer, function.return_type);
+  TypeIdArray parameters = {};
+  for (uint32_t i = 0; i < function.parameter_count; ++i) {
+    array_push(analyzer->allocator, &parameters,
+               resolve_type_name(analyzer, function.parameters[i].type));
+  }
+  TypeId type = function_type(analyzer->types, result, parameters.data,
+                              function.parameter_count);
+  bind(analyzer, function.name, type, expression);
+  Scope *scope = allocate(analyzer->allocator, Scope);
+  if (scope == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  *scope = (Scope){.parent = analyzer->scope, .function = true};
+  analyzer->scope = scope;
+  for (uint32_t i = 0; i < function.parameter_count; ++i) {
+    bind(analyzer, function.parameters[i].name, parameters.data[i], nullptr);
+  }
+  check_expression(analyzer, function.body, result);
+  analyzer->scope = scope->parent;
+  analyzer->type_parameters = nullptr;
+  analyzer->type_parameter_count = 0;
+  return type;
+}
+
+bool is_literal(const Expression *expression) {
+  return expression->kind == IntExpression ||
+         expression->kind == FloatExpression;
+}
+
+bool is_number_type(const Type *type) {
+  return type->kind == SignedIntType || type->kind == UnsignedIntType ||
+         type->kind == FloatType;
+}
+
+// Type arguments are inferred from the expected result and the arguments.
+// Arguments that are not literals are checked first, so a literal takes the
+// type its parameter is bound to, like it takes the type of the other
+// operand of a binary op.
+// Type arguments are numbers, which support everything a body can do with
+// a value of a type parameter.
+TypeId check_generic_call(Analyzer *analyzer, const Expression *expression,
+                          Type type, uint32_t type_parameter_count,
+                          TypeId expected) {
+  Call call = expression->value.call;
+  Symbol callee = call.callee->value.symbol;
+  TypeTable *types = analyzer->types;
+  if (analyzer->type_parameter_count > 0) {
+    report_diagnostic(analyzer, GenericCallDiagnostic, callee.span,
+                      callee.view);
+    for (uint32_t i = 0; i < call.argument_count; ++i) {
+      check_element(analyzer, expression, &call.arguments[i],
+                    InvalidTypeId);
+    }
+    return InvalidTypeId;
+  }
+  TypeIdArray arguments = {};
+  for (uint32_t k = 0; k < type_parameter_count; ++k) {
+    array_push(analyzer->allocator, &arguments, InvalidTypeId);
+  }
+  if (expected != InvalidTypeId) {
+    bind_type_arguments(types, type.element, expected, arguments.data);
+  }
+  for (uint32_t literals = 0; literals < 2; ++literals) {
+    for (uint32_t i = 0; i < call.argument_count; ++i) {
+      const Expression *argument = &call.arguments[i];
+      if (is_literal(argument) != (literals == 1)) {
+        continue;
+      }
+      TypeId parameter =
+          i < type.parameter_count ? type.parameters[i] : InvalidTypeId;
+      if (!mentions_type_parameter(types, parameter)) {
+        check_element(analyzer, expression, argument, parameter);
+        continue;
+      }
+      const Type *pattern = lookup_type(types, parameter);
+      TypeId bound = pattern->kind == TypeParameterType
+                         ? arguments.data[pattern->index]
+                         : InvalidTypeId;
+      TypeId actual = check_element(analyzer, expression, argument, bound);
+      // Checking against a bound parameter already reported a mismatch.
+      if (actual != InvalidTypeId && bound == InvalidTypeId &&
+          !bind_type_arguments(types, parameter, actual, arguments.data)) {
+        report_diagnostic(analyzer, TypeMismatchDiagnostic, callee.span,
+                          callee.view);
+      }
+    }
+  }
+  for (uint32_t k = 0; k < type_parameter_count; ++k) {
+    TypeId argument = arguments.data[k];
+    if (argument == InvalidTypeId) {
+      report_diagnostic(analyzer, UninferredTypeArgumentDiagnostic,
+                        callee.span, callee.view);
+      return InvalidTypeId;
+    }
+    if (!is_number_type(lookup_type(types, argument))) {
+      report_diagnostic(analyzer, TypeArgumentDiagnostic, callee.span,
+                        lookup_type(types, argument)->name);
+      return InvalidTypeId;
+    }
+  }
+  TypeId result = substitute_type(types, type.element, arguments.data);
+  if (expected != InvalidTypeId && result != expected) {
+    report_diagnostic(analyzer, TypeMismatchDiagnostic, callee.span,
+                      callee.view);
+  }
+  return result;
+}
+
+TypeId check_call(Analyzer *analyzer, const Expression *expression,
+                  TypeId expected) {
+  Call call = expression->value.call;
+  Symbol callee = call.callee->value.symbol;
+  const Binding *binding =
+      call.callee->kind == SymbolExpression
+          ? lookup_binding(analyzer, intern(analyzer->interner, callee.view))
+          : nullptr;
+  const Type *type = binding == nullptr
+                         ? nullptr
+                         : lookup_type(analyzer->types, binding->type);
+  if (type == nullptr || type->kind != FunctionType) {
+    if (call.callee->kind == SymbolExpression && binding == nullptr) {
+      report_diagnostic(analyzer, UndefinedSymbolDiagnostic, callee.span,
+                        callee.view);
+    } else {
+      bool named = call.callee->kind == SymbolExpression;
+      report_diagnostic(analyzer, NotCallableDiagnostic,
+                        named ? callee.span : expression->span,
+                        named ? callee.view : (StringView){});
+    }
+    for (uint32_t i = 0; i < call.argument_count; ++i) {
+      check_element(analyzer, expression, &call.arguments[i],
+                    InvalidTypeId);
+    }
+    return InvalidTypeId;
+  }
+  if (call.argument_count != type->parameter_count) {
+    report_diagnostic(analyzer, ArgumentCountDiagnostic, callee.span,
+                      callee.view);
+  }
+  const Expression *definition = binding->value;
+  if (definition != nullptr && definition->kind == FunctionExpression &&
+      definition->value.function.type_parameter_count > 0) {
+    return check_generic_call(
+        analyzer, expression, *type,
+        definition->value.function.type_parameter_count, expected);
+  }
+  for (uint32_t i = 0; i < call.argument_count; ++i) {
+    check_element(analyzer, expression, &call.arguments[i],
+                  i < type->parameter_count ? type->parameters[i]
+                                            : InvalidTypeId);
+  }
+  if (expected != InvalidTypeId && type->element != InvalidTypeId &&
+      type->element != expected) {
+    report_diagnostic(analyzer, TypeMismatchDiagnostic, callee.span,
+                      callee.view);
+  }
+  return type->element;
+}
+
+bool is_comparison(OperatorKind kind) {
+  switch (kind) {
+  case EqOperator:
+  case NeOperator:
+  case LtOperator:
+  case LeOperator:
+  case GtOperator:
+  case GeOperator:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Vectors support the operators every lane type has an instruction for.
+bool vector_supports(const TypeTable *types, const Type *type,
+                     OperatorKind kind) {
+  switch (kind) {
+  case AddOperator:
+  case SubOperator:
+  case MulOperator:
+    return true;
+  case DivOperator:
+    return lookup_type(types, type->element)->kind == FloatType;
+  default:
+    return false;
+  }
+}
+
+// Slices have no operators; their elements do.
+void check_operator_support(Analyzer *analyzer, BinaryOp binary_op,
+                            TypeId operands) {
+  const Type *type = lookup_type(analyzer->types, operands);
+  if (type->kind == SliceType ||
+      (type->kind == VectorType &&
+       !vector_supports(analyzer->types, type, binary_op.op.kind))) {
+    report_diagnostic(analyzer, UnsupportedOperatorDiagnostic,
+                      binary_op.op.span, type->name);
+  }
+}
+
+TypeId check_operands(Analyzer *analyzer, BinaryOp binary_op,
+                      TypeId expected) {
+  // Literals take the type of the other operand, so check that one first.
+  if (expected == InvalidTypeId && is_literal(binary_op.left) &&
+      !is_literal(binary_op.right)) {
+    TypeId type = check_expression(analyzer, binary_op.right, InvalidTypeId);
+    check_expression(analyzer, binary_op.left, type);
+    return type;
+  }
+  TypeId type = check_expression(analyzer, binary_op.left, expected);
+  check_expression(analyzer, binary_op.right, type);
+  return type;
+}
+
+TypeId check_binary_op(Analyzer *analyzer, const Expression *expression,
+                       TypeId expected) {
+  BinaryOp binary_op = expression->value.binary_op;
+  if (is_comparison(binary_op.op.kind)) {
+    TypeId operands = check_operands(analyzer, binary_op, InvalidTypeId);
+    check_operator_support(analyzer, binary_op, operands);
+    if (expected != InvalidTypeId && expected != BoolTypeId) {
+      report_diagnostic(analyzer, TypeMismatchDiagnostic, binary_op.op.span,
+                        (StringView){});
+    }
+    return BoolTypeId;
+  }
+  TypeId type = check_operands(analyzer, binary_op, expected);
+  if (type == BoolTypeId) {
+    report_diagnostic(analyzer, TypeMismatchDiagnostic, binary_op.op.span,
+                      (StringView){});
+    return InvalidTypeId;
+  }
+  check_operator_support(analyzer, binary_op, type);
+  return type;
+}
+
+TypeId check_expression(Analyzer *analyzer, const Expression *expression,
+                        TypeId expected) {
+  switch (expression->kind) {
+  case SymbolExpression:
+    return check_symbol(analyzer, expression->value.symbol, expected);
+  case IntExpression:
+    return check_int(analyzer, expression->value.int_, expected);
+  case FloatExpression:
+    return check_float(analyzer, expression->value.float_, expected);
+  case AssignExpression: {
+    TypeId type = check_assign(analyzer, expression->value.assign);
+    if (expected != InvalidTypeId && type != InvalidTypeId &&
+        type != expected) {
+      report_diagnostic(analyzer, TypeMismatchDiagnostic, expression->span,
+                        expression->value.assign.name.view);
+    }
+    return type;
+  }
+  case BinaryOpExpression:
+    return check_binary_op(analyzer, expression, expected);
+  case StructExpression:
+    return check_struct(analyzer, expression->value.struct_);
+  case ArrayExpression:
+    return check_array(analyzer, expression, expected);
+  case IndexExpression:
+    return check_index(analyzer, expression, expected);
+  case FunctionExpression:
+    return check_function(analyzer, expression);
+  case CallExpression:
+    return check_call(analyzer, expression, expected);
+  case SliceTypeExpression:
+    // A type where a value belongs.
+    report_diagnostic(analyzer, TypeMismatchDiagnostic, expression->span,
+                      (StringView){});
+    return InvalidTypeId;
+  }
+  assert(false);
+}
+
+TypeId analyze_expression(Analyzer *analyzer, const Expression *expression) {
+  return check_expression(analyzer, expression, InvalidTypeId);
+}
+
+void analyze_module(Analyzer *analyzer, Module module) {
+  analyzer->shared_spans = module.shared;
+  for (size_t i = 0; i < module.length; ++i) {
+    analyzer->anchor = &module.expressions[i];
+    analyze_expression(analyzer, &module.expressions[i]);
+  }
+  analyzer->shared_spans = false;
+  analyzer->anchor = nullptr;
+}
+
+const char *diagnostic_message(DiagnosticKind kind) {
+  switch (kind) {
+  case UnknownTypeDiagnostic:
+    return "unknown type";
+  case UndefinedSymbolDiagnostic:
+    return "undefined symbol";
+  case RedefinitionDiagnostic:
+    return "redefinition of";
+  case TypeMismatchDiagnostic:
+    return "type mismatch for";
+  case LiteralOutOfRangeDiagnostic:
+    return "literal out of range for its type";
+  case UnsupportedOperatorDiagnostic:
+    return "operator not supported for";
+  case UnknownAttributeDiagnostic:
+    return "unknown attribute";
+  case NotCallableDiagnostic:
+    return "cannot call";
+  case ArgumentCountDiagnostic:
+    return "wrong number of arguments to";
+  case OuterBindingDiagnostic:
+    return "function body uses outer binding";
+  case GenericSliceDiagnostic:
+    return "cannot take a slice of type parameter";
+  case GenericCallDiagnostic:
+    return "generic function cannot call generic function";
+  case UninferredTypeArgumentDiagnostic:
+    return "cannot infer the type arguments of";
+  case TypeArgumentDiagnostic:
+    return "type argument is not a number type";
+  }
+  return "unknown diagnostic";
+}
@@ -0,0 +1,28 @@
+#include "small_vector.h"
+#include "allocator.h"
+#include "array.h"
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+void *small_vector_grow(Allocator allocator, void *data, size_t *capacity,
+                        size_t length, size_t inline_capacity,
+                        size_t element_size, size_t alignment,
+                        CallSite call_site) {
+  if (*capacity != 0) {
+    return array_grow(allocator, data, capacity, length + 1, element_size,
+                      alignment, call_site);
+  }
+  size_t new_capacity = inline_capacity * 2;
+  void *heap = allocate_at_call_site(allocator, new_capacity * element_size,
+                                     alignment, call_site);
+  if (heap == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  // The heap pointer shares storage with the inline elements, so they have to
+  // be copied out before the caller stores it.
+  memcpy(heap, data, length * element_size);
+  *capacity = new_capacity;
+  return heap;
+}
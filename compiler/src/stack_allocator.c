@@ -1,17 +1,51 @@
+#define _DEFAULT_SOURCE
+
 #include "stack_allocator.h"
+#include "allocator.h"
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
-#include <stdio.h>
 #include <stdlib.h>
 
-size_t align_forward_adjustment(const void *address, size_t alignment) {
-  size_t adjustment = alignment - ((size_t)address & (alignment - 1));
-  if (adjustment == alignment) {
-    return 0; // Already aligned
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+enum { HUGE_PAGE_SIZE = 1 << 21 };
+
+void release_block(uint8_t *base, size_t mapped_size) {
+#ifdef __linux__
+  if (mapped_size != 0) {
+    munmap(base, mapped_size);
+    return;
   }
-  return adjustment;
+#endif
+  free(base);
+}
+
+// Retires the current block and continues in a new one with room for at
+// least needed bytes.
+void stack_allocator_grow(StackAllocator *stack, size_t needed) {
+  StackBlock *retired = malloc(sizeof(StackBlock));
+  if (retired == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  *retired = (StackBlock){.previous = stack->previous,
+                          .base = stack->base,
+                          .mapped_size = stack->mapped_size};
+  size_t retired_bytes =
+      stack->retired_bytes + (stack->current_position - stack->base);
+  size_t total_size =
+      stack->total_size * 2 > needed ? stack->total_size * 2 : needed;
+  if (stack->mapped_size != 0) {
+    stack_allocator_init_huge_pages(stack, total_size);
+  } else {
+    stack_allocator_init(stack, total_size);
+  }
+  stack->previous = retired;
+  stack->retired_bytes = retired_bytes;
 }
 
 void *stack_allocate(void *allocator, size_t size, size_t alignment) {
@@ -23,10 +57,8 @@ void *stack_allocate(void *allocator, size_t size, size_t alignment) {
   size_t spaceLeft = stack->total_size - (stack->current_position - stack->base);
 
   if (spaceLeft < spaceNeeded) {
-    // Handle out-of-memory error (e.g., by logging an error or exiting the program)
-    printf("\n\n=== stack allocator out of memory ===\n\n");
-    assert(false); // This will now correctly trigger if there isn't enough memory
-    return NULL; // It's good practice to return NULL if the allocation fails
+    stack_allocator_grow(stack, size + alignment);
+    adjustment = align_forward_adjustment(stack->current_position, alignment);
   }
 
   void *aligned_address = stack->current_position + adjustment;
@@ -34,6 +66,20 @@ void *stack_allocate(void *allocator, size_t size, size_t alignment) {
   return aligned_address;
 }
 
+bool stack_resize(void *allocator, void *memory, size_t old_size,
+                  size_t new_size) {
+  StackAllocator *stack = (StackAllocator *)allocator;
+  uint8_t *begin = memory;
+  if (begin + old_size != stack->current_position) {
+    return false;
+  }
+  if ((size_t)(stack->base + stack->total_size - begin) < new_size) {
+    return false;
+  }
+  stack->current_position = begin + new_size;
+  return true;
+}
+
 void stack_allocator_init(StackAllocator *stack, size_t total_size) {
   stack->base =
       (uint8_t *)malloc(total_size); // Allocate the total required memory
@@ -46,14 +92,101 @@ void stack_allocator_init(StackAllocator *stack, size_t total_size) {
       stack->base; // Initial position is at the base of the stack
   stack->total_size =
       total_size; // Store the total size of the allocated memory area
+  stack->mapped_size = 0;
+  stack->pages = DefaultPages;
+  stack->previous = nullptr;
+  stack->retired_bytes = 0;
+}
+
+#ifdef __linux__
+
+uint8_t *map_transparent_huge_pages(size_t mapped_size, PageKind *pages) {
+  // Transparent huge pages are only used for 2 MiB aligned ranges, so map an
+  // extra huge page and trim both ends to an aligned window.
+  size_t padded_size = mapped_size + HUGE_PAGE_SIZE;
+  uint8_t *padded = mmap(nullptr, padded_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (padded == MAP_FAILED) {
+    return nullptr;
+  }
+  uint8_t *base = padded + align_forward_adjustment(padded, HUGE_PAGE_SIZE);
+  if (base != padded) {
+    munmap(padded, base - padded);
+  }
+  size_t tail = (padded + padded_size) - (base + mapped_size);
+  if (tail != 0) {
+    munmap(base + mapped_size, tail);
+  }
+  *pages = madvise(base, mapped_size, MADV_HUGEPAGE) == 0 ? RequestedHugePages
+                                                          : DefaultPages;
+  return base;
+}
+
+void stack_allocator_init_huge_pages(StackAllocator *stack,
+                                     size_t total_size) {
+  size_t mapped_size =
+      (total_size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+  PageKind pages = HugeTlbPages;
+  uint8_t *base = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (base == MAP_FAILED) {
+    base = map_transparent_huge_pages(mapped_size, &pages);
+  }
+  if (base == nullptr) {
+    stack_allocator_init(stack, total_size);
+    return;
+  }
+  stack->base = base;
+  stack->current_position = base;
+  stack->total_size = mapped_size;
+  stack->mapped_size = mapped_size;
+  stack->pages = pages;
+  stack->previous = nullptr;
+  stack->retired_bytes = 0;
+}
+
+#else
+
+void stack_allocator_init_huge_pages(StackAllocator *stack,
+                                     size_t total_size) {
+  stack_allocator_init(stack, total_size);
+}
+
+#endif
+
+void release_previous_blocks(StackAllocator *stack) {
+  while (stack->previous != nullptr) {
+    StackBlock *block = stack->previous;
+    stack->previous = block->previous;
+    release_block(block->base, block->mapped_size);
+    free(block);
+  }
+  stack->retired_bytes = 0;
 }
 
 void stack_allocator_reset(StackAllocator *stack) {
+  release_previous_blocks(stack);
   stack->current_position =
       stack->base; // Reset the current position to the base of the stack
 }
 
+size_t stack_allocator_used(const StackAllocator *stack) {
+  return stack->retired_bytes + (size_t)(stack->current_position - stack->base);
+}
+
 void stack_allocator_destroy(StackAllocator *stack) {
-  free(stack->base); // Free the allocated memory area when the allocator is no
-                     // longer needed
+  release_previous_blocks(stack);
+  release_block(stack->base, stack->mapped_size);
+}
+
+const char *page_kind_name(PageKind pages) {
+  switch (pages) {
+  case DefaultPages:
+    return "default pages";
+  case RequestedHugePages:
+    return "requested transparent huge pages";
+  case HugeTlbPages:
+    return "hugetlb pages";
+  }
+  return "unknown pages";
 }
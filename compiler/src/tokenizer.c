@@ -1,7 +1,10 @@
 #include "tokenizer.h"
+#include "hash_map.h"
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 
 typedef struct {
   Cursor cursor;
@@ -45,11 +48,16 @@ TakeWhileResult take_while(Cursor cursor, bool (*predicate)(char)) {
   return take_while_stateful(cursor, matches_predicate, predicate);
 }
 
-bool is_space(char c) { return c == ' '; }
+bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
 
 Cursor trim_whitespace(Cursor cursor) {
-  TakeWhileResult result = take_while(cursor, is_space);
-  return result.cursor;
+  cursor = take_while(cursor, is_space).cursor;
+  while (*cursor.input == '\n') {
+    cursor = (Cursor){.input = cursor.input + 1,
+                      .position = {.line = cursor.position.line + 1}};
+    cursor = take_while(cursor, is_space).cursor;
+  }
+  return cursor;
 }
 
 bool is_valid_for_symbol(char c) {
@@ -235,3 +243,47 @@ NextTokenResult next_token(Cursor cursor) {
     assert(false);
   }
 }
+
+DecodeIntResult decode_int(Int int_) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < int_.view.length; ++i) {
+    uint64_t digit = int_.view.data[i] - '0';
+    if (value > (UINT64_MAX - digit) / 10) {
+      return (DecodeIntResult){.value = UINT64_MAX, .overflow = true};
+    }
+    value = value * 10 + digit;
+  }
+  return (DecodeIntResult){.value = value};
+}
+
+double decode_float(Float float_) {
+  // strtod needs a terminated string, the view points into the source.
+  char buffer[128];
+  char *text = float_.view.length < sizeof(buffer)
+                   ? buffer
+                   : malloc(float_.view.length + 1);
+  memcpy(text, float_.view.data, float_.view.length);
+  text[float_.view.length] = '\0';
+  double value = strtod(text, nullptr);
+  if (text != buffer) {
+    free(text);
+  }
+  return value;
+}
+
+bool string_view_equal(StringView a, StringView b) {
+  return a.length == b.length && memcmp(a.data, b.data, a.length) == 0;
+}
+
+uint64_t hash_string_view(StringView view) {
+  return hash_bytes(view.data, view.length);
+}
+
+size_t count_tokens(Cursor cursor) {
+  size_t count = 0;
+  for (NextTokenResult next = next_token(cursor);
+       next.token.kind != EndOfFileToken; next = next_token(next.cursor)) {
+    ++count;
+  }
+  return count;
+}
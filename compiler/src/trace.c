@@ -0,0 +1,98 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "trace.h"
+#include "tracking_allocator.h"
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+void tracer_init(Tracer *tracer, Allocator allocator, size_t buffer_capacity,
+                 uint64_t origin_ns) {
+  tracer->allocator = allocator;
+  atomic_init(&tracer->buffers, nullptr);
+  atomic_init(&tracer->threads, 0);
+  tracer->buffer_capacity = buffer_capacity;
+  tracer->origin_ns = origin_ns;
+}
+
+TraceBuffer *trace_buffer_push(Tracer *tracer, uint32_t thread) {
+  TraceBuffer *buffer = allocate_bytes(
+      tracer->allocator,
+      sizeof(TraceBuffer) + tracer->buffer_capacity * sizeof(TraceEvent),
+      _Alignof(TraceBuffer));
+  if (buffer == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  buffer->thread = thread;
+  atomic_init(&buffer->length, 0);
+  buffer->capacity = tracer->buffer_capacity;
+  buffer->next = atomic_load_explicit(&tracer->buffers, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&tracer->buffers,
+                                                &buffer->next, buffer,
+                                                memory_order_release,
+                                                memory_order_relaxed)) {
+  }
+  return buffer;
+}
+
+void trace_thread_init(TraceThread *thread, Tracer *tracer) {
+  thread->tracer = tracer;
+  thread->buffer = nullptr;
+  thread->thread =
+      atomic_fetch_add_explicit(&tracer->threads, 1, memory_order_relaxed);
+}
+
+void trace_event(TraceThread *thread, const char *name, const char *file,
+                 uint64_t begin_ns, uint64_t end_ns) {
+  TraceBuffer *buffer = thread->buffer;
+  if (buffer == nullptr ||
+      atomic_load_explicit(&buffer->length, memory_order_relaxed) ==
+          buffer->capacity) {
+    buffer = thread->buffer = trace_buffer_push(thread->tracer, thread->thread);
+  }
+  size_t length = atomic_load_explicit(&buffer->length, memory_order_relaxed);
+  buffer->events[length] = (TraceEvent){
+      .name = name, .file = file, .begin_ns = begin_ns, .end_ns = end_ns};
+  atomic_store_explicit(&buffer->length, length + 1, memory_order_release);
+}
+
+void write_trace_microseconds(FILE *file, uint64_t nanoseconds) {
+  fprintf(file, "%llu.%03llu", (unsigned long long)(nanoseconds / 1000),
+          (unsigned long long)(nanoseconds % 1000));
+}
+
+void tracer_write_json(const Tracer *tracer, FILE *file) {
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+  uint32_t threads =
+      atomic_load_explicit(&tracer->threads, memory_order_relaxed);
+  for (uint32_t i = 0; i < threads; ++i) {
+    fprintf(file,
+            "%s\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": %u, \"args\": {\"name\": \"thread %u\"}}",
+            i == 0 ? "" : ",", i, i);
+  }
+  bool first = threads == 0;
+  for (const TraceBuffer *buffer =
+           atomic_load_explicit(&tracer->buffers, memory_order_acquire);
+       buffer != nullptr; buffer = buffer->next) {
+    size_t length =
+        atomic_load_explicit(&buffer->length, memory_order_acquire);
+    for (size_t i = 0; i < length; ++i) {
+      const TraceEvent *event = &buffer->events[i];
+      fprintf(file, first ? "\n  {\"name\": " : ",\n  {\"name\": ");
+      first = false;
+      write_json_string(file, event->name);
+      fprintf(file, ", \"cat\": \"phase\", \"ph\": \"X\", \"pid\": 1, "
+                    "\"tid\": %u, \"ts\": ",
+              buffer->thread);
+      write_trace_microseconds(file, event->begin_ns - tracer->origin_ns);
+      fprintf(file, ", \"dur\": ");
+      write_trace_microseconds(file, event->end_ns - event->begin_ns);
+      fprintf(file, ", \"args\": {\"file\": ");
+      write_json_string(file, event->file);
+      fprintf(file, "}}");
+    }
+  }
+  fprintf(file, first ? "]}\n" : "\n]}\n");
+}
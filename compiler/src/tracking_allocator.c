@@ -0,0 +1,144 @@
+#include "tracking_allocator.h"
+#include "allocator.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+bool call_site_equal(CallSite a, CallSite b) {
+  return a.line == b.line && a.file == b.file && a.type_name == b.type_name;
+}
+
+CallSiteStats *call_site_stats_for(TrackingAllocator *tracking,
+                                   CallSite call_site) {
+  const size_t mask = TRACKED_CALL_SITE_CAPACITY - 1;
+  size_t hash = ((size_t)call_site.file >> 3) * 31 + call_site.line;
+  for (size_t probe = 0; probe < TRACKED_CALL_SITE_CAPACITY; ++probe) {
+    CallSiteStats *stats = &tracking->call_sites[(hash + probe) & mask];
+    if (stats->allocations == 0) {
+      *stats = (CallSiteStats){.call_site = call_site};
+      return stats;
+    }
+    if (call_site_equal(stats->call_site, call_site)) {
+      return stats;
+    }
+  }
+  return &tracking->overflow;
+}
+
+void *tracking_allocate(void *allocator, size_t size, size_t alignment) {
+  TrackingAllocator *tracking = (TrackingAllocator *)allocator;
+  uint8_t *result =
+      tracking->backing.allocate(tracking->backing.state, size, alignment);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  // Bump allocators hand out memory right after the previous allocation, so
+  // the gap the backing allocator skipped for alignment is what it would
+  // have computed from the previous end.
+  if (tracking->previous_end != nullptr) {
+    size_t adjustment =
+        align_forward_adjustment(tracking->previous_end, alignment);
+    if (result == tracking->previous_end + adjustment) {
+      tracking->alignment_waste += adjustment;
+    }
+  }
+  tracking->previous_end = result + size;
+  tracking->bytes += size;
+  tracking->allocations += 1;
+  if (tracking->bytes > tracking->peak_bytes) {
+    tracking->peak_bytes = tracking->bytes;
+  }
+  CallSiteStats *stats = call_site_stats_for(tracking, current_call_site());
+  stats->bytes += size;
+  stats->allocations += 1;
+  tracking->previous_call_site = stats;
+  return result;
+}
+
+bool tracking_resize(void *allocator, void *memory, size_t old_size,
+                     size_t new_size) {
+  TrackingAllocator *tracking = (TrackingAllocator *)allocator;
+  Allocator backing = tracking->backing;
+  if (backing.resize == nullptr ||
+      !backing.resize(backing.state, memory, old_size, new_size)) {
+    return false;
+  }
+  tracking->bytes = tracking->bytes - old_size + new_size;
+  if (tracking->bytes > tracking->peak_bytes) {
+    tracking->peak_bytes = tracking->bytes;
+  }
+  // The site resizing a block is rarely the one that allocated it, and only
+  // the site of the most recent allocation is remembered. Other resizes
+  // are left out of the per site counts.
+  const uint8_t *begin = memory;
+  if (tracking->previous_end == begin + old_size) {
+    tracking->previous_end = begin + new_size;
+    CallSiteStats *stats = tracking->previous_call_site;
+    stats->bytes = stats->bytes - old_size + new_size;
+  }
+  return true;
+}
+
+void tracking_allocator_init(TrackingAllocator *tracking, Allocator backing) {
+  memset(tracking, 0, sizeof(TrackingAllocator));
+  tracking->backing = backing;
+  tracking->overflow.call_site.file = "<overflow>";
+}
+
+void tracking_allocator_reset(TrackingAllocator *tracking) {
+  tracking->bytes = 0;
+  tracking->previous_end = nullptr;
+  tracking->previous_call_site = nullptr;
+}
+
+void write_json_string(FILE *file, const char *string) {
+  if (string == nullptr) {
+    fputs("null", file);
+    return;
+  }
+  fputc('"', file);
+  for (; *string != '\0'; ++string) {
+    switch (*string) {
+    case '"':
+    case '\\':
+      fputc('\\', file);
+      fputc(*string, file);
+      break;
+    default:
+      fputc(*string, file);
+    }
+  }
+  fputc('"', file);
+}
+
+void tracking_allocator_write_json(const TrackingAllocator *tracking,
+                                   FILE *file) {
+  fprintf(file,
+          "{\n"
+          "  \"bytes\": %zu,\n"
+          "  \"allocations\": %zu,\n"
+          "  \"alignment_waste\": %zu,\n"
+          "  \"peak_bytes\": %zu,\n"
+          "  \"call_sites\": [",
+          tracking->bytes, tracking->allocations, tracking->alignment_waste,
+          tracking->peak_bytes);
+  bool first = true;
+  for (size_t i = 0; i <= TRACKED_CALL_SITE_CAPACITY; ++i) {
+    const CallSiteStats *stats = i < TRACKED_CALL_SITE_CAPACITY
+                                     ? &tracking->call_sites[i]
+                                     : &tracking->overflow;
+    if (stats->allocations == 0) {
+      continue;
+    }
+    fprintf(file, first ? "\n    {\"file\": " : ",\n    {\"file\": ");
+    first = false;
+    write_json_string(file, stats->call_site.file);
+    fprintf(file, ", \"line\": %u, \"type_name\": ", stats->call_site.line);
+    write_json_string(file, stats->call_site.type_name);
+    fprintf(file, ", \"bytes\": %zu, \"allocations\": %zu}", stats->bytes,
+            stats->allocations);
+  }
+  fprintf(file, first ? "]\n}\n" : "\n  ]\n}\n");
+}
@@ -0,0 +1,370 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "types.h"
+#include "array.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BUILTIN_TYPE(type_kind, type_size, type_name)                          \
+  {                                                                            \
+    .kind = type_kind, .size = type_size, .alignment = type_size,              \
+    .name = {.data = type_name, .length = sizeof(type_name) - 1},              \
+  }
+
+#define BUILTIN_VECTOR(element_type, element_lanes, element_size, type_name)  \
+  {                                                                            \
+    .kind = VectorType, .size = (element_lanes) * (element_size),              \
+    .alignment = (element_lanes) * (element_size),                             \
+    .name = {.data = type_name, .length = sizeof(type_name) - 1},              \
+    .element = element_type, .lanes = element_lanes,                           \
+  }
+
+static const Type builtin_types[BuiltinTypeCount] = {
+    [InvalidTypeId] = BUILTIN_TYPE(InvalidType, 0, "<invalid>"),
+    [BoolTypeId] = BUILTIN_TYPE(BoolType, 1, "bool"),
+    [I8TypeId] = BUILTIN_TYPE(SignedIntType, 1, "i8"),
+    [I16TypeId] = BUILTIN_TYPE(SignedIntType, 2, "i16"),
+    [I32TypeId] = BUILTIN_TYPE(SignedIntType, 4, "i32"),
+    [I64TypeId] = BUILTIN_TYPE(SignedIntType, 8, "i64"),
+    [U8TypeId] = BUILTIN_TYPE(UnsignedIntType, 1, "u8"),
+    [U16TypeId] = BUILTIN_TYPE(UnsignedIntType, 2, "u16"),
+    [U32TypeId] = BUILTIN_TYPE(UnsignedIntType, 4, "u32"),
+    [U64TypeId] = BUILTIN_TYPE(UnsignedIntType, 8, "u64"),
+    [F32TypeId] = BUILTIN_TYPE(FloatType, 4, "f32"),
+    [F64TypeId] = BUILTIN_TYPE(FloatType, 8, "f64"),
+    [F32x4TypeId] = BUILTIN_VECTOR(F32TypeId, 4, 4, "f32x4"),
+    [F32x8TypeId] = BUILTIN_VECTOR(F32TypeId, 8, 4, "f32x8"),
+    [I32x4TypeId] = BUILTIN_VECTOR(I32TypeId, 4, 4, "i32x4"),
+    [I32x8TypeId] = BUILTIN_VECTOR(I32TypeId, 8, 4, "i32x8"),
+};
+
+void type_table_init(TypeTable *table, Allocator allocator) {
+  *table = (TypeTable){.allocator = allocator};
+  array_append(allocator, &table->types, builtin_types, BuiltinTypeCount);
+}
+
+const Type *lookup_type(const TypeTable *table, TypeId type) {
+  return &table->types.data[type];
+}
+
+TypeId type_parameter(TypeTable *table, uint32_t index) {
+  for (TypeId id = BuiltinTypeCount; id < table->types.length; ++id) {
+    const Type *type = &table->types.data[id];
+    if (type->kind == TypeParameterType && type->index == index) {
+      return id;
+    }
+  }
+  char *name = allocate_bytes(table->allocator, 16, 1);
+  if (name == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  size_t length = snprintf(name, 16, "T%u", index);
+  array_push(table->allocator, &table->types,
+             (Type){.kind = TypeParameterType,
+                    .name = {.data = name, .length = length},
+                    .index = index});
+  return (TypeId)table->types.length - 1;
+}
+
+TypeId slice_type(TypeTable *table, TypeId element) {
+  for (TypeId id = BuiltinTypeCount; id < table->types.length; ++id) {
+    const Type *type = &table->types.data[id];
+    if (type->kind == SliceType && type->element == element) {
+      return id;
+    }
+  }
+  StringView element_name = lookup_type(table, element)->name;
+  size_t length = element_name.length + 2;
+  char *name = allocate_bytes(table->allocator, length, 1);
+  if (name == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  memcpy(name, "[]", 2);
+  memcpy(name + 2, element_name.data, element_name.length);
+  array_push(table->allocator, &table->types,
+             (Type){.kind = SliceType,
+                    .size = 8,
+                    .alignment = 8,
+                    .name = {.data = name, .length = length},
+                    .element = element});
+  return (TypeId)table->types.length - 1;
+}
+
+TypeId vector_type(TypeTable *table, TypeId element, uint32_t lanes) {
+  for (TypeId id = InvalidTypeId + 1; id < table->types.length; ++id) {
+    const Type *type = &table->types.data[id];
+    if (type->kind == VectorType && type->element == element &&
+        type->lanes == lanes) {
+      return id;
+    }
+  }
+  // Only vectors of type parameters are missing, named like T0x4.
+  StringView element_name = lookup_type(table, element)->name;
+  char *name = allocate_bytes(table->allocator, element_name.length + 12, 1);
+  if (name == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  size_t length = snprintf(name, element_name.length + 12, "%.*sx%u",
+                           (int)element_name.length, element_name.data, lanes);
+  uint32_t size = lookup_type(table, element)->size * lanes;
+  array_push(table->allocator, &table->types,
+             (Type){.kind = VectorType,
+                    .size = size,
+                    .alignment = size,
+                    .name = {.data = name, .length = length},
+                    .element = element,
+                    .lanes = lanes});
+  return (TypeId)table->types.length - 1;
+}
+
+bool same_function_type(const Type *type, TypeId result,
+                        const TypeId *parameters, uint32_t count) {
+  return type->kind == FunctionType && type->element == result &&
+         type->parameter_count == count &&
+         (count == 0 ||
+          memcmp(type->parameters, parameters, count * sizeof(TypeId)) == 0);
+}
+
+TypeId function_type(TypeTable *table, TypeId result,
+                     const TypeId *parameters, uint32_t count) {
+  for (TypeId id = BuiltinTypeCount; id < table->types.length; ++id) {
+    if (same_function_type(&table->types.data[id], result, parameters,
+                           count)) {
+      return id;
+    }
+  }
+  // Named like the definitions that have the type, (i64, f32) -> f32.
+  size_t length = 7 + lookup_type(table, result)->name.length;
+  for (uint32_t i = 0; i < count; ++i) {
+    length += lookup_type(table, parameters[i])->name.length + 2;
+  }
+  char *name = allocate_bytes(table->allocator, length, 1);
+  TypeId *copy = allocate_bytes(table->allocator, count * sizeof(TypeId) + 1,
+                                _Alignof(TypeId));
+  if (name == nullptr || copy == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  size_t used = 0;
+  name[used++] = '(';
+  for (uint32_t i = 0; i < count; ++i) {
+    StringView parameter = lookup_type(table, parameters[i])->name;
+    if (i > 0) {
+      memcpy(name + used, ", ", 2);
+      used += 2;
+    }
+    memcpy(name + used, parameter.data, parameter.length);
+    used += parameter.length;
+    copy[i] = parameters[i];
+  }
+  StringView returned = lookup_type(table, result)->name;
+  memcpy(name + used, ") -> ", 5);
+  used += 5;
+  memcpy(name + used, returned.data, returned.length);
+  used += returned.length;
+  array_push(table->allocator, &table->types,
+             (Type){.kind = FunctionType,
+                    .name = {.data = name, .length = used},
+                    .element = result,
+                    .parameters = copy,
+                    .parameter_count = count});
+  return (TypeId)table->types.length - 1;
+}
+
+typedef Array(TypeId) TypeIdArray;
+
+TypeId substitute_type(TypeTable *table, TypeId type,
+                       const TypeId *arguments) {
+  Type resolved = *lookup_type(table, type);
+  switch (resolved.kind) {
+  case TypeParameterType:
+    return arguments[resolved.index];
+  case VectorType: {
+    TypeId element = substitute_type(table, resolved.element, arguments);
+    return element == resolved.element
+               ? type
+               : vector_type(table, element, resolved.lanes);
+  }
+  case SliceType: {
+    TypeId element = substitute_type(table, resolved.element, arguments);
+    return element == resolved.element ? type : slice_type(table, element);
+  }
+  case FunctionType: {
+    TypeId result = substitute_type(table, resolved.element, arguments);
+    bool changed = result != resolved.element;
+    TypeIdArray parameters = {};
+    for (uint32_t i = 0; i < resolved.parameter_count; ++i) {
+      TypeId parameter =
+          substitute_type(table, resolved.parameters[i], arguments);
+      changed |= parameter != resolved.parameters[i];
+      array_push(table->allocator, &parameters, parameter);
+    }
+    return changed ? function_type(table, result, parameters.data,
+                                   resolved.parameter_count)
+                   : type;
+  }
+  default:
+    return type;
+  }
+}
+
+bool mentions_type_parameter(const TypeTable *table, TypeId type) {
+  const Type *resolved = lookup_type(table, type);
+  switch (resolved->kind) {
+  case TypeParameterType:
+    return true;
+  case VectorType:
+  case SliceType:
+    return mentions_type_parameter(table, resolved->element);
+  case FunctionType:
+    for (uint32_t i = 0; i < resolved->parameter_count; ++i) {
+      if (mentions_type_parameter(table, resolved->parameters[i])) {
+        return true;
+      }
+    }
+    return mentions_type_parameter(table, resolved->element);
+  default:
+    return false;
+  }
+}
+
+bool bind_type_arguments(const TypeTable *table, TypeId pattern, TypeId type,
+                         TypeId *arguments) {
+  if (!mentions_type_parameter(table, pattern)) {
+    return pattern == type;
+  }
+  const Type *expected = lookup_type(table, pattern);
+  const Type *actual = lookup_type(table, type);
+  switch (expected->kind) {
+  case TypeParameterType:
+    if (arguments[expected->index] == InvalidTypeId) {
+      arguments[expected->index] = type;
+    }
+    return arguments[expected->index] == type;
+  case VectorType:
+  case SliceType:
+    return actual->kind == expected->kind &&
+           actual->lanes == expected->lanes &&
+           bind_type_arguments(table, expected->element, actual->element,
+                               arguments);
+  case FunctionType:
+    if (actual->kind != FunctionType ||
+        actual->parameter_count != expected->parameter_count) {
+      return false;
+    }
+    for (uint32_t i = 0; i < expected->parameter_count; ++i) {
+      if (!bind_type_arguments(table, expected->parameters[i],
+                               actual->parameters[i], arguments)) {
+        return false;
+      }
+    }
+    return bind_type_arguments(table, expected->element, actual->element,
+                               arguments);
+  default:
+    return false;
+  }
+}
+
+uint64_t align_up(uint64_t offset, uint32_t alignment) {
+  return alignment > 1 ? (offset + alignment - 1) & ~(uint64_t)(alignment - 1)
+                       : offset;
+}
+
+TypeId struct_type(TypeTable *table, StringView name,
+                   const StructField *fields, uint32_t count, uint32_t flags) {
+  StructField *laid_out =
+      allocate_bytes(table->allocator, count * sizeof(StructField) + 1,
+                     _Alignof(StructField));
+  if (laid_out == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  if (count > 0) {
+    memcpy(laid_out, fields, count * sizeof(StructField));
+  }
+  if ((flags & PinnedStruct) == 0) {
+    // Insertion sort is stable and structs have few fields.
+    for (uint32_t i = 1; i < count; ++i) {
+      StructField field = laid_out[i];
+      uint32_t alignment = lookup_type(table, field.type)->alignment;
+      uint32_t j = i;
+      while (j > 0 &&
+             lookup_type(table, laid_out[j - 1].type)->alignment < alignment) {
+        laid_out[j] = laid_out[j - 1];
+        j -= 1;
+      }
+      laid_out[j] = field;
+    }
+  }
+  uint64_t offset = 0;
+  uint32_t alignment = 1;
+  for (uint32_t i = 0; i < count; ++i) {
+    const Type *type = lookup_type(table, laid_out[i].type);
+    offset = align_up(offset, type->alignment);
+    laid_out[i].offset = (uint32_t)offset;
+    offset += type->size;
+    if (type->alignment > alignment) {
+      alignment = type->alignment;
+    }
+  }
+  array_push(table->allocator, &table->types,
+             (Type){.kind = StructType,
+                    .size = (uint32_t)align_up(offset, alignment),
+                    .alignment = alignment,
+                    .name = name,
+                    .fields = laid_out,
+                    .field_count = count,
+                    .flags = flags});
+  return (TypeId)table->types.length - 1;
+}
+
+const StructField *find_field(const TypeTable *table, TypeId type,
+                              StringView name) {
+  const Type *resolved = lookup_type(table, type);
+  for (uint32_t i = 0; i < resolved->field_count; ++i) {
+    if (string_view_equal(resolved->fields[i].name, name)) {
+      return &resolved->fields[i];
+    }
+  }
+  return nullptr;
+}
+
+// Where the column of field starts in an SoA array of count elements.
+uint64_t column_offset(const TypeTable *table, const Type *type,
+                       uint32_t field, uint64_t count) {
+  uint64_t offset = 0;
+  for (uint32_t i = 0; i < field; ++i) {
+    const Type *column = lookup_type(table, type->fields[i].type);
+    offset = align_up(offset, column->alignment) + column->size * count;
+  }
+  return align_up(offset,
+                  lookup_type(table, type->fields[field].type)->alignment);
+}
+
+uint64_t array_size(const TypeTable *table, TypeId element, uint64_t count) {
+  const Type *type = lookup_type(table, element);
+  if (type->kind != StructType || (type->flags & SoaStruct) == 0 ||
+      type->field_count == 0) {
+    return type->size * count;
+  }
+  uint32_t last = type->field_count - 1;
+  uint64_t end = column_offset(table, type, last, count) +
+                 lookup_type(table, type->fields[last].type)->size * count;
+  return align_up(end, type->alignment);
+}
+
+uint64_t field_offset_in_array(const TypeTable *table, TypeId type,
+                               uint32_t field, uint64_t index,
+                               uint64_t count) {
+  const Type *resolved = lookup_type(table, type);
+  if ((resolved->flags & SoaStruct) == 0) {
+    return index * resolved->size + resolved->fields[field].offset;
+  }
+  const Type *column = lookup_type(table, resolved->fields[field].type);
+  return column_offset(table, resolved, field, count) + index * column->size;
+}
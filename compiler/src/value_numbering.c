@@ -0,0 +1,95 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "value_numbering.h"
+#include "hash_map.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Instructions are their own keys once their operands are value numbers.
+uint64_t hash_value_key(IrInstruction key) {
+  uint64_t header =
+      key.opcode | (uint64_t)key.lane << 16 | (uint64_t)key.type << 32;
+  uint64_t operands = key.operands[0] | (uint64_t)key.operands[1] << 32;
+  return hash_combine(hash_integer(header), operands);
+}
+
+bool value_keys_equal(IrInstruction a, IrInstruction b) {
+  return a.opcode == b.opcode && a.lane == b.lane && a.type == b.type &&
+         a.operands[0] == b.operands[0] && a.operands[1] == b.operands[1];
+}
+
+DEFINE_HASH_MAP(ValueTable, value_table, IrInstruction, IrValue,
+                hash_value_key, value_keys_equal)
+
+// Every allocation is a distinct address and loads read whatever was
+// stored last, so memory operations are never merged.
+bool numbered(IrOpcode opcode) {
+  return opcode != AllocOp && opcode != LoadOp && opcode != StoreOp &&
+         opcode != ParamOp && opcode != ArgOp && opcode != CallOp &&
+         !ir_is_terminator(opcode);
+}
+
+// Float addition and multiplication pick which NaN to return by operand
+// order, so only integer lanes and equality are treated as commutative.
+bool commutes(IrInstruction instruction, const TypeTable *types) {
+  if (instruction.opcode == EqOp || instruction.opcode == NeOp) {
+    return true;
+  }
+  if (instruction.opcode != AddOp && instruction.opcode != MulOp) {
+    return false;
+  }
+  const Type *type = lookup_type(types, instruction.type);
+  if (type->kind == VectorType) {
+    type = lookup_type(types, type->element);
+  }
+  return type->kind != FloatType;
+}
+
+ValueNumberingStats number_values(Allocator allocator, IrFunction *function,
+                                  const TypeTable *types) {
+  ValueNumberingStats stats = {};
+  IrInstruction *instructions = function->instructions.data;
+  uint32_t length = (uint32_t)function->instructions.length;
+  bool *keep =
+      allocate_bytes(allocator, length * sizeof(bool) + 1, _Alignof(bool));
+  IrValue *numbers = allocate_bytes(allocator, length * sizeof(IrValue) + 1,
+                                    _Alignof(IrValue));
+  if (keep == nullptr || numbers == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  ValueTable table = {};
+  // Sized up front so the table never rehashes while numbering.
+  hash_map_reserve(allocator, &table.map, &value_table_layout, length);
+  for (uint32_t i = 0; i < length; ++i) {
+    IrInstruction *instruction = &instructions[i];
+    uint32_t count = ir_operand_count(*instruction);
+    for (uint32_t j = 0; j < count; ++j) {
+      instruction->operands[j] = numbers[instruction->operands[j]];
+    }
+    numbers[i] = i;
+    keep[i] = true;
+    if (!numbered(instruction->opcode)) {
+      continue;
+    }
+    IrInstruction key = *instruction;
+    if (commutes(key, types) &&
+        key.operands[0] > key.operands[1]) {
+      key.operands[0] = instruction->operands[1];
+      key.operands[1] = instruction->operands[0];
+    }
+    IrValue number =
+        *map_find_or_insert(value_table, allocator, &table, key, i);
+    if (number != i) {
+      numbers[i] = number;
+      keep[i] = false;
+      stats.removed += 1;
+    }
+  }
+  if (stats.removed > 0) {
+    ir_compact(function, keep, numbers);
+  }
+  return stats;
+}
@@ -0,0 +1,595 @@
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "vectorize.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+const VectorTarget sse2_target = {
+    .name = "sse2", .max_lanes = 4, .packed_i32_multiply = false};
+
+const VectorTarget avx2_target = {
+    .name = "avx2", .max_lanes = 8, .packed_i32_multiply = true};
+
+// Costs in instructions issued. Inserts go through memory and count
+// double; a scalar instruction and its vector form cost the same.
+enum {
+  ScalarCost = 1,
+  VectorCost = 1,
+  BroadcastCost = 1,
+  InsertCost = 2,
+  ExtractCost = 1,
+};
+
+enum { MinLanes = 4 };
+
+#define NO_PACK UINT32_MAX
+
+typedef enum {
+  // Every lane reads the same lane of one earlier pack.
+  ReuseSide,
+  // Every lane reads the same constant.
+  BroadcastSide,
+  GatherSide,
+} PackSide;
+
+typedef struct {
+  IrOpcode opcode;
+  TypeId element;
+  TypeId vector;
+  // Index of the first member in the members array.
+  uint32_t first;
+  uint32_t lanes;
+  bool accepted;
+  VectorizeRemarkKind kind;
+  PackSide sides[2];
+  uint32_t reused[2];
+  // The pack is emitted right before this instruction.
+  uint32_t anchor;
+  uint32_t cost;
+  uint32_t component;
+  // Costs of every pack connected to this one through reused vectors.
+  uint32_t scalar_cost;
+  uint32_t vector_cost;
+  IrValue value;
+  // Next pack emitted before the same instruction.
+  uint32_t next;
+} Pack;
+
+typedef struct {
+  uint32_t block;
+  uint32_t depth;
+  uint32_t opcode;
+  TypeId type;
+  IrValue value;
+} Candidate;
+
+typedef struct {
+  Allocator allocator;
+  const IrInstruction *instructions;
+  uint32_t length;
+  IrUses uses;
+  uint32_t *block_begins;
+  IrValue *members;
+  uint32_t *pack_of;
+  uint32_t *lane_of;
+  Pack *packs;
+  uint32_t pack_count;
+} Vectorizer;
+
+void *vectorize_allocate(Allocator allocator, size_t count, size_t size) {
+  void *memory =
+      allocate_bytes(allocator, count * size + 1, _Alignof(uint64_t));
+  if (memory == nullptr) {
+    // TODO: report out of memory instead of panicking
+    assert(false);
+  }
+  return memory;
+}
+
+uint32_t greater_of(uint32_t a, uint32_t b) { return a > b ? a : b; }
+
+int compare_candidates(const void *a, const void *b) {
+  const Candidate *x = a;
+  const Candidate *y = b;
+  if (x->block != y->block) {
+    return x->block < y->block ? -1 : 1;
+  }
+  if (x->depth != y->depth) {
+    return x->depth < y->depth ? -1 : 1;
+  }
+  if (x->opcode != y->opcode) {
+    return x->opcode < y->opcode ? -1 : 1;
+  }
+  if (x->type != y->type) {
+    return x->type < y->type ? -1 : 1;
+  }
+  return (x->value > y->value) - (x->value < y->value);
+}
+
+bool same_group(const Candidate *a, const Candidate *b) {
+  return a->block == b->block && a->depth == b->depth &&
+         a->opcode == b->opcode && a->type == b->type;
+}
+
+bool vectorizable(IrInstruction instruction) {
+  switch (instruction.opcode) {
+  case AddOp:
+  case SubOp:
+  case MulOp:
+    return instruction.type == F32TypeId || instruction.type == I32TypeId;
+  case DivOp:
+    return instruction.type == F32TypeId;
+  default:
+    return false;
+  }
+}
+
+TypeId vector_type_of(TypeId element, uint32_t lanes) {
+  if (element == F32TypeId) {
+    return lanes == 8 ? F32x8TypeId : F32x4TypeId;
+  }
+  return lanes == 8 ? I32x8TypeId : I32x4TypeId;
+}
+
+IrValue pack_operand(const Vectorizer *vectorizer, const Pack *pack,
+                     uint32_t side, uint32_t lane) {
+  IrValue member = vectorizer->members[pack->first + lane];
+  return vectorizer->instructions[member].operands[side];
+}
+
+PackSide classify_side(const Vectorizer *vectorizer, Pack *pack,
+                       uint32_t side) {
+  const IrInstruction *instructions = vectorizer->instructions;
+  IrValue first = pack_operand(vectorizer, pack, side, 0);
+  uint32_t reused = vectorizer->pack_of[first];
+  bool reuse = reused != NO_PACK &&
+               vectorizer->packs[reused].lanes == pack->lanes;
+  bool broadcast = instructions[first].opcode == ConstOp;
+  for (uint32_t lane = 0; lane < pack->lanes; ++lane) {
+    IrValue operand = pack_operand(vectorizer, pack, side, lane);
+    reuse = reuse && vectorizer->pack_of[operand] == reused &&
+            vectorizer->lane_of[operand] == lane;
+    broadcast = broadcast && instructions[operand].opcode == ConstOp &&
+                ir_constant_bits(instructions[operand]) ==
+                    ir_constant_bits(instructions[first]);
+  }
+  pack->reused[side] = reused;
+  return reuse ? ReuseSide : broadcast ? BroadcastSide : GatherSide;
+}
+
+PackSide effective_side(const Vectorizer *vectorizer, const Pack *pack,
+                        uint32_t side) {
+  if (pack->sides[side] == ReuseSide &&
+      !vectorizer->packs[pack->reused[side]].accepted) {
+    return GatherSide;
+  }
+  return pack->sides[side];
+}
+
+// Whether a user of a member reads it from the member's pack's vector
+// rather than needing it as a scalar.
+bool reads_vector(const Vectorizer *vectorizer, IrValue user, IrValue member) {
+  uint32_t index = vectorizer->pack_of[user];
+  if (index == NO_PACK || !vectorizer->packs[index].accepted) {
+    return false;
+  }
+  const Pack *pack = &vectorizer->packs[index];
+  for (uint32_t side = 0; side < 2; ++side) {
+    if (vectorizer->instructions[user].operands[side] == member &&
+        effective_side(vectorizer, pack, side) != ReuseSide) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool needs_scalar(const Vectorizer *vectorizer, IrValue member) {
+  const IrUses *uses = &vectorizer->uses;
+  for (uint32_t i = uses->offsets[member]; i < uses->offsets[member + 1];
+       ++i) {
+    if (!reads_vector(vectorizer, uses->users[i], member)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Whether every user of a constant reads it as a broadcast, leaving the
+// scalar dead once the packs replace them.
+bool only_broadcast(const Vectorizer *vectorizer, IrValue value) {
+  const IrUses *uses = &vectorizer->uses;
+  if (uses->offsets[value] == uses->offsets[value + 1]) {
+    return false;
+  }
+  for (uint32_t i = uses->offsets[value]; i < uses->offsets[value + 1]; ++i) {
+    IrValue user = uses->users[i];
+    uint32_t index = vectorizer->pack_of[user];
+    if (index == NO_PACK || !vectorizer->packs[index].accepted) {
+      return false;
+    }
+    for (uint32_t side = 0; side < 2; ++side) {
+      if (vectorizer->instructions[user].operands[side] == value &&
+          effective_side(vectorizer, &vectorizer->packs[index], side) !=
+              BroadcastSide) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Places an accepted pack after everything it reads and prices it,
+// rejecting it when some scalar user would run before it.
+bool place_pack(Vectorizer *vectorizer, Pack *pack) {
+  const IrUses *uses = &vectorizer->uses;
+  IrValue first = vectorizer->members[pack->first];
+  uint32_t anchor = vectorizer->block_begins[first];
+  uint32_t cost = VectorCost;
+  for (uint32_t side = 0; side < 2; ++side) {
+    switch (effective_side(vectorizer, pack, side)) {
+    case ReuseSide:
+      anchor = greater_of(anchor, vectorizer->packs[pack->reused[side]].anchor);
+      break;
+    case BroadcastSide:
+      cost += BroadcastCost;
+      break;
+    case GatherSide:
+      cost += BroadcastCost + pack->lanes * InsertCost;
+      for (uint32_t lane = 0; lane < pack->lanes; ++lane) {
+        IrValue operand = pack_operand(vectorizer, pack, side, lane);
+        anchor = greater_of(anchor, operand + 1);
+        uint32_t index = vectorizer->pack_of[operand];
+        if (index != NO_PACK && vectorizer->packs[index].accepted) {
+          anchor = greater_of(anchor, vectorizer->packs[index].anchor);
+        }
+      }
+      break;
+    }
+  }
+  // Arguments run right up to their call, so nothing goes between them.
+  while (anchor > 0 && anchor < vectorizer->length &&
+         vectorizer->instructions[anchor - 1].opcode == ArgOp) {
+    anchor += 1;
+  }
+  for (uint32_t lane = 0; lane < pack->lanes; ++lane) {
+    IrValue member = vectorizer->members[pack->first + lane];
+    for (uint32_t i = uses->offsets[member]; i < uses->offsets[member + 1];
+         ++i) {
+      IrValue user = uses->users[i];
+      uint32_t index = vectorizer->pack_of[user];
+      bool moves = index != NO_PACK && vectorizer->packs[index].accepted;
+      if (!moves && user < anchor) {
+        return false;
+      }
+    }
+    if (needs_scalar(vectorizer, member)) {
+      cost += ExtractCost;
+    }
+  }
+  pack->anchor = anchor;
+  pack->cost = cost;
+  return true;
+}
+
+uint32_t find_component(Pack *packs, uint32_t index) {
+  while (packs[index].component != index) {
+    packs[index].component = packs[packs[index].component].component;
+    index = packs[index].component;
+  }
+  return index;
+}
+
+// Rejects packs until every accepted one can be placed and every group of
+// packs sharing vectors is cheaper than its scalar instructions. Packs
+// are only ever rejected, so this settles.
+void settle_packs(Vectorizer *vectorizer) {
+  Pack *packs = vectorizer->packs;
+  uint32_t count = vectorizer->pack_count;
+  uint32_t *scalar = vectorize_allocate(vectorizer->allocator, count,
+                                        sizeof(uint32_t));
+  uint32_t *vector = vectorize_allocate(vectorizer->allocator, count,
+                                        sizeof(uint32_t));
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (uint32_t i = 0; i < count; ++i) {
+      if (packs[i].accepted && !place_pack(vectorizer, &packs[i])) {
+        packs[i].accepted = false;
+        packs[i].kind = UsedTooEarlyRemark;
+        changed = true;
+      }
+    }
+    if (changed) {
+      continue;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      packs[i].component = i;
+      scalar[i] = 0;
+      vector[i] = 0;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      for (uint32_t side = 0; side < 2 && packs[i].accepted; ++side) {
+        if (effective_side(vectorizer, &packs[i], side) == ReuseSide) {
+          uint32_t a = find_component(packs, i);
+          uint32_t b = find_component(packs, packs[i].reused[side]);
+          packs[a].component = b;
+        }
+      }
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      if (packs[i].accepted) {
+        uint32_t root = find_component(packs, i);
+        scalar[root] += packs[i].lanes * ScalarCost;
+        vector[root] += packs[i].cost;
+      }
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      uint32_t root = find_component(packs, i);
+      if (!packs[i].accepted) {
+        continue;
+      }
+      packs[i].scalar_cost = scalar[root];
+      packs[i].vector_cost = vector[root];
+      if (vector[root] >= scalar[root]) {
+        packs[i].accepted = false;
+        packs[i].kind = NotProfitableRemark;
+        changed = true;
+      }
+    }
+  }
+}
+
+void add_remark(Allocator allocator, VectorizeResult *result,
+            VectorizeRemarkKind kind, IrInstruction instruction,
+            IrValue first, uint32_t lanes) {
+  array_push(allocator, &result->remarks,
+             (VectorizeRemark){.kind = kind,
+                               .opcode = instruction.opcode,
+                               .type = instruction.type,
+                               .first = first,
+                               .lanes = lanes,
+                               .scalar_cost = lanes * ScalarCost});
+}
+
+IrValue emit_pack_side(const Vectorizer *vectorizer, IrFunction *function,
+                       const Pack *pack, uint32_t side, const IrValue *remap) {
+  Allocator allocator = vectorizer->allocator;
+  switch (effective_side(vectorizer, pack, side)) {
+  case ReuseSide:
+    return vectorizer->packs[pack->reused[side]].value;
+  case BroadcastSide: {
+    IrValue operand = pack_operand(vectorizer, pack, side, 0);
+    return ir_constant(allocator, function, pack->vector,
+                       ir_constant_bits(vectorizer->instructions[operand]));
+  }
+  case GatherSide: {
+    IrValue vector = ir_constant(allocator, function, pack->vector, 0);
+    for (uint32_t lane = 0; lane < pack->lanes; ++lane) {
+      IrValue operand = pack_operand(vectorizer, pack, side, lane);
+      vector = ir_insert(allocator, function, pack->vector, vector,
+                         remap[operand], lane);
+    }
+    return vector;
+  }
+  }
+  assert(false);
+}
+
+void emit_pack(Vectorizer *vectorizer, IrFunction *function, Pack *pack,
+               IrValue *remap) {
+  IrValue left = emit_pack_side(vectorizer, function, pack, 0, remap);
+  IrValue right = emit_pack_side(vectorizer, function, pack, 1, remap);
+  pack->value = ir_binary(vectorizer->allocator, function, pack->opcode,
+                          pack->vector, left, right);
+  for (uint32_t lane = 0; lane < pack->lanes; ++lane) {
+    IrValue member = vectorizer->members[pack->first + lane];
+    if (needs_scalar(vectorizer, member)) {
+      remap[member] = ir_extract(vectorizer->allocator, function,
+                                 pack->element, pack->value, lane);
+    }
+  }
+}
+
+// Lays the function out again with every accepted pack right before its
+// anchor and its members gone.
+void rebuild_function(Vectorizer *vectorizer, IrFunction *function) {
+  uint32_t length = vectorizer->length;
+  Allocator allocator = vectorizer->allocator;
+  uint32_t *heads = vectorize_allocate(allocator, length, sizeof(uint32_t));
+  uint32_t *tails = vectorize_allocate(allocator, length, sizeof(uint32_t));
+  IrValue *remap = vectorize_allocate(allocator, length, sizeof(IrValue));
+  memset(heads, 0xff, length * sizeof(uint32_t));
+  for (uint32_t i = 0; i < vectorizer->pack_count; ++i) {
+    Pack *pack = &vectorizer->packs[i];
+    if (!pack->accepted) {
+      continue;
+    }
+    pack->next = NO_PACK;
+    if (heads[pack->anchor] == NO_PACK) {
+      heads[pack->anchor] = i;
+    } else {
+      vectorizer->packs[tails[pack->anchor]].next = i;
+    }
+    tails[pack->anchor] = i;
+  }
+  IrBlockArray blocks = function->blocks;
+  uint32_t block = 0;
+  IrFunction rebuilt = *function;
+  rebuilt.instructions = (IrInstructionArray){};
+  rebuilt.blocks = (IrBlockArray){};
+  for (uint32_t i = 0; i < length; ++i) {
+    for (uint32_t p = heads[i]; p != NO_PACK; p = vectorizer->packs[p].next) {
+      emit_pack(vectorizer, &rebuilt, &vectorizer->packs[p], remap);
+    }
+    uint32_t index = vectorizer->pack_of[i];
+    bool packed = index != NO_PACK && vectorizer->packs[index].accepted;
+    bool dead = vectorizer->instructions[i].opcode == ConstOp &&
+                only_broadcast(vectorizer, i);
+    if (!packed && !dead) {
+      IrInstruction instruction = vectorizer->instructions[i];
+      uint32_t count = ir_operand_count(instruction);
+      for (uint32_t j = 0; j < count; ++j) {
+        instruction.operands[j] = remap[instruction.operands[j]];
+      }
+      remap[i] = ir_append(allocator, &rebuilt, instruction);
+    }
+    while (block < blocks.length && blocks.data[block].end == i + 1) {
+      ir_end_block(allocator, &rebuilt);
+      block += 1;
+    }
+  }
+  *function = rebuilt;
+}
+
+VectorizeResult vectorize(Allocator allocator, IrFunction *function,
+                          const VectorTarget *target) {
+  VectorizeResult result = {};
+  uint32_t length = (uint32_t)function->instructions.length;
+  const IrInstruction *instructions = function->instructions.data;
+  Vectorizer vectorizer = {
+      .allocator = allocator,
+      .instructions = instructions,
+      .length = length,
+      .uses = ir_compute_uses(allocator, function),
+      .block_begins = vectorize_allocate(allocator, length, sizeof(uint32_t)),
+      .members = vectorize_allocate(allocator, length, sizeof(IrValue)),
+      .pack_of = vectorize_allocate(allocator, length, sizeof(uint32_t)),
+      .lane_of = vectorize_allocate(allocator, length, sizeof(uint32_t)),
+      .packs = vectorize_allocate(allocator, length / MinLanes, sizeof(Pack)),
+  };
+  uint32_t *blocks = vectorize_allocate(allocator, length, sizeof(uint32_t));
+  uint32_t *depths = vectorize_allocate(allocator, length, sizeof(uint32_t));
+  Candidate *candidates =
+      vectorize_allocate(allocator, length, sizeof(Candidate));
+  memset(vectorizer.pack_of, 0xff, length * sizeof(uint32_t));
+  for (uint32_t b = 0; b < function->blocks.length; ++b) {
+    IrBlock block = function->blocks.data[b];
+    for (uint32_t i = block.begin; i < block.end; ++i) {
+      blocks[i] = b;
+      vectorizer.block_begins[i] = block.begin;
+    }
+  }
+
+  // A value is one deeper than its deepest operand, so two instructions
+  // at the same depth never depend on each other.
+  uint32_t candidate_count = 0;
+  for (uint32_t i = 0; i < length; ++i) {
+    uint32_t count = ir_operand_count(instructions[i]);
+    depths[i] = 0;
+    for (uint32_t j = 0; j < count; ++j) {
+      IrValue operand = instructions[i].operands[j];
+      depths[i] = greater_of(depths[i], depths[operand] + 1);
+    }
+    if (vectorizable(instructions[i])) {
+      candidates[candidate_count++] =
+          (Candidate){.block = blocks[i],
+                      .depth = depths[i],
+                      .opcode = instructions[i].opcode,
+                      .type = instructions[i].type,
+                      .value = i};
+    }
+  }
+  qsort(candidates, candidate_count, sizeof(Candidate), compare_candidates);
+
+  uint32_t member_count = 0;
+  for (uint32_t begin = 0; begin < candidate_count;) {
+    uint32_t end = begin + 1;
+    while (end < candidate_count &&
+           same_group(&candidates[begin], &candidates[end])) {
+      end += 1;
+    }
+    IrInstruction instruction = instructions[candidates[begin].value];
+    bool supported = instruction.opcode != MulOp ||
+                     instruction.type != I32TypeId ||
+                     target->packed_i32_multiply;
+    uint32_t group = begin;
+    while (end - group >= MinLanes) {
+      uint32_t lanes =
+          end - group >= target->max_lanes ? target->max_lanes : MinLanes;
+      if (!supported) {
+        add_remark(allocator, &result, UnsupportedOperationRemark, instruction,
+               candidates[group].value, end - group);
+        group = end;
+        break;
+      }
+      Pack *pack = &vectorizer.packs[vectorizer.pack_count];
+      *pack = (Pack){.opcode = instruction.opcode,
+                     .element = instruction.type,
+                     .vector = vector_type_of(instruction.type, lanes),
+                     .first = member_count,
+                     .lanes = lanes,
+                     .accepted = true,
+                     .kind = VectorizedRemark};
+      for (uint32_t lane = 0; lane < lanes; ++lane) {
+        IrValue member = candidates[group + lane].value;
+        vectorizer.members[member_count++] = member;
+        vectorizer.pack_of[member] = vectorizer.pack_count;
+        vectorizer.lane_of[member] = lane;
+      }
+      pack->sides[0] = classify_side(&vectorizer, pack, 0);
+      pack->sides[1] = classify_side(&vectorizer, pack, 1);
+      vectorizer.pack_count += 1;
+      group += lanes;
+    }
+    if (end - group >= 2) {
+      add_remark(allocator, &result, TooFewLanesRemark, instruction,
+             candidates[group].value, end - group);
+    }
+    begin = end;
+  }
+
+  settle_packs(&vectorizer);
+  for (uint32_t i = 0; i < vectorizer.pack_count; ++i) {
+    const Pack *pack = &vectorizer.packs[i];
+    IrValue first = vectorizer.members[pack->first];
+    add_remark(allocator, &result, pack->kind, instructions[first], first,
+               pack->lanes);
+    array_last(&result.remarks).scalar_cost = pack->scalar_cost;
+    array_last(&result.remarks).vector_cost = pack->vector_cost;
+    if (pack->accepted) {
+      result.vectorized += 1;
+      result.instructions_replaced += pack->lanes;
+    }
+  }
+  if (result.vectorized > 0) {
+    rebuild_function(&vectorizer, function);
+  }
+  return result;
+}
+
+void vectorize_write_remarks(FILE *out, const VectorizeResult *result,
+                             const TypeTable *types,
+                             const VectorTarget *target) {
+  for (size_t i = 0; i < result->remarks.length; ++i) {
+    const VectorizeRemark *remark = &result->remarks.data[i];
+    const Type *type = lookup_type(types, remark->type);
+    fprintf(out, "%%%u: ", remark->first);
+    fprintf(out, remark->kind == VectorizedRemark ? "vectorized"
+                                                  : "not vectorized");
+    fprintf(out, " %u x %s %.*s", remark->lanes,
+            ir_opcode_name(remark->opcode), (int)type->name.length,
+            type->name.data);
+    switch (remark->kind) {
+    case VectorizedRemark:
+      fprintf(out, " (scalar cost %u, vector cost %u)\n", remark->scalar_cost,
+              remark->vector_cost);
+      break;
+    case TooFewLanesRemark:
+      fprintf(out, ": too few independent lanes, kept scalar\n");
+      break;
+    case UnsupportedOperationRemark:
+      fprintf(out, ": no packed instruction on %s\n", target->name);
+      break;
+    case NotProfitableRemark:
+      fprintf(out, ": not profitable (scalar cost %u, vector cost %u)\n",
+              remark->scalar_cost, remark->vector_cost);
+      break;
+    case UsedTooEarlyRemark:
+      fprintf(out, ": a lane is used before every operand is ready\n");
+      break;
+    }
+  }
+  fprintf(out, "vectorized %u groups for %s, replacing %u instructions\n",
+          result->vectorized, target->name, result->instructions_replaced);
+}
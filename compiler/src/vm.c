@@ -0,0 +1,71 @@
+#include "vm.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+static inline uint32_t wide_operand(BytecodeInstruction instruction) {
+  return (uint32_t)instruction.c << 16 | instruction.b;
+}
+
+static inline float to_f32(uint64_t bits) {
+  uint32_t narrow = (uint32_t)bits;
+  float value;
+  memcpy(&value, &narrow, sizeof(value));
+  return value;
+}
+
+static inline uint64_t from_f32(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static inline double to_f64(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static inline uint64_t from_f64(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static inline uint64_t f32_lanes(float low, float high) {
+  return from_f32(low) | from_f32(high) << 32;
+}
+
+static inline uint64_t i32_lanes(uint32_t low, uint32_t high) {
+  return low | (uint64_t)high << 32;
+}
+
+#define VM_FUNCTION vm_run_switch
+#include "vm_loop.h"
+#undef VM_FUNCTION
+
+#ifdef __GNUC__
+#define VM_THREADED
+#define VM_FUNCTION vm_run
+#include "vm_loop.h"
+#undef VM_FUNCTION
+#undef VM_THREADED
+#else
+VmResult vm_run(const BytecodeFunction *function, uint64_t *registers) {
+  return vm_run_switch(function, registers);
+}
+#endif
+
+const char *vm_status_message(VmStatus status) {
+  switch (status) {
+  case VmOk:
+    return "ok";
+  case VmDivisionByZero:
+    return "division by zero";
+  case VmDivisionOverflow:
+    return "signed division overflow";
+  }
+  return "unknown status";
+}
@@ -0,0 +1,336 @@
+// Interpreter body shared by the dispatch strategies in vm.c. The includer
+// defines VM_FUNCTION and, for threaded dispatch, VM_THREADED.
+
+VmResult VM_FUNCTION(const BytecodeFunction *function, uint64_t *r) {
+  const BytecodeInstruction *code = function->instructions.data;
+  const uint64_t *constants = function->constants.data;
+  const BytecodeInstruction *pc = code;
+  BytecodeInstruction i;
+#ifdef VM_THREADED
+  static const void *labels[BytecodeOpcodeCount] = {
+      [LoadConstBytecode] = &&LoadConstBytecode_label,
+      [MoveBytecode] = &&MoveBytecode_label,
+      [AddIntBytecode] = &&AddIntBytecode_label,
+      [SubIntBytecode] = &&SubIntBytecode_label,
+      [MulIntBytecode] = &&MulIntBytecode_label,
+      [DivSignedBytecode] = &&DivSignedBytecode_label,
+      [DivUnsignedBytecode] = &&DivUnsignedBytecode_label,
+      [ModSignedBytecode] = &&ModSignedBytecode_label,
+      [ModUnsignedBytecode] = &&ModUnsignedBytecode_label,
+      [EqIntBytecode] = &&EqIntBytecode_label,
+      [NeIntBytecode] = &&NeIntBytecode_label,
+      [LtSignedBytecode] = &&LtSignedBytecode_label,
+      [LeSignedBytecode] = &&LeSignedBytecode_label,
+      [LtUnsignedBytecode] = &&LtUnsignedBytecode_label,
+      [LeUnsignedBytecode] = &&LeUnsignedBytecode_label,
+      [SignExtend8Bytecode] = &&SignExtend8Bytecode_label,
+      [SignExtend16Bytecode] = &&SignExtend16Bytecode_label,
+      [SignExtend32Bytecode] = &&SignExtend32Bytecode_label,
+      [ZeroExtend8Bytecode] = &&ZeroExtend8Bytecode_label,
+      [ZeroExtend16Bytecode] = &&ZeroExtend16Bytecode_label,
+      [ZeroExtend32Bytecode] = &&ZeroExtend32Bytecode_label,
+      [AddF32Bytecode] = &&AddF32Bytecode_label,
+      [SubF32Bytecode] = &&SubF32Bytecode_label,
+      [MulF32Bytecode] = &&MulF32Bytecode_label,
+      [DivF32Bytecode] = &&DivF32Bytecode_label,
+      [ModF32Bytecode] = &&ModF32Bytecode_label,
+      [EqF32Bytecode] = &&EqF32Bytecode_label,
+      [NeF32Bytecode] = &&NeF32Bytecode_label,
+      [LtF32Bytecode] = &&LtF32Bytecode_label,
+      [LeF32Bytecode] = &&LeF32Bytecode_label,
+      [AddF64Bytecode] = &&AddF64Bytecode_label,
+      [SubF64Bytecode] = &&SubF64Bytecode_label,
+      [MulF64Bytecode] = &&MulF64Bytecode_label,
+      [DivF64Bytecode] = &&DivF64Bytecode_label,
+      [ModF64Bytecode] = &&ModF64Bytecode_label,
+      [EqF64Bytecode] = &&EqF64Bytecode_label,
+      [NeF64Bytecode] = &&NeF64Bytecode_label,
+      [LtF64Bytecode] = &&LtF64Bytecode_label,
+      [LeF64Bytecode] = &&LeF64Bytecode_label,
+      [AddF32x2Bytecode] = &&AddF32x2Bytecode_label,
+      [SubF32x2Bytecode] = &&SubF32x2Bytecode_label,
+      [MulF32x2Bytecode] = &&MulF32x2Bytecode_label,
+      [DivF32x2Bytecode] = &&DivF32x2Bytecode_label,
+      [AddI32x2Bytecode] = &&AddI32x2Bytecode_label,
+      [SubI32x2Bytecode] = &&SubI32x2Bytecode_label,
+      [MulI32x2Bytecode] = &&MulI32x2Bytecode_label,
+      [InsertLowBytecode] = &&InsertLowBytecode_label,
+      [InsertHighBytecode] = &&InsertHighBytecode_label,
+      [ExtractHighBytecode] = &&ExtractHighBytecode_label,
+      [JumpBytecode] = &&JumpBytecode_label,
+      [JumpIfBytecode] = &&JumpIfBytecode_label,
+      [ReturnBytecode] = &&ReturnBytecode_label,
+      [ReturnVectorBytecode] = &&ReturnVectorBytecode_label,
+  };
+// Every handler ends in its own indirect jump, which gives the branch
+// predictor one history per opcode instead of a single shared one.
+#define VM_CASE(opcode) opcode##_label:
+#define VM_NEXT()                                                              \
+  do {                                                                         \
+    i = *pc++;                                                                 \
+    goto *labels[i.opcode];                                                    \
+  } while (false)
+  VM_NEXT();
+#else
+#define VM_CASE(opcode) case opcode:
+#define VM_NEXT() continue
+  for (;;) {
+    i = *pc++;
+    switch ((BytecodeOpcode)i.opcode) {
+#endif
+
+  VM_CASE(LoadConstBytecode) {
+    r[i.a] = constants[wide_operand(i)];
+    VM_NEXT();
+  }
+  VM_CASE(MoveBytecode) {
+    r[i.a] = r[i.b];
+    VM_NEXT();
+  }
+  VM_CASE(AddIntBytecode) {
+    r[i.a] = r[i.b] + r[i.c];
+    VM_NEXT();
+  }
+  VM_CASE(SubIntBytecode) {
+    r[i.a] = r[i.b] - r[i.c];
+    VM_NEXT();
+  }
+  VM_CASE(MulIntBytecode) {
+    r[i.a] = r[i.b] * r[i.c];
+    VM_NEXT();
+  }
+  VM_CASE(DivSignedBytecode) {
+    if (r[i.c] == 0) {
+      return (VmResult){.status = VmDivisionByZero};
+    }
+    if ((int64_t)r[i.c] == -1 && (int64_t)r[i.b] == INT64_MIN) {
+      return (VmResult){.status = VmDivisionOverflow};
+    }
+    r[i.a] = (uint64_t)((int64_t)r[i.b] / (int64_t)r[i.c]);
+    VM_NEXT();
+  }
+  VM_CASE(DivUnsignedBytecode) {
+    if (r[i.c] == 0) {
+      return (VmResult){.status = VmDivisionByZero};
+    }
+    r[i.a] = r[i.b] / r[i.c];
+    VM_NEXT();
+  }
+  VM_CASE(ModSignedBytecode) {
+    if (r[i.c] == 0) {
+      return (VmResult){.status = VmDivisionByZero};
+    }
+    if ((int64_t)r[i.c] == -1) {
+      r[i.a] = 0;
+      VM_NEXT();
+    }
+    r[i.a] = (uint64_t)((int64_t)r[i.b] % (int64_t)r[i.c]);
+    VM_NEXT();
+  }
+  VM_CASE(ModUnsignedBytecode) {
+    if (r[i.c] == 0) {
+      return (VmResult){.status = VmDivisionByZero};
+    }
+    r[i.a] = r[i.b] % r[i.c];
+    VM_NEXT();
+  }
+  VM_CASE(EqIntBytecode) {
+    r[i.a] = r[i.b] == r[i.c];
+    VM_NEXT();
+  }
+  VM_CASE(NeIntBytecode) {
+    r[i.a] = r[i.b] != r[i.c];
+    VM_NEXT();
+  }
+  VM_CASE(LtSignedBytecode) {
+    r[i.a] = (int64_t)r[i.b] < (int64_t)r[i.c];
+    VM_NEXT();
+  }
+  VM_CASE(LeSignedBytecode) {
+    r[i.a] = (int64_t)r[i.b] <= (int64_t)r[i.c];
+    VM_NEXT();
+  }
+  VM_CASE(LtUnsignedBytecode) {
+    r[i.a] = r[i.b] < r[i.c];
+    VM_NEXT();
+  }
+  VM_CASE(LeUnsignedBytecode) {
+    r[i.a] = r[i.b] <= r[i.c];
+    VM_NEXT();
+  }
+  VM_CASE(SignExtend8Bytecode) {
+    r[i.a] = (uint64_t)(int64_t)(int8_t)r[i.b];
+    VM_NEXT();
+  }
+  VM_CASE(SignExtend16Bytecode) {
+    r[i.a] = (uint64_t)(int64_t)(int16_t)r[i.b];
+    VM_NEXT();
+  }
+  VM_CASE(SignExtend32Bytecode) {
+    r[i.a] = (uint64_t)(int64_t)(int32_t)r[i.b];
+    VM_NEXT();
+  }
+  VM_CASE(ZeroExtend8Bytecode) {
+    r[i.a] = (uint8_t)r[i.b];
+    VM_NEXT();
+  }
+  VM_CASE(ZeroExtend16Bytecode) {
+    r[i.a] = (uint16_t)r[i.b];
+    VM_NEXT();
+  }
+  VM_CASE(ZeroExtend32Bytecode) {
+    r[i.a] = (uint32_t)r[i.b];
+    VM_NEXT();
+  }
+  VM_CASE(AddF32Bytecode) {
+    r[i.a] = from_f32(to_f32(r[i.b]) + to_f32(r[i.c]));
+    VM_NEXT();
+  }
+  VM_CASE(SubF32Bytecode) {
+    r[i.a] = from_f32(to_f32(r[i.b]) - to_f32(r[i.c]));
+    VM_NEXT();
+  }
+  VM_CASE(MulF32Bytecode) {
+    r[i.a] = from_f32(to_f32(r[i.b]) * to_f32(r[i.c]));
+    VM_NEXT();
+  }
+  VM_CASE(DivF32Bytecode) {
+    r[i.a] = from_f32(to_f32(r[i.b]) / to_f32(r[i.c]));
+    VM_NEXT();
+  }
+  VM_CASE(ModF32Bytecode) {
+    r[i.a] = from_f32(fmodf(to_f32(r[i.b]), to_f32(r[i.c])));
+    VM_NEXT();
+  }
+  VM_CASE(EqF32Bytecode) {
+    r[i.a] = to_f32(r[i.b]) == to_f32(r[i.c]);
+    VM_NEXT();
+  }
+  VM_CASE(NeF32Bytecode) {
+    r[i.a] = to_f32(r[i.b]) != to_f32(r[i.c]);
+    VM_NEXT();
+  }
+  VM_CASE(LtF32Bytecode) {
+    r[i.a] = to_f32(r[i.b]) < to_f32(r[i.c]);
+    VM_NEXT();
+  }
+  VM_CASE(LeF32Bytecode) {
+    r[i.a] = to_f32(r[i.b]) <= to_f32(r[i.c]);
+    VM_NEXT();
+  }
+  VM_CASE(AddF64Bytecode) {
+    r[i.a] = from_f64(to_f64(r[i.b]) + to_f64(r[i.c]));
+    VM_NEXT();
+  }
+  VM_CASE(SubF64Bytecode) {
+    r[i.a] = from_f64(to_f64(r[i.b]) - to_f64(r[i.c]));
+    VM_NEXT();
+  }
+  VM_CASE(MulF64Bytecode) {
+    r[i.a] = from_f64(to_f64(r[i.b]) * to_f64(r[i.c]));
+    VM_NEXT();
+  }
+  VM_CASE(DivF64Bytecode) {
+    r[i.a] = from_f64(to_f64(r[i.b]) / to_f64(r[i.c]));
+    VM_NEXT();
+  }
+  VM_CASE(ModF64Bytecode) {
+    r[i.a] = from_f64(fmod(to_f64(r[i.b]), to_f64(r[i.c])));
+    VM_NEXT();
+  }
+  VM_CASE(EqF64Bytecode) {
+    r[i.a] = to_f64(r[i.b]) == to_f64(r[i.c]);
+    VM_NEXT();
+  }
+  VM_CASE(NeF64Bytecode) {
+    r[i.a] = to_f64(r[i.b]) != to_f64(r[i.c]);
+    VM_NEXT();
+  }
+  VM_CASE(LtF64Bytecode) {
+    r[i.a] = to_f64(r[i.b]) < to_f64(r[i.c]);
+    VM_NEXT();
+  }
+  VM_CASE(LeF64Bytecode) {
+    r[i.a] = to_f64(r[i.b]) <= to_f64(r[i.c]);
+    VM_NEXT();
+  }
+  VM_CASE(AddF32x2Bytecode) {
+    r[i.a] = f32_lanes(to_f32(r[i.b]) + to_f32(r[i.c]),
+                       to_f32(r[i.b] >> 32) + to_f32(r[i.c] >> 32));
+    VM_NEXT();
+  }
+  VM_CASE(SubF32x2Bytecode) {
+    r[i.a] = f32_lanes(to_f32(r[i.b]) - to_f32(r[i.c]),
+                       to_f32(r[i.b] >> 32) - to_f32(r[i.c] >> 32));
+    VM_NEXT();
+  }
+  VM_CASE(MulF32x2Bytecode) {
+    r[i.a] = f32_lanes(to_f32(r[i.b]) * to_f32(r[i.c]),
+                       to_f32(r[i.b] >> 32) * to_f32(r[i.c] >> 32));
+    VM_NEXT();
+  }
+  VM_CASE(DivF32x2Bytecode) {
+    r[i.a] = f32_lanes(to_f32(r[i.b]) / to_f32(r[i.c]),
+                       to_f32(r[i.b] >> 32) / to_f32(r[i.c] >> 32));
+    VM_NEXT();
+  }
+  VM_CASE(AddI32x2Bytecode) {
+    r[i.a] = i32_lanes((uint32_t)r[i.b] + (uint32_t)r[i.c],
+                       (uint32_t)(r[i.b] >> 32) + (uint32_t)(r[i.c] >> 32));
+    VM_NEXT();
+  }
+  VM_CASE(SubI32x2Bytecode) {
+    r[i.a] = i32_lanes((uint32_t)r[i.b] - (uint32_t)r[i.c],
+                       (uint32_t)(r[i.b] >> 32) - (uint32_t)(r[i.c] >> 32));
+    VM_NEXT();
+  }
+  VM_CASE(MulI32x2Bytecode) {
+    r[i.a] = i32_lanes((uint32_t)r[i.b] * (uint32_t)r[i.c],
+                       (uint32_t)(r[i.b] >> 32) * (uint32_t)(r[i.c] >> 32));
+    VM_NEXT();
+  }
+  VM_CASE(InsertLowBytecode) {
+    r[i.a] = i32_lanes((uint32_t)r[i.b], (uint32_t)(r[i.a] >> 32));
+    VM_NEXT();
+  }
+  VM_CASE(InsertHighBytecode) {
+    r[i.a] = i32_lanes((uint32_t)r[i.a], (uint32_t)r[i.b]);
+    VM_NEXT();
+  }
+  VM_CASE(ExtractHighBytecode) {
+    r[i.a] = r[i.b] >> 32;
+    VM_NEXT();
+  }
+  VM_CASE(JumpBytecode) {
+    pc = code + wide_operand(i);
+    VM_NEXT();
+  }
+  VM_CASE(JumpIfBytecode) {
+    if (r[i.a]) {
+      pc = code + wide_operand(i);
+    }
+    VM_NEXT();
+  }
+  VM_CASE(ReturnBytecode) {
+    return (VmResult){
+        .status = VmOk,
+        .value = i.a == BYTECODE_NO_REGISTER ? 0 : r[i.a],
+    };
+  }
+  VM_CASE(ReturnVectorBytecode) {
+    VmResult result = {.status = VmOk, .value = r[i.a]};
+    memcpy(result.vector, r + i.a, i.b * sizeof(uint64_t));
+    return result;
+  }
+
+#ifndef VM_THREADED
+    case BytecodeOpcodeCount:
+      break;
+    }
+    assert(false);
+  }
+#endif
+}
+
+#undef VM_CASE
+#undef VM_NEXT
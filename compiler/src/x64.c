@@ -0,0 +1,903 @@
+#include "x64.h"
+#include "array.h"
+#include "vm.h"
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+// Values live where the register allocator puts them. Instructions load
+// their left operand into rax or xmm0, combine it with the right operand
+// straight from its register or spill slot, and move the result to where
+// its value lives. rax, rcx, rdx, xmm0 and xmm1 are scratch and never
+// allocated. Vectors of 16 bytes live in xmm registers and use SSE, those
+// of 32 bytes live in ymm registers and use AVX.
+
+typedef enum {
+  Rax = 0,
+  Rcx = 1,
+  Rdx = 2,
+  Rbx = 3,
+  Rbp = 5,
+  Rsi = 6,
+  Rdi = 7,
+  R8 = 8,
+  R9 = 9,
+  R10 = 10,
+  R11 = 11,
+  R12 = 12,
+  R13 = 13,
+  R14 = 14,
+  R15 = 15,
+} X64Register;
+
+// Registers that need no saving come first, so short intervals leave the
+// callee saved ones to intervals that cross a call.
+static const uint8_t general_registers[] = {
+    Rsi, Rdi, R8, R9, R10, R11, Rbx, R12, R13, R14, R15,
+};
+
+static const uint8_t float_registers[] = {
+    2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+};
+
+const RegisterFile x64_registers = {
+    .classes =
+        {
+            [GeneralRegisterClass] =
+                {
+                    .registers = general_registers,
+                    .count = sizeof(general_registers),
+                    .caller_saved = 1u << Rsi | 1u << Rdi | 1u << R8 |
+                                    1u << R9 | 1u << R10 | 1u << R11,
+                },
+            [FloatRegisterClass] =
+                {
+                    .registers = float_registers,
+                    .count = sizeof(float_registers),
+                    .caller_saved = 0xffff,
+                },
+        },
+};
+
+static const uint32_t callee_saved =
+    1u << Rbx | 1u << R12 | 1u << R13 | 1u << R14 | 1u << R15;
+
+// A register, or memory at rbp + displacement.
+typedef struct {
+  bool in_register;
+  uint8_t reg;
+  int32_t displacement;
+} Operand;
+
+typedef struct {
+  Allocator allocator;
+  const IrFunction *function;
+  X64Code *code;
+  const RegisterAllocation *registers;
+  // Callee saved registers in use, kept right below the result pointer.
+  uint8_t saved[5];
+  uint32_t saved_count;
+  // The instruction being emitted, which decides where split values are.
+  uint32_t position;
+  // Every spill slot fits the widest value in the function.
+  uint32_t slot_size;
+  // Upper ymm halves must be cleared before calls and returns, or SSE code
+  // outside pays for the transition.
+  bool uses_ymm;
+  // 32 bytes below the spill slots where lanes are moved in and out of
+  // vectors, when the function has any lane instructions.
+  bool uses_lanes;
+  int32_t lane_scratch;
+} Emitter;
+
+void emit_bytes(Emitter *emitter, const uint8_t *bytes, size_t length) {
+  array_append(emitter->allocator, &emitter->code->bytes, bytes, length);
+}
+
+#define EMIT(emitter, ...)                                                     \
+  emit_bytes(emitter, (const uint8_t[]){__VA_ARGS__},                          \
+             sizeof((const uint8_t[]){__VA_ARGS__}))
+
+void emit_u32(Emitter *emitter, uint32_t value) {
+  EMIT(emitter, value, value >> 8, value >> 16, value >> 24);
+}
+
+void emit_u64(Emitter *emitter, uint64_t value) {
+  emit_u32(emitter, (uint32_t)value);
+  emit_u32(emitter, (uint32_t)(value >> 32));
+}
+
+typedef enum {
+  NoPrefix = 0,
+  OperandSizePrefix = 0x66,
+  DoublePrefix = 0xf2,
+  SinglePrefix = 0xf3,
+} X64Prefix;
+
+// Emits an instruction whose ModRM names reg and the register or memory
+// operand rm, with whatever REX prefix the registers and width need.
+void emit_modrm(Emitter *emitter, uint8_t reg, Operand rm) {
+  if (rm.in_register) {
+    EMIT(emitter, 0xc0 | (reg & 7) << 3 | (rm.reg & 7));
+    return;
+  }
+  EMIT(emitter, 0x80 | (reg & 7) << 3 | Rbp);
+  emit_u32(emitter, (uint32_t)rm.displacement);
+}
+
+void emit_operand(Emitter *emitter, X64Prefix prefix, bool wide,
+                  const uint8_t *opcode, size_t length, uint8_t reg,
+                  Operand rm) {
+  if (prefix != NoPrefix) {
+    EMIT(emitter, prefix);
+  }
+  uint8_t rex = 0x40 | (wide ? 8 : 0) | (reg >= 8 ? 4 : 0) |
+                (rm.in_register && rm.reg >= 8 ? 1 : 0);
+  if (rex != 0x40) {
+    EMIT(emitter, rex);
+  }
+  emit_bytes(emitter, opcode, length);
+  emit_modrm(emitter, reg, rm);
+}
+
+#define EMIT_OP(emitter, prefix, wide, reg, rm, ...)                           \
+  emit_operand(emitter, prefix, wide, (const uint8_t[]){__VA_ARGS__},          \
+               sizeof((const uint8_t[]){__VA_ARGS__}), reg, rm)
+
+typedef enum {
+  Map0f = 1,
+  Map0f38 = 2,
+  Map0f3a = 3,
+} X64VexMap;
+
+// Emits a three byte VEX instruction on 128 or 256 bit registers. vvvv
+// names the first source, which SSE encodings take from reg, and is 0
+// when the instruction has none.
+void emit_vex(Emitter *emitter, X64VexMap map, X64Prefix prefix,
+              uint8_t opcode, uint8_t reg, uint8_t vvvv, Operand rm,
+              bool wide) {
+  uint8_t pp = prefix == OperandSizePrefix ? 1
+               : prefix == SinglePrefix    ? 2
+               : prefix == DoublePrefix    ? 3
+                                           : 0;
+  EMIT(emitter, 0xc4,
+       (reg >= 8 ? 0 : 0x80) | 0x40 |
+           (rm.in_register && rm.reg >= 8 ? 0 : 0x20) | map,
+       (~vvvv & 15) << 3 | (wide ? 4 : 0) | pp, opcode);
+  emit_modrm(emitter, reg, rm);
+}
+
+void emit_vex256(Emitter *emitter, X64VexMap map, X64Prefix prefix,
+                 uint8_t opcode, uint8_t reg, uint8_t vvvv, Operand rm) {
+  emit_vex(emitter, map, prefix, opcode, reg, vvvv, rm, true);
+}
+
+Operand register_operand(uint8_t reg) {
+  return (Operand){.in_register = true, .reg = reg};
+}
+
+Operand frame_operand(int32_t displacement) {
+  return (Operand){.displacement = displacement};
+}
+
+static const int32_t result_pointer_slot = -8;
+
+Operand saved_register_operand(uint32_t index) {
+  return frame_operand(-16 - 8 * (int32_t)index);
+}
+
+Operand spill_slot_operand(Emitter *emitter, uint32_t slot) {
+  return frame_operand(-8 - 8 * (int32_t)emitter->saved_count -
+                       (int32_t)(emitter->slot_size * (slot + 1)));
+}
+
+bool is_unused(const Emitter *emitter, IrValue value) {
+  ValueLocation location = emitter->registers->values[value];
+  return location.reg == NO_REGISTER && location.split == UINT32_MAX;
+}
+
+// Where value is while the current instruction executes.
+Operand value_operand(Emitter *emitter, IrValue value) {
+  ValueLocation location = emitter->registers->values[value];
+  if (location.reg != NO_REGISTER && emitter->position < location.split) {
+    return register_operand(location.reg);
+  }
+  return spill_slot_operand(emitter, location.slot);
+}
+
+size_t code_position(Emitter *emitter) { return emitter->code->bytes.length; }
+
+// Emits a short jump with a placeholder and returns where to patch it.
+size_t emit_jump(Emitter *emitter, uint8_t opcode) {
+  EMIT(emitter, opcode, 0);
+  return code_position(emitter) - 1;
+}
+
+void patch_jump(Emitter *emitter, size_t at) {
+  size_t distance = code_position(emitter) - (at + 1);
+  assert(distance < 128);
+  emitter->code->bytes.data[at] = (uint8_t)distance;
+}
+
+void emit_vzeroupper(Emitter *emitter) {
+  if (emitter->uses_ymm) {
+    EMIT(emitter, 0xc5, 0xf8, 0x77);
+  }
+}
+
+void emit_epilogue(Emitter *emitter) {
+  emit_vzeroupper(emitter);
+  for (uint32_t i = 0; i < emitter->saved_count; ++i) {
+    EMIT_OP(emitter, NoPrefix, true, emitter->saved[i],
+            saved_register_operand(i), 0x8b);
+  }
+  EMIT(emitter, 0xc9, 0xc3); // leave; ret
+}
+
+void emit_exit(Emitter *emitter, VmStatus status) {
+  EMIT(emitter, 0xb8);
+  emit_u32(emitter, status);
+  emit_epilogue(emitter);
+}
+
+void emit_load(Emitter *emitter, X64Register reg, Operand source) {
+  EMIT_OP(emitter, NoPrefix, true, reg, source, 0x8b);
+}
+
+void emit_store(Emitter *emitter, X64Register reg, Operand destination) {
+  if (!destination.in_register || destination.reg != reg) {
+    EMIT_OP(emitter, NoPrefix, true, reg, destination, 0x89);
+  }
+}
+
+// Brings rax back to the canonical register form of a narrow integer.
+void emit_extend_rax(Emitter *emitter, const Type *type) {
+  bool is_signed = type->kind == SignedIntType;
+  switch (type->size) {
+  case 1:
+    if (is_signed) {
+      EMIT(emitter, 0x48, 0x0f, 0xbe, 0xc0); // movsx rax, al
+    } else {
+      EMIT(emitter, 0x0f, 0xb6, 0xc0); // movzx eax, al
+    }
+    return;
+  case 2:
+    if (is_signed) {
+      EMIT(emitter, 0x48, 0x0f, 0xbf, 0xc0); // movsx rax, ax
+    } else {
+      EMIT(emitter, 0x0f, 0xb7, 0xc0); // movzx eax, ax
+    }
+    return;
+  case 4:
+    if (is_signed) {
+      EMIT(emitter, 0x48, 0x63, 0xc0); // movsxd rax, eax
+    } else {
+      EMIT(emitter, 0x89, 0xc0); // mov eax, eax
+    }
+    return;
+  default:
+    return;
+  }
+}
+
+// Puts bits in a general register with the shortest encoding.
+void emit_move_immediate(Emitter *emitter, uint8_t reg, uint64_t bits) {
+  if ((int64_t)bits == (int32_t)bits) {
+    // mov r64, imm32 sign extended
+    EMIT_OP(emitter, NoPrefix, true, 0, register_operand(reg), 0xc7);
+    emit_u32(emitter, (uint32_t)bits);
+  } else if (bits <= UINT32_MAX) {
+    // mov r32, imm32 zero extends
+    if (reg >= 8) {
+      EMIT(emitter, 0x41);
+    }
+    EMIT(emitter, 0xb8 + (reg & 7));
+    emit_u32(emitter, (uint32_t)bits);
+  } else {
+    EMIT(emitter, 0x48 | (reg >= 8 ? 1 : 0), 0xb8 + (reg & 7));
+    emit_u64(emitter, bits);
+  }
+}
+
+void emit_constant(Emitter *emitter, IrValue destination,
+                   IrInstruction instruction, const Type *type) {
+  if (is_unused(emitter, destination)) {
+    return;
+  }
+  uint64_t bits = ir_constant_bits(instruction);
+  if (type->kind == SignedIntType) {
+    uint32_t shift = 64 - type->size * 8;
+    bits = (uint64_t)((int64_t)(bits << shift) >> shift);
+  }
+  Operand operand = value_operand(emitter, destination);
+  if (!operand.in_register) {
+    if ((int64_t)bits == (int32_t)bits) {
+      // mov qword [rbp + slot], imm32 sign extended
+      EMIT_OP(emitter, NoPrefix, true, 0, operand, 0xc7);
+      emit_u32(emitter, (uint32_t)bits);
+      return;
+    }
+    emit_move_immediate(emitter, Rax, bits);
+    emit_store(emitter, Rax, operand);
+    return;
+  }
+  if (type->kind != FloatType) {
+    emit_move_immediate(emitter, operand.reg, bits);
+    return;
+  }
+  if (bits == 0) {
+    EMIT_OP(emitter, NoPrefix, false, operand.reg, operand, 0x0f, 0x57);
+    return;
+  }
+  emit_move_immediate(emitter, Rax, bits);
+  // movq xmm, rax
+  EMIT_OP(emitter, OperandSizePrefix, true, operand.reg,
+          register_operand(Rax), 0x0f, 0x6e);
+}
+
+void emit_division(Emitter *emitter, IrInstruction instruction,
+                   const Type *type) {
+  Operand left = value_operand(emitter, instruction.operands[0]);
+  Operand right = value_operand(emitter, instruction.operands[1]);
+  bool is_div = instruction.opcode == DivOp;
+  EMIT_OP(emitter, NoPrefix, true, 7, right, 0x83); // cmp right, 0
+  EMIT(emitter, 0);
+  size_t nonzero = emit_jump(emitter, 0x75);
+  emit_exit(emitter, VmDivisionByZero);
+  patch_jump(emitter, nonzero);
+  if (type->kind == UnsignedIntType) {
+    emit_load(emitter, Rax, left);
+    EMIT(emitter, 0x31, 0xd2);                        // xor edx, edx
+    EMIT_OP(emitter, NoPrefix, true, 6, right, 0xf7); // div right
+    if (!is_div) {
+      EMIT(emitter, 0x48, 0x89, 0xd0); // mov rax, rdx
+    }
+    return;
+  }
+  // idiv faults on INT64_MIN / -1, and narrow operands are sign extended
+  // so that is the only overflow. Dividing by -1 is negation.
+  EMIT_OP(emitter, NoPrefix, true, 7, right, 0x83); // cmp right, -1
+  EMIT(emitter, 0xff);
+  size_t not_minus_one = emit_jump(emitter, 0x75);
+  if (is_div) {
+    emit_load(emitter, Rax, left);
+    if (type->size == 8) {
+      EMIT(emitter, 0x48, 0xb9); // mov rcx, INT64_MIN
+      emit_u64(emitter, (uint64_t)INT64_MIN);
+      EMIT(emitter, 0x48, 0x39, 0xc8); // cmp rax, rcx
+      size_t no_overflow = emit_jump(emitter, 0x75);
+      emit_exit(emitter, VmDivisionOverflow);
+      patch_jump(emitter, no_overflow);
+    }
+    EMIT(emitter, 0x48, 0xf7, 0xd8); // neg rax
+    emit_extend_rax(emitter, type);
+  } else {
+    EMIT(emitter, 0x31, 0xc0); // xor eax, eax
+  }
+  size_t done = emit_jump(emitter, 0xeb);
+  patch_jump(emitter, not_minus_one);
+  emit_load(emitter, Rax, left);
+  EMIT(emitter, 0x48, 0x99);                        // cqo
+  EMIT_OP(emitter, NoPrefix, true, 7, right, 0xf7); // idiv right
+  if (!is_div) {
+    EMIT(emitter, 0x48, 0x89, 0xd0); // mov rax, rdx
+  }
+  patch_jump(emitter, done);
+}
+
+uint8_t setcc(IrOpcode opcode, bool is_signed) {
+  switch (opcode) {
+  case EqOp:
+    return 0x94;
+  case NeOp:
+    return 0x95;
+  case LtOp:
+    return is_signed ? 0x9c : 0x92;
+  case LeOp:
+    return is_signed ? 0x9e : 0x96;
+  case GtOp:
+    return is_signed ? 0x9f : 0x97;
+  case GeOp:
+    return is_signed ? 0x9d : 0x93;
+  default:
+    assert(false);
+  }
+}
+
+void emit_integer(Emitter *emitter, IrInstruction instruction,
+                  const Type *type) {
+  IrOpcode opcode = instruction.opcode;
+  if (opcode == DivOp || opcode == ModOp) {
+    emit_division(emitter, instruction, type);
+    return;
+  }
+  Operand right = value_operand(emitter, instruction.operands[1]);
+  emit_load(emitter, Rax, value_operand(emitter, instruction.operands[0]));
+  switch (opcode) {
+  case AddOp:
+    EMIT_OP(emitter, NoPrefix, true, Rax, right, 0x03);
+    emit_extend_rax(emitter, type);
+    return;
+  case SubOp:
+    EMIT_OP(emitter, NoPrefix, true, Rax, right, 0x2b);
+    emit_extend_rax(emitter, type);
+    return;
+  case MulOp:
+    EMIT_OP(emitter, NoPrefix, true, Rax, right, 0x0f, 0xaf);
+    emit_extend_rax(emitter, type);
+    return;
+  default:
+    EMIT_OP(emitter, NoPrefix, true, Rax, right, 0x3b); // cmp rax, right
+    EMIT(emitter, 0x0f, setcc(opcode, type->kind == SignedIntType), 0xc0);
+    EMIT(emitter, 0x0f, 0xb6, 0xc0); // movzx eax, al
+    return;
+  }
+}
+
+X64Prefix scalar_prefix(bool single) {
+  return single ? SinglePrefix : DoublePrefix;
+}
+
+// Loads a float into xmm0 or xmm1.
+void emit_load_float(Emitter *emitter, uint8_t xmm, IrValue value,
+                     bool single) {
+  EMIT_OP(emitter, scalar_prefix(single), false, xmm,
+          value_operand(emitter, value), 0x0f, 0x10);
+}
+
+void emit_float_operation(Emitter *emitter, uint8_t opcode, IrValue right,
+                          bool single) {
+  EMIT_OP(emitter, scalar_prefix(single), false, 0,
+          value_operand(emitter, right), 0x0f, opcode);
+}
+
+void emit_float_compare(Emitter *emitter, IrValue right, bool single) {
+  // ucomiss, or ucomisd with the operand size prefix
+  EMIT_OP(emitter, single ? NoPrefix : OperandSizePrefix, false, 0,
+          value_operand(emitter, right), 0x0f, 0x2e);
+}
+
+// Emits a float instruction, leaving a float result in xmm0 or a boolean
+// in rax. Returns whether the result is a float.
+bool emit_float(Emitter *emitter, IrInstruction instruction,
+                const Type *type) {
+  IrValue left = instruction.operands[0];
+  IrValue right = instruction.operands[1];
+  bool single = type->size == 4;
+  switch ((IrOpcode)instruction.opcode) {
+  case AddOp:
+  case SubOp:
+  case MulOp:
+  case DivOp: {
+    static const uint8_t opcodes[] = {
+        [AddOp] = 0x58, [SubOp] = 0x5c, [MulOp] = 0x59, [DivOp] = 0x5e};
+    emit_load_float(emitter, 0, left, single);
+    emit_float_operation(emitter, opcodes[instruction.opcode], right, single);
+    return true;
+  }
+  case ModOp: {
+    emit_load_float(emitter, 0, left, single);
+    emit_load_float(emitter, 1, right, single);
+    emit_vzeroupper(emitter);
+    EMIT(emitter, 0xff, 0x15); // call [rip + displacement]
+    X64Relocation relocation = {
+        .offset = (uint32_t)code_position(emitter),
+        .symbol = single ? FmodfSymbol : FmodSymbol,
+    };
+    array_push(emitter->allocator, &emitter->code->relocations, relocation);
+    emit_u32(emitter, 0);
+    return true;
+  }
+  case EqOp:
+  case NeOp: {
+    // Unordered operands set the parity flag, and NaN is never equal.
+    bool eq = instruction.opcode == EqOp;
+    emit_load_float(emitter, 0, left, single);
+    emit_float_compare(emitter, right, single);
+    EMIT(emitter, 0x0f, eq ? 0x94 : 0x95, 0xc0); // sete/setne al
+    EMIT(emitter, 0x0f, eq ? 0x9b : 0x9a, 0xc1); // setnp/setp cl
+    EMIT(emitter, eq ? 0x20 : 0x08, 0xc8);       // and/or al, cl
+    EMIT(emitter, 0x0f, 0xb6, 0xc0);             // movzx eax, al
+    return false;
+  }
+  default: {
+    // seta and setae are false when unordered, so a < b is tested as b > a.
+    bool swap = instruction.opcode == LtOp || instruction.opcode == LeOp;
+    bool or_equal = instruction.opcode == LeOp || instruction.opcode == GeOp;
+    emit_load_float(emitter, 0, swap ? right : left, single);
+    emit_float_compare(emitter, swap ? left : right, single);
+    EMIT(emitter, 0x0f, or_equal ? 0x93 : 0x97, 0xc0); // setae/seta al
+    EMIT(emitter, 0x0f, 0xb6, 0xc0);                   // movzx eax, al
+    return false;
+  }
+  }
+}
+
+void emit_store_float(Emitter *emitter, Operand destination, bool single) {
+  if (destination.in_register) {
+    // movaps destination, xmm0
+    EMIT_OP(emitter, NoPrefix, false, destination.reg, register_operand(0),
+            0x0f, 0x28);
+    return;
+  }
+  EMIT_OP(emitter, scalar_prefix(single), false, 0, destination, 0x0f, 0x11);
+}
+
+// Moves a whole vector between a register and a register or slot. Slots
+// are not aligned to the vector size, so moves are unaligned.
+void emit_vector_load(Emitter *emitter, uint8_t reg, Operand source,
+                      bool wide) {
+  if (wide) {
+    emit_vex256(emitter, Map0f, NoPrefix, 0x10, reg, 0, source); // vmovups
+  } else {
+    EMIT_OP(emitter, NoPrefix, false, reg, source, 0x0f, 0x10); // movups
+  }
+}
+
+void emit_vector_store(Emitter *emitter, uint8_t reg, Operand destination,
+                       bool wide) {
+  if (destination.in_register) {
+    if (destination.reg != reg) {
+      emit_vector_load(emitter, destination.reg, register_operand(reg), wide);
+    }
+  } else if (wide) {
+    emit_vex256(emitter, Map0f, NoPrefix, 0x11, reg, 0, destination);
+  } else {
+    EMIT_OP(emitter, NoPrefix, false, reg, destination, 0x0f, 0x11);
+  }
+}
+
+// Broadcasts a 32 bit element into xmm0, or both halves of ymm0. Code on
+// ymm registers stays VEX encoded, since mixing in legacy SSE instructions
+// while the upper halves are dirty stalls on every switch.
+void emit_vector_constant(Emitter *emitter, IrValue destination,
+                          IrInstruction instruction, bool wide) {
+  emit_move_immediate(emitter, Rax, (uint32_t)ir_constant_bits(instruction));
+  if (wide) {
+    // vmovd xmm0, eax; vpshufd xmm0, xmm0, 0; vinsertf128 ymm0, ymm0, xmm0, 1
+    emit_vex(emitter, Map0f, OperandSizePrefix, 0x6e, 0, 0,
+             register_operand(Rax), false);
+    emit_vex(emitter, Map0f, OperandSizePrefix, 0x70, 0, 0,
+             register_operand(0), false);
+    EMIT(emitter, 0);
+    emit_vex256(emitter, Map0f3a, OperandSizePrefix, 0x18, 0, 0,
+                register_operand(0));
+    EMIT(emitter, 1);
+  } else {
+    // movd xmm0, eax; pshufd xmm0, xmm0, 0
+    EMIT_OP(emitter, OperandSizePrefix, false, 0, register_operand(Rax), 0x0f,
+            0x6e);
+    EMIT_OP(emitter, OperandSizePrefix, false, 0, register_operand(0), 0x0f,
+            0x70);
+    EMIT(emitter, 0);
+  }
+  emit_vector_store(emitter, 0, value_operand(emitter, destination), wide);
+}
+
+// Leaves the element-wise result in xmm0 or ymm0.
+void emit_vector(Emitter *emitter, IrInstruction instruction,
+                 const Type *type, const TypeTable *types) {
+  bool wide = type->size == 32;
+  bool is_float = lookup_type(types, type->element)->kind == FloatType;
+  IrOpcode opcode = instruction.opcode;
+  Operand right = value_operand(emitter, instruction.operands[1]);
+  if (!right.in_register) {
+    emit_vector_load(emitter, 1, right, wide);
+    right = register_operand(1);
+  }
+  emit_vector_load(emitter, 0, value_operand(emitter, instruction.operands[0]),
+                   wide);
+  if (is_float) {
+    // addps, subps, mulps, divps
+    static const uint8_t opcodes[] = {
+        [AddOp] = 0x58, [SubOp] = 0x5c, [MulOp] = 0x59, [DivOp] = 0x5e};
+    emitter->code->features |= wide ? X64Avx : 0;
+    if (wide) {
+      emit_vex256(emitter, Map0f, NoPrefix, opcodes[opcode], 0, 0, right);
+    } else {
+      EMIT_OP(emitter, NoPrefix, false, 0, right, 0x0f, opcodes[opcode]);
+    }
+    return;
+  }
+  emitter->code->features |= wide ? X64Avx2 : 0;
+  if (opcode == MulOp) {
+    // pmulld
+    emitter->code->features |= wide ? 0 : X64Sse41;
+    if (wide) {
+      emit_vex256(emitter, Map0f38, OperandSizePrefix, 0x40, 0, 0, right);
+    } else {
+      EMIT_OP(emitter, OperandSizePrefix, false, 0, right, 0x0f, 0x38, 0x40);
+    }
+    return;
+  }
+  uint8_t op = opcode == AddOp ? 0xfe : 0xfa; // paddd, psubd
+  if (wide) {
+    emit_vex256(emitter, Map0f, OperandSizePrefix, op, 0, 0, right);
+  } else {
+    EMIT_OP(emitter, OperandSizePrefix, false, 0, right, 0x0f, op);
+  }
+}
+
+// movss (0x10 loads, 0x11 stores) or movaps (0x28), VEX encoded in code
+// on ymm registers.
+void emit_lane_move(Emitter *emitter, uint8_t opcode, uint8_t reg,
+                    Operand rm) {
+  X64Prefix prefix = opcode == 0x28 ? NoPrefix : SinglePrefix;
+  if (emitter->uses_ymm) {
+    emit_vex(emitter, Map0f, prefix, opcode, reg, 0, rm, false);
+  } else {
+    EMIT_OP(emitter, prefix, false, reg, rm, 0x0f, opcode);
+  }
+}
+
+// Lanes are written and read through memory, which needs nothing beyond
+// SSE2 and costs a store forwarding stall that the vectorizer accounts for.
+void emit_insert(Emitter *emitter, IrValue destination,
+                 IrInstruction instruction, const Type *type,
+                 const TypeTable *types) {
+  bool wide = type->size == 32;
+  Operand scratch = frame_operand(emitter->lane_scratch);
+  Operand lane = frame_operand(emitter->lane_scratch + 4 * instruction.lane);
+  emit_vector_load(emitter, 0, value_operand(emitter, instruction.operands[0]),
+                   wide);
+  emit_vector_store(emitter, 0, scratch, wide);
+  Operand scalar = value_operand(emitter, instruction.operands[1]);
+  if (lookup_type(types, type->element)->kind == FloatType) {
+    if (!scalar.in_register) {
+      emit_lane_move(emitter, 0x10, 1, scalar);
+      scalar = register_operand(1);
+    }
+    emit_lane_move(emitter, 0x11, scalar.reg, lane);
+  } else {
+    emit_load(emitter, Rax, scalar);
+    EMIT_OP(emitter, NoPrefix, false, Rax, lane, 0x89); // mov [lane], eax
+  }
+  emit_vector_load(emitter, 0, scratch, wide);
+  emit_vector_store(emitter, 0, value_operand(emitter, destination), wide);
+}
+
+// Reads the lane straight from a spilled vector, or from the scratch area
+// after storing a vector held in a register.
+void emit_extract(Emitter *emitter, IrValue destination,
+                  IrInstruction instruction, const Type *type,
+                  const TypeTable *types) {
+  const Type *vector =
+      lookup_type(types, emitter->function->instructions
+                             .data[instruction.operands[0]]
+                             .type);
+  Operand source = value_operand(emitter, instruction.operands[0]);
+  if (source.in_register) {
+    emit_vector_store(emitter, source.reg,
+                      frame_operand(emitter->lane_scratch),
+                      vector->size == 32);
+    source = frame_operand(emitter->lane_scratch);
+  }
+  Operand lane = frame_operand(source.displacement + 4 * instruction.lane);
+  Operand result = value_operand(emitter, destination);
+  if (type->kind == FloatType) {
+    emit_lane_move(emitter, 0x10, 0, lane);
+    if (result.in_register) {
+      emit_lane_move(emitter, 0x28, result.reg, register_operand(0));
+    } else {
+      emit_lane_move(emitter, 0x11, 0, result);
+    }
+  } else {
+    EMIT_OP(emitter, NoPrefix, true, Rax, lane, 0x63); // movsxd rax, [lane]
+    emit_store(emitter, Rax, result);
+  }
+}
+
+// Stores the values split at the current instruction to their slots
+// before it runs. Returns the next unprocessed split.
+uint32_t emit_split_stores(Emitter *emitter, const IrFunction *function,
+                           const TypeTable *types, uint32_t next) {
+  const RegisterAllocation *registers = emitter->registers;
+  for (; next < registers->split_count; ++next) {
+    IrValue value = registers->splits[next];
+    ValueLocation location = registers->values[value];
+    if (location.split != emitter->position) {
+      break;
+    }
+    Operand slot = spill_slot_operand(emitter, location.slot);
+    const Type *type =
+        lookup_type(types, function->instructions.data[value].type);
+    if (type->kind == VectorType) {
+      emit_vector_store(emitter, location.reg, slot, type->size == 32);
+    } else if (register_class_of(type) == FloatRegisterClass) {
+      EMIT_OP(emitter, DoublePrefix, false, location.reg, slot, 0x0f, 0x11);
+    } else {
+      EMIT_OP(emitter, NoPrefix, true, location.reg, slot, 0x89);
+    }
+  }
+  return next;
+}
+
+void emit_return(Emitter *emitter, IrValue value, const Type *type) {
+  if (value != IR_NO_VALUE && type->kind == VectorType) {
+    bool wide = type->size == 32;
+    emit_vector_load(emitter, 0, value_operand(emitter, value), wide);
+    emit_load(emitter, Rcx, frame_operand(result_pointer_slot));
+    if (wide) {
+      EMIT(emitter, 0xc5, 0xfc, 0x11, 0x01); // vmovups [rcx], ymm0
+    } else {
+      EMIT(emitter, 0x0f, 0x11, 0x01); // movups [rcx], xmm0
+    }
+  } else if (value != IR_NO_VALUE) {
+    Operand operand = value_operand(emitter, value);
+    if (type->kind != FloatType) {
+      emit_load(emitter, Rax, operand);
+    } else if (operand.in_register) {
+      // movd eax, xmm or movq rax, xmm
+      EMIT_OP(emitter, OperandSizePrefix, type->size == 8, operand.reg,
+              register_operand(Rax), 0x0f, 0x7e);
+    } else {
+      // A 32 bit load zero extends, leaving f32 in the low half.
+      EMIT_OP(emitter, NoPrefix, type->size == 8, Rax, operand, 0x8b);
+    }
+    emit_load(emitter, Rcx, frame_operand(result_pointer_slot));
+    EMIT(emitter, 0x48, 0x89, 0x01); // mov [rcx], rax
+  }
+  EMIT(emitter, 0x31, 0xc0); // xor eax, eax
+  emit_epilogue(emitter);
+}
+
+// Appends one 8 byte slot per called symbol and points every call's
+// displacement at its slot.
+void emit_address_table(Emitter *emitter) {
+  X64Code *code = emitter->code;
+  if (code->relocations.length == 0) {
+    return;
+  }
+  while (code_position(emitter) % 8 != 0) {
+    EMIT(emitter, 0xcc); // int3
+  }
+  uint32_t slots[X64SymbolCount] = {};
+  for (size_t i = 0; i < code->relocations.length; ++i) {
+    X64Relocation relocation = code->relocations.data[i];
+    if (slots[relocation.symbol] == 0) {
+      slots[relocation.symbol] = (uint32_t)code_position(emitter);
+      emit_u64(emitter, 0);
+    }
+    uint32_t displacement =
+        slots[relocation.symbol] - (relocation.offset + 4);
+    memcpy(code->bytes.data + relocation.offset, &displacement,
+           sizeof(displacement));
+  }
+}
+
+void emit_prologue(Emitter *emitter) {
+  const RegisterAllocation *registers = emitter->registers;
+  uint32_t used = registers->used_registers[GeneralRegisterClass];
+  for (uint32_t reg = 0; reg < 16; ++reg) {
+    if (used & callee_saved & 1u << reg) {
+      emitter->saved[emitter->saved_count++] = (uint8_t)reg;
+    }
+  }
+  uint32_t frame = 8 + 8 * emitter->saved_count +
+                   emitter->slot_size * registers->slot_count;
+  if (emitter->uses_lanes) {
+    frame += 32;
+    emitter->lane_scratch = -(int32_t)frame;
+  }
+  frame = (frame + 15) & ~15u;
+  EMIT(emitter, 0x55);                   // push rbp
+  EMIT(emitter, 0x48, 0x89, 0xe5);       // mov rbp, rsp
+  EMIT(emitter, 0x48, 0x81, 0xec);       // sub rsp, frame
+  emit_u32(emitter, frame);
+  emit_store(emitter, Rdi, frame_operand(result_pointer_slot));
+  for (uint32_t i = 0; i < emitter->saved_count; ++i) {
+    emit_store(emitter, emitter->saved[i], saved_register_operand(i));
+  }
+}
+
+X64CompileResult x64_compile(Allocator allocator, const IrFunction *function,
+                             const TypeTable *types) {
+  return x64_compile_with_registers(allocator, function, types,
+                                    &x64_registers);
+}
+
+X64CompileResult x64_compile_with_registers(Allocator allocator,
+                                            const IrFunction *function,
+                                            const TypeTable *types,
+                                            const RegisterFile *file) {
+  X64CompileResult result = {.supported = true};
+  const IrInstruction *instructions = function->instructions.data;
+  uint32_t length = (uint32_t)function->instructions.length;
+  for (uint32_t i = 0; i < length; ++i) {
+    if (instructions[i].opcode >= IrOpcodeCount) {
+      result.supported = false;
+      return result;
+    }
+  }
+  result.registers = allocate_registers(allocator, function, types, file);
+  Emitter emitter = {
+      .allocator = allocator,
+      .function = function,
+      .code = &result.code,
+      .registers = &result.registers,
+      .slot_size = 8,
+  };
+  for (uint32_t i = 0; i < length; ++i) {
+    const Type *type = lookup_type(types, instructions[i].type);
+    if (type->kind == VectorType && type->size > emitter.slot_size) {
+      emitter.slot_size = type->size;
+    }
+    emitter.uses_lanes |= instructions[i].opcode == InsertOp ||
+                          instructions[i].opcode == ExtractOp;
+  }
+  emitter.uses_ymm = emitter.slot_size == 32;
+  emit_prologue(&emitter);
+  uint32_t next_split = 0;
+  for (uint32_t i = 0; i < length; ++i) {
+    emitter.position = i;
+    next_split = emit_split_stores(&emitter, function, types, next_split);
+    IrInstruction instruction = instructions[i];
+    const Type *type = lookup_type(types, instruction.type);
+    switch ((IrOpcode)instruction.opcode) {
+    case ConstOp:
+      if (type->kind == VectorType) {
+        if (!is_unused(&emitter, i)) {
+          emit_vector_constant(&emitter, i, instruction, type->size == 32);
+        }
+      } else {
+        emit_constant(&emitter, i, instruction, type);
+      }
+      continue;
+    case ReturnOp:
+      emit_return(&emitter, instruction.operands[0], type);
+      continue;
+    case InsertOp:
+    case ExtractOp:
+      if (is_unused(&emitter, i)) {
+        continue;
+      }
+      if (instruction.opcode == InsertOp) {
+        emit_insert(&emitter, i, instruction, type, types);
+      } else {
+        emit_extract(&emitter, i, instruction, type, types);
+      }
+      continue;
+    default:
+      break;
+    }
+    const Type *operand_type =
+        lookup_type(types, instructions[instruction.operands[0]].type);
+    if (operand_type->kind == VectorType) {
+      emit_vector(&emitter, instruction, operand_type, types);
+      if (!is_unused(&emitter, i)) {
+        emit_vector_store(&emitter, 0, value_operand(&emitter, i),
+                          operand_type->size == 32);
+      }
+      continue;
+    }
+    bool float_result = false;
+    if (operand_type->kind == FloatType) {
+      float_result = emit_float(&emitter, instruction, operand_type);
+    } else {
+      emit_integer(&emitter, instruction, operand_type);
+    }
+    if (is_unused(&emitter, i)) {
+      continue;
+    }
+    Operand destination = value_operand(&emitter, i);
+    if (float_result) {
+      emit_store_float(&emitter, destination, operand_type->size == 4);
+    } else {
+      emit_store(&emitter, Rax, destination);
+    }
+  }
+  emit_address_table(&emitter);
+  return result;
+}
+
+const char *x64_symbol_name(X64Symbol symbol) {
+  switch (symbol) {
+  case FmodSymbol:
+    return "fmod";
+  case FmodfSymbol:
+    return "fmodf";
+  case X64SymbolCount:
+    break;
+  }
+  return "<invalid>";
+}
@@ -29,6 +29,19 @@ void assert_next_token_result_equal(NextTokenResult expected,
 
 void assert_assign_expression_equal(Assign expected, Assign actual);
 
+void assert_binary_op_equal(BinaryOp expected, BinaryOp actual);
+
+void assert_struct_equal(StructDeclaration expected, StructDeclaration actual);
+
+void assert_array_literal_equal(ArrayLiteral expected, ArrayLiteral actual);
+
+void assert_typed_names_equal(const TypedName *expected,
+                              const TypedName *actual, uint32_t count);
+
+void assert_function_equal(Function expected, Function actual);
+
+void assert_call_equal(Call expected, Call actual);
+
 void assert_expression_equal(Expression expected, Expression actual);
 
 void assert_parse_expression_result_equal(ParseExpressionResult expected,
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ir.h"
+#include "parser.h"
+#include "semantic.h"
+#include "stack_allocator.h"
+
+// The front end a test takes source code through, everything allocated
+// from stack.
+typedef struct {
+  StackAllocator stack;
+  Allocator allocator;
+  Interner interner;
+  TypeTable types;
+  Analyzer analyzer;
+} SourceFixture;
+
+// Starts a fresh stack and an analyzer with no bindings.
+void source_fixture_init(SourceFixture *fixture);
+
+// Initializes fixture, then parses and analyzes source, leaving any
+// diagnostics in the analyzer.
+Module analyze_fixture_source(SourceFixture *fixture, const char *source);
+
+// Like analyze_fixture_source but source must have no diagnostics.
+Module check_fixture_source(SourceFixture *fixture, const char *source);
+
+// Checks source and lowers it to IR without optimizing.
+IrFunction lower_fixture_source(SourceFixture *fixture, const char *source);
@@ -4,3 +4,29 @@
 
 extern MunitSuite tokenizer_suite;
 extern MunitSuite parser_suite;
+extern MunitSuite hash_cons_suite;
+extern MunitSuite stack_allocator_suite;
+extern MunitSuite concurrent_arena_suite;
+extern MunitSuite tracking_allocator_suite;
+extern MunitSuite array_suite;
+extern MunitSuite hash_map_suite;
+extern MunitSuite small_vector_suite;
+extern MunitSuite interner_suite;
+extern MunitSuite semantic_suite;
+extern MunitSuite ir_suite;
+extern MunitSuite constant_fold_suite;
+extern MunitSuite value_numbering_suite;
+extern MunitSuite dead_code_suite;
+extern MunitSuite comptime_suite;
+extern MunitSuite monomorphize_suite;
+extern MunitSuite vm_suite;
+extern MunitSuite jit_suite;
+extern MunitSuite buffered_writer_suite;
+extern MunitSuite c_backend_suite;
+extern MunitSuite elf_object_suite;
+extern MunitSuite register_allocator_suite;
+extern MunitSuite vectorize_suite;
+extern MunitSuite inliner_suite;
+extern MunitSuite escape_suite;
+extern MunitSuite compile_stats_suite;
+extern MunitSuite trace_suite;
@@ -89,6 +89,64 @@ void assert_assign_equal(Assign expected, Assign actual) {
   assert_expression_equal(*expected.value, *actual.value);
 }
 
+void assert_binary_op_equal(BinaryOp expected, BinaryOp actual) {
+  assert_operator_equal(expected.op, actual.op);
+  assert_expression_equal(*expected.left, *actual.left);
+  assert_expression_equal(*expected.right, *actual.right);
+}
+
+void assert_struct_equal(StructDeclaration expected,
+                         StructDeclaration actual) {
+  assert_span_equal(expected.keyword, actual.keyword);
+  assert_symbol_equal(expected.name, actual.name);
+  assert_uint32(expected.attribute_count, ==, actual.attribute_count);
+  for (uint32_t i = 0; i < expected.attribute_count; ++i) {
+    assert_symbol_equal(expected.attributes[i], actual.attributes[i]);
+  }
+  assert_uint32(expected.field_count, ==, actual.field_count);
+  assert_typed_names_equal(expected.fields, actual.fields,
+                           expected.field_count);
+}
+
+void assert_array_literal_equal(ArrayLiteral expected, ArrayLiteral actual) {
+  assert_uint32(expected.count, ==, actual.count);
+  for (uint32_t i = 0; i < expected.count; ++i) {
+    assert_expression_equal(expected.elements[i], actual.elements[i]);
+  }
+}
+
+void assert_typed_names_equal(const TypedName *expected,
+                              const TypedName *actual, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    assert_expression_equal(*expected[i].type, *actual[i].type);
+    assert_symbol_equal(expected[i].name, actual[i].name);
+  }
+}
+
+void assert_function_equal(Function expected, Function actual) {
+  assert_expression_equal(*expected.return_type, *actual.return_type);
+  assert_symbol_equal(expected.name, actual.name);
+  assert_uint32(expected.type_parameter_count, ==,
+                actual.type_parameter_count);
+  for (uint32_t i = 0; i < expected.type_parameter_count; ++i) {
+    assert_symbol_equal(expected.type_parameters[i],
+                        actual.type_parameters[i]);
+  }
+  assert_uint32(expected.parameter_count, ==, actual.parameter_count);
+  assert_typed_names_equal(expected.parameters, actual.parameters,
+                           expected.parameter_count);
+  assert_span_equal(expected.assign_token, actual.assign_token);
+  assert_expression_equal(*expected.body, *actual.body);
+}
+
+void assert_call_equal(Call expected, Call actual) {
+  assert_expression_equal(*expected.callee, *actual.callee);
+  assert_uint32(expected.argument_count, ==, actual.argument_count);
+  for (uint32_t i = 0; i < expected.argument_count; ++i) {
+    assert_expression_equal(expected.arguments[i], actual.arguments[i]);
+  }
+}
+
 void assert_expression_equal(Expression expected, Expression actual) {
   assert_uint32(expected.kind, ==, actual.kind);
   switch (expected.kind) {
@@ -100,6 +158,27 @@ void assert_expression_equal(Expression expected, Expression actual) {
     return assert_float_equal(expected.value.float_, actual.value.float_);
   case AssignExpression:
     return assert_assign_equal(expected.value.assign, actual.value.assign);
+  case BinaryOpExpression:
+    return assert_binary_op_equal(expected.value.binary_op,
+                                  actual.value.binary_op);
+  case StructExpression:
+    return assert_struct_equal(expected.value.struct_, actual.value.struct_);
+  case ArrayExpression:
+    return assert_array_literal_equal(expected.value.array,
+                                      actual.value.array);
+  case SliceTypeExpression:
+    return assert_expression_equal(*expected.value.slice.element,
+                                   *actual.value.slice.element);
+  case IndexExpression:
+    assert_expression_equal(*expected.value.index.target,
+                            *actual.value.index.target);
+    return assert_expression_equal(*expected.value.index.index,
+                                   *actual.value.index.index);
+  case FunctionExpression:
+    return assert_function_equal(expected.value.function,
+                                 actual.value.function);
+  case CallExpression:
+    return assert_call_equal(expected.value.call, actual.value.call);
   }
 }
 
@@ -0,0 +1,35 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "source_fixture.h"
+#include "lower.h"
+#include <munit.h>
+
+void source_fixture_init(SourceFixture *fixture) {
+  stack_allocator_init(&fixture->stack, 1 << 16);
+  fixture->allocator = (Allocator){.allocate = stack_allocate,
+                                   .resize = stack_resize,
+                                   .state = &fixture->stack};
+  interner_init(&fixture->interner, fixture->allocator);
+  type_table_init(&fixture->types, fixture->allocator);
+  analyzer_init(&fixture->analyzer, fixture->allocator, &fixture->interner,
+                &fixture->types);
+}
+
+Module analyze_fixture_source(SourceFixture *fixture, const char *source) {
+  source_fixture_init(fixture);
+  Parser parser = {.allocator = fixture->allocator};
+  Module module = parse_module(&parser, (Cursor){.input = source}).module;
+  analyze_module(&fixture->analyzer, module);
+  return module;
+}
+
+Module check_fixture_source(SourceFixture *fixture, const char *source) {
+  Module module = analyze_fixture_source(fixture, source);
+  assert_size(fixture->analyzer.diagnostics.length, ==, 0);
+  return module;
+}
+
+IrFunction lower_fixture_source(SourceFixture *fixture, const char *source) {
+  return lower_module(&fixture->analyzer,
+                      check_fixture_source(fixture, source));
+}
@@ -0,0 +1,104 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "allocator.h"
+#include "array.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+
+typedef Array(uint32_t) Uint32Array;
+
+typedef struct {
+  uint32_t x;
+  uint32_t y;
+} Point;
+
+typedef Array(Point) PointArray;
+
+MunitResult push_grows_in_place(const MunitParameter params[],
+                                void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 16);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  Uint32Array array = {};
+  array_push(allocator, &array, 0);
+  uint32_t *first_data = array.data;
+  for (uint32_t i = 1; i < 1000; ++i) {
+    array_push(allocator, &array, i);
+  }
+  assert_ptr_equal(array.data, first_data);
+  assert_size(array.length, ==, 1000);
+  assert_size(array.capacity, >=, 1000);
+  for (uint32_t i = 0; i < 1000; ++i) {
+    assert_uint32(array.data[i], ==, i);
+  }
+  array_shrink_to_fit(allocator, &array);
+  assert_size(array.capacity, ==, 1000);
+  assert_ptr_equal(stack.current_position, array.data + 1000);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult push_copies_when_resize_fails(const MunitParameter params[],
+                                          void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 16);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  PointArray array = {};
+  for (uint32_t i = 0; i < 100; ++i) {
+    array_push(allocator, &array, (Point){.x = i, .y = i * 2});
+    // Something else allocating blocks growth in place.
+    allocate(allocator, uint8_t);
+  }
+  assert_size(array.length, ==, 100);
+  for (uint32_t i = 0; i < 100; ++i) {
+    assert_uint32(array.data[i].x, ==, i);
+    assert_uint32(array.data[i].y, ==, i * 2);
+  }
+  assert_uint32(array_pop(&array).x, ==, 99);
+  assert_uint32(array_last(&array).x, ==, 98);
+  assert_size(array.length, ==, 99);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult append_and_reserve(const MunitParameter params[],
+                               void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  Allocator allocator = {.allocate = stack_allocate, .state = &stack};
+  Uint32Array array = {};
+  array_reserve(allocator, &array, 3);
+  assert_size(array.capacity, >=, 3);
+  uint32_t values[] = {4, 5, 6, 7, 8, 9, 10, 11, 12, 13};
+  array_append(allocator, &array, values, 10);
+  array_append(allocator, &array, values, 10);
+  assert_size(array.length, ==, 20);
+  assert_uint32(array.data[9], ==, 13);
+  assert_uint32(array.data[10], ==, 4);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitTest array_tests[] = {
+    {
+        .name = "/push_grows_in_place",
+        .test = push_grows_in_place,
+    },
+    {
+        .name = "/push_copies_when_resize_fails",
+        .test = push_copies_when_resize_fails,
+    },
+    {
+        .name = "/append_and_reserve",
+        .test = append_and_reserve,
+    },
+    {}};
+
+MunitSuite array_suite = {
+    .prefix = "/array",
+    .tests = array_tests,
+    .iterations = 1,
+};
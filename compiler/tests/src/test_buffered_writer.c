@@ -0,0 +1,86 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "buffered_writer.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Reads back everything written to a temporary file.
+size_t read_back(FILE *file, char *buffer, size_t capacity) {
+  rewind(file);
+  size_t length = fread(buffer, 1, capacity - 1, file);
+  buffer[length] = '\0';
+  return length;
+}
+
+MunitResult small_writes_are_batched(const MunitParameter params[],
+                                     void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  FILE *file = tmpfile();
+  BufferedWriter writer;
+  buffered_writer_init(&writer,
+                       (Allocator){.allocate = stack_allocate, .state = &stack},
+                       fileno(file), 64);
+  buffered_write_string(&writer, "x = ");
+  buffered_write_signed(&writer, INT64_MIN);
+  buffered_write_char(&writer, ' ');
+  buffered_write_unsigned(&writer, UINT64_MAX);
+  buffered_write_format(&writer, " %s%d", "y", 0);
+  char text[256];
+  assert_size(read_back(file, text, sizeof(text)), ==, 0);
+  assert_true(buffered_writer_flush(&writer));
+  read_back(file, text, sizeof(text));
+  assert_string_equal(text,
+                      "x = -9223372036854775808 18446744073709551615 y0");
+  fclose(file);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult writes_larger_than_the_buffer(const MunitParameter params[],
+                                          void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  FILE *file = tmpfile();
+  BufferedWriter writer;
+  buffered_writer_init(&writer,
+                       (Allocator){.allocate = stack_allocate, .state = &stack},
+                       fileno(file), 8);
+  char expected[200] = {};
+  for (size_t i = 0; i < 10; ++i) {
+    buffered_write_string(&writer, "abc");
+    strcat(expected, "abc");
+  }
+  buffered_write_format(&writer, "%s", "a format result over eight bytes");
+  strcat(expected, "a format result over eight bytes");
+  buffered_write_string(&writer, "0123456789abcdef");
+  strcat(expected, "0123456789abcdef");
+  assert_true(buffered_writer_flush(&writer));
+  char text[256];
+  read_back(file, text, sizeof(text));
+  assert_string_equal(text, expected);
+  fclose(file);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitTest buffered_writer_tests[] = {
+    {
+        .name = "/small_writes_are_batched",
+        .test = small_writes_are_batched,
+    },
+    {
+        .name = "/writes_larger_than_the_buffer",
+        .test = writes_larger_than_the_buffer,
+    },
+    {}};
+
+MunitSuite buffered_writer_suite = {
+    .prefix = "/buffered_writer",
+    .tests = buffered_writer_tests,
+    .iterations = 1,
+};
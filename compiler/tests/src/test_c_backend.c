@@ -0,0 +1,172 @@
+#define _DEFAULT_SOURCE
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "buffered_writer.h"
+#include "c_backend.h"
+#include "constant_fold.h"
+#include "source_fixture.h"
+#include "test_suites.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+  SourceFixture source;
+  char text[4096];
+} Fixture;
+
+// Emits the C for function into fixture->text.
+void emit_function(Fixture *fixture, const IrFunction *function,
+                   const TypeTable *types) {
+  FILE *file = tmpfile();
+  BufferedWriter writer;
+  buffered_writer_init(&writer, fixture->source.allocator, fileno(file),
+                       1 << 12);
+  emit_c(&writer, function, types);
+  assert_true(buffered_writer_flush(&writer));
+  rewind(file);
+  size_t length = fread(fixture->text, 1, sizeof(fixture->text) - 1, file);
+  fixture->text[length] = '\0';
+  fclose(file);
+}
+
+// Emits the C for source into fixture->text, folding first when asked.
+void emit_source(Fixture *fixture, const char *source, bool fold) {
+  IrFunction function = lower_fixture_source(&fixture->source, source);
+  if (fold) {
+    fold_constants(fixture->source.allocator, &function,
+                   &fixture->source.types);
+  }
+  emit_function(fixture, &function, &fixture->source.types);
+  stack_allocator_destroy(&fixture->source.stack);
+}
+
+void assert_contains(const char *text, const char *expected) {
+  assert_not_null(strstr(text, expected));
+}
+
+MunitResult maps_types_and_wraps_arithmetic(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+  Fixture fixture;
+  emit_source(&fixture, "i8 a = 100\ni8 b = a * a\nu16 c = 7\nf32 d = 1.5\n"
+                        "f64 e = 2\nbool f = d > 1", false);
+  assert_contains(fixture.text, "static bool yeti_main(void) {\n");
+  assert_contains(fixture.text, "  int8_t v0 = (int8_t)INT64_C(100);\n");
+  assert_contains(fixture.text,
+                  "  int8_t v1 = (int8_t)((uint32_t)v0 * (uint32_t)v0);\n");
+  assert_contains(fixture.text, "  uint16_t v2 = (uint16_t)UINT64_C(7);\n");
+  assert_contains(fixture.text, "  float v3 = 0x1.8p+0f;\n");
+  assert_contains(fixture.text, "  double v4 = 0x1p+1;\n");
+  assert_contains(fixture.text, "  bool v6 = v3 > v5;\n");
+  assert_contains(fixture.text, "  return v6;\n");
+  return MUNIT_OK;
+}
+
+MunitResult guards_division(const MunitParameter params[],
+                            void *user_data_or_fixture) {
+  Fixture fixture;
+  emit_source(&fixture, "i64 a = 7\ni64 b = 2\ni64 c = a / b", false);
+  assert_contains(fixture.text, "v1 == 0 ? (yeti_trap(\"division by zero\")");
+  assert_contains(fixture.text, "v0 == INT64_MIN ? (yeti_trap(\"signed "
+                                "division overflow\")");
+  emit_source(&fixture, "u32 a = 7\nu32 b = a % 2", false);
+  assert_contains(fixture.text,
+                  "  uint32_t v2 = (v1 == 0 ? (yeti_trap(\"division by "
+                  "zero\"), 0) : v0 % v1);\n");
+  return MUNIT_OK;
+}
+
+MunitResult nans_keep_their_bits(const MunitParameter params[],
+                                void *user_data_or_fixture) {
+  Fixture fixture;
+  source_fixture_init(&fixture.source);
+  Allocator allocator = fixture.source.allocator;
+  IrFunction function = {.return_type = F64TypeId};
+  ir_constant(allocator, &function, F32TypeId, 0xffc00123);
+  IrValue wide =
+      ir_constant(allocator, &function, F64TypeId, 0x7ff0000000000042);
+  ir_return(allocator, &function, wide);
+  emit_function(&fixture, &function, &fixture.source.types);
+  assert_contains(fixture.text,
+                  "  float v0 = yeti_f32_from_bits(UINT32_C(0xffc00123));\n");
+  assert_contains(
+      fixture.text,
+      "  double v1 = yeti_f64_from_bits(UINT64_C(0x7ff0000000000042));\n");
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+// Builds the emitted C with the system compiler and checks what the
+// program prints. Skipped where no compiler is installed.
+MunitResult compiled_programs_print_their_result(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  if (system("cc --version > /dev/null 2>&1") != 0) {
+    return MUNIT_SKIP;
+  }
+  static const struct {
+    const char *source;
+    const char *output;
+  } programs[] = {
+      {"i8 a = 100\ni8 b = a + a", "-56\n"},
+      {"u16 a = 65535\nu16 b = a * a", "1\n"},
+      {"f32 x = 16777216\nf32 y = x + 1", "16777216\n"},
+      {"f64 x = 7.5\nf64 y = x % 2 + x / 2", "5.25\n"},
+      {"i32 a = 7\ni32 b = 0 - a\ni32 c = b / 2", "-3\n"},
+      {"f64 z = 0.0\nf64 n = z / z\nbool b = n == n", "false\n"},
+      {"i32x4 a = 5\ni32x4 b = a * a - 100", "[-75, -75, -75, -75]\n"},
+      {"f32x8 a = 1.5\nf32x8 b = a * 2 + a",
+       "[4.5, 4.5, 4.5, 4.5, 4.5, 4.5, 4.5, 4.5]\n"},
+  };
+  for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); ++i) {
+    Fixture fixture;
+    emit_source(&fixture, programs[i].source, i % 2 == 0);
+    char c_path[] = "/tmp/yeti-test-XXXXXX.c";
+    int fd = mkstemps(c_path, 2);
+    assert_int(fd, >=, 0);
+    FILE *file = fdopen(fd, "w");
+    fputs(fixture.text, file);
+    fclose(file);
+    char command[256];
+    snprintf(command, sizeof(command),
+             "cc -std=c2x -O2 -o %.*s %s -lm && %.*s",
+             (int)(strlen(c_path) - 2), c_path, c_path,
+             (int)(strlen(c_path) - 2), c_path);
+    FILE *program = popen(command, "r");
+    char output[64] = {};
+    size_t length = fread(output, 1, sizeof(output) - 1, program);
+    output[length] = '\0';
+    assert_int(pclose(program), ==, 0);
+    assert_string_equal(output, programs[i].output);
+    unlink(c_path);
+    c_path[strlen(c_path) - 2] = '\0';
+    unlink(c_path);
+  }
+  return MUNIT_OK;
+}
+
+MunitTest c_backend_tests[] = {
+    {
+        .name = "/maps_types_and_wraps_arithmetic",
+        .test = maps_types_and_wraps_arithmetic,
+    },
+    {
+        .name = "/guards_division",
+        .test = guards_division,
+    },
+    {
+        .name = "/nans_keep_their_bits",
+        .test = nans_keep_their_bits,
+    },
+    {
+        .name = "/compiled_programs_print_their_result",
+        .test = compiled_programs_print_their_result,
+    },
+    {}};
+
+MunitSuite c_backend_suite = {
+    .prefix = "/c_backend",
+    .tests = c_backend_tests,
+    .iterations = 1,
+};
@@ -0,0 +1,85 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "compile_stats.h"
+#include "test_suites.h"
+#include <munit.h>
+#include <stdio.h>
+#include <string.h>
+
+MunitResult laps_chain_phases(const MunitParameter params[],
+                              void *user_data_or_fixture) {
+  CompileStats stats = {};
+  uint64_t begin = monotonic_ns() - 1000;
+  uint64_t end = compile_stats_lap(&stats, ParsePhase, begin);
+  assert_uint64(stats.nanoseconds[ParsePhase], ==, end - begin);
+  compile_stats_lap(&stats, ParsePhase, end);
+  assert_uint64(stats.nanoseconds[ParsePhase], >=, 1000);
+  assert_uint64(stats.nanoseconds[ReadPhase], ==, 0);
+  return MUNIT_OK;
+}
+
+MunitResult writes_table_and_json(const MunitParameter params[],
+                                  void *user_data_or_fixture) {
+  CompileStats stats = {.nanoseconds = {[LexPhase] = 500000,
+                                        [ParsePhase] = 3000000,
+                                        [CodegenPhase] = 1000000},
+                        .files = 1,
+                        .source_bytes = 120,
+                        .tokens = 40,
+                        .nodes = 25,
+                        .instructions = 12,
+                        .arena_bytes = 4096};
+  char text[2048];
+  FILE *file = tmpfile();
+  compile_stats_write_json(&stats, file);
+  rewind(file);
+  text[fread(text, 1, sizeof(text) - 1, file)] = '\0';
+  assert_string_equal(text, "{\n"
+                            "  \"phases\": {\n"
+                            "    \"read\": {\"nanoseconds\": 0},\n"
+                            "    \"parse\": {\"nanoseconds\": 3000000, "
+                            "\"lex\": {\"nanoseconds\": 500000}},\n"
+                            "    \"analyze\": {\"nanoseconds\": 0},\n"
+                            "    \"lower\": {\"nanoseconds\": 0},\n"
+                            "    \"optimize\": {\"nanoseconds\": 0},\n"
+                            "    \"codegen\": {\"nanoseconds\": 1000000},\n"
+                            "    \"run\": {\"nanoseconds\": 0},\n"
+                            "    \"cc\": {\"nanoseconds\": 0}\n"
+                            "  },\n"
+                            "  \"total_nanoseconds\": 4000000,\n"
+                            "  \"files\": 1,\n"
+                            "  \"source_bytes\": 120,\n"
+                            "  \"tokens\": 40,\n"
+                            "  \"nodes\": 25,\n"
+                            "  \"instructions\": 12,\n"
+                            "  \"arena_bytes\": 4096\n"
+                            "}\n");
+  fclose(file);
+  file = tmpfile();
+  compile_stats_write_table(&stats, file);
+  rewind(file);
+  text[fread(text, 1, sizeof(text) - 1, file)] = '\0';
+  assert_not_null(strstr(text, "parse             3.000 ms   75.0%\n"
+                               "  lex             0.500 ms   12.5%\n"));
+  assert_not_null(strstr(text, "total             4.000 ms\n"));
+  assert_not_null(strstr(text, "arena bytes        4096\n"));
+  fclose(file);
+  return MUNIT_OK;
+}
+
+MunitTest compile_stats_tests[] = {
+    {
+        .name = "/laps_chain_phases",
+        .test = laps_chain_phases,
+    },
+    {
+        .name = "/writes_table_and_json",
+        .test = writes_table_and_json,
+    },
+    {}};
+
+MunitSuite compile_stats_suite = {
+    .prefix = "/compile_stats",
+    .tests = compile_stats_tests,
+    .iterations = 1,
+};
@@ -0,0 +1,213 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "comptime.h"
+#include "constant_fold.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+#include <string.h>
+
+// The language has no function syntax yet, so modules are built by hand.
+typedef struct {
+  StackAllocator stack;
+  Allocator allocator;
+  TypeTable types;
+  IrModule module;
+} Program;
+
+void comptime_program_init(Program *program) {
+  stack_allocator_init(&program->stack, 1 << 20);
+  program->allocator = (Allocator){.allocate = stack_allocate,
+                                   .resize = stack_resize,
+                                   .state = &program->stack};
+  type_table_init(&program->types, program->allocator);
+  program->module = (IrModule){};
+}
+
+// Starts a function taking one i64 parameter, %0.
+IrFunction start_unary(const char *name, Program *program) {
+  IrFunction function = {.name = {.data = name, .length = strlen(name)},
+                         .return_type = I64TypeId};
+  ir_param(program->allocator, &function, I64TypeId);
+  return function;
+}
+
+uint32_t finish_function(Program *program, IrFunction *function,
+                         IrValue value) {
+  ir_return(program->allocator, function, value);
+  ir_end_block(program->allocator, function);
+  array_push(program->allocator, &program->module.functions, *function);
+  return (uint32_t)program->module.functions.length - 1;
+}
+
+IrValue call_unary(Program *program, IrFunction *function, uint32_t callee,
+                   IrValue argument) {
+  return ir_call(program->allocator, function, I64TypeId, callee, &argument,
+                 1);
+}
+
+// f0(x) = f1(x) + f1(x), ..., and the last one returns x * 3, so f0 makes
+// 2^depth calls unless they are memoized.
+void doubling_chain(Program *program, uint32_t depth) {
+  for (uint32_t k = 0; k < depth; ++k) {
+    IrFunction function = start_unary("double", program);
+    IrValue once = call_unary(program, &function, k + 1, 0);
+    IrValue twice = call_unary(program, &function, k + 1, 0);
+    finish_function(program, &function,
+                    ir_binary(program->allocator, &function, AddOp,
+                              I64TypeId, once, twice));
+  }
+  IrFunction leaf = start_unary("triple", program);
+  IrValue three = ir_constant(program->allocator, &leaf, I64TypeId, 3);
+  finish_function(
+      program, &leaf,
+      ir_binary(program->allocator, &leaf, MulOp, I64TypeId, 0, three));
+}
+
+MunitResult memoizes_repeated_calls(const MunitParameter params[],
+                                    void *user_data_or_fixture) {
+  Program program;
+  comptime_program_init(&program);
+  doubling_chain(&program, 40);
+  Comptime comptime;
+  comptime_init(&comptime, program.allocator, &program.module,
+                &program.types, &default_comptime_limits);
+  uint64_t one = 1;
+  ComptimeResult result = comptime_call(&comptime, 0, &one);
+  assert_int(result.status, ==, ComptimeOk);
+  assert_uint64(result.bits, ==, 3ull << 40);
+  // The second call in every function is answered from the memo.
+  assert_size(comptime.stats.memo_hits, ==, 40);
+  assert_uint64(comptime.stats.steps, <, 300);
+  result = comptime_call(&comptime, 0, &one);
+  assert_uint64(result.bits, ==, 3ull << 40);
+  assert_size(comptime.stats.memo_hits, ==, 41);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitResult results_feed_constant_folding(const MunitParameter params[],
+                                          void *user_data_or_fixture) {
+  Program program;
+  comptime_program_init(&program);
+  IrFunction square = start_unary("square", &program);
+  uint32_t callee = finish_function(
+      &program, &square,
+      ir_binary(program.allocator, &square, MulOp, I64TypeId, 0, 0));
+  IrFunction caller = start_unary("main", &program);
+  IrValue seven = ir_constant(program.allocator, &caller, I64TypeId, 7);
+  IrValue squared = call_unary(&program, &caller, callee, seven);
+  // The parameter is only known at run time, so this call stays.
+  call_unary(&program, &caller, callee, 0);
+  IrValue one = ir_constant(program.allocator, &caller, I64TypeId, 1);
+  uint32_t entry = finish_function(
+      &program, &caller,
+      ir_binary(program.allocator, &caller, AddOp, I64TypeId,
+                call_unary(&program, &caller, callee, squared), one));
+  IrFunction *body = &program.module.functions.data[entry];
+  Comptime comptime;
+  comptime_init(&comptime, program.allocator, &program.module,
+                &program.types, &default_comptime_limits);
+  ComptimeStats stats = evaluate_constant_calls(&comptime, &program.module);
+  // square(7) becomes 49, which makes square(49) constant too.
+  assert_uint32(stats.calls, ==, 2);
+  assert_uint32(stats.evaluated, ==, 2);
+  assert_true(ir_verify_module(&program.module, &program.types).valid);
+  assert_size(body->instructions.length, ==, 9);
+  fold_constants(program.allocator, body, &program.types);
+  assert_true(ir_verify_module(&program.module, &program.types).valid);
+  IrInstruction returned = array_last(&body->instructions);
+  IrInstruction result = body->instructions.data[returned.operands[0]];
+  assert_uint32(result.opcode, ==, ConstOp);
+  assert_uint64(ir_constant_bits(result), ==, 49 * 49 + 1);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitResult traps_are_left_to_run_time(const MunitParameter params[],
+                                       void *user_data_or_fixture) {
+  Program program;
+  comptime_program_init(&program);
+  IrFunction reciprocal = start_unary("reciprocal", &program);
+  IrValue hundred =
+      ir_constant(program.allocator, &reciprocal, I64TypeId, 100);
+  finish_function(&program, &reciprocal,
+                  ir_binary(program.allocator, &reciprocal, DivOp, I64TypeId,
+                            hundred, 0));
+  IrFunction remainder = {.return_type = F64TypeId};
+  IrValue x = ir_constant(program.allocator, &remainder, F64TypeId, 0);
+  finish_function(&program, &remainder,
+                  ir_binary(program.allocator, &remainder, ModOp, F64TypeId,
+                            x, x));
+  Comptime comptime;
+  comptime_init(&comptime, program.allocator, &program.module,
+                &program.types, &default_comptime_limits);
+  uint64_t argument = 0;
+  assert_int(comptime_call(&comptime, 0, &argument).status, ==,
+             ComptimeNotConstant);
+  argument = 4;
+  ComptimeResult result = comptime_call(&comptime, 0, &argument);
+  assert_int(result.status, ==, ComptimeOk);
+  assert_uint64(result.bits, ==, 25);
+  assert_int(comptime_call(&comptime, 1, nullptr).status, ==,
+             ComptimeNotConstant);
+  assert_uint32(comptime.stats.not_constant, ==, 2);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitResult limits_stop_evaluation(const MunitParameter params[],
+                                   void *user_data_or_fixture) {
+  Program program;
+  comptime_program_init(&program);
+  // forever(x) = forever(x) + 1 never returns.
+  IrFunction forever = start_unary("forever", &program);
+  IrValue again = call_unary(&program, &forever, 0, 0);
+  IrValue one = ir_constant(program.allocator, &forever, I64TypeId, 1);
+  finish_function(
+      &program, &forever,
+      ir_binary(program.allocator, &forever, AddOp, I64TypeId, again, one));
+  Comptime comptime;
+  ComptimeLimits limits = {.max_steps = UINT64_MAX, .max_memory = 4096};
+  comptime_init(&comptime, program.allocator, &program.module,
+                &program.types, &limits);
+  uint64_t argument = 0;
+  assert_int(comptime_call(&comptime, 0, &argument).status, ==,
+             ComptimeMemoryLimit);
+  assert_uint32(comptime.stats.over_memory_limit, ==, 1);
+  // Frames take five values and the bookkeeping of one frame each.
+  assert_uint64(comptime.stats.steps, <=, 4096 / 40 * 3);
+  limits = (ComptimeLimits){.max_steps = 1000, .max_memory = 1 << 30};
+  comptime_init(&comptime, program.allocator, &program.module,
+                &program.types, &limits);
+  assert_int(comptime_call(&comptime, 0, &argument).status, ==,
+             ComptimeStepLimit);
+  assert_uint64(comptime.stats.steps, ==, 1001);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitTest comptime_tests[] = {
+    {
+        .name = "/memoizes_repeated_calls",
+        .test = memoizes_repeated_calls,
+    },
+    {
+        .name = "/results_feed_constant_folding",
+        .test = results_feed_constant_folding,
+    },
+    {
+        .name = "/traps_are_left_to_run_time",
+        .test = traps_are_left_to_run_time,
+    },
+    {
+        .name = "/limits_stop_evaluation",
+        .test = limits_stop_evaluation,
+    },
+    {}};
+
+MunitSuite comptime_suite = {
+    .prefix = "/comptime",
+    .tests = comptime_tests,
+    .iterations = 1,
+};
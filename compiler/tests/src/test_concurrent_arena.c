@@ -0,0 +1,140 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "allocator.h"
+#include "concurrent_arena.h"
+#include "test_suites.h"
+#include <stdint.h>
+#include <string.h>
+#include <threads.h>
+
+MunitResult allocations_are_aligned_and_disjoint(const MunitParameter params[],
+                                                 void *user_data_or_fixture) {
+  ConcurrentArena arena;
+  concurrent_arena_init(&arena, 256);
+  uint8_t *addresses[100];
+  for (size_t i = 0; i < 100; ++i) {
+    size_t alignment = 1 << (i % 4);
+    addresses[i] = concurrent_arena_allocate(&arena, 3, alignment);
+    assert_size((size_t)addresses[i] % alignment, ==, 0);
+    memset(addresses[i], (int)i, 3);
+  }
+  for (size_t i = 0; i < 100; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      assert_uint8(addresses[i][j], ==, i);
+    }
+  }
+  uint8_t *large = concurrent_arena_allocate(&arena, 1000, 16);
+  assert_size((size_t)large % 16, ==, 0);
+  large[999] = 1;
+  concurrent_arena_destroy(&arena);
+  return MUNIT_OK;
+}
+
+MunitResult thread_cache_refills_from_arena(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+  ConcurrentArena arena;
+  concurrent_arena_init(&arena, 1024);
+  ArenaThreadCache cache;
+  arena_thread_cache_init(&cache, &arena, 256);
+  Allocator allocator = {.allocate = arena_thread_cache_allocate,
+                         .state = &cache};
+  uint64_t *values[200];
+  for (size_t i = 0; i < 200; ++i) {
+    values[i] = allocate(allocator, uint64_t);
+    *values[i] = i;
+  }
+  for (size_t i = 0; i < 200; ++i) {
+    assert_uint64(*values[i], ==, i);
+  }
+  concurrent_arena_destroy(&arena);
+  return MUNIT_OK;
+}
+
+MunitResult resizes_most_recent_allocation_in_place(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  ConcurrentArena arena;
+  concurrent_arena_init(&arena, 1024);
+  ArenaThreadCache cache;
+  arena_thread_cache_init(&cache, &arena, 256);
+  uint8_t *block = arena_thread_cache_allocate(&cache, 16, 8);
+  assert_true(arena_thread_cache_resize(&cache, block, 16, 48));
+  assert_ptr_equal(cache.current_position, block + 48);
+  uint8_t *other = arena_thread_cache_allocate(&cache, 8, 8);
+  assert_ptr_equal(other, block + 48);
+  assert_false(arena_thread_cache_resize(&cache, block, 48, 64));
+  uint8_t *shared = concurrent_arena_allocate(&arena, 16, 8);
+  assert_true(concurrent_arena_resize(&arena, shared, 16, 32));
+  assert_false(concurrent_arena_resize(&arena, shared, 32, 4096));
+  concurrent_arena_destroy(&arena);
+  return MUNIT_OK;
+}
+
+enum { WORKER_COUNT = 8, ALLOCATIONS_PER_WORKER = 10000 };
+
+typedef struct {
+  ConcurrentArena *arena;
+  uint32_t id;
+  uint32_t *values[ALLOCATIONS_PER_WORKER];
+} Worker;
+
+int32_t worker_main(void *state) {
+  Worker *worker = state;
+  ArenaThreadCache cache;
+  arena_thread_cache_init(&cache, worker->arena, 4096);
+  Allocator allocator = {.allocate = arena_thread_cache_allocate,
+                         .state = &cache};
+  for (uint32_t i = 0; i < ALLOCATIONS_PER_WORKER; ++i) {
+    worker->values[i] = allocate(allocator, uint32_t);
+    *worker->values[i] = worker->id * ALLOCATIONS_PER_WORKER + i;
+  }
+  return 0;
+}
+
+MunitResult threads_share_one_arena(const MunitParameter params[],
+                                    void *user_data_or_fixture) {
+  ConcurrentArena arena;
+  concurrent_arena_init(&arena, 1 << 16);
+  static Worker workers[WORKER_COUNT];
+  thrd_t threads[WORKER_COUNT];
+  for (uint32_t i = 0; i < WORKER_COUNT; ++i) {
+    workers[i] = (Worker){.arena = &arena, .id = i};
+    assert_int(thrd_create(&threads[i], worker_main, &workers[i]), ==,
+               thrd_success);
+  }
+  for (uint32_t i = 0; i < WORKER_COUNT; ++i) {
+    thrd_join(threads[i], nullptr);
+  }
+  for (uint32_t i = 0; i < WORKER_COUNT; ++i) {
+    for (uint32_t j = 0; j < ALLOCATIONS_PER_WORKER; ++j) {
+      assert_uint32(*workers[i].values[j], ==, i * ALLOCATIONS_PER_WORKER + j);
+    }
+  }
+  concurrent_arena_destroy(&arena);
+  return MUNIT_OK;
+}
+
+MunitTest concurrent_arena_tests[] = {
+    {
+        .name = "/allocations_are_aligned_and_disjoint",
+        .test = allocations_are_aligned_and_disjoint,
+    },
+    {
+        .name = "/thread_cache_refills_from_arena",
+        .test = thread_cache_refills_from_arena,
+    },
+    {
+        .name = "/resizes_most_recent_allocation_in_place",
+        .test = resizes_most_recent_allocation_in_place,
+    },
+    {
+        .name = "/threads_share_one_arena",
+        .test = threads_share_one_arena,
+    },
+    {}};
+
+MunitSuite concurrent_arena_suite = {
+    .prefix = "/concurrent_arena",
+    .tests = concurrent_arena_tests,
+    .iterations = 1,
+};
@@ -0,0 +1,131 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "constant_fold.h"
+#include "source_fixture.h"
+#include "test_suites.h"
+#include <string.h>
+
+typedef struct {
+  SourceFixture source;
+  IrFunction function;
+  ConstantFoldStats stats;
+} Fixture;
+
+void fold_source(Fixture *fixture, const char *source) {
+  fixture->function = lower_fixture_source(&fixture->source, source);
+  fixture->stats = fold_constants(fixture->source.allocator,
+                                  &fixture->function, &fixture->source.types);
+  assert_true(ir_verify(&fixture->function, &fixture->source.types).valid);
+}
+
+// The constant returned by a function that folded down to one value.
+uint64_t returned_constant(Fixture *fixture) {
+  IrInstructionArray instructions = fixture->function.instructions;
+  assert_size(instructions.length, ==, 2);
+  assert_uint32(instructions.data[0].opcode, ==, ConstOp);
+  assert_uint32(instructions.data[1].opcode, ==, ReturnOp);
+  return ir_constant_bits(instructions.data[0]);
+}
+
+MunitResult folds_through_bindings(const MunitParameter params[],
+                                   void *user_data_or_fixture) {
+  Fixture fixture;
+  fold_source(&fixture, "f64 x = 42\nf64 y = x * 1.5 + x\nf64 z = y - 5");
+  double value;
+  uint64_t bits = returned_constant(&fixture);
+  memcpy(&value, &bits, sizeof(value));
+  assert_double(value, ==, 100.0);
+  assert_size(fixture.stats.folded, ==, 3);
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult integers_wrap_at_declared_width(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+  Fixture fixture;
+  fold_source(&fixture, "u8 x = 200\nu8 y = x + 100");
+  assert_uint64(returned_constant(&fixture), ==, 44);
+  stack_allocator_destroy(&fixture.source.stack);
+  fold_source(&fixture, "i8 a = 100\ni8 b = a + a");
+  assert_uint64(returned_constant(&fixture), ==, 0xc8);
+  stack_allocator_destroy(&fixture.source.stack);
+  fold_source(&fixture, "i16 a = 7\ni16 b = 0 - a\ni16 c = b / 2");
+  assert_uint64(returned_constant(&fixture), ==, 0xfffd);
+  stack_allocator_destroy(&fixture.source.stack);
+  fold_source(&fixture, "u32 a = 1\nbool b = 0 - a > a");
+  assert_uint64(returned_constant(&fixture), ==, 1);
+  stack_allocator_destroy(&fixture.source.stack);
+  fold_source(&fixture, "i32 a = 1\nbool b = 0 - a > a");
+  assert_uint64(returned_constant(&fixture), ==, 0);
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult f32_rounds_every_step(const MunitParameter params[],
+                                  void *user_data_or_fixture) {
+  Fixture fixture;
+  fold_source(&fixture, "f32 x = 16777216\nf32 y = x + 1");
+  float value;
+  uint32_t bits = (uint32_t)returned_constant(&fixture);
+  memcpy(&value, &bits, sizeof(value));
+  assert_float(value, ==, 16777216.0f);
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult trapping_division_is_left_alone(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+  Fixture fixture;
+  fold_source(&fixture, "i32 x = 0\ni32 y = 1 / x");
+  assert_size(fixture.stats.folded, ==, 0);
+  assert_size(fixture.function.instructions.length, ==, 4);
+  assert_uint32(fixture.function.instructions.data[2].opcode, ==, DivOp);
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult vector_broadcasts_fold_per_lane(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+  Fixture fixture;
+  fold_source(&fixture, "i32x8 a = 2147483647\ni32x8 b = a + 1");
+  assert_uint64(returned_constant(&fixture), ==, 0x80000000);
+  assert_uint32(fixture.function.instructions.data[0].type, ==, I32x8TypeId);
+  stack_allocator_destroy(&fixture.source.stack);
+  fold_source(&fixture, "f32x4 a = 1\nf32x4 b = a / 4");
+  uint32_t narrow = (uint32_t)returned_constant(&fixture);
+  float value;
+  memcpy(&value, &narrow, sizeof(value));
+  assert_float(value, ==, 0.25f);
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitTest constant_fold_tests[] = {
+    {
+        .name = "/folds_through_bindings",
+        .test = folds_through_bindings,
+    },
+    {
+        .name = "/integers_wrap_at_declared_width",
+        .test = integers_wrap_at_declared_width,
+    },
+    {
+        .name = "/f32_rounds_every_step",
+        .test = f32_rounds_every_step,
+    },
+    {
+        .name = "/trapping_division_is_left_alone",
+        .test = trapping_division_is_left_alone,
+    },
+    {
+        .name = "/vector_broadcasts_fold_per_lane",
+        .test = vector_broadcasts_fold_per_lane,
+    },
+    {}};
+
+MunitSuite constant_fold_suite = {
+    .prefix = "/constant_fold",
+    .tests = constant_fold_tests,
+    .iterations = 1,
+};
@@ -0,0 +1,129 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "bytecode.h"
+#include "dead_code.h"
+#include "source_fixture.h"
+#include "test_suites.h"
+#include "vm.h"
+
+typedef struct {
+  SourceFixture source;
+  IrFunction function;
+  DeadCodeStats stats;
+} Fixture;
+
+// Lowers without constant folding, runs the pass and checks the result
+// still verifies.
+void eliminate_source(Fixture *fixture, const char *source) {
+  fixture->function = lower_fixture_source(&fixture->source, source);
+  fixture->stats = eliminate_dead_code(
+      fixture->source.allocator, &fixture->function, &fixture->source.types);
+  assert_true(ir_verify(&fixture->function, &fixture->source.types).valid);
+}
+
+VmResult run_pruned(Fixture *fixture) {
+  BytecodeFunction bytecode = compile_bytecode(
+      fixture->source.allocator, &fixture->function, &fixture->source.types);
+  uint64_t registers[64];
+  assert_uint32(bytecode.register_count, <=, 64);
+  return vm_run(&bytecode, registers);
+}
+
+MunitResult removes_unused_chains(const MunitParameter params[],
+                                  void *user_data_or_fixture) {
+  Fixture fixture;
+  eliminate_source(&fixture,
+                   "i64 a = 5\ni64 unused = a * 3 + 1\ni64 b = a + 2");
+  // 3, the mul, 1 and the add go; the chain is released from its end.
+  assert_size(fixture.stats.removed, ==, 4);
+  assert_size(fixture.function.instructions.length, ==, 4);
+  VmResult result = run_pruned(&fixture);
+  assert_int(result.status, ==, VmOk);
+  assert_uint64(result.value, ==, 7);
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult division_that_may_trap_is_kept(const MunitParameter params[],
+                                           void *user_data_or_fixture) {
+  Fixture fixture;
+  eliminate_source(&fixture, "i64 a = 5\ni64 zero = 0\ni64 q = a / zero\n"
+                             "i64 h = a / 2\nf64 f = 1.5 / 0\ni64 b = a + 1");
+  // a / 2 and 1.5 / 0 cannot trap, so they go with their constants.
+  assert_size(fixture.stats.removed, ==, 5);
+  size_t divisions = 0;
+  for (size_t i = 0; i < fixture.function.instructions.length; ++i) {
+    divisions += fixture.function.instructions.data[i].opcode == DivOp;
+  }
+  assert_size(divisions, ==, 1);
+  assert_int(run_pruned(&fixture).status, ==, VmDivisionByZero);
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult index_bounds_checks_are_kept(const MunitParameter params[],
+                                         void *user_data_or_fixture) {
+  Fixture fixture;
+  eliminate_source(&fixture, "[]i64 xs = [1, 2]\ni64 unused = xs[5]\n"
+                             "i64 b = 3");
+  // The element load goes but the check of 5 against the length stays.
+  size_t checks = 0;
+  size_t loads = 0;
+  for (size_t i = 0; i < fixture.function.instructions.length; ++i) {
+    checks += fixture.function.instructions.data[i].opcode == BoundsOp;
+    loads += fixture.function.instructions.data[i].opcode == LoadOp;
+  }
+  assert_size(checks, ==, 1);
+  assert_size(loads, ==, 1);
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult calls_and_parameters_are_kept(const MunitParameter params[],
+                                          void *user_data_or_fixture) {
+  Fixture fixture;
+  eliminate_source(&fixture, "i64 x = 1");
+  Allocator allocator = fixture.source.allocator;
+  IrFunction function = {.return_type = I64TypeId};
+  IrValue x = ir_param(allocator, &function, I64TypeId);
+  ir_param(allocator, &function, I64TypeId);
+  IrValue doubled = ir_binary(allocator, &function, AddOp, I64TypeId, x, x);
+  ir_call(allocator, &function, I64TypeId, 0, &doubled, 1);
+  ir_binary(allocator, &function, MulOp, I64TypeId, x, x);
+  ir_return(allocator, &function, x);
+  ir_end_block(allocator, &function);
+  DeadCodeStats stats =
+      eliminate_dead_code(allocator, &function, &fixture.source.types);
+  // Only the mul goes; the call may have effects and reads the add.
+  assert_size(stats.removed, ==, 1);
+  assert_size(function.instructions.length, ==, 6);
+  assert_true(ir_verify(&function, &fixture.source.types).valid);
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitTest dead_code_tests[] = {
+    {
+        .name = "/removes_unused_chains",
+        .test = removes_unused_chains,
+    },
+    {
+        .name = "/division_that_may_trap_is_kept",
+        .test = division_that_may_trap_is_kept,
+    },
+    {
+        .name = "/index_bounds_checks_are_kept",
+        .test = index_bounds_checks_are_kept,
+    },
+    {
+        .name = "/calls_and_parameters_are_kept",
+        .test = calls_and_parameters_are_kept,
+    },
+    {}};
+
+MunitSuite dead_code_suite = {
+    .prefix = "/dead_code",
+    .tests = dead_code_tests,
+    .iterations = 1,
+};
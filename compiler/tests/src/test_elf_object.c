@@ -0,0 +1,178 @@
+#define _DEFAULT_SOURCE
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "buffered_writer.h"
+#include "elf_object.h"
+#include "source_fixture.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+#include "x64.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+uint64_t read_le(const uint8_t *bytes, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = size; i > 0; --i) {
+    value = value << 8 | bytes[i - 1];
+  }
+  return value;
+}
+
+// Writes an object for code into a temporary file named by path.
+void write_object(char *path, const X64Code *code, Allocator allocator) {
+  int fd = mkstemps(path, 2);
+  assert_int(fd, >=, 0);
+  BufferedWriter writer;
+  buffered_writer_init(&writer, allocator, fd, 1 << 12);
+  write_elf_object(&writer, code, "yeti_main");
+  assert_true(buffered_writer_flush(&writer));
+  close(fd);
+}
+
+X64Code compile_to_x64(SourceFixture *fixture, const char *source) {
+  IrFunction function = lower_fixture_source(fixture, source);
+  X64CompileResult compiled =
+      x64_compile(fixture->allocator, &function, &fixture->types);
+  assert_true(compiled.supported);
+  return compiled.code;
+}
+
+MunitResult header_describes_a_relocatable_object(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 16);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  X64Code code = {};
+  uint8_t ret = 0xc3;
+  array_push(allocator, &code.bytes, ret);
+  char path[] = "/tmp/yeti-test-XXXXXX.o";
+  write_object(path, &code, allocator);
+  uint8_t bytes[1024];
+  FILE *file = fopen(path, "rb");
+  size_t length = fread(bytes, 1, sizeof(bytes), file);
+  fclose(file);
+  unlink(path);
+  assert_memory_equal(4, bytes, "\x7f" "ELF");
+  assert_uint8(bytes[4], ==, 2);
+  assert_uint8(bytes[5], ==, 1);
+  assert_uint64(read_le(bytes + 16, 2), ==, 1);
+  assert_uint64(read_le(bytes + 18, 2), ==, 62);
+  uint64_t section_headers = read_le(bytes + 40, 8);
+  uint64_t section_count = read_le(bytes + 60, 2);
+  assert_uint64(section_headers + section_count * 64, ==, length);
+  // Section 1 is .text, holding just the ret.
+  const uint8_t *text = bytes + section_headers + 64;
+  assert_uint64(read_le(text + 24, 8), ==, 64);
+  assert_uint64(read_le(text + 32, 8), ==, 1);
+  assert_uint8(bytes[64], ==, 0xc3);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+// Reads everything command prints into output.
+int capture_command(const char *command, char *output, size_t capacity) {
+  FILE *pipe = popen(command, "r");
+  size_t length = fread(output, 1, capacity - 1, pipe);
+  output[length] = '\0';
+  return pclose(pipe);
+}
+
+MunitResult readelf_lists_symbols_and_relocations(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  if (system("readelf --version > /dev/null 2>&1") != 0) {
+    return MUNIT_SKIP;
+  }
+  SourceFixture fixture;
+  X64Code code =
+      compile_to_x64(&fixture, "f64 x = 7.5\nf64 y = x % 2\nf32 z = 3\n"
+                               "f32 w = z % 2");
+  char path[] = "/tmp/yeti-test-XXXXXX.o";
+  write_object(path, &code, fixture.allocator);
+  char command[128];
+  snprintf(command, sizeof(command), "readelf -W -h -s -r %s 2>&1", path);
+  char output[4096];
+  assert_int(capture_command(command, output, sizeof(output)), ==, 0);
+  unlink(path);
+  assert_not_null(strstr(output, "REL (Relocatable file)"));
+  assert_not_null(strstr(output, "Advanced Micro Devices X86-64"));
+  assert_not_null(strstr(output, "FUNC    GLOBAL DEFAULT    1 yeti_main"));
+  assert_not_null(strstr(output, "NOTYPE  GLOBAL DEFAULT  UND fmod\n"));
+  assert_not_null(strstr(output, "NOTYPE  GLOBAL DEFAULT  UND fmodf\n"));
+  assert_not_null(strstr(output, "R_X86_64_GOTPCREL      0000000000000000 "
+                                 "fmod - 4"));
+  assert_null(strstr(output, "Warning"));
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+// Links the object against a small C main with the system compiler and
+// runs the result. Skipped where no compiler is installed or the code
+// cannot run.
+MunitResult object_links_with_the_system_linker(
+    const MunitParameter params[], void *user_data_or_fixture) {
+#ifndef __x86_64__
+  return MUNIT_SKIP;
+#endif
+  if (system("cc --version > /dev/null 2>&1") != 0) {
+    return MUNIT_SKIP;
+  }
+  SourceFixture fixture;
+  X64Code code = compile_to_x64(&fixture, "f64 x = 7.5\nf64 y = x % 2");
+  char object_path[] = "/tmp/yeti-test-XXXXXX.o";
+  write_object(object_path, &code, fixture.allocator);
+  char main_path[] = "/tmp/yeti-test-XXXXXX.c";
+  int fd = mkstemps(main_path, 2);
+  assert_int(fd, >=, 0);
+  FILE *file = fdopen(fd, "w");
+  fputs("#include <stdint.h>\n#include <stdio.h>\n#include <string.h>\n"
+        "int yeti_main(uint64_t *result);\n"
+        "int main(void) {\n"
+        "  uint64_t bits;\n"
+        "  int status = yeti_main(&bits);\n"
+        "  double value;\n"
+        "  memcpy(&value, &bits, sizeof(value));\n"
+        "  printf(\"%d %g\\n\", status, value);\n"
+        "}\n",
+        file);
+  fclose(file);
+  char executable[sizeof(object_path)];
+  strcpy(executable, object_path);
+  executable[strlen(executable) - 2] = '\0';
+  char command[256];
+  snprintf(command, sizeof(command), "cc -o %s %s %s -lm 2>&1 && %s",
+           executable, main_path, object_path, executable);
+  char output[1024];
+  int status = capture_command(command, output, sizeof(output));
+  unlink(object_path);
+  unlink(main_path);
+  unlink(executable);
+  assert_int(status, ==, 0);
+  assert_string_equal(output, "0 1.5\n");
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitTest elf_object_tests[] = {
+    {
+        .name = "/header_describes_a_relocatable_object",
+        .test = header_describes_a_relocatable_object,
+    },
+    {
+        .name = "/readelf_lists_symbols_and_relocations",
+        .test = readelf_lists_symbols_and_relocations,
+    },
+    {
+        .name = "/object_links_with_the_system_linker",
+        .test = object_links_with_the_system_linker,
+    },
+    {}};
+
+MunitSuite elf_object_suite = {
+    .prefix = "/elf_object",
+    .tests = elf_object_tests,
+    .iterations = 1,
+};
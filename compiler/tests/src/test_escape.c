@@ -0,0 +1,213 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "escape.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+#include <string.h>
+
+// The language has no allocation syntax yet, so modules are built by hand.
+typedef struct {
+  StackAllocator stack;
+  Allocator allocator;
+  TypeTable types;
+  IrModule module;
+} EscapeProgram;
+
+void escape_program_init(EscapeProgram *program) {
+  stack_allocator_init(&program->stack, 1 << 16);
+  program->allocator = (Allocator){.allocate = stack_allocate,
+                                   .resize = stack_resize,
+                                   .state = &program->stack};
+  type_table_init(&program->types, program->allocator);
+  program->module = (IrModule){};
+}
+
+IrFunction start_function(const char *name, uint32_t parameters,
+                          TypeId return_type, EscapeProgram *program) {
+  IrFunction function = {.name = {.data = name, .length = strlen(name)},
+                         .return_type = return_type};
+  for (uint32_t i = 0; i < parameters; ++i) {
+    ir_param(program->allocator, &function, U64TypeId);
+  }
+  return function;
+}
+
+uint32_t close_function(EscapeProgram *program, IrFunction *function,
+                        IrValue value) {
+  ir_return(program->allocator, function, value);
+  ir_end_block(program->allocator, function);
+  array_push(program->allocator, &program->module.functions, *function);
+  return (uint32_t)program->module.functions.length - 1;
+}
+
+IrValue heap_alloc(EscapeProgram *program, IrFunction *function,
+                   uint64_t bytes) {
+  IrValue size = ir_constant(program->allocator, function, U64TypeId, bytes);
+  return ir_alloc(program->allocator, function, HeapAllocation, size);
+}
+
+IrValue store_constant(EscapeProgram *program, IrFunction *function,
+                       IrValue address, int64_t value) {
+  IrValue bits = ir_constant(program->allocator, function, I64TypeId,
+                             (uint64_t)value);
+  ir_store(program->allocator, function, address, bits);
+  return bits;
+}
+
+IrAllocation allocation_of(EscapeProgram *program, uint32_t function,
+                           IrValue value) {
+  IrInstruction instruction =
+      program->module.functions.data[function].instructions.data[value];
+  assert_uint32(instruction.opcode, ==, AllocOp);
+  return (IrAllocation)instruction.lane;
+}
+
+MunitResult local_allocations_move_to_stack(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+  EscapeProgram program;
+  escape_program_init(&program);
+  Allocator allocator = program.allocator;
+  IrFunction body = start_function("main", 0, I64TypeId, &program);
+  IrValue pair = heap_alloc(&program, &body, 16);
+  store_constant(&program, &body, pair, 5);
+  IrValue eight = ir_constant(allocator, &body, U64TypeId, 8);
+  IrValue second = ir_binary(allocator, &body, AddOp, U64TypeId, pair, eight);
+  store_constant(&program, &body, second, 7);
+  IrValue first = ir_load(allocator, &body, I64TypeId, pair);
+  IrValue sum = ir_binary(allocator, &body, AddOp, I64TypeId, first,
+                          ir_load(allocator, &body, I64TypeId, second));
+  uint32_t entry = close_function(&program, &body, sum);
+  assert_true(ir_verify_module(&program.module, &program.types).valid);
+  EscapeStats stats = promote_allocations(allocator, &program.module,
+                                          &default_escape_options);
+  assert_uint32(stats.allocations, ==, 1);
+  assert_uint32(stats.to_stack, ==, 1);
+  assert_uint32(allocation_of(&program, entry, pair), ==, StackAllocation);
+  assert_true(ir_verify_module(&program.module, &program.types).valid);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitResult size_decides_stack_or_arena(const MunitParameter params[],
+                                        void *user_data_or_fixture) {
+  EscapeProgram program;
+  escape_program_init(&program);
+  Allocator allocator = program.allocator;
+  IrFunction body = start_function("main", 1, I64TypeId, &program);
+  IrValue small = heap_alloc(&program, &body, 64);
+  IrValue large = heap_alloc(&program, &body, 4096);
+  IrValue dynamic = ir_alloc(allocator, &body, HeapAllocation, 0);
+  store_constant(&program, &body, small, 1);
+  store_constant(&program, &body, large, 2);
+  store_constant(&program, &body, dynamic, 3);
+  uint32_t entry = close_function(
+      &program, &body, ir_load(allocator, &body, I64TypeId, large));
+  EscapeStats stats = promote_allocations(allocator, &program.module,
+                                          &default_escape_options);
+  assert_uint32(stats.to_stack, ==, 1);
+  assert_uint32(stats.to_arena, ==, 2);
+  assert_uint32(allocation_of(&program, entry, small), ==, StackAllocation);
+  assert_uint32(allocation_of(&program, entry, large), ==, ArenaAllocation);
+  assert_uint32(allocation_of(&program, entry, dynamic), ==, ArenaAllocation);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitResult escaping_allocations_stay_on_heap(const MunitParameter params[],
+                                              void *user_data_or_fixture) {
+  EscapeProgram program;
+  escape_program_init(&program);
+  Allocator allocator = program.allocator;
+  // keep(x) stores x into memory it allocates; peek(x) only reads it.
+  IrFunction keep = start_function("keep", 1, I64TypeId, &program);
+  IrValue cell = heap_alloc(&program, &keep, 8);
+  ir_store(allocator, &keep, cell, 0);
+  uint32_t kept = close_function(
+      &program, &keep, ir_load(allocator, &keep, I64TypeId, cell));
+  IrFunction peek = start_function("peek", 1, I64TypeId, &program);
+  uint32_t peeked = close_function(
+      &program, &peek, ir_load(allocator, &peek, I64TypeId, 0));
+  IrFunction body = start_function("main", 0, I64TypeId, &program);
+  IrValue stored = heap_alloc(&program, &body, 8);
+  IrValue holder = heap_alloc(&program, &body, 8);
+  ir_store(allocator, &body, holder, stored);
+  IrValue passed = heap_alloc(&program, &body, 8);
+  store_constant(&program, &body, passed, 1);
+  ir_call(allocator, &body, I64TypeId, kept, &passed, 1);
+  IrValue read = heap_alloc(&program, &body, 8);
+  store_constant(&program, &body, read, 2);
+  IrValue result = ir_call(allocator, &body, I64TypeId, peeked, &read, 1);
+  uint32_t entry = close_function(&program, &body, result);
+  assert_true(ir_verify_module(&program.module, &program.types).valid);
+  EscapeStats stats = promote_allocations(allocator, &program.module,
+                                          &default_escape_options);
+  assert_uint32(stats.allocations, ==, 5);
+  assert_uint32(stats.escaping, ==, 2);
+  assert_uint32(allocation_of(&program, kept, cell), ==, StackAllocation);
+  assert_uint32(allocation_of(&program, entry, stored), ==, HeapAllocation);
+  assert_uint32(allocation_of(&program, entry, holder), ==, StackAllocation);
+  assert_uint32(allocation_of(&program, entry, passed), ==, HeapAllocation);
+  assert_uint32(allocation_of(&program, entry, read), ==, StackAllocation);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitResult returned_allocations_use_callers_arena(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  EscapeProgram program;
+  escape_program_init(&program);
+  Allocator allocator = program.allocator;
+  // make() returns a fresh cell that main only reads; main stores the
+  // cell share() returns, which can leave main that way.
+  IrFunction make = start_function("make", 0, U64TypeId, &program);
+  IrValue made = heap_alloc(&program, &make, 8);
+  store_constant(&program, &make, made, 42);
+  uint32_t maker = close_function(&program, &make, made);
+  IrFunction share = start_function("share", 0, U64TypeId, &program);
+  IrValue shared = heap_alloc(&program, &share, 8);
+  uint32_t sharer = close_function(&program, &share, shared);
+  IrFunction body = start_function("main", 0, I64TypeId, &program);
+  IrValue cell = ir_call(allocator, &body, U64TypeId, maker, nullptr, 0);
+  IrValue box = heap_alloc(&program, &body, 8);
+  ir_store(allocator, &body, box,
+           ir_call(allocator, &body, U64TypeId, sharer, nullptr, 0));
+  uint32_t entry = close_function(
+      &program, &body, ir_load(allocator, &body, I64TypeId, cell));
+  assert_true(ir_verify_module(&program.module, &program.types).valid);
+  EscapeStats stats = promote_allocations(allocator, &program.module,
+                                          &default_escape_options);
+  assert_uint32(stats.allocations, ==, 3);
+  assert_uint32(stats.to_arena, ==, 1);
+  assert_uint32(stats.escaping, ==, 1);
+  assert_uint32(allocation_of(&program, maker, made), ==, ArenaAllocation);
+  assert_uint32(allocation_of(&program, sharer, shared), ==, HeapAllocation);
+  assert_uint32(allocation_of(&program, entry, box), ==, StackAllocation);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitTest escape_tests[] = {
+    {
+        .name = "/local_allocations_move_to_stack",
+        .test = local_allocations_move_to_stack,
+    },
+    {
+        .name = "/size_decides_stack_or_arena",
+        .test = size_decides_stack_or_arena,
+    },
+    {
+        .name = "/escaping_allocations_stay_on_heap",
+        .test = escaping_allocations_stay_on_heap,
+    },
+    {
+        .name = "/returned_allocations_use_callers_arena",
+        .test = returned_allocations_use_callers_arena,
+    },
+    {}};
+
+MunitSuite escape_suite = {
+    .prefix = "/escape",
+    .tests = escape_tests,
+    .iterations = 1,
+};
@@ -0,0 +1,125 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "hash_cons.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+
+MunitResult leaves_are_keyed_by_kind_and_text(const MunitParameter params[],
+                                              void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  HashConsTable table;
+  hash_cons_table_init(
+      &table, (Allocator){.allocate = stack_allocate, .state = &stack});
+  const char *source = "42 42 42.0 x";
+  Expression *first = hash_cons(
+      &table, (Expression){.kind = IntExpression,
+                           .value.int_ = {.view = {.data = source,
+                                                   .length = 2}}});
+  Expression *second = hash_cons(
+      &table,
+      (Expression){.kind = IntExpression,
+                   .value.int_ = {.span = {.begin.column = 3},
+                                  .view = {.data = source + 3, .length = 2}}});
+  Expression *float_ = hash_cons(
+      &table, (Expression){.kind = FloatExpression,
+                           .value.float_ = {.view = {.data = source + 6,
+                                                     .length = 4}}});
+  Expression *symbol = hash_cons(
+      &table,
+      (Expression){.kind = SymbolExpression,
+                   .value.symbol = {.view = {.data = source + 11,
+                                             .length = 1}}});
+  assert_ptr_equal(first, second);
+  assert_uint32(second->value.int_.span.begin.column, ==, 0);
+  assert_ptr_not_equal(first, float_);
+  assert_ptr_not_equal(first, symbol);
+  assert_size(table.hits, ==, 1);
+  assert_size(table.nodes.length, ==, 3);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult interior_nodes_compare_children_by_address(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  HashConsTable table;
+  hash_cons_table_init(
+      &table, (Allocator){.allocate = stack_allocate, .state = &stack});
+  Expression *type = hash_cons(
+      &table,
+      (Expression){.kind = SymbolExpression,
+                   .value.symbol = {.view = {.data = "f32", .length = 3}}});
+  Expression *value = hash_cons(
+      &table, (Expression){.kind = IntExpression,
+                           .value.int_ = {.view = {.data = "1", .length = 1}}});
+  Expression assign = {
+      .kind = AssignExpression,
+      .value.assign = {.type = type,
+                       .name = {.view = {.data = "x", .length = 1}},
+                       .value = value},
+  };
+  Expression *first = hash_cons(&table, assign);
+  Expression *second = hash_cons(&table, assign);
+  assign.value.assign.name.view = (StringView){.data = "y", .length = 1};
+  Expression *renamed = hash_cons(&table, assign);
+  assert_ptr_equal(first, second);
+  assert_ptr_not_equal(first, renamed);
+  assert_true(expressions_equal(first, second));
+  assert_false(expressions_equal(first, renamed));
+  assert_uint64(hash_expression(first), ==, hash_expression(second));
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult lists_are_compared_element_by_element(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 14);
+  Allocator allocator = {.allocate = stack_allocate,
+                         .resize = stack_resize,
+                         .state = &stack};
+  HashConsTable table;
+  hash_cons_table_init(&table, allocator);
+  Parser parser = {.allocator = allocator, .hash_cons = &table};
+  Module module = parse_module(&parser,
+                               (Cursor){.input = "i64 a = f(x, [1, 2])\n"
+                                                 "i64 b = f(x, [1, 2])\n"
+                                                 "i64 c = f(x, [1, 3])"})
+                      .module;
+  assert_size(module.length, ==, 3);
+  const Expression *a = module.expressions[0].value.assign.value;
+  const Expression *b = module.expressions[1].value.assign.value;
+  const Expression *c = module.expressions[2].value.assign.value;
+  assert_ptr_equal(a, b);
+  assert_ptr_not_equal(a, c);
+  assert_true(expressions_equal(&a->value.call.arguments[1],
+                                &b->value.call.arguments[1]));
+  assert_false(expressions_equal(&a->value.call.arguments[1],
+                                 &c->value.call.arguments[1]));
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitTest hash_cons_tests[] = {
+    {
+        .name = "/leaves_are_keyed_by_kind_and_text",
+        .test = leaves_are_keyed_by_kind_and_text,
+    },
+    {
+        .name = "/interior_nodes_compare_children_by_address",
+        .test = interior_nodes_compare_children_by_address,
+    },
+    {
+        .name = "/lists_are_compared_element_by_element",
+        .test = lists_are_compared_element_by_element,
+    },
+    {}};
+
+MunitSuite hash_cons_suite = {
+    .prefix = "/hash_cons",
+    .tests = hash_cons_tests,
+    .iterations = 1,
+};
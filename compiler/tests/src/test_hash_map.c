@@ -0,0 +1,124 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "allocator.h"
+#include "hash_map.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+#include "tokenizer.h"
+
+bool uint64_equal(uint64_t a, uint64_t b) { return a == b; }
+
+DEFINE_HASH_MAP(Uint64Map, uint64_map, uint64_t, uint64_t, hash_integer,
+                uint64_equal)
+
+DEFINE_HASH_MAP(StringMap, string_map, StringView, uint32_t, hash_string_view,
+                string_view_equal)
+
+MunitResult insert_and_find(const MunitParameter params[],
+                            void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 20);
+  Allocator allocator = {.allocate = stack_allocate, .state = &stack};
+  Uint64Map map = {};
+  assert_ptr_null(uint64_map_find(&map, 1));
+  for (uint64_t i = 0; i < 10000; ++i) {
+    map_insert(uint64_map, allocator, &map, i * 3, i);
+  }
+  assert_size(map.map.length, ==, 10000);
+  for (uint64_t i = 0; i < 10000; ++i) {
+    uint64_t *value = uint64_map_find(&map, i * 3);
+    assert_ptr_not_null(value);
+    assert_uint64(*value, ==, i);
+    assert_ptr_null(uint64_map_find(&map, i * 3 + 1));
+  }
+  map_insert(uint64_map, allocator, &map, 3, 42);
+  assert_uint64(*uint64_map_find(&map, 3), ==, 42);
+  assert_uint64(*map_find_or_insert(uint64_map, allocator, &map, 3, 7), ==,
+                42);
+  assert_size(map.map.length, ==, 10000);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult remove_leaves_others(const MunitParameter params[],
+                                 void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 20);
+  Allocator allocator = {.allocate = stack_allocate, .state = &stack};
+  Uint64Map map = {};
+  for (uint64_t i = 0; i < 1000; ++i) {
+    map_insert(uint64_map, allocator, &map, i, i);
+  }
+  for (uint64_t i = 0; i < 1000; i += 2) {
+    assert_true(uint64_map_remove(&map, i));
+  }
+  assert_false(uint64_map_remove(&map, 0));
+  assert_size(map.map.length, ==, 500);
+  for (uint64_t i = 0; i < 1000; ++i) {
+    assert_true((uint64_map_find(&map, i) != nullptr) == (i % 2 == 1));
+  }
+  // Churn through many tombstones without the table growing unboundedly.
+  size_t capacity = map.map.capacity;
+  for (uint64_t round = 0; round < 20; ++round) {
+    for (uint64_t i = 0; i < 500; ++i) {
+      map_insert(uint64_map, allocator, &map, 100000 + i, i);
+    }
+    for (uint64_t i = 0; i < 500; ++i) {
+      assert_true(uint64_map_remove(&map, 100000 + i));
+    }
+  }
+  assert_size(map.map.capacity, ==, capacity);
+  size_t index = 0;
+  size_t visited = 0;
+  for (Uint64MapEntry *entry = uint64_map_next(&map, &index); entry != nullptr;
+       entry = uint64_map_next(&map, &index)) {
+    assert_uint64(entry->key % 2, ==, 1);
+    visited += 1;
+  }
+  assert_size(visited, ==, 500);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult string_keys(const MunitParameter params[],
+                        void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  Allocator allocator = {.allocate = stack_allocate, .state = &stack};
+  StringMap map = {};
+  const char *source = "f32 x f32 y x";
+  StringView f32 = {.data = source, .length = 3};
+  StringView x = {.data = source + 4, .length = 1};
+  StringView f32_again = {.data = source + 6, .length = 3};
+  StringView x_again = {.data = source + 12, .length = 1};
+  assert_uint32(*map_find_or_insert(string_map, allocator, &map, f32, 0), ==,
+                0);
+  assert_uint32(*map_find_or_insert(string_map, allocator, &map, x, 1), ==, 1);
+  assert_uint32(
+      *map_find_or_insert(string_map, allocator, &map, f32_again, 2), ==, 0);
+  assert_uint32(*string_map_find(&map, x_again), ==, 1);
+  assert_size(map.map.length, ==, 2);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitTest hash_map_tests[] = {
+    {
+        .name = "/insert_and_find",
+        .test = insert_and_find,
+    },
+    {
+        .name = "/remove_leaves_others",
+        .test = remove_leaves_others,
+    },
+    {
+        .name = "/string_keys",
+        .test = string_keys,
+    },
+    {}};
+
+MunitSuite hash_map_suite = {
+    .prefix = "/hash_map",
+    .tests = hash_map_tests,
+    .iterations = 1,
+};
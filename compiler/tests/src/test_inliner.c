@@ -0,0 +1,265 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "bytecode.h"
+#include "constant_fold.h"
+#include "inliner.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+#include "vm.h"
+#include <string.h>
+
+// The language has no function syntax yet, so modules are built by hand.
+typedef struct {
+  StackAllocator stack;
+  Allocator allocator;
+  TypeTable types;
+  IrModule module;
+} Program;
+
+void program_init(Program *program) {
+  stack_allocator_init(&program->stack, 1 << 16);
+  program->allocator = (Allocator){.allocate = stack_allocate,
+                                   .resize = stack_resize,
+                                   .state = &program->stack};
+  type_table_init(&program->types, program->allocator);
+  program->module = (IrModule){};
+}
+
+IrFunction begin_function(const char *name, uint32_t parameters,
+                          Program *program) {
+  IrFunction function = {.name = {.data = name, .length = strlen(name)},
+                         .return_type = I64TypeId};
+  for (uint32_t i = 0; i < parameters; ++i) {
+    ir_param(program->allocator, &function, I64TypeId);
+  }
+  return function;
+}
+
+uint32_t end_function(Program *program, IrFunction *function, IrValue value) {
+  ir_return(program->allocator, function, value);
+  ir_end_block(program->allocator, function);
+  array_push(program->allocator, &program->module.functions, *function);
+  return (uint32_t)program->module.functions.length - 1;
+}
+
+IrValue call_one(Program *program, IrFunction *function, uint32_t callee,
+                 IrValue argument) {
+  return ir_call(program->allocator, function, I64TypeId, callee, &argument,
+                 1);
+}
+
+IrValue constant(Program *program, IrFunction *function, int64_t value) {
+  return ir_constant(program->allocator, function, I64TypeId,
+                     (uint64_t)value);
+}
+
+// x + x + ... with ten adds, each reading the parameter.
+uint32_t add_ten_times(Program *program) {
+  IrFunction function = begin_function("ten", 1, program);
+  IrValue sum = 0;
+  for (uint32_t i = 0; i < 10; ++i) {
+    sum = ir_binary(program->allocator, &function, AddOp, I64TypeId, sum, 0);
+  }
+  return end_function(program, &function, sum);
+}
+
+size_t count_calls(const IrFunction *function) {
+  size_t calls = 0;
+  for (size_t i = 0; i < function->instructions.length; ++i) {
+    calls += function->instructions.data[i].opcode == CallOp;
+  }
+  return calls;
+}
+
+int64_t folded_result(Program *program, IrFunction *function) {
+  fold_constants(program->allocator, function, &program->types);
+  assert_size(function->instructions.length, ==, 2);
+  assert_uint32(function->instructions.data[0].opcode, ==, ConstOp);
+  return (int64_t)ir_constant_bits(function->instructions.data[0]);
+}
+
+MunitResult inlines_small_helpers(const MunitParameter params[],
+                                  void *user_data_or_fixture) {
+  Program program;
+  program_init(&program);
+  IrFunction square = begin_function("square", 1, &program);
+  uint32_t callee = end_function(
+      &program, &square,
+      ir_binary(program.allocator, &square, MulOp, I64TypeId, 0, 0));
+  IrFunction caller = begin_function("main", 0, &program);
+  IrValue squared =
+      call_one(&program, &caller, callee, constant(&program, &caller, 7));
+  IrValue sum = ir_binary(program.allocator, &caller, AddOp, I64TypeId,
+                          squared, constant(&program, &caller, 1));
+  uint32_t entry = end_function(&program, &caller, sum);
+  InlineStats stats =
+      inline_calls(program.allocator, &program.module, &default_inline_options);
+  assert_uint32(stats.calls, ==, 1);
+  assert_uint32(stats.inlined, ==, 1);
+  assert_true(ir_verify_module(&program.module, &program.types).valid);
+  IrFunction *inlined = &program.module.functions.data[entry];
+  assert_size(count_calls(inlined), ==, 0);
+  assert_int64(folded_result(&program, inlined), ==, 50);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitResult callees_are_inlined_first(const MunitParameter params[],
+                                      void *user_data_or_fixture) {
+  Program program;
+  program_init(&program);
+  // main is defined first so the traversal has to reach the leaves
+  // through the calls. increment(x) = x + 1, twice(x) =
+  // increment(increment(x)) and outer(x) = twice(x) * 2.
+  IrFunction caller = begin_function("main", 0, &program);
+  call_one(&program, &caller, 1, constant(&program, &caller, 3));
+  uint32_t entry =
+      end_function(&program, &caller, caller.instructions.length - 1);
+  IrFunction outer = begin_function("outer", 1, &program);
+  IrValue inner = call_one(&program, &outer, 2, 0);
+  IrValue doubled = ir_binary(program.allocator, &outer, MulOp, I64TypeId,
+                              inner, constant(&program, &outer, 2));
+  end_function(&program, &outer, doubled);
+  IrFunction twice = begin_function("twice", 1, &program);
+  IrValue once = call_one(&program, &twice, 3, 0);
+  end_function(&program, &twice, call_one(&program, &twice, 3, once));
+  IrFunction increment = begin_function("increment", 1, &program);
+  end_function(&program, &increment,
+               ir_binary(program.allocator, &increment, AddOp, I64TypeId, 0,
+                         constant(&program, &increment, 1)));
+  assert_true(ir_verify_module(&program.module, &program.types).valid);
+  InlineStats stats =
+      inline_calls(program.allocator, &program.module, &default_inline_options);
+  assert_uint32(stats.calls, ==, 4);
+  assert_uint32(stats.inlined, ==, 4);
+  assert_true(ir_verify_module(&program.module, &program.types).valid);
+  IrFunction *inlined = &program.module.functions.data[entry];
+  assert_size(count_calls(inlined), ==, 0);
+  // Without calls the entry runs on the backends as it is.
+  BytecodeFunction bytecode =
+      compile_bytecode(program.allocator, inlined, &program.types);
+  uint64_t registers[64];
+  assert_uint32(bytecode.register_count, <=, 64);
+  VmResult result = vm_run(&bytecode, registers);
+  assert_int(result.status, ==, VmOk);
+  assert_int64((int64_t)result.value, ==, 10);
+  assert_int64(folded_result(&program, inlined), ==, 10);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitResult recursion_is_left_alone(const MunitParameter params[],
+                                    void *user_data_or_fixture) {
+  Program program;
+  program_init(&program);
+  // self calls itself; even and odd call each other.
+  IrFunction self = begin_function("self", 1, &program);
+  end_function(&program, &self, call_one(&program, &self, 0, 0));
+  IrFunction even = begin_function("even", 1, &program);
+  end_function(&program, &even, call_one(&program, &even, 2, 0));
+  IrFunction odd = begin_function("odd", 1, &program);
+  end_function(&program, &odd, call_one(&program, &odd, 1, 0));
+  IrFunction caller = begin_function("main", 0, &program);
+  IrValue a = call_one(&program, &caller, 0, constant(&program, &caller, 1));
+  IrValue b = call_one(&program, &caller, 1, constant(&program, &caller, 2));
+  uint32_t entry = end_function(
+      &program, &caller,
+      ir_binary(program.allocator, &caller, AddOp, I64TypeId, a, b));
+  const IrInstruction *body = program.module.functions.data[0].instructions.data;
+  InlineStats stats =
+      inline_calls(program.allocator, &program.module, &default_inline_options);
+  // Functions with nothing to inline are not rebuilt.
+  assert_ptr_equal(program.module.functions.data[0].instructions.data, body);
+  assert_uint32(stats.calls, ==, 5);
+  assert_uint32(stats.recursive, ==, 3);
+  // main takes one level of each, which still calls into its cycle.
+  assert_uint32(stats.inlined, ==, 2);
+  assert_true(ir_verify_module(&program.module, &program.types).valid);
+  assert_size(count_calls(&program.module.functions.data[entry]), ==, 2);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitResult caller_budget_limits_growth(const MunitParameter params[],
+                                        void *user_data_or_fixture) {
+  Program program;
+  program_init(&program);
+  uint32_t callee = add_ten_times(&program);
+  IrFunction caller = begin_function("main", 1, &program);
+  IrValue sum = 0;
+  for (uint32_t i = 0; i < 3; ++i) {
+    sum = call_one(&program, &caller, callee, sum);
+  }
+  uint32_t entry = end_function(&program, &caller, sum);
+  // Each call adds the ten adds less the argument and the call.
+  InlineOptions options = {.threshold = 100, .caller_budget = 20};
+  InlineStats stats =
+      inline_calls(program.allocator, &program.module, &options);
+  assert_uint32(stats.inlined, ==, 2);
+  assert_uint32(stats.over_budget, ==, 1);
+  assert_size(count_calls(&program.module.functions.data[entry]), ==, 1);
+  assert_size(stats.instructions_after - stats.instructions_before, ==, 16);
+  assert_true(ir_verify_module(&program.module, &program.types).valid);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitResult constant_arguments_pay_for_inlining(const MunitParameter params[],
+                                                void *user_data_or_fixture) {
+  Program program;
+  program_init(&program);
+  uint32_t callee = add_ten_times(&program);
+  IrFunction caller = begin_function("main", 1, &program);
+  IrValue a = call_one(&program, &caller, callee, 0);
+  IrValue b =
+      call_one(&program, &caller, callee, constant(&program, &caller, 3));
+  uint32_t entry = end_function(
+      &program, &caller,
+      ir_binary(program.allocator, &caller, AddOp, I64TypeId, a, b));
+  // The body adds eight instructions; a constant argument is expected to
+  // fold all ten of its uses.
+  InlineOptions options = {
+      .threshold = 0, .caller_budget = 100, .constant_argument_bonus = 1};
+  InlineStats stats =
+      inline_calls(program.allocator, &program.module, &options);
+  assert_uint32(stats.inlined, ==, 1);
+  assert_uint32(stats.too_costly, ==, 1);
+  IrFunction *inlined = &program.module.functions.data[entry];
+  assert_size(count_calls(inlined), ==, 1);
+  fold_constants(program.allocator, inlined, &program.types);
+  assert_true(ir_verify_module(&program.module, &program.types).valid);
+  // Only the call with a variable argument is left besides the sum.
+  assert_size(inlined->instructions.length, ==, 6);
+  stack_allocator_destroy(&program.stack);
+  return MUNIT_OK;
+}
+
+MunitTest inliner_tests[] = {
+    {
+        .name = "/inlines_small_helpers",
+        .test = inlines_small_helpers,
+    },
+    {
+        .name = "/callees_are_inlined_first",
+        .test = callees_are_inlined_first,
+    },
+    {
+        .name = "/recursion_is_left_alone",
+        .test = recursion_is_left_alone,
+    },
+    {
+        .name = "/caller_budget_limits_growth",
+        .test = caller_budget_limits_growth,
+    },
+    {
+        .name = "/constant_arguments_pay_for_inlining",
+        .test = constant_arguments_pay_for_inlining,
+    },
+    {}};
+
+MunitSuite inliner_suite = {
+    .prefix = "/inliner",
+    .tests = inliner_tests,
+    .iterations = 1,
+};
@@ -0,0 +1,40 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "interner.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+
+MunitResult equal_spellings_share_an_id(const MunitParameter params[],
+                                        void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  Interner interner;
+  interner_init(&interner,
+                (Allocator){.allocate = stack_allocate, .state = &stack});
+  const char *source = "x y x";
+  SymbolId x = intern(&interner, (StringView){.data = source, .length = 1});
+  SymbolId y = intern(&interner, (StringView){.data = source + 2, .length = 1});
+  SymbolId again =
+      intern(&interner, (StringView){.data = source + 4, .length = 1});
+  assert_uint32(x, ==, again);
+  assert_uint32(x, !=, y);
+  assert_ptr_equal(symbol_string(&interner, x).data, source);
+  assert_ptr_equal(symbol_string(&interner, y).data, source + 2);
+  assert_size(interner.strings.length, ==, 2);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitTest interner_tests[] = {
+    {
+        .name = "/equal_spellings_share_an_id",
+        .test = equal_spellings_share_an_id,
+    },
+    {}};
+
+MunitSuite interner_suite = {
+    .prefix = "/interner",
+    .tests = interner_tests,
+    .iterations = 1,
+};
@@ -0,0 +1,308 @@
+#define _POSIX_C_SOURCE 200809L
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "ir.h"
+#include "lower.h"
+#include "source_fixture.h"
+#include "test_suites.h"
+#include <stdlib.h>
+
+void assert_dump_equal(const char *expected, const IrFunction *function,
+                       const TypeTable *types) {
+  char *text = nullptr;
+  size_t length = 0;
+  FILE *out = open_memstream(&text, &length);
+  ir_dump(function, types, out);
+  fclose(out);
+  assert_string_equal(expected, text);
+  free(text);
+}
+
+MunitResult lower_definitions(const MunitParameter params[],
+                              void *user_data_or_fixture) {
+  SourceFixture fixture;
+  IrFunction function = lower_fixture_source(&fixture, "f32 x = 42\n"
+                                                       "f32 y = x * 1.5 + x\n"
+                                                       "u8 z = 255\n"
+                                                       "bool b = z > 3");
+  assert_true(ir_verify(&function, &fixture.types).valid);
+  assert_size(function.blocks.length, ==, 1);
+  assert_uint32(function.return_type, ==, BoolTypeId);
+  assert_dump_equal("function main() -> bool {\n"
+                    "block0:\n"
+                    "  %0 = const f32 42\n"
+                    "  %1 = const f32 1.5\n"
+                    "  %2 = mul f32 %0, %1\n"
+                    "  %3 = add f32 %2, %0\n"
+                    "  %4 = const u8 255\n"
+                    "  %5 = const u8 3\n"
+                    "  %6 = gt bool %4, %5\n"
+                    "  return %6\n"
+                    "}\n",
+                    &function, &fixture.types);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult use_lists(const MunitParameter params[],
+                      void *user_data_or_fixture) {
+  SourceFixture fixture;
+  IrFunction function =
+      lower_fixture_source(&fixture, "i32 x = 2\ni32 y = x * x + x");
+  IrUses uses = ir_compute_uses(fixture.allocator, &function);
+  // %0 x, %1 mul, %2 add, %3 return
+  assert_uint32(uses.offsets[1] - uses.offsets[0], ==, 3);
+  assert_uint32(uses.users[uses.offsets[0]], ==, 1);
+  assert_uint32(uses.users[uses.offsets[0] + 1], ==, 1);
+  assert_uint32(uses.users[uses.offsets[0] + 2], ==, 2);
+  assert_uint32(uses.offsets[2] - uses.offsets[1], ==, 1);
+  assert_uint32(uses.users[uses.offsets[1]], ==, 2);
+  assert_uint32(uses.users[uses.offsets[2]], ==, 3);
+  assert_uint32(uses.offsets[4] - uses.offsets[3], ==, 0);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult verifier_rejects_malformed_functions(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  SourceFixture fixture;
+  IrFunction function = lower_fixture_source(&fixture, "i32 x = 1 + 2");
+  IrInstruction *add = &function.instructions.data[2];
+  add->operands[1] = 2;
+  IrVerifyResult result = ir_verify(&function, &fixture.types);
+  assert_false(result.valid);
+  assert_uint32(result.instruction, ==, 2);
+  add->operands[1] = 1;
+  add->type = I64TypeId;
+  assert_false(ir_verify(&function, &fixture.types).valid);
+  add->type = I32TypeId;
+  function.blocks.data[0].end -= 1;
+  result = ir_verify(&function, &fixture.types);
+  assert_false(result.valid);
+  assert_string_equal(result.message, "block does not end in a terminator");
+  function.blocks.data[0].end += 1;
+  assert_true(ir_verify(&function, &fixture.types).valid);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult verifier_checks_calls(const MunitParameter params[],
+                                  void *user_data_or_fixture) {
+  SourceFixture fixture;
+  lower_fixture_source(&fixture, "i64 x = 1");
+  Allocator allocator = fixture.allocator;
+  IrFunction square = {.name = {.data = "square", .length = 6},
+                       .return_type = I64TypeId};
+  IrValue x = ir_param(allocator, &square, I64TypeId);
+  ir_return(allocator, &square,
+            ir_binary(allocator, &square, MulOp, I64TypeId, x, x));
+  ir_end_block(allocator, &square);
+  IrFunction caller = {.name = {.data = "main", .length = 4},
+                       .return_type = I64TypeId};
+  IrValue seven = ir_constant(allocator, &caller, I64TypeId, 7);
+  ir_return(allocator, &caller,
+            ir_call(allocator, &caller, I64TypeId, 0, &seven, 1));
+  ir_end_block(allocator, &caller);
+  IrModule module = {};
+  array_push(allocator, &module.functions, square);
+  array_push(allocator, &module.functions, caller);
+  assert_true(ir_verify_module(&module, &fixture.types).valid);
+  assert_dump_equal("function square(i64) -> i64 {\n"
+                    "block0:\n"
+                    "  %0 = param i64 0\n"
+                    "  %1 = mul i64 %0, %0\n"
+                    "  return %1\n"
+                    "}\n",
+                    &module.functions.data[0], &fixture.types);
+  assert_dump_equal("function main() -> i64 {\n"
+                    "block0:\n"
+                    "  %0 = const i64 7\n"
+                    "  %1 = arg i64 %0\n"
+                    "  %2 = call i64 @0\n"
+                    "  return %2\n"
+                    "}\n",
+                    &module.functions.data[1], &fixture.types);
+  IrInstruction *instructions = module.functions.data[1].instructions.data;
+  instructions[0].type = I32TypeId;
+  instructions[1].type = I32TypeId;
+  IrVerifyResult result = ir_verify_module(&module, &fixture.types);
+  assert_false(result.valid);
+  assert_uint32(result.function, ==, 1);
+  assert_uint32(result.instruction, ==, 1);
+  assert_string_equal(result.message, "argument type does not match");
+  instructions[1] = instructions[0];
+  result = ir_verify_module(&module, &fixture.types);
+  assert_false(result.valid);
+  assert_string_equal(result.message, "wrong number of arguments");
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult lower_arrays(const MunitParameter params[],
+                         void *user_data_or_fixture) {
+  SourceFixture fixture;
+  IrFunction function = lower_fixture_source(&fixture, "[]i16 xs = [7, 8]\n"
+                                                       "u64 i = 1\n"
+                                                       "i16 y = xs[i]");
+  assert_true(ir_verify(&function, &fixture.types).valid);
+  assert_dump_equal("function main() -> i16 {\n"
+                    "block0:\n"
+                    "  %0 = const u64 12\n"
+                    "  %1 = alloc u64 %0 heap\n"
+                    "  %2 = const u64 2\n"
+                    "  store %1, %2\n"
+                    "  %4 = const u64 8\n"
+                    "  %5 = add u64 %1, %4\n"
+                    "  %6 = const i16 7\n"
+                    "  store %5, %6\n"
+                    "  %8 = const i16 8\n"
+                    "  %9 = const u64 2\n"
+                    "  %10 = add u64 %5, %9\n"
+                    "  store %10, %8\n"
+                    "  %12 = const u64 1\n"
+                    "  %13 = const u64 8\n"
+                    "  %14 = sub u64 %5, %13\n"
+                    "  %15 = load u64 %14\n"
+                    "  %16 = bounds u64 %12, %15\n"
+                    "  %17 = const u64 2\n"
+                    "  %18 = mul u64 %16, %17\n"
+                    "  %19 = add u64 %5, %18\n"
+                    "  %20 = load i16 %19\n"
+                    "  return %20\n"
+                    "}\n",
+                    &function, &fixture.types);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult lower_functions(const MunitParameter params[],
+                            void *user_data_or_fixture) {
+  SourceFixture fixture;
+  Module module = check_fixture_source(&fixture,
+                                       "f32 at([]f32 xs, u64 i) = xs[i]\n"
+                                       "[]f32 ys = [1, 2]\n"
+                                       "at(ys, 1) + at(ys, 0)");
+  IrModule program = lower_program(&fixture.analyzer, module);
+  assert_size(program.functions.length, ==, 2);
+  assert_true(ir_verify_module(&program, &fixture.types).valid);
+  // Slices are passed as the address of their first element, with their
+  // length right below it.
+  assert_dump_equal("function at(u64, u64) -> f32 {\n"
+                    "block0:\n"
+                    "  %0 = param u64 0\n"
+                    "  %1 = param u64 1\n"
+                    "  %2 = const u64 8\n"
+                    "  %3 = sub u64 %0, %2\n"
+                    "  %4 = load u64 %3\n"
+                    "  %5 = bounds u64 %1, %4\n"
+                    "  %6 = const u64 4\n"
+                    "  %7 = mul u64 %5, %6\n"
+                    "  %8 = add u64 %0, %7\n"
+                    "  %9 = load f32 %8\n"
+                    "  return %9\n"
+                    "}\n",
+                    &program.functions.data[0], &fixture.types);
+  assert_dump_equal("function main() -> f32 {\n"
+                    "block0:\n"
+                    "  %0 = const u64 16\n"
+                    "  %1 = alloc u64 %0 heap\n"
+                    "  %2 = const u64 2\n"
+                    "  store %1, %2\n"
+                    "  %4 = const u64 8\n"
+                    "  %5 = add u64 %1, %4\n"
+                    "  %6 = const f32 1\n"
+                    "  store %5, %6\n"
+                    "  %8 = const f32 2\n"
+                    "  %9 = const u64 4\n"
+                    "  %10 = add u64 %5, %9\n"
+                    "  store %10, %8\n"
+                    "  %12 = const u64 1\n"
+                    "  %13 = arg u64 %5\n"
+                    "  %14 = arg u64 %12\n"
+                    "  %15 = call f32 @0\n"
+                    "  %16 = const u64 0\n"
+                    "  %17 = arg u64 %5\n"
+                    "  %18 = arg u64 %16\n"
+                    "  %19 = call f32 @0\n"
+                    "  %20 = add f32 %15, %19\n"
+                    "  return %20\n"
+                    "}\n",
+                    &program.functions.data[1], &fixture.types);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult lower_generic_calls(const MunitParameter params[],
+                                void *user_data_or_fixture) {
+  SourceFixture fixture;
+  Module module = check_fixture_source(&fixture, "T twice<T>(T x) = x * 2\n"
+                                                 "f32 a = twice(1.5)\n"
+                                                 "i64 b = twice(3)\n"
+                                                 "f32 c = twice(a)\n"
+                                                 "c");
+  IrModule program = lower_program(&fixture.analyzer, module);
+  // One instance per type argument, in the order first called.
+  assert_size(program.functions.length, ==, 3);
+  assert_true(ir_verify_module(&program, &fixture.types).valid);
+  assert_dump_equal("function twice<f32>(f32) -> f32 {\n"
+                    "block0:\n"
+                    "  %0 = param f32 0\n"
+                    "  %1 = const f32 2\n"
+                    "  %2 = mul f32 %0, %1\n"
+                    "  return %2\n"
+                    "}\n",
+                    &program.functions.data[0], &fixture.types);
+  assert_dump_equal("function main() -> f32 {\n"
+                    "block0:\n"
+                    "  %0 = const f32 1.5\n"
+                    "  %1 = arg f32 %0\n"
+                    "  %2 = call f32 @0\n"
+                    "  %3 = const i64 3\n"
+                    "  %4 = arg i64 %3\n"
+                    "  %5 = call i64 @1\n"
+                    "  %6 = arg f32 %2\n"
+                    "  %7 = call f32 @0\n"
+                    "  return %7\n"
+                    "}\n",
+                    &program.functions.data[2], &fixture.types);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitTest ir_tests[] = {
+    {
+        .name = "/lower_definitions",
+        .test = lower_definitions,
+    },
+    {
+        .name = "/use_lists",
+        .test = use_lists,
+    },
+    {
+        .name = "/verifier_rejects_malformed_functions",
+        .test = verifier_rejects_malformed_functions,
+    },
+    {
+        .name = "/verifier_checks_calls",
+        .test = verifier_checks_calls,
+    },
+    {
+        .name = "/lower_arrays",
+        .test = lower_arrays,
+    },
+    {
+        .name = "/lower_functions",
+        .test = lower_functions,
+    },
+    {
+        .name = "/lower_generic_calls",
+        .test = lower_generic_calls,
+    },
+    {}};
+
+MunitSuite ir_suite = {
+    .prefix = "/ir",
+    .tests = ir_tests,
+    .iterations = 1,
+};
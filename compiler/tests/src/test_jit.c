@@ -0,0 +1,110 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "bytecode.h"
+#include "jit.h"
+#include "source_fixture.h"
+#include "test_suites.h"
+#include "vm.h"
+#include "x64.h"
+
+// Runs source through the JIT and through the VM, which serves as the
+// reference, and returns the JIT's result.
+VmResult run_both(const char *source) {
+  SourceFixture fixture;
+  IrFunction ir = lower_fixture_source(&fixture, source);
+  Allocator allocator = fixture.allocator;
+  TypeTable *types = &fixture.types;
+  BytecodeFunction bytecode = compile_bytecode(allocator, &ir, types);
+  uint64_t registers[64];
+  assert_uint32(bytecode.register_count, <=, 64);
+  VmResult expected = vm_run(&bytecode, registers);
+  X64CompileResult compiled = x64_compile(allocator, &ir, types);
+  assert_true(compiled.supported);
+  JitFunction function = jit_load(&compiled.code);
+  assert_not_null(function.entry);
+  VmResult actual = {};
+  actual.status = function.entry(&actual.value);
+  jit_release(&function);
+  stack_allocator_destroy(&fixture.stack);
+  assert_int(actual.status, ==, expected.status);
+  if (actual.status == VmOk) {
+    assert_uint64(actual.value, ==, expected.value);
+  }
+  return actual;
+}
+
+MunitResult integer_programs(const MunitParameter params[],
+                             void *user_data_or_fixture) {
+#ifndef __x86_64__
+  return MUNIT_SKIP;
+#endif
+  assert_uint64(run_both("i64 x = 7\ni64 y = (x * 6 - 2) / 4 % 7").value, ==,
+                3);
+  run_both("i64 x = 5000000000\ni64 y = x * x - x");
+  run_both("i8 a = 100\ni8 b = a + a");
+  run_both("i16 a = 300\ni16 b = a * a");
+  run_both("u8 a = 3\nu8 b = a - 4");
+  run_both("u32 a = 1\nu32 b = 0 - a\nu32 c = b / 3 + b % 10");
+  run_both("i32 a = 0 - 17\ni32 b = a / 5 + a % 5");
+  run_both("i32 a = 0 - 17\nbool b = a < 3");
+  run_both("u32 a = 0 - 17\nbool b = a < 3");
+  run_both("i64 a = 4\nbool b = a >= 4");
+  return MUNIT_OK;
+}
+
+MunitResult float_programs(const MunitParameter params[],
+                           void *user_data_or_fixture) {
+#ifndef __x86_64__
+  return MUNIT_SKIP;
+#endif
+  run_both("f32 x = 16777216\nf32 y = x + 1 - x / 3 * 2");
+  run_both("f64 x = 7.5\nf64 y = x % 2 + x / 2");
+  run_both("f32 x = 7.5\nf32 y = x % 2");
+  run_both("f64 x = 1.5\nbool b = x > 1");
+  run_both("f64 z = 0.0\nf64 n = z / z\nbool b = n == n");
+  run_both("f64 z = 0.0\nf64 n = z / z\nbool b = n != n");
+  run_both("f32 z = 0.0\nf32 n = z / z\nbool b = n < 1");
+  run_both("f32 z = 0.0\nf32 n = z / z\nbool b = n >= 1");
+  run_both("f32 x = 2\nbool b = x <= 2");
+  return MUNIT_OK;
+}
+
+MunitResult traps_are_reported(const MunitParameter params[],
+                               void *user_data_or_fixture) {
+#ifndef __x86_64__
+  return MUNIT_SKIP;
+#endif
+  assert_int(run_both("u8 x = 0\nu8 y = 1 / x").status, ==, VmDivisionByZero);
+  assert_int(run_both("i64 x = 9223372036854775807\n"
+                      "i64 min = 0 - x - 1\n"
+                      "i64 y = min / (0 - 1)")
+                 .status,
+             ==, VmDivisionOverflow);
+  run_both("i64 x = 9223372036854775807\n"
+           "i64 min = 0 - x - 1\n"
+           "i64 y = min % (0 - 1)");
+  run_both("i8 x = 127\ni8 min = 0 - x - 1\ni8 y = min / (0 - 1)");
+  return MUNIT_OK;
+}
+
+MunitTest jit_tests[] = {
+    {
+        .name = "/integer_programs",
+        .test = integer_programs,
+    },
+    {
+        .name = "/float_programs",
+        .test = float_programs,
+    },
+    {
+        .name = "/traps_are_reported",
+        .test = traps_are_reported,
+    },
+    {}};
+
+MunitSuite jit_suite = {
+    .prefix = "/jit",
+    .tests = jit_tests,
+    .iterations = 1,
+};
@@ -2,7 +2,35 @@
 #include <munit.h>
 
 int32_t main(int argc, char *argv[]) {
-  MunitSuite suites[] = {tokenizer_suite, parser_suite, {}};
+  MunitSuite suites[] = {tokenizer_suite,
+                         parser_suite,
+                         hash_cons_suite,
+                         stack_allocator_suite,
+                         concurrent_arena_suite,
+                         tracking_allocator_suite,
+                         array_suite,
+                         hash_map_suite,
+                         small_vector_suite,
+                         interner_suite,
+                         semantic_suite,
+                         ir_suite,
+                         constant_fold_suite,
+                         value_numbering_suite,
+                         dead_code_suite,
+                         comptime_suite,
+                         monomorphize_suite,
+                         vm_suite,
+                         jit_suite,
+                         buffered_writer_suite,
+                         c_backend_suite,
+                         elf_object_suite,
+                         register_allocator_suite,
+                         vectorize_suite,
+                         inliner_suite,
+                         escape_suite,
+                         compile_stats_suite,
+                         trace_suite,
+                         {}};
 
   MunitSuite main_suite = {.prefix = "All Tests",
                            .suites = suites,
@@ -0,0 +1,255 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "comptime.h"
+#include "monomorphize.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+#include <string.h>
+
+typedef struct {
+  StackAllocator stack;
+  Allocator allocator;
+  TypeTable types;
+  IrModule module;
+  Monomorphizer monomorphizer;
+} Build;
+
+void build_init(Build *build) {
+  stack_allocator_init(&build->stack, 1 << 16);
+  build->allocator = (Allocator){.allocate = stack_allocate,
+                                 .resize = stack_resize,
+                                 .state = &build->stack};
+  type_table_init(&build->types, build->allocator);
+  build->module = (IrModule){};
+  monomorphizer_init(&build->monomorphizer, build->allocator, &build->types,
+                     &build->module);
+}
+
+// axpy<T>(a: T, x: T, y: T) -> T = a * x + y, as a compilation unit would
+// register it.
+uint32_t add_axpy(Build *build) {
+  TypeId t = type_parameter(&build->types, 0);
+  IrFunction body = {.name = {.data = "axpy", .length = 4}, .return_type = t};
+  IrValue a = ir_param(build->allocator, &body, t);
+  IrValue x = ir_param(build->allocator, &body, t);
+  IrValue y = ir_param(build->allocator, &body, t);
+  IrValue product = ir_binary(build->allocator, &body, MulOp, t, a, x);
+  ir_return(build->allocator, &body,
+            ir_binary(build->allocator, &body, AddOp, t, product, y));
+  ir_end_block(build->allocator, &body);
+  return monomorphizer_add_generic(
+      &build->monomorphizer,
+      (IrGeneric){.body = body, .type_parameter_count = 1});
+}
+
+void assert_name(const IrFunction *function, const char *expected) {
+  assert_size(function->name.length, ==, strlen(expected));
+  assert_memory_equal(function->name.length, function->name.data, expected);
+}
+
+MunitResult specializes_per_type(const MunitParameter params[],
+                                 void *user_data_or_fixture) {
+  Build build;
+  build_init(&build);
+  uint32_t axpy = add_axpy(&build);
+  const IrGeneric *generic = &build.monomorphizer.generics.data[axpy];
+  IrVerifyResult generic_verified = ir_verify(&generic->body, &build.types);
+  assert_false(generic_verified.valid);
+  assert_string_equal(generic_verified.message,
+                      "type parameter in a concrete function");
+  TypeId f32 = F32TypeId;
+  TypeId f64 = F64TypeId;
+  TypeId i64 = I64TypeId;
+  uint32_t single = monomorphize(&build.monomorphizer, axpy, &f32);
+  uint32_t dual = monomorphize(&build.monomorphizer, axpy, &f64);
+  uint32_t integer = monomorphize(&build.monomorphizer, axpy, &i64);
+  assert_size(build.module.functions.length, ==, 3);
+  assert_true(ir_verify_module(&build.module, &build.types).valid);
+  const IrFunction *functions = build.module.functions.data;
+  assert_name(&functions[single], "axpy<f32>");
+  assert_name(&functions[dual], "axpy<f64>");
+  for (size_t i = 0; i < functions[dual].instructions.length - 1; ++i) {
+    assert_uint32(functions[dual].instructions.data[i].type, ==, F64TypeId);
+  }
+  // Each instance computes in its own type.
+  Comptime comptime;
+  comptime_init(&comptime, build.allocator, &build.module, &build.types,
+                &default_comptime_limits);
+  double operands[3] = {1.5, 2.0, 0.25};
+  uint64_t bits[3];
+  memcpy(bits, operands, sizeof(bits));
+  ComptimeResult result = comptime_call(&comptime, dual, bits);
+  double value;
+  memcpy(&value, &result.bits, sizeof(value));
+  assert_double(value, ==, 3.25);
+  uint64_t integers[3] = {(uint64_t)-3, 5, 2};
+  result = comptime_call(&comptime, integer, integers);
+  assert_int64((int64_t)result.bits, ==, -13);
+  stack_allocator_destroy(&build.stack);
+  return MUNIT_OK;
+}
+
+MunitResult instances_are_cached(const MunitParameter params[],
+                                 void *user_data_or_fixture) {
+  Build build;
+  build_init(&build);
+  uint32_t axpy = add_axpy(&build);
+  TypeId f32 = F32TypeId;
+  uint32_t first = monomorphize(&build.monomorphizer, axpy, &f32);
+  uint32_t second = monomorphize(&build.monomorphizer, axpy, &f32);
+  assert_uint32(first, ==, second);
+  assert_size(build.module.functions.length, ==, 1);
+  MonomorphizeStats stats = build.monomorphizer.stats;
+  assert_uint32(stats.requests, ==, 2);
+  assert_uint32(stats.cache_hits, ==, 1);
+  assert_uint32(stats.instantiated, ==, 1);
+  // Type tuples are interned by value, in order.
+  TypeId pair[2] = {F32TypeId, I64TypeId};
+  TypeId swapped[2] = {I64TypeId, F32TypeId};
+  uint32_t tuple = intern_type_tuple(&build.monomorphizer, pair, 2);
+  assert_uint32(intern_type_tuple(&build.monomorphizer, pair, 2), ==, tuple);
+  assert_uint32(intern_type_tuple(&build.monomorphizer, swapped, 2), !=,
+                tuple);
+  assert_uint32(intern_type_tuple(&build.monomorphizer, pair, 1), ==,
+                intern_type_tuple(&build.monomorphizer, &f32, 1));
+  stack_allocator_destroy(&build.stack);
+  return MUNIT_OK;
+}
+
+MunitResult units_share_identical_instances(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+  Build build;
+  build_init(&build);
+  // Two units each bring their own copy of axpy.
+  uint32_t first_unit = add_axpy(&build);
+  uint32_t second_unit = add_axpy(&build);
+  assert_uint32(first_unit, !=, second_unit);
+  TypeId i32 = I32TypeId;
+  TypeId u32 = U32TypeId;
+  uint32_t first = monomorphize(&build.monomorphizer, first_unit, &i32);
+  uint32_t second = monomorphize(&build.monomorphizer, second_unit, &i32);
+  assert_uint32(first, ==, second);
+  uint32_t unsigned_instance =
+      monomorphize(&build.monomorphizer, second_unit, &u32);
+  assert_uint32(unsigned_instance, !=, first);
+  assert_size(build.module.functions.length, ==, 2);
+  assert_uint32(build.monomorphizer.stats.deduplicated, ==, 1);
+  assert_uint32(build.monomorphizer.stats.instantiated, ==, 2);
+  // The shared instance is now cached for the second unit as well.
+  assert_uint32(monomorphize(&build.monomorphizer, second_unit, &i32), ==,
+                first);
+  assert_uint32(build.monomorphizer.stats.cache_hits, ==, 1);
+  stack_allocator_destroy(&build.stack);
+  return MUNIT_OK;
+}
+
+// scale<T>(x: T) -> T = x * 2, whose constant is only an integer until T
+// is known.
+uint32_t add_scale(Build *build, TypeId t) {
+  IrFunction body = {.name = {.data = "scale", .length = 5}, .return_type = t};
+  IrValue x = ir_param(build->allocator, &body, t);
+  IrValue two = ir_constant(build->allocator, &body, t, 2);
+  ir_return(build->allocator, &body,
+            ir_binary(build->allocator, &body, MulOp, t, x, two));
+  ir_end_block(build->allocator, &body);
+  return monomorphizer_add_generic(
+      &build->monomorphizer,
+      (IrGeneric){.body = body, .type_parameter_count = 1});
+}
+
+MunitResult constants_take_the_instance_type(const MunitParameter params[],
+                                             void *user_data_or_fixture) {
+  Build build;
+  build_init(&build);
+  uint32_t scale = add_scale(&build, type_parameter(&build.types, 0));
+  TypeId f32 = F32TypeId;
+  TypeId u8 = U8TypeId;
+  uint32_t single_index = monomorphize(&build.monomorphizer, scale, &f32);
+  uint32_t byte_index = monomorphize(&build.monomorphizer, scale, &u8);
+  const IrFunction *single = &build.module.functions.data[single_index];
+  float two = 2.0f;
+  uint32_t two_bits;
+  memcpy(&two_bits, &two, sizeof(two_bits));
+  assert_uint64(ir_constant_bits(single->instructions.data[1]), ==, two_bits);
+  const IrFunction *byte = &build.module.functions.data[byte_index];
+  assert_uint64(ir_constant_bits(byte->instructions.data[1]), ==, 2);
+  assert_true(ir_verify_module(&build.module, &build.types).valid);
+  Comptime comptime;
+  comptime_init(&comptime, build.allocator, &build.module, &build.types,
+                &default_comptime_limits);
+  float operand = 1.5f;
+  uint64_t bits = 0;
+  memcpy(&bits, &operand, sizeof(operand));
+  ComptimeResult result = comptime_call(&comptime, single_index, &bits);
+  float value;
+  memcpy(&value, &result.bits, sizeof(value));
+  assert_float(value, ==, 3.0f);
+  stack_allocator_destroy(&build.stack);
+  return MUNIT_OK;
+}
+
+MunitResult substitutes_through_composite_types(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  Build build;
+  build_init(&build);
+  TypeId t = type_parameter(&build.types, 0);
+  TypeId f32 = F32TypeId;
+  TypeId lanes = vector_type(&build.types, t, 4);
+  assert_uint32(vector_type(&build.types, F32TypeId, 4), ==, F32x4TypeId);
+  assert_uint32(substitute_type(&build.types, lanes, &f32), ==, F32x4TypeId);
+  assert_uint32(substitute_type(&build.types, slice_type(&build.types, t),
+                                &f32),
+                ==, slice_type(&build.types, F32TypeId));
+  TypeId generic_function = function_type(&build.types, t, &lanes, 1);
+  TypeId f32x4 = F32x4TypeId;
+  assert_uint32(substitute_type(&build.types, generic_function, &f32), ==,
+                function_type(&build.types, F32TypeId, &f32x4, 1));
+  // A vector of T is broadcast from the integer as well.
+  uint32_t scale = add_scale(&build, lanes);
+  uint32_t index = monomorphize(&build.monomorphizer, scale, &f32);
+  const IrFunction *instance = &build.module.functions.data[index];
+  assert_uint32(instance->return_type, ==, F32x4TypeId);
+  float two = 2.0f;
+  uint32_t two_bits;
+  memcpy(&two_bits, &two, sizeof(two_bits));
+  assert_uint64(ir_constant_bits(instance->instructions.data[1]), ==,
+                two_bits);
+  assert_true(ir_verify(instance, &build.types).valid);
+  IrVerifyResult generic = ir_verify(
+      &build.monomorphizer.generics.data[scale].body, &build.types);
+  assert_false(generic.valid);
+  assert_string_equal(generic.message,
+                      "type parameter in a concrete function");
+  stack_allocator_destroy(&build.stack);
+  return MUNIT_OK;
+}
+
+MunitTest monomorphize_tests[] = {
+    {
+        .name = "/specializes_per_type",
+        .test = specializes_per_type,
+    },
+    {
+        .name = "/instances_are_cached",
+        .test = instances_are_cached,
+    },
+    {
+        .name = "/units_share_identical_instances",
+        .test = units_share_identical_instances,
+    },
+    {
+        .name = "/constants_take_the_instance_type",
+        .test = constants_take_the_instance_type,
+    },
+    {
+        .name = "/substitutes_through_composite_types",
+        .test = substitutes_through_composite_types,
+    },
+    {}};
+
+MunitSuite monomorphize_suite = {
+    .prefix = "/monomorphize",
+    .tests = monomorphize_tests,
+    .iterations = 1,
+};
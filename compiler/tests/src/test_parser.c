@@ -1,6 +1,8 @@
 #define YETI_ENABLE_DEFER_MACROS
+#define MUNIT_ENABLE_ASSERT_ALIASES
 
 #include "assertions.h"
+#include "hash_cons.h"
 #include "parser.h"
 #include "stack_allocator.h"
 #include "test_suites.h"
@@ -9,9 +11,11 @@ MunitResult parse_variable_definition(const MunitParameter params[],
                                       void *user_data_or_fixture) {
   StackAllocator stack;
   stack_allocator_init(&stack, 2 << 7);
-  Allocator allocator = {.allocate = stack_allocate, .state = &stack};
+  Parser parser = {
+      .allocator = {.allocate = stack_allocate, .state = &stack},
+  };
   Cursor cursor = {.input = "f32 x = 42"};
-  ParseExpressionResult actual = parse_expression(allocator, cursor);
+  ParseExpressionResult actual = parse_expression(&parser, cursor);
   ParseExpressionResult
       expected =
           {
@@ -60,10 +64,260 @@ MunitResult parse_variable_definition(const MunitParameter params[],
   return MUNIT_OK;
 }
 
+MunitResult parse_hash_consed_definitions(const MunitParameter params[],
+                                          void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  Allocator allocator = {.allocate = stack_allocate, .state = &stack};
+  HashConsTable hash_cons;
+  hash_cons_table_init(&hash_cons, allocator);
+  Parser parser = {.allocator = allocator, .hash_cons = &hash_cons};
+  Assign x =
+      parse_expression(&parser, (Cursor){.input = "f32 x = 42"})
+          .expression.value.assign;
+  Assign y =
+      parse_expression(&parser, (Cursor){.input = "f32 y = 42"})
+          .expression.value.assign;
+  Assign z =
+      parse_expression(&parser, (Cursor){.input = "f64 z = 42"})
+          .expression.value.assign;
+  assert_ptr_equal(x.type, y.type);
+  assert_ptr_equal(x.value, y.value);
+  assert_ptr_equal(x.value, z.value);
+  assert_ptr_not_equal(x.type, z.type);
+  assert_size(hash_cons.hits, ==, 3);
+  Parser copying = {.allocator = allocator};
+  Assign w = parse_expression(&copying, (Cursor){.input = "f32 w = 42"})
+                 .expression.value.assign;
+  assert_ptr_not_equal(x.type, w.type);
+  assert_expression_equal(*x.type, *w.type);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult parse_module_of_definitions(const MunitParameter params[],
+                                       void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  Parser parser = {.allocator = {.allocate = stack_allocate,
+                                 .resize = stack_resize,
+                                 .state = &stack}};
+  ParseModuleResult result =
+      parse_module(&parser, (Cursor){.input = "f32 x = 1\nf64 y = x\n"});
+  assert_size(result.module.length, ==, 2);
+  assert_int(result.module.expressions[0].kind, ==, AssignExpression);
+  Assign y = result.module.expressions[1].value.assign;
+  assert_string_view_equal((StringView){.data = "y", .length = 1}, y.name.view);
+  assert_int(y.value->kind, ==, SymbolExpression);
+  assert_int(next_token(result.cursor).token.kind, ==, EndOfFileToken);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult parse_binary_op_precedence(const MunitParameter params[],
+                                      void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  Parser parser = {.allocator = {.allocate = stack_allocate,
+                                 .resize = stack_resize,
+                                 .state = &stack}};
+  Module module =
+      parse_module(&parser, (Cursor){.input = "f32 x = a + b * (c - d)\n"
+                                              "f32 y = x"})
+          .module;
+  assert_size(module.length, ==, 2);
+  Expression *sum = module.expressions[0].value.assign.value;
+  assert_int(sum->kind, ==, BinaryOpExpression);
+  assert_int(sum->value.binary_op.op.kind, ==, AddOperator);
+  assert_int(sum->value.binary_op.left->kind, ==, SymbolExpression);
+  Expression *product = sum->value.binary_op.right;
+  assert_int(product->kind, ==, BinaryOpExpression);
+  assert_int(product->value.binary_op.op.kind, ==, MulOperator);
+  Expression *difference = product->value.binary_op.right;
+  assert_int(difference->value.binary_op.op.kind, ==, SubOperator);
+  assert_string_view_equal(
+      (StringView){.data = "d", .length = 1},
+      difference->value.binary_op.right->value.symbol.view);
+  assert_int(module.expressions[1].kind, ==, AssignExpression);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult parse_struct_declaration(const MunitParameter params[],
+                                     void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  Parser parser = {.allocator = {.allocate = stack_allocate,
+                                 .resize = stack_resize,
+                                 .state = &stack}};
+  Module module =
+      parse_module(&parser,
+                   (Cursor){.input = "struct [soa, pinned] Particle {\n"
+                                     "  f32 x,\n"
+                                     "  u8 alive,\n"
+                                     "}\n"
+                                     "struct Empty {}\n"
+                                     "f32 y = 1"})
+          .module;
+  assert_size(module.length, ==, 3);
+  assert_int(module.expressions[0].kind, ==, StructExpression);
+  StructDeclaration particle = module.expressions[0].value.struct_;
+  assert_string_view_equal((StringView){.data = "Particle", .length = 8},
+                           particle.name.view);
+  assert_uint32(particle.attribute_count, ==, 2);
+  assert_string_view_equal((StringView){.data = "pinned", .length = 6},
+                           particle.attributes[1].view);
+  assert_uint32(particle.field_count, ==, 2);
+  assert_string_view_equal((StringView){.data = "u8", .length = 2},
+                           particle.fields[1].type->value.symbol.view);
+  assert_string_view_equal((StringView){.data = "alive", .length = 5},
+                           particle.fields[1].name.view);
+  assert_span_equal((Span){.begin = {.line = 2, .column = 5},
+                           .end = {.line = 2, .column = 10}},
+                    particle.fields[1].name.span);
+  assert_uint32(module.expressions[1].value.struct_.attribute_count, ==, 0);
+  assert_uint32(module.expressions[1].value.struct_.field_count, ==, 0);
+  assert_int(module.expressions[2].kind, ==, AssignExpression);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult parse_arrays_and_indexing(const MunitParameter params[],
+                                      void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  Parser parser = {.allocator = {.allocate = stack_allocate,
+                                 .resize = stack_resize,
+                                 .state = &stack}};
+  Module module =
+      parse_module(&parser, (Cursor){.input = "[][]f32 xs = [[1], [2, 3],]\n"
+                                              "f32 y = xs[1][0] * 2\n"
+                                              "[4, 5]"})
+          .module;
+  assert_size(module.length, ==, 3);
+  Assign xs = module.expressions[0].value.assign;
+  assert_int(xs.type->kind, ==, SliceTypeExpression);
+  assert_int(xs.type->value.slice.element->kind, ==, SliceTypeExpression);
+  assert_int(xs.value->kind, ==, ArrayExpression);
+  ArrayLiteral rows = xs.value->value.array;
+  assert_uint32(rows.count, ==, 2);
+  // Rows sit side by side, each with its own run of elements.
+  assert_int(rows.elements[1].kind, ==, ArrayExpression);
+  assert_uint32(rows.elements[1].value.array.count, ==, 2);
+  assert_string_view_equal(
+      (StringView){.data = "3", .length = 1},
+      rows.elements[1].value.array.elements[1].value.int_.view);
+  assert_size(parser.scratch.length, ==, 0);
+  Expression *product = module.expressions[1].value.assign.value;
+  assert_int(product->value.binary_op.op.kind, ==, MulOperator);
+  Expression *outer = product->value.binary_op.left;
+  assert_int(outer->kind, ==, IndexExpression);
+  assert_int(outer->value.index.target->kind, ==, IndexExpression);
+  assert_int(outer->value.index.index->kind, ==, IntExpression);
+  // A bracket on a new line starts an array rather than an index.
+  assert_int(module.expressions[2].kind, ==, ArrayExpression);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult parse_functions_and_calls(const MunitParameter params[],
+                                      void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  Parser parser = {.allocator = {.allocate = stack_allocate,
+                                 .resize = stack_resize,
+                                 .state = &stack}};
+  Module module =
+      parse_module(&parser, (Cursor){.input = "f32 dot([]f32 a, i64 n,) =\n"
+                                              "  a[n] * 2\n"
+                                              "f(g(1, 2), h(), 3)"})
+          .module;
+  assert_size(module.length, ==, 2);
+  assert_int(module.expressions[0].kind, ==, FunctionExpression);
+  Function dot = module.expressions[0].value.function;
+  assert_string_view_equal((StringView){.data = "dot", .length = 3},
+                           dot.name.view);
+  assert_int(dot.return_type->kind, ==, SymbolExpression);
+  assert_uint32(dot.parameter_count, ==, 2);
+  assert_int(dot.parameters[0].type->kind, ==, SliceTypeExpression);
+  assert_string_view_equal((StringView){.data = "n", .length = 1},
+                           dot.parameters[1].name.view);
+  assert_int(dot.body->value.binary_op.left->kind, ==, IndexExpression);
+  assert_size(parser.typed_names.length, ==, 0);
+  assert_int(module.expressions[1].kind, ==, CallExpression);
+  Call f = module.expressions[1].value.call;
+  assert_uint32(f.argument_count, ==, 3);
+  // Nested argument lists are copied out before the outer one.
+  assert_int(f.arguments[0].kind, ==, CallExpression);
+  assert_uint32(f.arguments[0].value.call.argument_count, ==, 2);
+  assert_uint32(f.arguments[1].value.call.argument_count, ==, 0);
+  assert_int(f.arguments[2].kind, ==, IntExpression);
+  assert_size(parser.scratch.length, ==, 0);
+  assert_size(count_nodes(module), ==, 19);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult parse_generic_functions(const MunitParameter params[],
+                                    void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  Parser parser = {.allocator = {.allocate = stack_allocate,
+                                 .resize = stack_resize,
+                                 .state = &stack}};
+  Module module =
+      parse_module(&parser, (Cursor){.input = "T pick<T, U>(T a, U b) = a\n"
+                                              "i64 f(i64 x) = x\n"
+                                              "pick(1, 2) < f(3)"})
+          .module;
+  assert_size(module.length, ==, 3);
+  Function pick = module.expressions[0].value.function;
+  assert_uint32(pick.type_parameter_count, ==, 2);
+  assert_string_view_equal((StringView){.data = "U", .length = 1},
+                           pick.type_parameters[1].view);
+  assert_uint32(pick.parameter_count, ==, 2);
+  assert_string_view_equal((StringView){.data = "U", .length = 1},
+                           pick.parameters[1].type->value.symbol.view);
+  assert_uint32(module.expressions[1].value.function.type_parameter_count,
+                ==, 0);
+  // Outside of a definition < is still a comparison.
+  assert_int(module.expressions[2].kind, ==, BinaryOpExpression);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
 MunitTest parser_tests[] = {{
                                 .name = "/parse_symbol",
                                 .test = parse_variable_definition,
                             },
+                            {
+                                .name = "/parse_hash_consed_definitions",
+                                .test = parse_hash_consed_definitions,
+                            },
+                            {
+                                .name = "/parse_module_of_definitions",
+                                .test = parse_module_of_definitions,
+                            },
+                            {
+                                .name = "/parse_binary_op_precedence",
+                                .test = parse_binary_op_precedence,
+                            },
+                            {
+                                .name = "/parse_struct_declaration",
+                                .test = parse_struct_declaration,
+                            },
+                            {
+                                .name = "/parse_arrays_and_indexing",
+                                .test = parse_arrays_and_indexing,
+                            },
+                            {
+                                .name = "/parse_functions_and_calls",
+                                .test = parse_functions_and_calls,
+                            },
+                            {
+                                .name = "/parse_generic_functions",
+                                .test = parse_generic_functions,
+                            },
                             {}};
 
 MunitSuite parser_suite = {
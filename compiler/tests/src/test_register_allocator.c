@@ -0,0 +1,260 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "bytecode.h"
+#include "jit.h"
+#include "register_allocator.h"
+#include "source_fixture.h"
+#include "test_suites.h"
+#include "vm.h"
+#include "x64.h"
+
+typedef struct {
+  SourceFixture source;
+  IrFunction function;
+} Lowered;
+
+void lower_for_allocation(Lowered *lowered, const char *source) {
+  lowered->function = lower_fixture_source(&lowered->source, source);
+}
+
+static const uint8_t rsi_rdi[] = {6, 7};
+static const uint8_t rbx[] = {3};
+static const uint8_t xmm2_xmm3[] = {2, 3};
+
+static const RegisterFile two_registers = {
+    .classes =
+        {
+            [GeneralRegisterClass] = {.registers = rsi_rdi,
+                                      .count = 2,
+                                      .caller_saved = 1u << 6 | 1u << 7},
+            [FloatRegisterClass] = {.registers = xmm2_xmm3,
+                                    .count = 2,
+                                    .caller_saved = 0xffff},
+        },
+};
+
+static const RegisterFile one_callee_saved_register = {
+    .classes =
+        {
+            [GeneralRegisterClass] = {.registers = rbx, .count = 1},
+            [FloatRegisterClass] = {.registers = xmm2_xmm3,
+                                    .count = 1,
+                                    .caller_saved = 0xffff},
+        },
+};
+
+static const RegisterFile no_registers = {};
+
+MunitResult short_intervals_share_registers(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+  Lowered lowered;
+  // %0 = 1, %1 = 2, %2 = add %0 %1, %3 = 3, %4 = mul %2 %3, return %4
+  lower_for_allocation(&lowered, "i64 a = 1 + 2\ni64 b = a * 3");
+  RegisterAllocation allocation =
+      allocate_registers(lowered.source.allocator, &lowered.function,
+                         &lowered.source.types, &two_registers);
+  ValueLocation *values = allocation.values;
+  assert_uint8(values[0].reg, ==, 6);
+  assert_uint8(values[1].reg, ==, 7);
+  // Both operands end at the add, which takes the first one's register.
+  assert_uint8(values[2].reg, ==, 6);
+  assert_uint8(values[3].reg, ==, 7);
+  assert_uint8(values[4].reg, ==, 6);
+  assert_uint32(allocation.split_count, ==, 0);
+  assert_uint32(allocation.spill_count, ==, 0);
+  assert_uint32(allocation.slot_count, ==, 0);
+  stack_allocator_destroy(&lowered.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult pressure_splits_the_interval_ending_last(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  Lowered lowered;
+  // %0 = 1, %1 = 2, %2 = 3, %3 = add %1 %2, %4 = add %0 %3, return %4
+  lower_for_allocation(&lowered, "i64 a = 1\ni64 b = a + (2 + 3)");
+  RegisterAllocation allocation =
+      allocate_registers(lowered.source.allocator, &lowered.function,
+                         &lowered.source.types, &two_registers);
+  ValueLocation *values = allocation.values;
+  // %0 is live longest, so %2 takes its register and %0 moves to memory.
+  assert_uint8(values[0].reg, ==, 6);
+  assert_uint32(values[0].split, ==, 2);
+  assert_uint32(values[0].slot, ==, 0);
+  assert_uint8(values[2].reg, ==, 6);
+  assert_uint32(allocation.split_count, ==, 1);
+  assert_uint32(allocation.splits[0], ==, 0);
+  // %4 could only spill %3's register if %3 outlived it.
+  assert_uint8(values[4].reg, !=, NO_REGISTER);
+  stack_allocator_destroy(&lowered.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult spill_slots_are_reused(const MunitParameter params[],
+                                   void *user_data_or_fixture) {
+  Lowered lowered;
+  lower_for_allocation(&lowered, "i64 a = 1 + 2\ni64 b = a * 3\ni64 c = b - 4\n"
+                         "i64 d = c / 5");
+  RegisterAllocation allocation =
+      allocate_registers(lowered.source.allocator, &lowered.function,
+                         &lowered.source.types, &no_registers);
+  assert_uint32(allocation.spill_count, ==, 9);
+  // No more than three values are ever live at once.
+  assert_uint32(allocation.slot_count, ==, 3);
+  stack_allocator_destroy(&lowered.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult calls_split_caller_saved_intervals(const MunitParameter params[],
+                                               void *user_data_or_fixture) {
+  Lowered lowered;
+  // %0 = 7.5, %1 = 2, %2 = mod %0 %1, %3 = add %2 %0, %4 = 3, %5 = 4,
+  // %6 = 3, %7 = mod %3 %6, %8 = add %4 %5, return %8
+  lower_for_allocation(&lowered, "f64 x = 7.5\nf64 y = x % 2 + x\ni64 i = 3\n"
+                         "i64 j = 4\nf64 z = y % 3\ni64 k = i + j");
+  RegisterAllocation allocation =
+      allocate_registers(lowered.source.allocator, &lowered.function,
+                         &lowered.source.types, &x64_registers);
+  ValueLocation *values = allocation.values;
+  assert_uint8(values[0].reg, ==, 2);
+  assert_uint32(values[0].split, ==, 2);
+  assert_uint32(allocation.splits[0], ==, 0);
+  // i and j live across the second call and get callee saved registers.
+  assert_uint8(values[4].reg, ==, 3);
+  assert_uint8(values[5].reg, ==, 12);
+  assert_uint32(values[4].split, ==, UINT32_MAX);
+  stack_allocator_destroy(&lowered.source.stack);
+  return MUNIT_OK;
+}
+
+// Every program must give the VM's result whatever registers it gets.
+MunitResult generated_code_matches_the_vm(const MunitParameter params[],
+                                          void *user_data_or_fixture) {
+#ifndef __x86_64__
+  return MUNIT_SKIP;
+#endif
+  static const char *programs[] = {
+      "i64 a = 3\ni64 b = a * 5\ni64 c = b - a\ni64 d = c * b\n"
+      "i64 e = d / a\ni64 f = e + d + c + b + a",
+      "i8 a = 100\ni8 b = a + a\ni8 c = b * a - a / 3\ni8 d = c % b + a",
+      "u32 a = 0 - 7\nu32 b = a / 3\nu32 c = a % 10 + b\nbool d = c > a",
+      "f64 x = 7.5\nf64 y = x * 3\nf64 z = y % x\nf64 w = z + y + x",
+      "f32 x = 7.5\nf32 y = x * 3\nf32 z = y % 2 - x\nf32 w = z * y / x",
+      "i64 i = 9\nf64 x = 1.5\nf64 y = x % 1 + x\ni64 j = i * i + i\n"
+      "bool b = y < x",
+      "f64 z = 0.0\nf64 n = z / z\nbool b = n == n",
+      "i64 a = 5\ni64 b = a - 5\ni64 c = a / b",
+  };
+  const RegisterFile *files[] = {
+      &x64_registers,
+      &two_registers,
+      &one_callee_saved_register,
+      &no_registers,
+  };
+  for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); ++i) {
+    for (size_t j = 0; j < sizeof(files) / sizeof(files[0]); ++j) {
+      Lowered lowered;
+      lower_for_allocation(&lowered, programs[i]);
+      BytecodeFunction bytecode = compile_bytecode(
+          lowered.source.allocator, &lowered.function, &lowered.source.types);
+      uint64_t registers[64];
+      assert_uint32(bytecode.register_count, <=, 64);
+      VmResult expected = vm_run(&bytecode, registers);
+      X64CompileResult compiled = x64_compile_with_registers(
+          lowered.source.allocator, &lowered.function, &lowered.source.types,
+          files[j]);
+      JitFunction function = jit_load(&compiled.code);
+      assert_not_null(function.entry);
+      VmResult actual = {};
+      actual.status = function.entry(&actual.value);
+      jit_release(&function);
+      assert_int(actual.status, ==, expected.status);
+      assert_uint64(actual.value, ==, expected.value);
+      stack_allocator_destroy(&lowered.source.stack);
+    }
+  }
+  return MUNIT_OK;
+}
+
+// Vectors spill and split in whole registers. Skipped on hosts without
+// the extensions the code needs.
+MunitResult vector_code_matches_the_vm(const MunitParameter params[],
+                                       void *user_data_or_fixture) {
+#ifndef __x86_64__
+  return MUNIT_SKIP;
+#endif
+  static const char *programs[] = {
+      "f32x4 a = 1.5\nf32x4 b = a * 3\nf32x4 c = b / a - 0.25\n"
+      "f32x4 d = c * b + a - c",
+      "i32x4 a = 7\ni32x4 b = a * a\ni32x4 c = b - 2147483647 - a\n"
+      "i32x4 d = c * b + a",
+      "f32x8 a = 2.5\nf32x8 b = a * a\nf32x8 c = b / 3 - a\n"
+      "f32x8 d = c + b * a",
+      "i32x8 a = 9\ni32x8 b = a * 100000\ni32x8 c = b * b - a\n"
+      "i32x8 d = c + b - a",
+      "f32x8 a = 7.5\nf64 x = 2.5\nf64 y = x % 2\nf32x8 b = a * a + a",
+  };
+  const RegisterFile *files[] = {
+      &x64_registers,
+      &two_registers,
+      &no_registers,
+  };
+  for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); ++i) {
+    for (size_t j = 0; j < sizeof(files) / sizeof(files[0]); ++j) {
+      Lowered lowered;
+      lower_for_allocation(&lowered, programs[i]);
+      BytecodeFunction bytecode = compile_bytecode(
+          lowered.source.allocator, &lowered.function, &lowered.source.types);
+      uint64_t registers[64];
+      assert_uint32(bytecode.register_count, <=, 64);
+      VmResult expected = vm_run(&bytecode, registers);
+      X64CompileResult compiled = x64_compile_with_registers(
+          lowered.source.allocator, &lowered.function, &lowered.source.types,
+          files[j]);
+      JitFunction function = jit_load(&compiled.code);
+      if (function.entry == nullptr) {
+        stack_allocator_destroy(&lowered.source.stack);
+        return MUNIT_SKIP;
+      }
+      uint64_t actual[4] = {};
+      assert_int(function.entry(actual), ==, VmOk);
+      jit_release(&function);
+      assert_memory_equal(sizeof(actual), actual, expected.vector);
+      stack_allocator_destroy(&lowered.source.stack);
+    }
+  }
+  return MUNIT_OK;
+}
+
+MunitTest register_allocator_tests[] = {
+    {
+        .name = "/short_intervals_share_registers",
+        .test = short_intervals_share_registers,
+    },
+    {
+        .name = "/pressure_splits_the_interval_ending_last",
+        .test = pressure_splits_the_interval_ending_last,
+    },
+    {
+        .name = "/spill_slots_are_reused",
+        .test = spill_slots_are_reused,
+    },
+    {
+        .name = "/calls_split_caller_saved_intervals",
+        .test = calls_split_caller_saved_intervals,
+    },
+    {
+        .name = "/generated_code_matches_the_vm",
+        .test = generated_code_matches_the_vm,
+    },
+    {
+        .name = "/vector_code_matches_the_vm",
+        .test = vector_code_matches_the_vm,
+    },
+    {}};
+
+MunitSuite register_allocator_suite = {
+    .prefix = "/register_allocator",
+    .tests = register_allocator_tests,
+    .iterations = 1,
+};
@@ -0,0 +1,498 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "hash_cons.h"
+#include "semantic.h"
+#include "source_fixture.h"
+#include "test_suites.h"
+
+TypeId binding_type(SourceFixture *fixture, const char *name) {
+  SymbolId symbol = intern(&fixture->interner,
+                           (StringView){.data = name, .length = strlen(name)});
+  const Binding *binding = lookup_binding(&fixture->analyzer, symbol);
+  assert_not_null(binding);
+  return binding->type;
+}
+
+void assert_single_diagnostic(SourceFixture *fixture, DiagnosticKind kind,
+                              const char *subject) {
+  DiagnosticArray diagnostics = fixture->analyzer.diagnostics;
+  assert_size(diagnostics.length, ==, 1);
+  assert_int(diagnostics.data[0].kind, ==, kind);
+  assert_string_view_equal(
+      (StringView){.data = subject, .length = strlen(subject)},
+      diagnostics.data[0].subject);
+}
+
+MunitResult well_typed_bindings(const MunitParameter params[],
+                                void *user_data_or_fixture) {
+  SourceFixture fixture;
+  analyze_fixture_source(&fixture, "u8 a = 255\n"
+                                   "i8 b = 127\n"
+                                   "f32 c = 42\n"
+                                   "f64 d = 1.5\n"
+                                   "u64 e = 18446744073709551615\n"
+                                   "f32 f = c");
+  assert_size(fixture.analyzer.diagnostics.length, ==, 0);
+  assert_uint32(binding_type(&fixture, "a"), ==, U8TypeId);
+  assert_uint32(binding_type(&fixture, "b"), ==, I8TypeId);
+  assert_uint32(binding_type(&fixture, "c"), ==, F32TypeId);
+  assert_uint32(binding_type(&fixture, "d"), ==, F64TypeId);
+  assert_uint32(binding_type(&fixture, "e"), ==, U64TypeId);
+  assert_uint32(binding_type(&fixture, "f"), ==, F32TypeId);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult unknown_type(const MunitParameter params[],
+                         void *user_data_or_fixture) {
+  SourceFixture fixture;
+  analyze_fixture_source(&fixture, "f16 x = 1");
+  assert_single_diagnostic(&fixture, UnknownTypeDiagnostic, "f16");
+  Diagnostic diagnostic = fixture.analyzer.diagnostics.data[0];
+  assert_span_equal((Span){.begin = {.column = 0}, .end = {.column = 3}},
+                    diagnostic.span);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult int_literal_out_of_range(const MunitParameter params[],
+                                     void *user_data_or_fixture) {
+  SourceFixture fixture;
+  analyze_fixture_source(&fixture, "u8 x = 256");
+  assert_single_diagnostic(&fixture, LiteralOutOfRangeDiagnostic, "256");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "i8 x = 128");
+  assert_single_diagnostic(&fixture, LiteralOutOfRangeDiagnostic, "128");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "u64 x = 18446744073709551616");
+  assert_single_diagnostic(&fixture, LiteralOutOfRangeDiagnostic,
+                           "18446744073709551616");
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult float_literal_checks(const MunitParameter params[],
+                                 void *user_data_or_fixture) {
+  SourceFixture fixture;
+  analyze_fixture_source(&fixture, "i32 x = 1.5");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "1.5");
+  stack_allocator_destroy(&fixture.stack);
+  const char *big = "1000000000000000000000000000000000000000.0";
+  analyze_fixture_source(&fixture,
+                         "f32 x = 1000000000000000000000000000000000000000.0\n"
+                         "f64 y = 1000000000000000000000000000000000000000.0");
+  assert_single_diagnostic(&fixture, LiteralOutOfRangeDiagnostic, big);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult symbol_checks(const MunitParameter params[],
+                          void *user_data_or_fixture) {
+  SourceFixture fixture;
+  analyze_fixture_source(&fixture, "f32 x = y");
+  assert_single_diagnostic(&fixture, UndefinedSymbolDiagnostic, "y");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "f32 x = 1\nf64 y = x");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "x");
+  assert_uint32(binding_type(&fixture, "y"), ==, F64TypeId);
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "f32 x = 1\nf32 x = 2");
+  assert_single_diagnostic(&fixture, RedefinitionDiagnostic, "x");
+  assert_span_equal(
+      (Span){.begin = {.line = 1, .column = 4},
+             .end = {.line = 1, .column = 5}},
+      fixture.analyzer.diagnostics.data[0].span);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult binary_op_checks(const MunitParameter params[],
+                             void *user_data_or_fixture) {
+  SourceFixture fixture;
+  analyze_fixture_source(&fixture, "i32 a = 1\n"
+                                   "i32 b = 2 * a + 1\n"
+                                   "bool c = 1 < b");
+  assert_size(fixture.analyzer.diagnostics.length, ==, 0);
+  assert_uint32(binding_type(&fixture, "c"), ==, BoolTypeId);
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "f32 x = 1\ni32 y = x + 1");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "x");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "u8 x = 1\nu8 y = x + 256");
+  assert_single_diagnostic(&fixture, LiteralOutOfRangeDiagnostic, "256");
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult vector_checks(const MunitParameter params[],
+                          void *user_data_or_fixture) {
+  SourceFixture fixture;
+  // Literals broadcast to every lane and are checked against the element.
+  analyze_fixture_source(&fixture, "f32x4 a = 1\nf32x4 b = a * 2.5 / a\n"
+                                   "i32x8 c = 3\ni32x8 d = c - c * 7");
+  assert_size(fixture.analyzer.diagnostics.length, ==, 0);
+  assert_uint32(binding_type(&fixture, "b"), ==, F32x4TypeId);
+  assert_uint32(binding_type(&fixture, "d"), ==, I32x8TypeId);
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "i32x4 a = 1.5");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "1.5");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "i32x4 a = 2147483648");
+  assert_single_diagnostic(&fixture, LiteralOutOfRangeDiagnostic,
+                           "2147483648");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "i32x4 a = 4\ni32x4 b = a / 2");
+  assert_single_diagnostic(&fixture, UnsupportedOperatorDiagnostic, "i32x4");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "f32x8 a = 4\nf32x8 b = a % 2");
+  assert_single_diagnostic(&fixture, UnsupportedOperatorDiagnostic, "f32x8");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "f32x4 a = 4\nbool b = a < a");
+  assert_single_diagnostic(&fixture, UnsupportedOperatorDiagnostic, "f32x4");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "f32x4 a = 4\nf32x8 b = a + 1");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "a");
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+TypeId type_named(SourceFixture *fixture, const char *name) {
+  SymbolId symbol = intern(&fixture->interner,
+                           (StringView){.data = name, .length = strlen(name)});
+  const TypeId *type =
+      type_name_map_find(&fixture->analyzer.type_names, symbol);
+  assert_not_null(type);
+  return *type;
+}
+
+uint32_t field_offset(SourceFixture *fixture, TypeId type, const char *name) {
+  StringView view = {.data = name, .length = strlen(name)};
+  const StructField *field = find_field(&fixture->types, type, view);
+  assert_not_null(field);
+  return field->offset;
+}
+
+MunitResult struct_fields_are_reordered(const MunitParameter params[],
+                                        void *user_data_or_fixture) {
+  SourceFixture fixture;
+  analyze_fixture_source(&fixture,
+                         "struct Packet { u8 tag, f64 value, u16 port, "
+                         "i32 id }\n"
+                         "struct [pinned] Header { u8 tag, f64 value, "
+                         "u16 port, i32 id }");
+  assert_size(fixture.analyzer.diagnostics.length, ==, 0);
+  // Sorting by alignment leaves no holes.
+  TypeId packet = type_named(&fixture, "Packet");
+  const Type *type = lookup_type(&fixture.types, packet);
+  assert_int(type->kind, ==, StructType);
+  assert_uint32(type->size, ==, 16);
+  assert_uint32(type->alignment, ==, 8);
+  assert_uint32(field_offset(&fixture, packet, "value"), ==, 0);
+  assert_uint32(field_offset(&fixture, packet, "id"), ==, 8);
+  assert_uint32(field_offset(&fixture, packet, "port"), ==, 12);
+  assert_uint32(field_offset(&fixture, packet, "tag"), ==, 14);
+  // Pinned fields keep the order and padding of the declaration.
+  TypeId header = type_named(&fixture, "Header");
+  assert_uint32(lookup_type(&fixture.types, header)->size, ==, 24);
+  assert_uint32(field_offset(&fixture, header, "tag"), ==, 0);
+  assert_uint32(field_offset(&fixture, header, "value"), ==, 8);
+  assert_uint32(field_offset(&fixture, header, "port"), ==, 16);
+  assert_uint32(field_offset(&fixture, header, "id"), ==, 20);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult soa_arrays_store_fields_in_columns(const MunitParameter params[],
+                                               void *user_data_or_fixture) {
+  SourceFixture fixture;
+  analyze_fixture_source(&fixture, "struct [soa] Particle { u8 alive, f32 x, "
+                                   "f64 mass }\n"
+                                   "struct Body { u8 alive, f32 x, f64 mass }");
+  assert_size(fixture.analyzer.diagnostics.length, ==, 0);
+  TypeId particle = type_named(&fixture, "Particle");
+  const Type *type = lookup_type(&fixture.types, particle);
+  // One element on its own is laid out like any struct.
+  assert_uint32(type->size, ==, 16);
+  uint32_t alive = (uint32_t)(find_field(&fixture.types, particle,
+                                         (StringView){.data = "alive",
+                                                      .length = 5}) -
+                              type->fields);
+  // Columns of ten masses, ten xs and ten alive flags.
+  assert_uint64(array_size(&fixture.types, particle, 10), ==, 136);
+  assert_uint64(field_offset_in_array(&fixture.types, particle, 0, 3, 10), ==,
+                24);
+  assert_uint64(field_offset_in_array(&fixture.types, particle, 1, 3, 10), ==,
+                92);
+  assert_uint64(
+      field_offset_in_array(&fixture.types, particle, alive, 3, 10), ==, 123);
+  TypeId body = type_named(&fixture, "Body");
+  assert_uint64(array_size(&fixture.types, body, 10), ==, 160);
+  assert_uint64(field_offset_in_array(&fixture.types, body, alive, 3, 10), ==,
+                60);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult struct_checks(const MunitParameter params[],
+                          void *user_data_or_fixture) {
+  SourceFixture fixture;
+  analyze_fixture_source(&fixture,
+                         "struct Vec { f32 x, f32 y }\n"
+                         "struct Ray { Vec origin, u8 depth, Vec dir }\n"
+                         "i32 n = 1");
+  assert_size(fixture.analyzer.diagnostics.length, ==, 0);
+  TypeId ray = type_named(&fixture, "Ray");
+  assert_uint32(lookup_type(&fixture.types, ray)->size, ==, 20);
+  assert_uint32(field_offset(&fixture, ray, "depth"), ==, 16);
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "struct [packed] P { u8 a }");
+  assert_single_diagnostic(&fixture, UnknownAttributeDiagnostic, "packed");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "struct P { u8 a, u16 a }");
+  assert_single_diagnostic(&fixture, RedefinitionDiagnostic, "a");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "struct P { u8 a }\nstruct P { u8 b }");
+  assert_single_diagnostic(&fixture, RedefinitionDiagnostic, "P");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "struct P { P next }");
+  assert_single_diagnostic(&fixture, UnknownTypeDiagnostic, "P");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "struct P { u8 a }\nP p = 1");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "1");
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult slice_checks(const MunitParameter params[],
+                         void *user_data_or_fixture) {
+  SourceFixture fixture;
+  analyze_fixture_source(&fixture, "[]f32 xs = [1, 2.5]\n"
+                                   "f32 y = xs[1] * 2\n"
+                                   "[]f32 e = []\n"
+                                   "u64 i = 0\n"
+                                   "[][]u8 grid = [[1], [2, 3]]\n"
+                                   "u8 z = grid[i][0]");
+  assert_size(fixture.analyzer.diagnostics.length, ==, 0);
+  TypeId floats = binding_type(&fixture, "xs");
+  assert_int(lookup_type(&fixture.types, floats)->kind, ==, SliceType);
+  assert_uint32(lookup_type(&fixture.types, floats)->element, ==, F32TypeId);
+  assert_uint32(binding_type(&fixture, "e"), ==, floats);
+  assert_string_view_equal(
+      (StringView){.data = "[][]u8", .length = 6},
+      lookup_type(&fixture.types, binding_type(&fixture, "grid"))->name);
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "[]u8 xs = [1, 256]");
+  assert_single_diagnostic(&fixture, LiteralOutOfRangeDiagnostic, "256");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "f32 x = 1\nf32 y = x[0]");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "f32");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "[]f32 xs = [1]\ni32 y = xs[0]");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "f32");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "[]f32 xs = [1]\ni32 i = 0\nf32 y = xs[i]");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "i");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "[]f32 xs = [1]\n[]f32 ys = xs + xs");
+  assert_single_diagnostic(&fixture, UnsupportedOperatorDiagnostic, "[]f32");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "f32 x = [1]");
+  assert_size(fixture.analyzer.diagnostics.length, ==, 1);
+  assert_int(fixture.analyzer.diagnostics.data[0].kind, ==,
+             TypeMismatchDiagnostic);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult function_checks(const MunitParameter params[],
+                            void *user_data_or_fixture) {
+  SourceFixture fixture;
+  analyze_fixture_source(&fixture, "i64 fact(i64 n) = n * fact(n - 1)\n"
+                                   "f32 first([]f32 xs) = xs[0]\n"
+                                   "i64 x = fact(3)\n"
+                                   "f32 y = first([1, 2])");
+  assert_size(fixture.analyzer.diagnostics.length, ==, 0);
+  const Type *fact =
+      lookup_type(&fixture.types, binding_type(&fixture, "fact"));
+  assert_int(fact->kind, ==, FunctionType);
+  assert_uint32(fact->element, ==, I64TypeId);
+  assert_uint32(fact->parameter_count, ==, 1);
+  assert_string_view_equal(
+      (StringView){.data = "([]f32) -> f32", .length = 14},
+      lookup_type(&fixture.types, binding_type(&fixture, "first"))->name);
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "i64 f(i64 a) = a\ni64 x = f(1, 2)");
+  assert_single_diagnostic(&fixture, ArgumentCountDiagnostic, "f");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "i64 f(i64 a) = a\nf32 x = f(1)");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "f");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "i64 a = 1\ni64 x = a(1)");
+  assert_single_diagnostic(&fixture, NotCallableDiagnostic, "a");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "i64 a = 1\ni64 f(i64 b) = a + b");
+  assert_single_diagnostic(&fixture, OuterBindingDiagnostic, "a");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "i64 f(i64 a, i64 a) = a");
+  assert_single_diagnostic(&fixture, RedefinitionDiagnostic, "a");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "i64 f(i64 a) = a\ni64 x = f");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "f");
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult generic_checks(const MunitParameter params[],
+                           void *user_data_or_fixture) {
+  SourceFixture fixture;
+  analyze_fixture_source(&fixture, "T add<T>(T a, T b) = a + b * 2\n"
+                                   "T zero<T>() = 0\n"
+                                   "f32 x = add(1.5, 2)\n"
+                                   "u8 y = add(1, 2)\n"
+                                   "i64 z = zero()");
+  assert_size(fixture.analyzer.diagnostics.length, ==, 0);
+  const Type *add = lookup_type(&fixture.types, binding_type(&fixture, "add"));
+  assert_int(lookup_type(&fixture.types, add->element)->kind, ==,
+             TypeParameterType);
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "T id<T>(T x) = x\nbool b = id(1 < 2)");
+  assert_single_diagnostic(&fixture, TypeArgumentDiagnostic, "bool");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "T zero<T>() = 0\nzero()");
+  assert_single_diagnostic(&fixture, UninferredTypeArgumentDiagnostic,
+                           "zero");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "T add<T>(T a, T b) = a + b\n"
+                                   "f32 a = 1\n"
+                                   "f64 b = 2\n"
+                                   "add(a, b)");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "b");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "T id<T>(T x) = x\nT f<T>(T x) = id(x)");
+  assert_single_diagnostic(&fixture, GenericCallDiagnostic, "id");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "T first<T>([]T xs) = xs[0]");
+  assert_single_diagnostic(&fixture, GenericSliceDiagnostic, "T");
+  stack_allocator_destroy(&fixture.stack);
+  analyze_fixture_source(&fixture, "T f<T>(T x) = x * 1.5");
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "1.5");
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult shared_nodes_report_at_their_own_line(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  SourceFixture fixture;
+  source_fixture_init(&fixture);
+  HashConsTable table;
+  hash_cons_table_init(&table, fixture.allocator);
+  Parser parser = {.allocator = fixture.allocator, .hash_cons = &table};
+  Module module =
+      parse_module(&parser,
+                   (Cursor){.input = "f64 a = 1.5\nf32 b = 2\ni32 c = 1.5"})
+          .module;
+  assert_true(module.shared);
+  assert_ptr_equal(module.expressions[0].value.assign.value,
+                   module.expressions[2].value.assign.value);
+  analyze_module(&fixture.analyzer, module);
+  assert_single_diagnostic(&fixture, TypeMismatchDiagnostic, "1.5");
+  assert_span_equal(
+      (Span){.begin = {.line = 2, .column = 4},
+             .end = {.line = 2, .column = 5}},
+      fixture.analyzer.diagnostics.data[0].span);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult shared_calls_report_at_their_own_line(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  SourceFixture fixture;
+  source_fixture_init(&fixture);
+  HashConsTable table;
+  hash_cons_table_init(&table, fixture.allocator);
+  Parser parser = {.allocator = fixture.allocator, .hash_cons = &table};
+  Module module = parse_module(&parser,
+                               (Cursor){.input = "i64 f(i64 a) = a\n"
+                                                 "i64 x = f(1.5)\n"
+                                                 "i64 y = f(1.5)"})
+                      .module;
+  assert_ptr_equal(module.expressions[1].value.assign.value,
+                   module.expressions[2].value.assign.value);
+  analyze_module(&fixture.analyzer, module);
+  DiagnosticArray diagnostics = fixture.analyzer.diagnostics;
+  assert_size(diagnostics.length, ==, 2);
+  assert_uint32(diagnostics.data[0].span.begin.line, ==, 1);
+  assert_uint32(diagnostics.data[1].span.begin.line, ==, 2);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitTest semantic_tests[] = {
+    {
+        .name = "/well_typed_bindings",
+        .test = well_typed_bindings,
+    },
+    {
+        .name = "/unknown_type",
+        .test = unknown_type,
+    },
+    {
+        .name = "/int_literal_out_of_range",
+        .test = int_literal_out_of_range,
+    },
+    {
+        .name = "/float_literal_checks",
+        .test = float_literal_checks,
+    },
+    {
+        .name = "/symbol_checks",
+        .test = symbol_checks,
+    },
+    {
+        .name = "/binary_op_checks",
+        .test = binary_op_checks,
+    },
+    {
+        .name = "/vector_checks",
+        .test = vector_checks,
+    },
+    {
+        .name = "/struct_fields_are_reordered",
+        .test = struct_fields_are_reordered,
+    },
+    {
+        .name = "/soa_arrays_store_fields_in_columns",
+        .test = soa_arrays_store_fields_in_columns,
+    },
+    {
+        .name = "/struct_checks",
+        .test = struct_checks,
+    },
+    {
+        .name = "/slice_checks",
+        .test = slice_checks,
+    },
+    {
+        .name = "/function_checks",
+        .test = function_checks,
+    },
+    {
+        .name = "/generic_checks",
+        .test = generic_checks,
+    },
+    {
+        .name = "/shared_nodes_report_at_their_own_line",
+        .test = shared_nodes_report_at_their_own_line,
+    },
+    {
+        .name = "/shared_calls_report_at_their_own_line",
+        .test = shared_calls_report_at_their_own_line,
+    },
+    {}};
+
+MunitSuite semantic_suite = {
+    .prefix = "/semantic",
+    .tests = semantic_tests,
+    .iterations = 1,
+};
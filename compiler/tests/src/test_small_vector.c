@@ -0,0 +1,66 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "allocator.h"
+#include "small_vector.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+
+typedef SmallVector(uint64_t, 4) SmallUint64s;
+
+MunitResult stays_inline_until_full(const MunitParameter params[],
+                                    void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 10);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  SmallUint64s vector = {};
+  for (uint64_t i = 0; i < 4; ++i) {
+    small_vector_push(allocator, &vector, i * 10);
+  }
+  assert_ptr_equal(stack.current_position, stack.base);
+  assert_size(vector.capacity, ==, 0);
+  assert_ptr_equal(small_vector_data(&vector), vector.inline_storage);
+  SmallUint64s copy = vector;
+  assert_uint64(small_vector_data(&copy)[3], ==, 30);
+  assert_uint64(small_vector_pop(&vector), ==, 30);
+  assert_size(vector.length, ==, 3);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult spills_to_allocator(const MunitParameter params[],
+                                void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  SmallUint64s vector = {};
+  for (uint64_t i = 0; i < 100; ++i) {
+    small_vector_push(allocator, &vector, i * 10);
+  }
+  assert_size(vector.length, ==, 100);
+  assert_size(vector.capacity, >=, 100);
+  assert_ptr_equal(small_vector_data(&vector), vector.heap);
+  for (uint64_t i = 0; i < 100; ++i) {
+    assert_uint64(small_vector_data(&vector)[i], ==, i * 10);
+  }
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitTest small_vector_tests[] = {
+    {
+        .name = "/stays_inline_until_full",
+        .test = stays_inline_until_full,
+    },
+    {
+        .name = "/spills_to_allocator",
+        .test = spills_to_allocator,
+    },
+    {}};
+
+MunitSuite small_vector_suite = {
+    .prefix = "/small_vector",
+    .tests = small_vector_tests,
+    .iterations = 1,
+};
@@ -0,0 +1,106 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "allocator.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+#include <string.h>
+
+MunitResult allocates_aligned_memory(const MunitParameter params[],
+                                     void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 8);
+  Allocator allocator = {.allocate = stack_allocate, .state = &stack};
+  uint8_t *byte = allocate(allocator, uint8_t);
+  uint64_t *word = allocate(allocator, uint64_t);
+  assert_size((size_t)word % _Alignof(uint64_t), ==, 0);
+  assert_ptr(word, >, byte);
+  assert_int(stack.pages, ==, DefaultPages);
+  stack_allocator_reset(&stack);
+  assert_ptr_equal(allocate(allocator, uint8_t), byte);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult resizes_most_recent_allocation(const MunitParameter params[],
+                                          void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 64);
+  uint8_t *first = stack_allocate(&stack, 8, 1);
+  assert_true(stack_resize(&stack, first, 8, 32));
+  assert_ptr_equal(stack.current_position, first + 32);
+  assert_false(stack_resize(&stack, first, 32, 128));
+  uint8_t *second = stack_allocate(&stack, 8, 1);
+  assert_false(stack_resize(&stack, first, 32, 40));
+  assert_true(stack_resize(&stack, second, 8, 4));
+  assert_ptr_equal(stack.current_position, second + 4);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult grows_past_its_first_block(const MunitParameter params[],
+                                      void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 64);
+  uint8_t *first = stack_allocate(&stack, 48, 1);
+  memset(first, 1, 48);
+  // Too large for what is left and for twice the first block.
+  uint8_t *large = stack_allocate(&stack, 200, 8);
+  memset(large, 2, 200);
+  assert_size((size_t)large % 8, ==, 0);
+  assert_ptr_not_null(stack.previous);
+  assert_size(stack.total_size, >=, 208);
+  assert_size(stack_allocator_used(&stack), >=, 248);
+  assert_uint8(first[47], ==, 1);
+  assert_true(stack_resize(&stack, large, 200, 204));
+  stack_allocator_reset(&stack);
+  assert_ptr_null(stack.previous);
+  assert_size(stack_allocator_used(&stack), ==, 0);
+  assert_ptr_equal(stack_allocate(&stack, 8, 8), stack.base);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult huge_pages_fall_back_gracefully(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init_huge_pages(&stack, 3 << 20);
+  assert_size(stack.total_size, >=, 3 << 20);
+  assert_int(stack.pages, >=, DefaultPages);
+  assert_int(stack.pages, <=, HugeTlbPages);
+  assert_string_not_equal(page_kind_name(stack.pages), "unknown pages");
+  Allocator allocator = {.allocate = stack_allocate, .state = &stack};
+  uint64_t *first = allocate(allocator, uint64_t);
+  *first = 1;
+  uint8_t *last = stack.base + stack.total_size - 1;
+  *last = 2;
+  assert_uint64(*first, ==, 1);
+  assert_uint8(*last, ==, 2);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitTest stack_allocator_tests[] = {
+    {
+        .name = "/allocates_aligned_memory",
+        .test = allocates_aligned_memory,
+    },
+    {
+        .name = "/resizes_most_recent_allocation",
+        .test = resizes_most_recent_allocation,
+    },
+    {
+        .name = "/grows_past_its_first_block",
+        .test = grows_past_its_first_block,
+    },
+    {
+        .name = "/huge_pages_fall_back_gracefully",
+        .test = huge_pages_fall_back_gracefully,
+    },
+    {}};
+
+MunitSuite stack_allocator_suite = {
+    .prefix = "/stack_allocator",
+    .tests = stack_allocator_tests,
+    .iterations = 1,
+};
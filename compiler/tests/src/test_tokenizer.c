@@ -549,6 +549,57 @@ MunitResult tokenize_variable_definition(const MunitParameter params[],
   return MUNIT_OK;
 }
 
+MunitResult tokenize_newlines(const MunitParameter params[],
+                              void *user_data_or_fixture) {
+  Cursor cursor = {.input = "x\n\t y\r\n\nz\n"};
+  NextTokenResult actual = next_token(cursor);
+  NextTokenResult expected = {
+      .token =
+          {
+              .kind = SymbolToken,
+              .value.symbol = {.span.end = {.column = 1},
+                               .view = {.data = "x", .length = 1}},
+          },
+      .cursor = (Cursor){.input = "\n\t y\r\n\nz\n", .position.column = 1}};
+  assert_next_token_result_equal(expected, actual);
+  actual = next_token(actual.cursor);
+  expected = (NextTokenResult){
+      .token =
+          {
+              .kind = SymbolToken,
+              .value.symbol = {.span = {.begin = {.line = 1, .column = 2},
+                                        .end = {.line = 1, .column = 3}},
+                               .view = {.data = "y", .length = 1}},
+          },
+      .cursor = (Cursor){.input = "\r\n\nz\n",
+                         .position = {.line = 1, .column = 3}}};
+  assert_next_token_result_equal(expected, actual);
+  actual = next_token(actual.cursor);
+  expected = (NextTokenResult){
+      .token =
+          {
+              .kind = SymbolToken,
+              .value.symbol = {.span = {.begin = {.line = 3, .column = 0},
+                                        .end = {.line = 3, .column = 1}},
+                               .view = {.data = "z", .length = 1}},
+          },
+      .cursor = (Cursor){.input = "\n", .position = {.line = 3, .column = 1}}};
+  assert_next_token_result_equal(expected, actual);
+  actual = next_token(actual.cursor);
+  expected = (NextTokenResult){
+      .token =
+          {
+              .kind = EndOfFileToken,
+              .value.end_of_file = {.span = {.begin = {.line = 4},
+                                             .end = {.line = 4}}},
+          },
+      .cursor = (Cursor){.input = "", .position.line = 4}};
+  assert_next_token_result_equal(expected, actual);
+  munit_assert_size(count_tokens(cursor), ==, 3);
+  munit_assert_size(count_tokens((Cursor){.input = "f(x, 1.5) = [y]"}), ==, 10);
+  return MUNIT_OK;
+}
+
 MunitTest tokenizer_tests[] = {{
                                    .name = "/tokenize_symbol",
                                    .test = tokenize_symbol,
@@ -573,6 +624,10 @@ MunitTest tokenizer_tests[] = {{
                                    .name = "/tokenize_variable_definition",
                                    .test = tokenize_variable_definition,
                                },
+                               {
+                                   .name = "/tokenize_newlines",
+                                   .test = tokenize_newlines,
+                               },
                                {}};
 
 MunitSuite tokenizer_suite = {
@@ -0,0 +1,115 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "concurrent_arena.h"
+#include "test_suites.h"
+#include "trace.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <threads.h>
+
+void trace_arena_init(Tracer *tracer, ConcurrentArena *arena,
+                      size_t buffer_capacity, uint64_t origin_ns) {
+  concurrent_arena_init(arena, 1 << 16);
+  tracer_init(tracer,
+              (Allocator){.allocate = concurrent_arena_allocate,
+                          .resize = concurrent_arena_resize,
+                          .state = arena},
+              buffer_capacity, origin_ns);
+}
+
+MunitResult writes_chrome_trace_events(const MunitParameter params[],
+                                       void *user_data_or_fixture) {
+  ConcurrentArena arena;
+  Tracer tracer;
+  trace_arena_init(&tracer, &arena, 2, 1000);
+  TraceThread thread;
+  trace_thread_init(&thread, &tracer);
+  trace_event(&thread, "parse", "a.yeti", 1000, 3500);
+  trace_event(&thread, "analyze", "a\"b.yeti", 3500, 4000);
+  // The third event starts a second buffer, which is written first.
+  trace_event(&thread, "lower", "a.yeti", 4000, 1004000);
+  char text[2048];
+  FILE *file = tmpfile();
+  tracer_write_json(&tracer, file);
+  rewind(file);
+  text[fread(text, 1, sizeof(text) - 1, file)] = '\0';
+  assert_string_equal(
+      text, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+            "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": 0, \"args\": {\"name\": \"thread 0\"}},\n"
+            "  {\"name\": \"lower\", \"cat\": \"phase\", \"ph\": \"X\", "
+            "\"pid\": 1, \"tid\": 0, \"ts\": 3.000, \"dur\": 1000.000, "
+            "\"args\": {\"file\": \"a.yeti\"}},\n"
+            "  {\"name\": \"parse\", \"cat\": \"phase\", \"ph\": \"X\", "
+            "\"pid\": 1, \"tid\": 0, \"ts\": 0.000, \"dur\": 2.500, "
+            "\"args\": {\"file\": \"a.yeti\"}},\n"
+            "  {\"name\": \"analyze\", \"cat\": \"phase\", \"ph\": \"X\", "
+            "\"pid\": 1, \"tid\": 0, \"ts\": 2.500, \"dur\": 0.500, "
+            "\"args\": {\"file\": \"a\\\"b.yeti\"}}\n"
+            "]}\n");
+  fclose(file);
+  concurrent_arena_destroy(&arena);
+  return MUNIT_OK;
+}
+
+enum { TRACE_WORKER_COUNT = 8, EVENTS_PER_TRACE_WORKER = 10000 };
+
+int32_t trace_worker_main(void *state) {
+  TraceThread thread;
+  trace_thread_init(&thread, state);
+  for (uint64_t i = 0; i < EVENTS_PER_TRACE_WORKER; ++i) {
+    trace_event(&thread, "parse", "a.yeti", i, i + 1);
+  }
+  return 0;
+}
+
+MunitResult threads_record_into_their_own_buffers(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  ConcurrentArena arena;
+  Tracer tracer;
+  trace_arena_init(&tracer, &arena, 64, 0);
+  thrd_t threads[TRACE_WORKER_COUNT];
+  for (uint32_t i = 0; i < TRACE_WORKER_COUNT; ++i) {
+    assert_int(thrd_create(&threads[i], trace_worker_main, &tracer), ==,
+               thrd_success);
+  }
+  for (uint32_t i = 0; i < TRACE_WORKER_COUNT; ++i) {
+    thrd_join(threads[i], nullptr);
+  }
+  assert_uint32(atomic_load(&tracer.threads), ==, TRACE_WORKER_COUNT);
+  size_t events[TRACE_WORKER_COUNT] = {};
+  for (const TraceBuffer *buffer = atomic_load(&tracer.buffers);
+       buffer != nullptr; buffer = buffer->next) {
+    assert_uint32(buffer->thread, <, TRACE_WORKER_COUNT);
+    size_t length = atomic_load(&buffer->length);
+    // Each thread keeps its events in order within a buffer.
+    for (size_t i = 1; i < length; ++i) {
+      assert_uint64(buffer->events[i].begin_ns, ==,
+                    buffer->events[i - 1].end_ns);
+    }
+    events[buffer->thread] += length;
+  }
+  for (uint32_t i = 0; i < TRACE_WORKER_COUNT; ++i) {
+    assert_size(events[i], ==, EVENTS_PER_TRACE_WORKER);
+  }
+  concurrent_arena_destroy(&arena);
+  return MUNIT_OK;
+}
+
+MunitTest trace_tests[] = {
+    {
+        .name = "/writes_chrome_trace_events",
+        .test = writes_chrome_trace_events,
+    },
+    {
+        .name = "/threads_record_into_their_own_buffers",
+        .test = threads_record_into_their_own_buffers,
+    },
+    {}};
+
+MunitSuite trace_suite = {
+    .prefix = "/trace",
+    .tests = trace_tests,
+    .iterations = 1,
+};
@@ -0,0 +1,273 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#define YETI_ENABLE_ALLOCATOR_MACROS
+
+#include "allocator.h"
+#include "array.h"
+#include "hash_map.h"
+#include "stack_allocator.h"
+#include "test_suites.h"
+#include "tracking_allocator.h"
+#include <stdio.h>
+#include <string.h>
+
+static bool tracked_keys_equal(uint64_t a, uint64_t b) { return a == b; }
+
+DEFINE_HASH_MAP(TrackedMap, tracked_map, uint64_t, uint64_t, hash_integer,
+                tracked_keys_equal)
+
+MunitResult tracks_bytes_and_alignment_waste(const MunitParameter params[],
+                                             void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 8);
+  TrackingAllocator tracking;
+  tracking_allocator_init(
+      &tracking, (Allocator){.allocate = stack_allocate, .state = &stack});
+  Allocator allocator = {.allocate = tracking_allocate, .state = &tracking};
+  uint8_t *byte = allocate(allocator, uint8_t);
+  uint64_t *word = allocate(allocator, uint64_t);
+  assert_ptr_equal(word, byte + 8);
+  assert_size(tracking.bytes, ==, 9);
+  assert_size(tracking.allocations, ==, 2);
+  assert_size(tracking.alignment_waste, ==, 7);
+  assert_size(tracking.peak_bytes, ==, 9);
+  stack_allocator_reset(&stack);
+  tracking_allocator_reset(&tracking);
+  allocate(allocator, uint8_t);
+  assert_size(tracking.bytes, ==, 1);
+  assert_size(tracking.allocations, ==, 3);
+  assert_size(tracking.alignment_waste, ==, 7);
+  assert_size(tracking.peak_bytes, ==, 9);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult counts_in_place_resizes(const MunitParameter params[],
+                                    void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 8);
+  TrackingAllocator tracking;
+  tracking_allocator_init(&tracking, (Allocator){.allocate = stack_allocate,
+                                                 .resize = stack_resize,
+                                                 .state = &stack});
+  uint8_t *block = tracking_allocate(&tracking, 16, 8);
+  assert_true(tracking_resize(&tracking, block, 16, 64));
+  assert_size(tracking.bytes, ==, 64);
+  assert_size(tracking.peak_bytes, ==, 64);
+  assert_true(tracking_resize(&tracking, block, 64, 8));
+  assert_size(tracking.bytes, ==, 8);
+  assert_size(tracking.peak_bytes, ==, 64);
+  assert_size(tracking.allocations, ==, 1);
+  uint64_t *word = tracking_allocate(&tracking, 8, 8);
+  assert_ptr_equal(word, block + 8);
+  assert_size(tracking.alignment_waste, ==, 0);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult groups_allocations_by_call_site(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+#ifndef YETI_TRACK_ALLOCATIONS
+  // Call sites are only recorded by builds that track allocations.
+  return MUNIT_SKIP;
+#endif
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 8);
+  TrackingAllocator tracking;
+  tracking_allocator_init(
+      &tracking, (Allocator){.allocate = stack_allocate, .state = &stack});
+  Allocator allocator = {.allocate = tracking_allocate, .state = &tracking};
+  for (size_t i = 0; i < 3; ++i) {
+    allocate(allocator, uint32_t);
+  }
+  const uint32_t line = __LINE__ - 2;
+  tracking_allocate(&tracking, 5, 1);
+  const CallSiteStats *loop = nullptr;
+  const CallSiteStats *unknown = nullptr;
+  for (size_t i = 0; i < TRACKED_CALL_SITE_CAPACITY; ++i) {
+    const CallSiteStats *stats = &tracking.call_sites[i];
+    if (stats->allocations == 0) {
+      continue;
+    }
+    if (stats->call_site.file == nullptr) {
+      unknown = stats;
+    } else {
+      loop = stats;
+    }
+  }
+  assert_ptr_not_null(loop);
+  assert_uint32(loop->call_site.line, ==, line);
+  assert_string_equal(loop->call_site.type_name, "uint32_t");
+  assert_size(loop->allocations, ==, 3);
+  assert_size(loop->bytes, ==, 12);
+  assert_ptr_not_null(unknown);
+  assert_size(unknown->allocations, ==, 1);
+  assert_size(unknown->bytes, ==, 5);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult resizes_are_charged_to_the_allocating_site(
+    const MunitParameter params[], void *user_data_or_fixture) {
+#ifndef YETI_TRACK_ALLOCATIONS
+  // Call sites are only recorded by builds that track allocations.
+  return MUNIT_SKIP;
+#endif
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 8);
+  TrackingAllocator tracking;
+  tracking_allocator_init(&tracking, (Allocator){.allocate = stack_allocate,
+                                                 .resize = stack_resize,
+                                                 .state = &stack});
+  Allocator allocator = {.allocate = tracking_allocate, .state = &tracking};
+  uint64_t *words = allocate(allocator, uint64_t);
+  const uint32_t line = __LINE__ - 1;
+  assert_true(tracking_resize(&tracking, words, sizeof(uint64_t), 40));
+  assert_true(tracking_resize(&tracking, words, 40, 16));
+  const CallSiteStats *site = nullptr;
+  for (size_t i = 0; i < TRACKED_CALL_SITE_CAPACITY; ++i) {
+    const CallSiteStats *stats = &tracking.call_sites[i];
+    if (stats->allocations != 0) {
+      assert_null(site);
+      site = stats;
+    }
+  }
+  assert_ptr_not_null(site);
+  assert_uint32(site->call_site.line, ==, line);
+  assert_size(site->bytes, ==, 16);
+  assert_size(site->allocations, ==, 1);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult charges_array_growth_to_the_push(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+#ifndef YETI_TRACK_ALLOCATIONS
+  // Call sites are only recorded by builds that track allocations.
+  return MUNIT_SKIP;
+#endif
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 10);
+  TrackingAllocator tracking;
+  tracking_allocator_init(
+      &tracking, (Allocator){.allocate = stack_allocate, .state = &stack});
+  Allocator allocator = {.allocate = tracking_allocate, .state = &tracking};
+  Array(uint32_t) numbers = {};
+  for (uint32_t i = 0; i < 20; ++i) {
+    array_push(allocator, &numbers, i);
+  }
+  const uint32_t line = __LINE__ - 2;
+  const CallSiteStats *site = nullptr;
+  for (size_t i = 0; i < TRACKED_CALL_SITE_CAPACITY; ++i) {
+    const CallSiteStats *stats = &tracking.call_sites[i];
+    if (stats->allocations != 0) {
+      assert_null(site);
+      site = stats;
+    }
+  }
+  assert_ptr_not_null(site);
+  assert_uint32(site->call_site.line, ==, line);
+  assert_string_equal(site->call_site.type_name, "Array");
+  assert_size(site->bytes, ==, tracking.bytes);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult charges_map_growth_to_the_insert(const MunitParameter params[],
+                                             void *user_data_or_fixture) {
+#ifndef YETI_TRACK_ALLOCATIONS
+  // Call sites are only recorded by builds that track allocations.
+  return MUNIT_SKIP;
+#endif
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  TrackingAllocator tracking;
+  tracking_allocator_init(
+      &tracking, (Allocator){.allocate = stack_allocate, .state = &stack});
+  Allocator allocator = {.allocate = tracking_allocate, .state = &tracking};
+  TrackedMap map = {};
+  for (uint64_t i = 0; i < 40; ++i) {
+    map_insert(tracked_map, allocator, &map, i, i);
+  }
+  const uint32_t line = __LINE__ - 2;
+  const CallSiteStats *site = nullptr;
+  for (size_t i = 0; i < TRACKED_CALL_SITE_CAPACITY; ++i) {
+    const CallSiteStats *stats = &tracking.call_sites[i];
+    if (stats->allocations != 0) {
+      assert_null(site);
+      site = stats;
+    }
+  }
+  assert_ptr_not_null(site);
+  assert_string_equal(site->call_site.file, __FILE__);
+  assert_uint32(site->call_site.line, ==, line);
+  assert_string_equal(site->call_site.type_name, "TrackedMap");
+  assert_size(site->bytes, ==, tracking.bytes);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult writes_json_report(const MunitParameter params[],
+                               void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 8);
+  TrackingAllocator tracking;
+  tracking_allocator_init(
+      &tracking, (Allocator){.allocate = stack_allocate, .state = &stack});
+  tracking_allocate(&tracking, 16, 8);
+  FILE *file = tmpfile();
+  assert_ptr_not_null(file);
+  tracking_allocator_write_json(&tracking, file);
+  rewind(file);
+  char buffer[512] = {};
+  fread(buffer, 1, sizeof(buffer) - 1, file);
+  fclose(file);
+  assert_string_equal(buffer, "{\n"
+                              "  \"bytes\": 16,\n"
+                              "  \"allocations\": 1,\n"
+                              "  \"alignment_waste\": 0,\n"
+                              "  \"peak_bytes\": 16,\n"
+                              "  \"call_sites\": [\n"
+                              "    {\"file\": null, \"line\": 0, \"type_name\": "
+                              "null, \"bytes\": 16, \"allocations\": 1}\n"
+                              "  ]\n"
+                              "}\n");
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitTest tracking_allocator_tests[] = {
+    {
+        .name = "/tracks_bytes_and_alignment_waste",
+        .test = tracks_bytes_and_alignment_waste,
+    },
+    {
+        .name = "/counts_in_place_resizes",
+        .test = counts_in_place_resizes,
+    },
+    {
+        .name = "/groups_allocations_by_call_site",
+        .test = groups_allocations_by_call_site,
+    },
+    {
+        .name = "/resizes_are_charged_to_the_allocating_site",
+        .test = resizes_are_charged_to_the_allocating_site,
+    },
+    {
+        .name = "/charges_array_growth_to_the_push",
+        .test = charges_array_growth_to_the_push,
+    },
+    {
+        .name = "/charges_map_growth_to_the_insert",
+        .test = charges_map_growth_to_the_insert,
+    },
+    {
+        .name = "/writes_json_report",
+        .test = writes_json_report,
+    },
+    {}};
+
+MunitSuite tracking_allocator_suite = {
+    .prefix = "/tracking_allocator",
+    .tests = tracking_allocator_tests,
+    .iterations = 1,
+};
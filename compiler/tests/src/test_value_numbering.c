@@ -0,0 +1,129 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "bytecode.h"
+#include "lower.h"
+#include "source_fixture.h"
+#include "test_suites.h"
+#include "value_numbering.h"
+#include "vm.h"
+
+VmResult run_numbered(SourceFixture *fixture, const IrFunction *function) {
+  BytecodeFunction bytecode =
+      compile_bytecode(fixture->allocator, function, &fixture->types);
+  uint64_t registers[64];
+  assert_uint32(bytecode.register_count, <=, 64);
+  return vm_run(&bytecode, registers);
+}
+
+size_t count_opcode(const IrFunction *function, IrOpcode opcode) {
+  size_t count = 0;
+  for (size_t i = 0; i < function->instructions.length; ++i) {
+    count += function->instructions.data[i].opcode == opcode;
+  }
+  return count;
+}
+
+MunitResult merges_repeated_expressions(const MunitParameter params[],
+                                        void *user_data_or_fixture) {
+  SourceFixture fixture;
+  IrFunction function = lower_fixture_source(
+      &fixture, "i64 a = 6\ni64 b = a * 7 + a * 7\ni64 c = b - a * 7");
+  VmResult expected = run_numbered(&fixture, &function);
+  ValueNumberingStats stats =
+      number_values(fixture.allocator, &function, &fixture.types);
+  // The second and third a * 7, each with its own constant 7.
+  assert_size(stats.removed, ==, 4);
+  assert_size(count_opcode(&function, MulOp), ==, 1);
+  assert_size(count_opcode(&function, ConstOp), ==, 2);
+  assert_true(ir_verify(&function, &fixture.types).valid);
+  VmResult actual = run_numbered(&fixture, &function);
+  assert_int(actual.status, ==, VmOk);
+  assert_uint64(actual.value, ==, expected.value);
+  assert_uint64(actual.value, ==, 42);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult commutative_operands_are_sorted(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+  SourceFixture fixture;
+  source_fixture_init(&fixture);
+  Allocator allocator = fixture.allocator;
+  IrFunction function = {.return_type = I64TypeId};
+  IrValue x = ir_param(allocator, &function, I64TypeId);
+  IrValue y = ir_param(allocator, &function, I64TypeId);
+  IrValue f = ir_param(allocator, &function, F32TypeId);
+  IrValue g = ir_param(allocator, &function, F32TypeId);
+  IrValue sum = ir_binary(allocator, &function, AddOp, I64TypeId, x, y);
+  ir_binary(allocator, &function, AddOp, I64TypeId, y, x);
+  ir_binary(allocator, &function, SubOp, I64TypeId, x, y);
+  ir_binary(allocator, &function, SubOp, I64TypeId, y, x);
+  // Float addition keeps its order, which decides the NaN it returns.
+  ir_binary(allocator, &function, AddOp, F32TypeId, f, g);
+  ir_binary(allocator, &function, AddOp, F32TypeId, g, f);
+  ir_binary(allocator, &function, EqOp, BoolTypeId, f, g);
+  ir_binary(allocator, &function, EqOp, BoolTypeId, g, f);
+  ir_return(allocator, &function, sum);
+  ir_end_block(allocator, &function);
+  ValueNumberingStats stats =
+      number_values(allocator, &function, &fixture.types);
+  assert_size(stats.removed, ==, 2);
+  assert_size(count_opcode(&function, AddOp), ==, 3);
+  assert_size(count_opcode(&function, SubOp), ==, 2);
+  assert_size(count_opcode(&function, EqOp), ==, 1);
+  assert_true(ir_verify(&function, &fixture.types).valid);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitResult lanes_types_and_calls_stay_apart(const MunitParameter params[],
+                                             void *user_data_or_fixture) {
+  SourceFixture fixture;
+  source_fixture_init(&fixture);
+  Allocator allocator = fixture.allocator;
+  IrFunction function = {.return_type = I64TypeId};
+  IrValue vector = ir_param(allocator, &function, F32x4TypeId);
+  ir_extract(allocator, &function, F32TypeId, vector, 0);
+  ir_extract(allocator, &function, F32TypeId, vector, 1);
+  ir_extract(allocator, &function, F32TypeId, vector, 0);
+  ir_constant(allocator, &function, I32TypeId, 1);
+  IrValue one = ir_constant(allocator, &function, I64TypeId, 1);
+  ir_constant(allocator, &function, I64TypeId, 1);
+  // Identical calls are both made.
+  ir_call(allocator, &function, I64TypeId, 0, &one, 1);
+  IrValue call = ir_call(allocator, &function, I64TypeId, 0, &one, 1);
+  ir_return(allocator, &function, call);
+  ir_end_block(allocator, &function);
+  ValueNumberingStats stats =
+      number_values(allocator, &function, &fixture.types);
+  assert_size(stats.removed, ==, 2);
+  assert_size(count_opcode(&function, ExtractOp), ==, 2);
+  assert_size(count_opcode(&function, ConstOp), ==, 2);
+  assert_size(count_opcode(&function, ArgOp), ==, 2);
+  assert_size(count_opcode(&function, CallOp), ==, 2);
+  assert_true(ir_verify(&function, &fixture.types).valid);
+  stack_allocator_destroy(&fixture.stack);
+  return MUNIT_OK;
+}
+
+MunitTest value_numbering_tests[] = {
+    {
+        .name = "/merges_repeated_expressions",
+        .test = merges_repeated_expressions,
+    },
+    {
+        .name = "/commutative_operands_are_sorted",
+        .test = commutative_operands_are_sorted,
+    },
+    {
+        .name = "/lanes_types_and_calls_stay_apart",
+        .test = lanes_types_and_calls_stay_apart,
+    },
+    {}};
+
+MunitSuite value_numbering_suite = {
+    .prefix = "/value_numbering",
+    .tests = value_numbering_tests,
+    .iterations = 1,
+};
@@ -0,0 +1,254 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "bytecode.h"
+#include "jit.h"
+#include "lower.h"
+#include "optimize.h"
+#include "source_fixture.h"
+#include "test_suites.h"
+#include "vectorize.h"
+#include "vm.h"
+#include "x64.h"
+#include <stdio.h>
+
+typedef struct {
+  SourceFixture source;
+  IrFunction function;
+} Chains;
+
+// Independent chains a<j>_<i> = a<j>_<i-1> * c + d summed at the end. The
+// IR is left unfolded so there is arithmetic to vectorize.
+void lower_chains(Chains *chains, const char *type, size_t lanes,
+                  size_t rounds) {
+  char source[8192];
+  bool is_float = type[0] == 'f';
+  size_t length = 0;
+  for (size_t j = 0; j < lanes; ++j) {
+    length += snprintf(source + length, sizeof(source) - length,
+                       is_float ? "%s a%zu_0 = %zu.5\n" : "%s a%zu_0 = %zu\n",
+                       type, j, j);
+  }
+  for (size_t i = 1; i <= rounds; ++i) {
+    for (size_t j = 0; j < lanes; ++j) {
+      length += snprintf(source + length, sizeof(source) - length,
+                         is_float ? "%s a%zu_%zu = a%zu_%zu * 0.75 + 1\n"
+                                  : "%s a%zu_%zu = a%zu_%zu * 3 - 1\n",
+                         type, j, i, j, i - 1);
+    }
+  }
+  length += snprintf(source + length, sizeof(source) - length,
+                     "%s sum = a0_%zu", type, rounds);
+  for (size_t j = 1; j < lanes; ++j) {
+    length += snprintf(source + length, sizeof(source) - length,
+                       " + a%zu_%zu", j, rounds);
+  }
+  chains->function = lower_fixture_source(&chains->source, source);
+}
+
+VmResult run_chains(Chains *chains) {
+  BytecodeFunction bytecode = compile_bytecode(
+      chains->source.allocator, &chains->function, &chains->source.types);
+  uint64_t registers[1024];
+  assert_uint32(bytecode.register_count, <=, 1024);
+  return vm_run(&bytecode, registers);
+}
+
+size_t count_remarks(const VectorizeResult *result, VectorizeRemarkKind kind) {
+  size_t count = 0;
+  for (size_t i = 0; i < result->remarks.length; ++i) {
+    count += result->remarks.data[i].kind == kind;
+  }
+  return count;
+}
+
+MunitResult packs_independent_chains(const MunitParameter params[],
+                                     void *user_data_or_fixture) {
+  Chains chains;
+  lower_chains(&chains, "f32", 8, 6);
+  VmResult expected = run_chains(&chains);
+  VectorizeResult result =
+      vectorize(chains.source.allocator, &chains.function, &avx2_target);
+  // A mul and an add per round, each eight lanes wide.
+  assert_uint32(result.vectorized, ==, 12);
+  assert_uint32(result.instructions_replaced, ==, 96);
+  assert_size(count_remarks(&result, VectorizedRemark), ==, 12);
+  assert_true(ir_verify(&chains.function, &chains.source.types).valid);
+  size_t vector_ops = 0;
+  size_t extracts = 0;
+  for (size_t i = 0; i < chains.function.instructions.length; ++i) {
+    IrInstruction instruction = chains.function.instructions.data[i];
+    vector_ops += instruction.type == F32x8TypeId &&
+                  (instruction.opcode == AddOp || instruction.opcode == MulOp);
+    extracts += instruction.opcode == ExtractOp;
+  }
+  assert_size(vector_ops, ==, 12);
+  // Only the last round is read as scalars, by the sum.
+  assert_size(extracts, ==, 8);
+  VmResult actual = run_chains(&chains);
+  assert_int(actual.status, ==, expected.status);
+  assert_uint64(actual.value, ==, expected.value);
+  stack_allocator_destroy(&chains.source.stack);
+  return MUNIT_OK;
+}
+
+// The VM and the JIT must give the scalar program's result.
+MunitResult vectorized_code_matches_scalar_code(const MunitParameter params[],
+                                                void *user_data_or_fixture) {
+  static const struct {
+    const char *type;
+    size_t lanes;
+    const VectorTarget *target;
+  } cases[] = {
+      {"f32", 8, &avx2_target}, {"f32", 12, &avx2_target},
+      {"f32", 12, &sse2_target}, {"i32", 8, &avx2_target},
+      {"i32", 13, &avx2_target}, {"f32", 4, &sse2_target},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    Chains chains;
+    lower_chains(&chains, cases[i].type, cases[i].lanes, 6);
+    VmResult expected = run_chains(&chains);
+    VectorizeResult result =
+        vectorize(chains.source.allocator, &chains.function, cases[i].target);
+    assert_uint32(result.vectorized, >, 0);
+    assert_true(ir_verify(&chains.function, &chains.source.types).valid);
+    VmResult actual = run_chains(&chains);
+    assert_int(actual.status, ==, expected.status);
+    assert_uint64(actual.value, ==, expected.value);
+#ifdef __x86_64__
+    X64CompileResult compiled = x64_compile(
+        chains.source.allocator, &chains.function, &chains.source.types);
+    JitFunction function = jit_load(&compiled.code);
+    if (function.entry != nullptr) {
+      uint64_t value[4] = {};
+      assert_int(function.entry(value), ==, VmOk);
+      jit_release(&function);
+      assert_uint64(value[0], ==, expected.value);
+    }
+#endif
+    stack_allocator_destroy(&chains.source.stack);
+  }
+  return MUNIT_OK;
+}
+
+MunitResult leftover_lanes_stay_scalar(const MunitParameter params[],
+                                       void *user_data_or_fixture) {
+  Chains chains;
+  lower_chains(&chains, "f32", 10, 6);
+  VectorizeResult result =
+      vectorize(chains.source.allocator, &chains.function, &avx2_target);
+  assert_uint32(result.vectorized, ==, 12);
+  // Two chains of every round are left over after the eight lane groups.
+  assert_size(count_remarks(&result, TooFewLanesRemark), ==, 12);
+  for (size_t i = 0; i < result.remarks.length; ++i) {
+    if (result.remarks.data[i].kind == TooFewLanesRemark) {
+      assert_uint32(result.remarks.data[i].lanes, ==, 2);
+    }
+  }
+  assert_true(ir_verify(&chains.function, &chains.source.types).valid);
+  stack_allocator_destroy(&chains.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult sse2_has_no_packed_i32_multiply(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+  Chains chains;
+  lower_chains(&chains, "i32", 4, 6);
+  VectorizeResult result =
+      vectorize(chains.source.allocator, &chains.function, &sse2_target);
+  assert_size(count_remarks(&result, UnsupportedOperationRemark), ==, 6);
+  for (size_t i = 0; i < result.remarks.length; ++i) {
+    VectorizeRemark remark = result.remarks.data[i];
+    assert_true(remark.kind != VectorizedRemark || remark.opcode != MulOp);
+  }
+  stack_allocator_destroy(&chains.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult short_chains_are_not_profitable(const MunitParameter params[],
+                                            void *user_data_or_fixture) {
+  Chains chains;
+  lower_chains(&chains, "f32", 4, 1);
+  size_t length = chains.function.instructions.length;
+  VectorizeResult result =
+      vectorize(chains.source.allocator, &chains.function, &avx2_target);
+  assert_uint32(result.vectorized, ==, 0);
+  // Gathering four scalars and extracting four costs more than it saves.
+  assert_size(count_remarks(&result, NotProfitableRemark), ==, 2);
+  VectorizeRemark remark = result.remarks.data[0];
+  assert_uint32(remark.scalar_cost, ==, 8);
+  assert_uint32(remark.vector_cost, >=, 8);
+  assert_size(chains.function.instructions.length, ==, length);
+  stack_allocator_destroy(&chains.source.stack);
+  return MUNIT_OK;
+}
+
+// The driver folds everything it can before vectorizing, so only chains
+// seeded by values it cannot fold, here float remainders, are left. They
+// have to run long enough to pay for gathering the seeds.
+MunitResult packs_chains_left_by_the_driver_passes(
+    const MunitParameter params[], void *user_data_or_fixture) {
+  const char *source =
+      "f32 s0 = 7.5 % 2\n"
+      "f32 s1 = 9.5 % 4\n"
+      "f32 s2 = 3.5 % 2\n"
+      "f32 s3 = 8.5 % 3\n"
+      "f32 a0 = ((((((s0 * 2 + 1) * 3 - 4) * 5 + 6) * 7 - 8) * 9 + 10) * 11)\n"
+      "f32 a1 = ((((((s1 * 2 + 1) * 3 - 4) * 5 + 6) * 7 - 8) * 9 + 10) * 11)\n"
+      "f32 a2 = ((((((s2 * 2 + 1) * 3 - 4) * 5 + 6) * 7 - 8) * 9 + 10) * 11)\n"
+      "f32 a3 = ((((((s3 * 2 + 1) * 3 - 4) * 5 + 6) * 7 - 8) * 9 + 10) * 11)\n"
+      "f32 sum = a0 + a1 + a2 + a3";
+  Chains chains;
+  Module module = check_fixture_source(&chains.source, source);
+  IrModule program = lower_program(&chains.source.analyzer, module);
+  assert_size(program.functions.length, ==, 1);
+  chains.function = program.functions.data[0];
+  PassStats stats[PassCount];
+  optimize(chains.source.allocator, &chains.function, &chains.source.types,
+           stats);
+  VmResult expected = run_chains(&chains);
+  VectorizeResult result =
+      vectorize(chains.source.allocator, &chains.function, &sse2_target);
+  // Eleven rounds of arithmetic per seed, each four lanes wide.
+  assert_uint32(result.vectorized, ==, 11);
+  assert_uint32(result.instructions_replaced, ==, 44);
+  assert_true(ir_verify(&chains.function, &chains.source.types).valid);
+  VmResult actual = run_chains(&chains);
+  assert_int(actual.status, ==, expected.status);
+  assert_uint64(actual.value, ==, expected.value);
+  stack_allocator_destroy(&chains.source.stack);
+  return MUNIT_OK;
+}
+
+MunitTest vectorize_tests[] = {
+    {
+        .name = "/packs_independent_chains",
+        .test = packs_independent_chains,
+    },
+    {
+        .name = "/vectorized_code_matches_scalar_code",
+        .test = vectorized_code_matches_scalar_code,
+    },
+    {
+        .name = "/leftover_lanes_stay_scalar",
+        .test = leftover_lanes_stay_scalar,
+    },
+    {
+        .name = "/sse2_has_no_packed_i32_multiply",
+        .test = sse2_has_no_packed_i32_multiply,
+    },
+    {
+        .name = "/short_chains_are_not_profitable",
+        .test = short_chains_are_not_profitable,
+    },
+    {
+        .name = "/packs_chains_left_by_the_driver_passes",
+        .test = packs_chains_left_by_the_driver_passes,
+    },
+    {}};
+
+MunitSuite vectorize_suite = {
+    .prefix = "/vectorize",
+    .tests = vectorize_tests,
+    .iterations = 1,
+};
@@ -0,0 +1,206 @@
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "assertions.h"
+#include "bytecode.h"
+#include "source_fixture.h"
+#include "test_suites.h"
+#include "vm.h"
+#include <string.h>
+
+typedef struct {
+  SourceFixture source;
+  BytecodeFunction function;
+} Fixture;
+
+// Compiles without folding so the interpreter does the arithmetic.
+void compile_source(Fixture *fixture, const char *source) {
+  IrFunction ir = lower_fixture_source(&fixture->source, source);
+  fixture->function =
+      compile_bytecode(fixture->source.allocator, &ir, &fixture->source.types);
+}
+
+// Runs both dispatch loops and checks that they agree.
+VmResult run(Fixture *fixture) {
+  uint64_t registers[64];
+  assert_uint32(fixture->function.register_count, <=, 64);
+  VmResult threaded = vm_run(&fixture->function, registers);
+  VmResult switched = vm_run_switch(&fixture->function, registers);
+  assert_int(threaded.status, ==, switched.status);
+  assert_uint64(threaded.value, ==, switched.value);
+  return threaded;
+}
+
+MunitResult integer_arithmetic(const MunitParameter params[],
+                               void *user_data_or_fixture) {
+  Fixture fixture;
+  compile_source(&fixture, "i64 x = 7\ni64 y = (x * 6 - 2) / 4 % 7");
+  assert_uint64(run(&fixture).value, ==, 3);
+  stack_allocator_destroy(&fixture.source.stack);
+  compile_source(&fixture, "i8 a = 100\ni8 b = a + a");
+  assert_int64((int64_t)run(&fixture).value, ==, -56);
+  stack_allocator_destroy(&fixture.source.stack);
+  compile_source(&fixture, "u16 a = 1\nu16 b = 0 - a");
+  assert_uint64(run(&fixture).value, ==, 0xffff);
+  stack_allocator_destroy(&fixture.source.stack);
+  compile_source(&fixture, "i32 a = 1\ni32 b = 0 - a\nbool c = b < a");
+  assert_uint64(run(&fixture).value, ==, 1);
+  stack_allocator_destroy(&fixture.source.stack);
+  compile_source(&fixture, "u32 a = 1\nu32 b = 0 - a\nbool c = b >= a");
+  assert_uint64(run(&fixture).value, ==, 1);
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult float_arithmetic(const MunitParameter params[],
+                             void *user_data_or_fixture) {
+  Fixture fixture;
+  compile_source(&fixture, "f32 x = 16777216\nf32 y = x + 1");
+  uint32_t narrow = (uint32_t)run(&fixture).value;
+  float single;
+  memcpy(&single, &narrow, sizeof(single));
+  assert_float(single, ==, 16777216.0f);
+  stack_allocator_destroy(&fixture.source.stack);
+  compile_source(&fixture, "f64 x = 7.5\nf64 y = x % 2 + x / 2");
+  uint64_t bits = run(&fixture).value;
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  assert_double(value, ==, 5.25);
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult division_traps(const MunitParameter params[],
+                           void *user_data_or_fixture) {
+  Fixture fixture;
+  compile_source(&fixture, "u8 x = 0\nu8 y = 1 / x");
+  assert_int(run(&fixture).status, ==, VmDivisionByZero);
+  stack_allocator_destroy(&fixture.source.stack);
+  compile_source(&fixture, "i64 x = 9223372036854775807\n"
+                           "i64 min = 0 - x - 1\n"
+                           "i64 y = min / (0 - 1)");
+  assert_int(run(&fixture).status, ==, VmDivisionOverflow);
+  stack_allocator_destroy(&fixture.source.stack);
+  compile_source(&fixture,
+                 "i8 x = 127\ni8 min = 0 - x - 1\ni8 y = min / (0 - 1)");
+  VmResult result = run(&fixture);
+  assert_int(result.status, ==, VmOk);
+  assert_int64((int64_t)result.value, ==, -128);
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult vector_arithmetic(const MunitParameter params[],
+                              void *user_data_or_fixture) {
+  Fixture fixture;
+  compile_source(&fixture, "i32x8 a = 7\ni32x8 b = a * a - 2147483647 - 100");
+  VmResult result = run(&fixture);
+  int32_t lanes[8];
+  memcpy(lanes, result.vector, sizeof(lanes));
+  for (size_t i = 0; i < 8; ++i) {
+    assert_int32(lanes[i], ==, 2147483598);
+  }
+  stack_allocator_destroy(&fixture.source.stack);
+  compile_source(&fixture, "f32x4 a = 1.5\nf32x4 b = a / 4 + a");
+  float values[4];
+  memcpy(values, run(&fixture).vector, sizeof(values));
+  for (size_t i = 0; i < 4; ++i) {
+    assert_float(values[i], ==, 1.875f);
+  }
+  stack_allocator_destroy(&fixture.source.stack);
+  return MUNIT_OK;
+}
+
+MunitResult jumps_form_loops(const MunitParameter params[],
+                             void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 12);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  // r0 = sum, r1 = i, r2 = n, r3 = 1, r4 = i < n
+  BytecodeFunction function = {.register_count = 5};
+  bytecode_load_constant(allocator, &function, 0, 0);
+  bytecode_load_constant(allocator, &function, 1, 0);
+  bytecode_load_constant(allocator, &function, 2, 100);
+  bytecode_load_constant(allocator, &function, 3, 1);
+  bytecode_emit(allocator, &function, AddIntBytecode, 0, 0, 1);
+  bytecode_emit(allocator, &function, AddIntBytecode, 1, 1, 3);
+  bytecode_emit(allocator, &function, LtSignedBytecode, 4, 1, 2);
+  bytecode_emit_wide(allocator, &function, JumpIfBytecode, 4, 4);
+  bytecode_emit(allocator, &function, ReturnBytecode, 0, 0, 0);
+  uint64_t registers[5];
+  assert_uint64(vm_run(&function, registers).value, ==, 4950);
+  assert_uint64(vm_run_switch(&function, registers).value, ==, 4950);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitResult dead_values_share_registers(const MunitParameter params[],
+                                       void *user_data_or_fixture) {
+  StackAllocator stack;
+  stack_allocator_init(&stack, 1 << 22);
+  Allocator allocator = {
+      .allocate = stack_allocate, .resize = stack_resize, .state = &stack};
+  TypeTable types;
+  type_table_init(&types, allocator);
+  // More values than registers can be numbered, but few live at once.
+  IrFunction chain = {.return_type = I64TypeId};
+  IrValue sum = ir_constant(allocator, &chain, I64TypeId, 0);
+  for (uint64_t i = 1; i <= 40000; ++i) {
+    IrValue term = ir_constant(allocator, &chain, I64TypeId, i);
+    sum = ir_binary(allocator, &chain, AddOp, I64TypeId, sum, term);
+  }
+  ir_return(allocator, &chain, sum);
+  BytecodeFunction bytecode = compile_bytecode(allocator, &chain, &types);
+  assert_false(bytecode.too_many_registers);
+  assert_uint32(bytecode.register_count, <=, 3);
+  uint64_t registers[3];
+  assert_uint64(vm_run(&bytecode, registers).value, ==, 40000ull * 40001 / 2);
+  // Every constant is live until the end.
+  IrFunction wide = {.return_type = I64TypeId};
+  IrValue first = ir_constant(allocator, &wide, I64TypeId, 0);
+  for (uint64_t i = 1; i < BYTECODE_NO_REGISTER; ++i) {
+    ir_constant(allocator, &wide, I64TypeId, i);
+  }
+  sum = first;
+  for (IrValue i = first + 1; i <= first + BYTECODE_NO_REGISTER - 1; ++i) {
+    sum = ir_binary(allocator, &wide, AddOp, I64TypeId, sum, i);
+  }
+  ir_return(allocator, &wide, sum);
+  bytecode = compile_bytecode(allocator, &wide, &types);
+  assert_true(bytecode.too_many_registers);
+  stack_allocator_destroy(&stack);
+  return MUNIT_OK;
+}
+
+MunitTest vm_tests[] = {
+    {
+        .name = "/integer_arithmetic",
+        .test = integer_arithmetic,
+    },
+    {
+        .name = "/float_arithmetic",
+        .test = float_arithmetic,
+    },
+    {
+        .name = "/division_traps",
+        .test = division_traps,
+    },
+    {
+        .name = "/vector_arithmetic",
+        .test = vector_arithmetic,
+    },
+    {
+        .name = "/jumps_form_loops",
+        .test = jumps_form_loops,
+    },
+    {
+        .name = "/dead_values_share_registers",
+        .test = dead_values_share_registers,
+    },
+    {}};
+
+MunitSuite vm_suite = {
+    .prefix = "/vm",
+    .tests = vm_tests,
+    .iterations = 1,
+};